@@ -0,0 +1,634 @@
+// 事件驱动的聊天引擎
+//
+// chat_server.c 是教学版：每个客户端一个分离线程，广播时拿着全局 mutex 对每个客户端阻塞 write，
+// 一个不收数据的客户端就能卡住所有广播和所有连接/断开，而且最多只有 MAX_CLNT 256 个客户端。这里是它的生产版本：
+//   - 单个 epoll reactor（边缘触发、非阻塞 socket），所有状态只被这一个线程访问，没有锁
+//   - 按行分帧：一次 recv 里所有完整的行合成一条消息，只存一份（引用计数的 struct msg），
+//     每个客户端的输出队列里放的只是指针
+//   - 广播只把消息挂到各个输出队列上，并把客户端放进 dirty 链表；一轮事件处理完之后，
+//     对每个 dirty 客户端调用一次 writev，一次把排队的多条消息都交给内核
+//   - 输出队列有上限（消息条数和字节数），超过之后按策略处理慢消费者：
+//       drop : 断开这个客户端（默认）
+//       shed : 丢掉队列里最旧的、还没开始发送的消息，客户端留着
+//   - -z 打开 MSG_ZEROCOPY：不小于阈值的消息不走 writev，而是对每个接收者零拷贝 send，
+//     内核直接引用消息所在的页，一份数据不再为每个接收者各复制一次；
+//     发完之后内核从 socket 的错误队列送回完成通知，在那之前消息的引用不能释放
+//
+// 用法: ./chat_engine [-p drop|shed] [-q max_queued_kb] [-z zerocopy_threshold_kb] [--buf-size=BYTES] <port>
+//       Ctrl-C 退出时打印统计
+//       选项由 ../getopt/bench_opts.h 解析：--buf-size 是 recv 缓冲区的大小（默认 64K）；-h 列出全部选项
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/uio.h>
+
+#include "bench_opts.h"
+
+#define MAX_EVENTS 1024
+#define RBUF_SIZE (64 * 1024)  // --buf-size 的默认值
+#define MAX_LINE 4096       // 这么长还没有换行，就当作一行直接广播
+#define OUTQ_MAX_MSGS 1024  // 每个客户端最多排队的消息条数，必须是 2 的幂
+#define WRITEV_IOVS 64      // 一次 writev 最多带多少条消息
+
+// 一条广播消息：所有客户端的输出队列共享同一份数据，最后一个发完的人释放
+struct msg {
+    unsigned refs;
+    size_t len;
+    char data[];
+};
+
+// 一次零拷贝 send 占用的序号，以及它引用的消息
+struct zc_pin {
+    uint32_t seq;
+    struct msg *m;
+};
+
+struct client {
+    int fd;
+    uint32_t events;  // 当前注册在 epoll 上的事件
+    // 输出队列：q[head & (cap - 1)] .. q[(tail - 1) & (cap - 1)]，cap 按需翻倍，不超过 OUTQ_MAX_MSGS
+    struct msg **q;
+    unsigned head, tail, cap;
+    size_t off;     // 队首消息已经发出去的字节数
+    size_t queued;  // 队列里还没发出去的字节数
+    char *partial;  // 上一次 recv 末尾不完整的那一行
+    size_t partial_len;
+    int dirty;      // 已经在 dirty 链表里，本轮结束时要 flush
+    // 还没收到完成通知的零拷贝 send，按序号递增排列：pins[pin_head & (pin_cap - 1)] ..
+    struct zc_pin *pins;
+    unsigned pin_head, pin_tail, pin_cap;
+    uint32_t zc_seq;  // 下一次零拷贝 send 的序号；内核对每次成功的 MSG_ZEROCOPY send 从 0 开始计数
+    struct client *prev, *next;  // 所有客户端
+    struct client *next_dirty;
+};
+
+enum policy { POLICY_DROP, POLICY_SHED };
+
+struct engine_stats {
+    unsigned long long accepted, closed, peak_clients;
+    unsigned long long msgs_in, bytes_in;
+    unsigned long long deliveries;  // 消息进入某个输出队列的次数
+    unsigned long long bytes_out, writevs;
+    unsigned long long dropped_clients, shed_msgs;
+    unsigned long long zc_sends, zc_completions;
+    unsigned long long zc_copied;     // 完成通知说内核最终还是复制了（例如回环、网卡不支持 scatter-gather）
+    unsigned long long zc_fallbacks;  // 未完成的通知太多（ENOBUFS），退回普通 send 的次数
+};
+
+struct engine {
+    int epfd;
+    int listen_fd;
+    int signal_fd;
+    enum policy policy;
+    size_t max_queued;
+    size_t zc_threshold;  // 0 表示不用 MSG_ZEROCOPY
+    char *rbuf;
+    size_t rbuf_size;
+    struct client *clients;
+    unsigned long long nclients;
+    struct client *dirty;
+    struct engine_stats stats;
+};
+
+// epoll_event.data.ptr 指向 client；监听 socket 和 signalfd 用这两个地址区分
+static char LISTEN_TAG, SIGNAL_TAG;
+
+void error_handling(const char *message);
+
+static struct msg *msg_new(const char *p1, size_t n1, const char *p2, size_t n2)
+{
+    struct msg *m = malloc(sizeof(*m) + n1 + n2);
+    if(!m) return NULL;
+    m->refs = 1;
+    m->len = n1 + n2;
+    if(n1) memcpy(m->data, p1, n1);
+    memcpy(m->data + n1, p2, n2);
+    return m;
+}
+
+static void msg_unref(struct msg *m)
+{
+    if(-- m->refs == 0) free(m);
+}
+
+static struct msg *q_at(const struct client *c, unsigned i) { return c->q[i & (c->cap - 1)]; }
+
+static int set_events(struct engine *e, struct client *c, uint32_t events)
+{
+    if(c->events == events) return 0;
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = c;
+    if(epoll_ctl(e->epfd, EPOLL_CTL_MOD, c->fd, &ev) == -1) return -1;
+    c->events = events;
+    return 0;
+}
+
+// 只是标记关闭：客户端可能还在 dirty 链表里，或者正在被广播遍历，真正释放在本轮末尾的 flush_dirty 里
+static void client_close(struct engine *e, struct client *c)
+{
+    if(c->fd == -1) return;
+    if(c->pin_head != c->pin_tail) {
+        // 关闭之后就收不到完成通知了，而这里马上要释放消息：
+        // 用 SO_LINGER 0 让 close 直接发 RST、丢掉发送缓冲区，内核不会再去读那些页上的内容
+        struct linger lg = {1, 0};
+        setsockopt(c->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        for(unsigned i = c->pin_head; i != c->pin_tail; i ++ ) msg_unref(c->pins[i & (c->pin_cap - 1)].m);
+        c->pin_head = c->pin_tail = 0;
+    }
+    close(c->fd);  // close 会自动把 fd 从 epoll 中移除
+    c->fd = -1;
+    for(unsigned i = c->head; i != c->tail; i ++ ) msg_unref(q_at(c, i));
+    c->head = c->tail = 0;
+    c->queued = 0;
+    e->nclients -- ;
+    e->stats.closed ++ ;
+    if(!c->dirty) {
+        c->dirty = 1;
+        c->next_dirty = e->dirty;
+        e->dirty = c;
+    }
+}
+
+static void client_free(struct engine *e, struct client *c)
+{
+    if(c->prev) c->prev->next = c->next;
+    else e->clients = c->next;
+    if(c->next) c->next->prev = c->prev;
+    free(c->q);
+    free(c->pins);
+    free(c->partial);
+    free(c);
+}
+
+// shed：从队首之后开始丢（队首可能已经发了一半，丢掉会让对端收到半行），直到放得下 need 字节、一条消息
+static int shed(struct engine *e, struct client *c, size_t need)
+{
+    unsigned keep = c->off > 0 ? 1 : 0;
+    while(c->tail - c->head > keep &&
+          (c->queued + need > e->max_queued || c->tail - c->head >= OUTQ_MAX_MSGS)) {
+        // 把第 keep 条丢掉，后面的往前挪一格，保持顺序
+        unsigned victim = c->head + keep;
+        struct msg *m = q_at(c, victim);
+        c->queued -= m->len;
+        msg_unref(m);
+        for(unsigned i = victim; i != c->head; i -- ) c->q[i & (c->cap - 1)] = q_at(c, i - 1);
+        c->head ++ ;
+        e->stats.shed_msgs ++ ;
+    }
+    return c->queued + need <= e->max_queued && c->tail - c->head < OUTQ_MAX_MSGS ? 0 : -1;
+}
+
+static int enqueue(struct engine *e, struct client *c, struct msg *m)
+{
+    if(c->queued + m->len > e->max_queued || c->tail - c->head >= OUTQ_MAX_MSGS) {
+        if(e->policy == POLICY_DROP || shed(e, c, m->len) == -1) {
+            e->stats.dropped_clients ++ ;
+            client_close(e, c);
+            return -1;
+        }
+    }
+    if(c->tail - c->head == c->cap) {
+        unsigned cap = c->cap ? c->cap * 2 : 8;
+        struct msg **q = malloc(cap * sizeof(*q));
+        if(!q) {
+            client_close(e, c);
+            return -1;
+        }
+        for(unsigned i = c->head; i != c->tail; i ++ ) q[i - c->head] = q_at(c, i);
+        free(c->q);
+        c->tail -= c->head;
+        c->head = 0;
+        c->q = q;
+        c->cap = cap;
+    }
+    m->refs ++ ;
+    c->q[c->tail & (c->cap - 1)] = m;
+    c->tail ++ ;
+    c->queued += m->len;
+    e->stats.deliveries ++ ;
+    if(!c->dirty) {
+        c->dirty = 1;
+        c->next_dirty = e->dirty;
+        e->dirty = c;
+    }
+    return 0;
+}
+
+static void broadcast(struct engine *e, struct msg *m)
+{
+    e->stats.msgs_in ++ ;
+    for(struct client *c = e->clients; c; c = c->next) {
+        if(c->fd != -1) enqueue(e, c, m);
+    }
+    msg_unref(m);  // 去掉创建时的那一份引用
+}
+
+// 队首开始的 sent 字节已经交给内核
+static void q_consume(struct client *c, size_t sent)
+{
+    c->queued -= sent;
+    while(sent > 0) {
+        struct msg *m = q_at(c, c->head);
+        size_t rest = m->len - c->off;
+        if(sent < rest) {
+            c->off += sent;
+            return;
+        }
+        sent -= rest;
+        c->off = 0;
+        c->head ++ ;
+        msg_unref(m);
+    }
+}
+
+// 先保证 pins 里有空位：send 成功之后序号已经用掉了，那时再分配失败就对不上号了
+static int pin_reserve(struct client *c)
+{
+    if(c->pin_tail - c->pin_head < c->pin_cap) return 0;
+    unsigned cap = c->pin_cap ? c->pin_cap * 2 : 8;
+    struct zc_pin *pins = malloc(cap * sizeof(*pins));
+    if(!pins) return -1;
+    for(unsigned i = c->pin_head; i != c->pin_tail; i ++ ) pins[i - c->pin_head] = c->pins[i & (c->pin_cap - 1)];
+    free(c->pins);
+    c->pin_tail -= c->pin_head;
+    c->pin_head = 0;
+    c->pins = pins;
+    c->pin_cap = cap;
+    return 0;
+}
+
+// 零拷贝发送队首消息（剩下的部分）；成功时消息多一份引用，直到完成通知到达
+static ssize_t send_zc(struct engine *e, struct client *c, size_t *want)
+{
+    struct msg *m = q_at(c, c->head);
+    const char *p = m->data + c->off;
+    size_t n = m->len - c->off;
+    *want = n;
+    if(pin_reserve(c) == -1) {
+        errno = ENOMEM;
+        return -1;
+    }
+    ssize_t sent = send(c->fd, p, n, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if(sent < 0 && errno == ENOBUFS) {
+        e->stats.zc_fallbacks ++ ;
+        return send(c->fd, p, n, MSG_NOSIGNAL);
+    }
+    if(sent > 0) {
+        m->refs ++ ;
+        c->pins[c->pin_tail & (c->pin_cap - 1)] = (struct zc_pin){c->zc_seq ++, m};
+        c->pin_tail ++ ;
+        e->stats.zc_sends ++ ;
+    }
+    return sent;
+}
+
+// 把连续的小消息（直到下一条要零拷贝的大消息为止）合成一次 writev
+static ssize_t send_gather(struct engine *e, struct client *c, size_t *want)
+{
+    struct iovec iov[WRITEV_IOVS];
+    int n = 0;
+    *want = 0;
+    for(unsigned i = c->head; i != c->tail && n < WRITEV_IOVS; i ++, n ++ ) {
+        struct msg *m = q_at(c, i);
+        if(i != c->head && e->zc_threshold && m->len >= e->zc_threshold) break;
+        size_t skip = i == c->head ? c->off : 0;
+        iov[n].iov_base = m->data + skip;
+        iov[n].iov_len = m->len - skip;
+        *want += iov[n].iov_len;
+    }
+    e->stats.writevs ++ ;
+    return writev(c->fd, iov, n);
+}
+
+// 把队列尽量发完；发不完时注册 EPOLLOUT，发完了就取消
+static int client_flush(struct engine *e, struct client *c)
+{
+    while(c->head != c->tail) {
+        size_t want;
+        int zc = e->zc_threshold && q_at(c, c->head)->len >= e->zc_threshold;
+        ssize_t sent = zc ? send_zc(e, c, &want) : send_gather(e, c, &want);
+        if(sent < 0) {
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        e->stats.bytes_out += sent;
+        q_consume(c, sent);
+        if((size_t)sent < want) break;  // 内核缓冲区满了
+    }
+    uint32_t events = EPOLLIN | EPOLLRDHUP | EPOLLET | (c->head != c->tail ? EPOLLOUT : 0);
+    return set_events(e, c, events);
+}
+
+// 读完错误队列里的零拷贝完成通知：[ee_info, ee_data] 这一段序号的数据内核已经不再引用
+static int drain_errqueue(struct engine *e, struct client *c)
+{
+    while(1) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if(recvmsg(c->fd, &msg, MSG_ERRQUEUE) == -1) {
+            if(errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        for(struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if(cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR) continue;
+            struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if(serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) return -1;  // 真正的 socket 错误
+            uint32_t lo = serr->ee_info, hi = serr->ee_data;
+            e->stats.zc_completions += hi - lo + 1;
+            if(serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) e->stats.zc_copied += hi - lo + 1;
+            // TCP 的通知按序到达；int32_t 的差值处理序号回绕
+            while(c->pin_head != c->pin_tail && (int32_t)(c->pins[c->pin_head & (c->pin_cap - 1)].seq - hi) <= 0) {
+                msg_unref(c->pins[c->pin_head & (c->pin_cap - 1)].m);
+                c->pin_head ++ ;
+            }
+        }
+    }
+}
+
+// 把一次 recv 的数据按行切开：完整的行合成一条消息广播，末尾不完整的行留到下次
+static int on_data(struct engine *e, struct client *c, const char *p, size_t n)
+{
+    e->stats.bytes_in += n;
+    const char *last_nl = memrchr(p, '\n', n);
+    if(!last_nl) {
+        if(c->partial_len + n < MAX_LINE) {
+            char *partial = realloc(c->partial, c->partial_len + n);
+            if(!partial) return -1;
+            memcpy(partial + c->partial_len, p, n);
+            c->partial = partial;
+            c->partial_len += n;
+            return 0;
+        }
+        last_nl = p + n - 1;  // 太长了，整段当作一行
+    }
+    size_t whole = last_nl - p + 1;
+    struct msg *m = msg_new(c->partial, c->partial_len, p, whole);
+    if(!m) return -1;
+    free(c->partial);
+    c->partial = NULL;
+    c->partial_len = 0;
+    if(whole < n) {
+        c->partial = malloc(n - whole);
+        if(!c->partial) {
+            msg_unref(m);
+            return -1;
+        }
+        memcpy(c->partial, p + whole, n - whole);
+        c->partial_len = n - whole;
+    }
+    broadcast(e, m);
+    return 0;
+}
+
+// revents 带 EPOLLRDHUP 时对端已经关闭写方向：最后一行和 FIN 可能在同一个边缘里到达，
+// 必须一直读到 0（EOF）才能关闭连接，不能用“读不满就是读空了”的捷径，否则之后再也不会有事件
+static void on_readable(struct engine *e, struct client *c, uint32_t revents)
+{
+    int peer_closed = (revents & (EPOLLRDHUP | EPOLLHUP)) != 0;
+    while(c->fd != -1) {
+        ssize_t n = recv(c->fd, e->rbuf, e->rbuf_size, 0);
+        if(n > 0) {
+            // 广播可能因为 drop 策略把发送者自己也断开了，循环条件会检查
+            if(on_data(e, c, e->rbuf, n) == -1) client_close(e, c);
+            if((size_t)n < e->rbuf_size && !peer_closed) return;  // 对流式 socket，读到的比要的少说明已经读空了
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        client_close(e, c);  // n == 0 对端关闭，或者出错
+    }
+}
+
+static void on_accept(struct engine *e)
+{
+    while(1) {
+        int fd = accept4(e->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd == -1) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            if(errno == EMFILE || errno == ENFILE) perror("accept4() error");
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if(e->zc_threshold && setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == -1) {
+            perror("setsockopt(SO_ZEROCOPY) error, zerocopy disabled");
+            e->zc_threshold = 0;
+        }
+
+        struct client *c = calloc(1, sizeof(*c));
+        if(!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        struct epoll_event ev;
+        ev.events = c->events;
+        ev.data.ptr = c;
+        if(epoll_ctl(e->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->next = e->clients;
+        if(e->clients) e->clients->prev = c;
+        e->clients = c;
+        e->stats.accepted ++ ;
+        if(++ e->nclients > e->stats.peak_clients) e->stats.peak_clients = e->nclients;
+    }
+}
+
+// 本轮的广播都排好队之后，每个 dirty 客户端 flush 一次；已关闭的在这里释放
+static void flush_dirty(struct engine *e)
+{
+    struct client *c = e->dirty;
+    e->dirty = NULL;
+    while(c) {
+        struct client *next = c->next_dirty;
+        // c->dirty 保持为 1，client_close 就不会把它再挂回链表
+        if(c->fd != -1 && client_flush(e, c) == -1) client_close(e, c);
+        c->dirty = 0;
+        if(c->fd == -1) client_free(e, c);
+        c = next;
+    }
+}
+
+static int create_listener(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd == -1) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 几万个连接需要几万个 fd：把软限制提到硬限制
+static void raise_nofile(void)
+{
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0) printf("fd limit: %llu\n", (unsigned long long)rl.rlim_cur);
+}
+
+static const struct bench_extra engine_opts[] = {
+    {"policy", 'p', required_argument, 'p', "drop|shed", "slow consumer policy (default drop)"},
+    {"max-queued", 'q', required_argument, 'q', "KB", "output queue limit per client (default 256)"},
+    {"zerocopy", 'z', required_argument, 'z', "KB", "MSG_ZEROCOPY threshold, 0 disables it (default 0)"},
+    {NULL, 0, 0, 0, NULL, NULL},
+};
+
+static int on_option(int id, const char *arg, void *ctx)
+{
+    struct engine *e = ctx;
+    long v;
+    if(id == 'p') {
+        if(strcmp(arg, "drop") == 0) e->policy = POLICY_DROP;
+        else if(strcmp(arg, "shed") == 0) e->policy = POLICY_SHED;
+        else return -1;
+        return 0;
+    }
+    if(bench_parse_long(arg, id == 'q' ? 1 : 0, &v) == -1 || v > 1L << 30) return -1;
+    switch(id) {
+        case 'q': e->max_queued = (size_t)v * 1024; return 0;
+        case 'z': e->zc_threshold = (size_t)v * 1024; return 0;
+        default: return -1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct engine e;
+    memset(&e, 0, sizeof(e));
+    e.policy = POLICY_DROP;
+    e.max_queued = 256 * 1024;
+    struct bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_BUF_SIZE, "<port>");
+    bench_list_set(&o.buf_size, RBUF_SIZE);
+    int idx = bench_opts_parse(&o, argc, argv, engine_opts, on_option, &e);
+    if(idx <= 0) return idx < 0;
+    if(idx + 1 != argc || o.buf_size.v[0] > 1L << 30) {
+        bench_opts_usage(stderr, argv[0], &o, engine_opts);
+        return 1;
+    }
+    e.rbuf_size = (size_t)o.buf_size.v[0];
+
+    raise_nofile();
+    signal(SIGPIPE, SIG_IGN);
+    // 信号也走 epoll：退出时不会打断到一半的处理
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+
+    e.listen_fd = create_listener(atoi(argv[idx]));
+    e.signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    e.epfd = epoll_create1(EPOLL_CLOEXEC);
+    e.rbuf = malloc(e.rbuf_size);
+    if(e.listen_fd == -1 || e.signal_fd == -1 || e.epfd == -1 || !e.rbuf) error_handling("init error");
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &LISTEN_TAG;
+    if(epoll_ctl(e.epfd, EPOLL_CTL_ADD, e.listen_fd, &ev) == -1) error_handling("epoll_ctl() error");
+    ev.events = EPOLLIN;
+    ev.data.ptr = &SIGNAL_TAG;
+    if(epoll_ctl(e.epfd, EPOLL_CTL_ADD, e.signal_fd, &ev) == -1) error_handling("epoll_ctl() error");
+    printf("chat engine listening on port %s (policy=%s, max_queued=%zuKB, zerocopy=%zuKB)\n", argv[idx],
+           e.policy == POLICY_DROP ? "drop" : "shed", e.max_queued / 1024, e.zc_threshold / 1024);
+
+    struct epoll_event events[MAX_EVENTS];
+    int stop = 0;
+    while(!stop) {
+        int n = epoll_wait(e.epfd, events, MAX_EVENTS, -1);
+        if(n == -1) {
+            if(errno == EINTR) continue;
+            perror("epoll_wait() error");
+            break;
+        }
+        for(int i = 0; i < n; i ++ ) {
+            void *tag = events[i].data.ptr;
+            if(tag == &LISTEN_TAG) {
+                on_accept(&e);
+                continue;
+            }
+            if(tag == &SIGNAL_TAG) {
+                stop = 1;
+                continue;
+            }
+            struct client *c = tag;
+            if(c->fd == -1) continue;  // 本轮早些时候已经被关闭（例如被 drop）
+            uint32_t revents = events[i].events;
+            // 零拷贝的完成通知也是以 EPOLLERR 报告的：先读错误队列，读到真正的错误才关闭
+            if((revents & EPOLLERR) && (!e.zc_threshold || drain_errqueue(&e, c) == -1)) {
+                client_close(&e, c);
+                continue;
+            }
+            if(revents & EPOLLHUP) {
+                client_close(&e, c);
+                continue;
+            }
+            if((revents & EPOLLOUT) && client_flush(&e, c) == -1) client_close(&e, c);
+            if(c->fd != -1 && (revents & (EPOLLIN | EPOLLRDHUP))) on_readable(&e, c, revents);
+        }
+        flush_dirty(&e);
+    }
+
+    for(struct client *c = e.clients, *next; c; c = next) {
+        next = c->next;
+        client_close(&e, c);
+        free(c->q);
+        free(c->pins);
+        free(c->partial);
+        free(c);
+    }
+    struct engine_stats *s = &e.stats;
+    printf("accepted=%llu closed=%llu peak_clients=%llu\n", s->accepted, s->closed, s->peak_clients);
+    printf("msgs_in=%llu bytes_in=%llu deliveries=%llu bytes_out=%llu writevs=%llu\n",
+           s->msgs_in, s->bytes_in, s->deliveries, s->bytes_out, s->writevs);
+    printf("dropped_clients=%llu shed_msgs=%llu\n", s->dropped_clients, s->shed_msgs);
+    printf("zc_sends=%llu zc_completions=%llu zc_copied=%llu zc_fallbacks=%llu\n",
+           s->zc_sends, s->zc_completions, s->zc_copied, s->zc_fallbacks);
+    close(e.listen_fd);
+    close(e.signal_fd);
+    close(e.epfd);
+    free(e.rbuf);
+    return 0;
+}
+
+void error_handling(const char *message)
+{
+    perror(message);
+    exit(1);
+}
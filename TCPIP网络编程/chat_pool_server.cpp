@@ -0,0 +1,523 @@
+// 反应器 + v4 线程池的聊天服务器
+//
+// chat_server.c 每接受一个客户端就 pthread_create 一个分离线程，阻塞在 read() 上；这里换成：
+//   - 一个 reactor 线程（epoll 边缘触发、非阻塞 socket）负责所有 socket 读写和按行分帧
+//   - 解码出来的每条消息放进这个连接的无锁邮箱（Mailbox，Vyukov 的 MPSC 链表队列），
+//     邮箱从空闲变成非空时才向 v4 ThreadPool 提交一个 drain 任务；
+//     一轮事件循环里新产生的 drain 任务攒起来，用一次 add_batch_task 提交（只有一个时用 add_task）
+//   - 每个连接同一时刻最多只有一个 drain 任务（scheduled 标志），所以同一个客户端的消息严格按顺序处理，
+//     连接上的应用状态（昵称）也只会被一个线程访问，不需要锁
+//   - drain 任务处理消息（"/nick 名字" 改昵称，其它行加上昵称前缀后广播），
+//     广播内容只生成一份（shared_ptr<const std::string>），放进 reactor 的发件箱（同样是 Mailbox），
+//     再通过 eventfd 叫醒 reactor；reactor 把它挂到每个连接的输出队列上，用 writev 发送
+//   - 输出队列超过 kMaxQueued 字节的慢客户端直接断开
+//
+// 用法: ./chat_pool_server [-t max_workers] <port>
+//       Ctrl-C 退出时打印统计；选项由 ../getopt/bench_opts.h 解析，-t 就是 --threads
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bench_opts.h"
+#include "v4.hpp"
+
+// 无锁的多生产者单消费者队列（Dmitry Vyukov 的侵入式 MPSC 队列）
+//   - push 是 wait-free 的：一次 exchange 加一次 store，任何线程都可以调用
+//   - pop / empty 只能由一个消费者调用
+//   - 生产者在 exchange 和 store 之间被打断时，消费者会暂时看不到这个元素（pop 返回空，但 empty() 为 false），
+//     调用方需要稍后重试
+template<typename T>
+class Mailbox {
+public:
+    Mailbox() : head_(&stub_), tail_(&stub_) {}
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    ~Mailbox() {
+        while(pop()) {}
+    }
+
+    void push(T value) {
+        push_node(new Node(std::move(value)));
+    }
+
+    std::optional<T> pop() {
+        NodeBase* tail = tail_;
+        NodeBase* next = tail->next.load(std::memory_order_acquire);
+        if(tail == &stub_) {
+            if(!next) return std::nullopt;
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if(next) {
+            tail_ = next;
+            return take(tail);
+        }
+        // tail 是最后一个元素：把 stub 接到后面，才能取出 tail 而不让队列变成空链
+        if(tail != head_.load(std::memory_order_acquire)) return std::nullopt;  // 有生产者正在 push
+        push_node(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if(next) {
+            tail_ = next;
+            return take(tail);
+        }
+        return std::nullopt;
+    }
+
+    bool empty() const {
+        return tail_ == &stub_ && head_.load(std::memory_order_acquire) == &stub_;
+    }
+
+private:
+    struct NodeBase {
+        std::atomic<NodeBase*> next{nullptr};
+    };
+    struct Node : NodeBase {
+        explicit Node(T v) : value(std::move(v)) {}
+        T value;
+    };
+
+    void push_node(NodeBase* n) {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        NodeBase* prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    static std::optional<T> take(NodeBase* n) {
+        Node* node = static_cast<Node*>(n);
+        std::optional<T> v(std::move(node->value));
+        delete node;
+        return v;
+    }
+
+    std::atomic<NodeBase*> head_;  // 生产者端
+    alignas(64) NodeBase* tail_;   // 消费者端，单独占一个缓存行
+    NodeBase stub_;
+};
+
+using Payload = std::shared_ptr<const std::string>;
+
+struct Conn {
+    explicit Conn(int fd_) : fd(fd_), nick("user" + std::to_string(fd_)) {}
+
+    int fd;
+
+    // 只由 reactor 访问
+    std::string partial;      // 还没遇到 '\n' 的半行
+    std::deque<Payload> out;  // 输出队列，广播的每条消息所有连接共享一份
+    size_t out_off = 0;       // 队首已经发出去的字节数
+    size_t out_bytes = 0;     // 队列里还没发出去的字节数
+    uint32_t events = 0;
+    bool closed = false;
+
+    // reactor 生产、drain 任务消费；scheduled 为 true 时已经有一个 drain 任务在排队或执行
+    Mailbox<std::string> inbox;
+    std::atomic<bool> scheduled{false};
+
+    // 只由 drain 任务访问（同一时刻最多一个，前后两个 drain 任务通过 scheduled 的 release / acquire 同步）
+    std::string nick;
+};
+
+struct Stats {
+    unsigned long long accepted = 0, closed = 0, dropped = 0;
+    unsigned long long msgs_in = 0, broadcasts = 0, bytes_out = 0, writevs = 0;
+    unsigned long long drain_tasks = 0, batch_calls = 0;
+};
+
+class ChatServer {
+public:
+    static constexpr size_t kMaxLine = 4096;           // 这么长还没有换行就截断成一行
+    static constexpr size_t kMaxQueued = 1024 * 1024;  // 每个连接的输出队列上限，超过就断开
+    static constexpr int kDrainBudget = 64;            // 一个 drain 任务最多连续处理几条，之后重新排队，给其它连接让路
+
+    ChatServer(int listen_fd, int signal_fd, int max_workers)
+        : listen_fd_(listen_fd), signal_fd_(signal_fd), pool_(1, max_workers) {
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(epfd_ == -1 || wake_fd_ == -1) {
+            perror("init error");
+            exit(1);
+        }
+        watch(listen_fd_, EPOLLIN | EPOLLET, &kListenTag);
+        watch(signal_fd_, EPOLLIN, &kSignalTag);
+        watch(wake_fd_, EPOLLIN | EPOLLET, &kWakeTag);
+    }
+
+    ~ChatServer() {
+        close(epfd_);
+        close(wake_fd_);
+    }
+
+    void run() {
+        std::vector<epoll_event> events(1024);
+        bool stop = false;
+        while(!stop) {
+            int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), -1);
+            if(n == -1) {
+                if(errno == EINTR) continue;
+                perror("epoll_wait() error");
+                break;
+            }
+            for(int i = 0; i < n; i ++ ) {
+                void* tag = events[i].data.ptr;
+                if(tag == &kListenTag) on_accept();
+                else if(tag == &kSignalTag) stop = true;
+                else if(tag == &kWakeTag) on_wake();
+                else on_conn_event(static_cast<Conn*>(tag), events[i].events);
+            }
+            submit_drains();
+            flush_dirty();
+        }
+        // 等线程池里的任务都跑完（它们持有 shared_ptr，连接对象不会提前释放），再关掉所有连接
+        pool_.stop();
+        for(auto& [fd, c] : conns_) close(fd);
+        stats_.broadcasts = broadcasts_.load(std::memory_order_relaxed);
+        stats_.drain_tasks = drain_tasks_.load(std::memory_order_relaxed);
+        conns_.clear();
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    // 只是为了区分 epoll 事件来源的地址
+    static inline char kListenTag, kSignalTag, kWakeTag;
+
+    void watch(int fd, uint32_t events, void* tag) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.ptr = tag;
+        if(epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            perror("epoll_ctl() error");
+            exit(1);
+        }
+    }
+
+    // ---- reactor 线程 ----
+
+    void on_accept() {
+        while(true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if(fd == -1) {
+                if(errno == EINTR || errno == ECONNABORTED) continue;
+                return;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto c = std::make_shared<Conn>(fd);
+            c->events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+            watch(fd, c->events, c.get());
+            conns_.emplace(fd, std::move(c));
+            stats_.accepted ++ ;
+        }
+    }
+
+    void on_conn_event(Conn* c, uint32_t events) {
+        if(c->closed) return;  // 本轮早些时候已经被关闭
+        if(events & (EPOLLERR | EPOLLHUP)) {
+            close_conn(c);
+            return;
+        }
+        if((events & EPOLLOUT) && !flush(c)) {
+            close_conn(c);
+            return;
+        }
+        if(events & (EPOLLIN | EPOLLRDHUP)) on_readable(c, events);
+    }
+
+    void on_readable(Conn* c, uint32_t events) {
+        char buf[64 * 1024];
+        // 对端已经关闭写端时 FIN 可能和最后一段数据一起到达，边沿触发下不会再有事件，必须读到 0 为止
+        const bool peer_closed = events & (EPOLLRDHUP | EPOLLHUP);
+        while(!c->closed) {
+            ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+            if(n > 0) {
+                decode(c, buf, static_cast<size_t>(n));
+                if(static_cast<size_t>(n) < sizeof(buf) && !peer_closed) return;
+                continue;
+            }
+            if(n < 0 && errno == EINTR) continue;
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            close_conn(c);  // n == 0 对端关闭，或者出错
+        }
+    }
+
+    // 按行切开，每一行是一条消息；邮箱从空闲变为有活时登记一个 drain 任务
+    void decode(Conn* c, const char* p, size_t n) {
+        bool pushed = false;
+        for(size_t i = 0; i < n; i ++ ) {
+            if(p[i] != '\n') {
+                c->partial.push_back(p[i]);
+                if(c->partial.size() < kMaxLine) continue;
+            }
+            if(!c->partial.empty() && c->partial.back() == '\r') c->partial.pop_back();
+            c->inbox.push(std::move(c->partial));
+            c->partial.clear();
+            stats_.msgs_in ++ ;
+            pushed = true;
+        }
+        if(pushed && !c->scheduled.exchange(true, std::memory_order_acq_rel)) {
+            pending_.push_back(conns_.at(c->fd));
+        }
+    }
+
+    // 一轮事件处理完后统一提交：多个连接的 drain 任务一次 add_batch_task，只加一次锁、按需唤醒线程
+    void submit_drains() {
+        if(pending_.empty()) return;
+        if(pending_.size() == 1) {
+            pool_.add_task([this, c = std::move(pending_.front())] { drain(c); });
+        }
+        else {
+            std::vector<std::function<void()>> tasks;
+            tasks.reserve(pending_.size());
+            for(auto& c : pending_) tasks.emplace_back([this, c = std::move(c)] { drain(c); });
+            pool_.add_batch_task(std::move(tasks));
+        }
+        stats_.batch_calls ++ ;
+        pending_.clear();
+    }
+
+    // 发件箱里的广播挂到每个连接的输出队列上
+    void on_wake() {
+        uint64_t v;
+        while(read(wake_fd_, &v, sizeof(v)) > 0) {}
+        // 先清标志再取：之后再来的广播一定会重新写 eventfd；exchange 与生产者的 exchange 同步
+        wake_pending_.exchange(false, std::memory_order_acq_rel);
+        while(true) {
+            auto msg = outbox_.pop();
+            if(!msg) {
+                if(outbox_.empty()) break;
+                std::this_thread::yield();  // 某个 worker 正在 push 的中间，稍等它完成
+                continue;
+            }
+            // enqueue 可能把慢客户端关掉、从 conns_ 里删掉，先把迭代器移到下一个再处理当前的
+            for(auto it = conns_.begin(); it != conns_.end(); ) enqueue((it ++ )->second.get(), *msg);
+        }
+    }
+
+    void enqueue(Conn* c, const Payload& msg) {
+        if(c->closed) return;
+        if(c->out_bytes + msg->size() > kMaxQueued) {
+            stats_.dropped ++ ;
+            close_conn(c);
+            return;
+        }
+        c->out.push_back(msg);
+        c->out_bytes += msg->size();
+        if(c->out.size() == 1) dirty_.push_back(c);
+    }
+
+    void flush_dirty() {
+        for(Conn* c : dirty_) {
+            if(!c->closed && !flush(c)) close_conn(c);
+        }
+        dirty_.clear();
+        // 关闭的连接在这一轮的事件和 dirty 都处理完之后才释放
+        closed_.clear();
+    }
+
+    // 返回 false 表示出错
+    bool flush(Conn* c) {
+        while(!c->out.empty()) {
+            iovec iov[64];
+            int n = 0;
+            size_t want = 0;
+            for(auto it = c->out.begin(); it != c->out.end() && n < 64; ++ it, ++ n) {
+                size_t skip = n == 0 ? c->out_off : 0;
+                iov[n].iov_base = const_cast<char*>((*it)->data()) + skip;
+                iov[n].iov_len = (*it)->size() - skip;
+                want += iov[n].iov_len;
+            }
+            ssize_t sent = writev(c->fd, iov, n);
+            stats_.writevs ++ ;
+            if(sent < 0) {
+                if(errno == EINTR) continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+            stats_.bytes_out += sent;
+            c->out_bytes -= sent;
+            size_t left = static_cast<size_t>(sent);
+            while(left > 0) {
+                size_t rest = c->out.front()->size() - c->out_off;
+                if(left < rest) {
+                    c->out_off += left;
+                    break;
+                }
+                left -= rest;
+                c->out_off = 0;
+                c->out.pop_front();
+            }
+            if(static_cast<size_t>(sent) < want) break;
+        }
+        uint32_t events = EPOLLIN | EPOLLRDHUP | EPOLLET | (c->out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+        if(events != c->events) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.ptr = c;
+            if(epoll_ctl(epfd_, EPOLL_CTL_MOD, c->fd, &ev) == -1) return false;
+            c->events = events;
+        }
+        return true;
+    }
+
+    // 先把连接从 conns_ 里摘下来再 close：同一轮里 accept4 可能马上拿回同一个 fd 号，
+    // 新连接要能以这个 fd 登记进 conns_；旧的 Conn 放在 closed_ 里保活到这一轮结束，
+    // 因为本轮的 epoll 事件数组、dirty_ 里可能还有指向它的指针
+    void close_conn(Conn* c) {
+        if(c->closed) return;
+        c->closed = true;
+        auto it = conns_.find(c->fd);
+        closed_.push_back(std::move(it->second));
+        conns_.erase(it);
+        close(c->fd);
+        c->out.clear();
+        stats_.closed ++ ;
+    }
+
+    // ---- 线程池里的 drain 任务 ----
+
+    void drain(const std::shared_ptr<Conn>& c) {
+        drain_tasks_.fetch_add(1, std::memory_order_relaxed);
+        for(;;) {
+            for(int budget = kDrainBudget; budget > 0; ) {
+                auto msg = c->inbox.pop();
+                if(msg) {
+                    handle(*c, *msg);
+                    budget -- ;
+                    continue;
+                }
+                if(!c->inbox.empty()) {
+                    std::this_thread::yield();  // reactor 正在 push 的中间
+                    continue;
+                }
+                // 看起来空了：先放下 scheduled，再检查一次，避免和 reactor 的 push 互相错过。
+                // 放下必须是 RMW：单纯的 store 之后再 load inbox 是 store→load，可能被重排到 reactor 的
+                // push + exchange(true) 两边，结果双方都以为对方会处理，消息就留在邮箱里没人管了
+                c->scheduled.exchange(false, std::memory_order_seq_cst);
+                if(c->inbox.empty() || c->scheduled.exchange(true, std::memory_order_acq_rel)) return;
+            }
+            // 额度用完还没处理完：继续占着 scheduled，重新排到队尾。
+            // 线程池已经 stop() 时 add_task 会抛异常，而 worker 里抛出去就是 std::terminate，
+            // 所以用 try_add_task，提交不了就留在当前线程接着处理完
+            if(pool_.try_add_task([this, c] { drain(c); })) return;
+        }
+    }
+
+    void handle(Conn& c, const std::string& line) {
+        if(line.rfind("/nick ", 0) == 0 && line.size() > 6) {
+            std::string old = std::exchange(c.nick, line.substr(6));
+            publish(std::make_shared<const std::string>("* " + old + " is now known as " + c.nick + "\n"));
+            return;
+        }
+        publish(std::make_shared<const std::string>("[" + c.nick + "] " + line + "\n"));
+    }
+
+    void publish(Payload msg) {
+        outbox_.push(std::move(msg));
+        broadcasts_.fetch_add(1, std::memory_order_relaxed);
+        if(!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+            uint64_t one = 1;
+            // eventfd 计数器只会在溢出时写失败，这里不可能
+            if(write(wake_fd_, &one, sizeof(one)) != sizeof(one)) perror("write(eventfd)");
+        }
+    }
+
+    int listen_fd_, signal_fd_, epfd_, wake_fd_;
+    std::unordered_map<int, std::shared_ptr<Conn>> conns_;
+    std::vector<std::shared_ptr<Conn>> pending_;  // 本轮要提交 drain 任务的连接
+    std::vector<Conn*> dirty_;                    // 本轮输出队列从空变为非空的连接
+    std::vector<std::shared_ptr<Conn>> closed_;   // 本轮关闭的连接，已经不在 conns_ 里
+    Mailbox<Payload> outbox_;                     // drain 任务生产、reactor 消费
+    std::atomic<bool> wake_pending_{false};       // 已经写过 eventfd、reactor 还没处理
+    std::atomic<unsigned long long> broadcasts_{0}, drain_tasks_{0};
+    Stats stats_;
+    ThreadPool pool_;  // 最后一个成员：析构时最先 stop()，任务里用到的其它成员此时都还在
+};
+
+static int create_listener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd == -1) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static const bench_extra kExtra[] = {
+    {nullptr, 't', required_argument, BENCH_ID_THREADS, "N", "same as --threads (default: CPU count)"},
+    {nullptr, 0, 0, 0, nullptr, nullptr},
+};
+
+int main(int argc, char** argv) {
+    bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_THREADS, "<port>");
+    bench_list_set(&o.threads, std::max(1u, std::thread::hardware_concurrency()));
+    int idx = bench_opts_parse(&o, argc, argv, kExtra, nullptr, nullptr);
+    if(idx <= 0) return idx < 0;
+    int workers = static_cast<int>(o.threads.v[0]);
+    if(idx + 1 != argc || workers <= 0) {
+        bench_opts_usage(stderr, argv[0], &o, kExtra);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    // 先屏蔽信号再创建线程池，worker 线程继承屏蔽字，SIGINT 只会通过 signalfd 交给 reactor
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    int listen_fd = create_listener(atoi(argv[idx]));
+    int signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(listen_fd == -1 || signal_fd == -1) {
+        perror("init error");
+        return 1;
+    }
+
+    Stats s;
+    {
+        ChatServer server(listen_fd, signal_fd, workers);
+        printf("chat pool server listening on port %s (max_workers=%d)\n", argv[idx], workers);
+        fflush(stdout);
+        server.run();
+        s = server.stats();
+    }
+    printf("accepted=%llu closed=%llu dropped=%llu\n", s.accepted, s.closed, s.dropped);
+    printf("msgs_in=%llu broadcasts=%llu drain_tasks=%llu batch_calls=%llu bytes_out=%llu writevs=%llu\n",
+           s.msgs_in, s.broadcasts, s.drain_tasks, s.batch_calls, s.bytes_out, s.writevs);
+    close(listen_fd);
+    close(signal_fd);
+    return 0;
+}
@@ -0,0 +1,360 @@
+// echo server 的压测客户端：多连接、流水线请求、RTT 直方图
+//
+// client.c 一次只有一个请求在路上（fgets -> fputs -> fflush -> fgets），既打不满服务器，也测不出什么。这里：
+//   - -c 个非阻塞连接平均分给 -t 个线程，每个线程一个 epoll（边缘触发），线程之间不共享任何东西
+//   - 每个连接始终保持 -p 个固定大小（-s 字节）的请求在路上：收回一个完整的回显就立刻补发一个，
+//     同一时刻能补的请求合成一次 send
+//   - echo 按顺序回送，所以第 k 个 s 字节的回显就是第 k 个请求的应答，用它出队的发送时间算 RTT
+//   - RTT 记在对数-线性的直方图里（每个 2 的幂区间分 16 格，相对误差约 6%），结束时各线程合并
+//   - 先跑 -w 秒预热（连接建立、服务器缓存变热），只统计之后 -d 秒内完成的请求
+//
+// 用法: ./echo_bench [-c conns] [-p depth] [-s size] [-t threads] [-d seconds] [-w warmup] [-j] <IP> <Port>
+//       -j 额外输出一行 JSON，方便脚本收集
+//       选项由 ../getopt/bench_opts.h 解析：-t 就是 --threads，-d 就是 --duration（也可以写 500ms），
+//       --buf-size 是每个线程 recv 缓冲区的大小（默认 256K）；-h 列出全部选项
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "bench_opts.h"
+
+#define MAX_EVENTS 256
+#define RBUF_SIZE (256 * 1024)  // --buf-size 的默认值
+#define SUB_BUCKETS 16  // 每个 2 的幂区间的格数
+#define HIST_BUCKETS (64 * SUB_BUCKETS)
+
+struct hist {
+    unsigned long long count[HIST_BUCKETS];
+    unsigned long long total, max;
+};
+
+struct bconn {
+    int fd;
+    uint64_t *sent_at;     // 在路上的请求的发送时间，环形队列，容量 depth
+    unsigned head, tail;   // tail - head 是在路上的请求数
+    size_t to_send;        // 已经计入在路上、但还没写进 socket 的字节数
+    size_t in_bytes;       // 当前这个应答已经收到的字节数
+};
+
+struct bench {
+    struct sockaddr_in addr;
+    int conns, depth, size, threads;
+    size_t rbuf_size;                        // 每个线程的 recv 缓冲区
+    uint64_t start_ns, measure_ns, end_ns;  // 开始、开始统计、结束的时刻
+};
+
+struct worker {
+    struct bench *b;
+    int id, nconns;
+    pthread_t tid;
+    struct bconn *conns;
+    struct hist hist;
+    unsigned long long completed;  // 统计窗口内完成的请求
+    unsigned long long errors;
+};
+
+static char *g_payload;  // 所有连接共用的请求内容，depth * size 字节
+
+void error_handling(const char *message);
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// v < 16 时直接落在第 0 个区间；否则按最高位 msb 分区间，区间内再按 msb 之后的 4 位分格
+static int hist_index(uint64_t v)
+{
+    if(v < SUB_BUCKETS) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - 4;
+    return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+}
+
+// 格子的下界；报告时取格子中点
+static uint64_t hist_lower(int i)
+{
+    if(i < SUB_BUCKETS) return i;
+    int shift = i / SUB_BUCKETS - 1;
+    return ((uint64_t)(SUB_BUCKETS + i % SUB_BUCKETS)) << shift;
+}
+
+static void hist_add(struct hist *h, uint64_t v)
+{
+    h->count[hist_index(v)] ++ ;
+    h->total ++ ;
+    if(v > h->max) h->max = v;
+}
+
+static uint64_t hist_percentile(const struct hist *h, double p)
+{
+    if(h->total == 0) return 0;
+    unsigned long long rank = (unsigned long long)(p * (h->total - 1)) + 1, seen = 0;
+    for(int i = 0; i < HIST_BUCKETS; i ++ ) {
+        seen += h->count[i];
+        if(seen >= rank) {
+            uint64_t lo = hist_lower(i), hi = i + 1 < HIST_BUCKETS ? hist_lower(i + 1) : lo;
+            uint64_t mid = lo + (hi - lo) / 2;
+            return mid < h->max ? mid : h->max;
+        }
+    }
+    return h->max;
+}
+
+// 补满在路上的请求，然后尽量把欠下的字节写进 socket
+static int conn_fill(struct worker *w, struct bconn *c, uint64_t now)
+{
+    int depth = w->b->depth;
+    while(c->tail - c->head < (unsigned)depth) {
+        c->sent_at[c->tail % depth] = now;
+        c->tail ++ ;
+        c->to_send += w->b->size;
+    }
+    while(c->to_send > 0) {
+        // 内容是重复的，从哪里开始发都一样，长度不超过 depth * size
+        ssize_t n = send(c->fd, g_payload, c->to_send, MSG_NOSIGNAL);
+        if(n > 0) {
+            c->to_send -= n;
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return -1;
+    }
+    return 0;
+}
+
+static int conn_read(struct worker *w, struct bconn *c, char *buf)
+{
+    struct bench *b = w->b;
+    while(1) {
+        ssize_t n = recv(c->fd, buf, b->rbuf_size, 0);
+        if(n > 0) {
+            uint64_t now = now_ns();
+            c->in_bytes += n;
+            while(c->in_bytes >= (size_t)b->size && c->head != c->tail) {
+                c->in_bytes -= b->size;
+                uint64_t sent = c->sent_at[c->head % b->depth];
+                c->head ++ ;
+                // 只统计在统计窗口里发出的请求，预热期间的不算
+                if(sent >= b->measure_ns && now <= b->end_ns) {
+                    hist_add(&w->hist, now - sent);
+                    w->completed ++ ;
+                }
+            }
+            if(conn_fill(w, c, now) == -1) return -1;
+            if((size_t)n < b->rbuf_size) return 0;
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return -1;  // 服务器关闭了连接，或者出错
+    }
+}
+
+static void *worker_loop(void *arg)
+{
+    struct worker *w = arg;
+    struct bench *b = w->b;
+    char *buf = malloc(b->rbuf_size);
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(!buf || epfd == -1) error_handling("worker init error");
+
+    // 阻塞 connect 建好连接再切成非阻塞：压测关心的是稳态，不是建连
+    for(int i = 0; i < w->nconns; i ++ ) {
+        struct bconn *c = &w->conns[i];
+        c->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(c->fd == -1 || connect(c->fd, (struct sockaddr*)&b->addr, sizeof(b->addr)) == -1)
+            error_handling("connect() error");
+        int one = 1;
+        setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+        c->sent_at = calloc(b->depth, sizeof(uint64_t));
+        if(!c->sent_at) error_handling("calloc() error");
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.ptr = c;
+        if(epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) == -1) error_handling("epoll_ctl() error");
+    }
+
+    // 所有线程在同一时刻开始发请求
+    while(now_ns() < b->start_ns) usleep(1000);
+    uint64_t now = now_ns();
+    for(int i = 0; i < w->nconns; i ++ ) {
+        if(conn_fill(w, &w->conns[i], now) == -1) w->errors ++ ;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while(now_ns() < b->end_ns) {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, 100);
+        if(n == -1) {
+            if(errno == EINTR) continue;
+            error_handling("epoll_wait() error");
+        }
+        for(int i = 0; i < n; i ++ ) {
+            struct bconn *c = events[i].data.ptr;
+            if(c->fd == -1) continue;
+            int r = 0;
+            if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) r = conn_read(w, c, buf);
+            if(r == 0 && (events[i].events & EPOLLOUT)) r = conn_fill(w, c, now_ns());
+            if(r == -1) {
+                w->errors ++ ;
+                close(c->fd);
+                c->fd = -1;
+            }
+        }
+    }
+
+    for(int i = 0; i < w->nconns; i ++ ) {
+        if(w->conns[i].fd != -1) close(w->conns[i].fd);
+        free(w->conns[i].sent_at);
+    }
+    close(epfd);
+    free(buf);
+    return NULL;
+}
+
+// 程序自己的选项，-t / -d 是公共选项 --threads / --duration 的别名
+static const struct bench_extra bench_extra_opts[] = {
+    {"conns", 'c', required_argument, 'c', "N", "connections (default 64)"},
+    {"depth", 'p', required_argument, 'p', "N", "requests in flight per connection (default 8)"},
+    {"size", 's', required_argument, 's', "BYTES", "request size (default 64)"},
+    {NULL, 't', required_argument, BENCH_ID_THREADS, "N", "same as --threads"},
+    {NULL, 'd', required_argument, BENCH_ID_DURATION, "TIME", "same as --duration"},
+    {"warmup", 'w', required_argument, 'w', "SECONDS", "warmup before measuring (default 1)"},
+    {"json", 'j', no_argument, 'j', NULL, "also print one JSON line"},
+    {NULL, 0, 0, 0, NULL, NULL},
+};
+
+struct bench_args {
+    struct bench *b;
+    long warmup;
+    int json;
+};
+
+static int on_option(int id, const char *arg, void *ctx)
+{
+    struct bench_args *a = ctx;
+    long v;
+    if(id == 'j') {
+        a->json = 1;
+        return 0;
+    }
+    if(bench_parse_long(arg, id == 'w' ? 0 : 1, &v) == -1 || v > 1L << 30) return -1;
+    switch(id) {
+        case 'c': a->b->conns = (int)v; return 0;
+        case 'p': a->b->depth = (int)v; return 0;
+        case 's': a->b->size = (int)v; return 0;
+        case 'w': a->warmup = v; return 0;
+        default: return -1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct bench b;
+    memset(&b, 0, sizeof(b));
+    b.conns = 64;
+    b.depth = 8;
+    b.size = 64;
+    struct bench_args args = {&b, 1, 0};
+    struct bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_THREADS | BENCH_OPT_DURATION | BENCH_OPT_BUF_SIZE, "<IP> <Port>");
+    bench_list_set(&o.threads, 1);
+    bench_list_set(&o.buf_size, RBUF_SIZE);
+    o.duration_ms = 5000;
+    int idx = bench_opts_parse(&o, argc, argv, bench_extra_opts, on_option, &args);
+    if(idx <= 0) return idx < 0;
+    if(idx + 2 != argc || o.duration_ms <= 0) {
+        bench_opts_usage(stderr, argv[0], &o, bench_extra_opts);
+        return 1;
+    }
+    b.threads = (int)o.threads.v[0];
+    b.rbuf_size = (size_t)o.buf_size.v[0];
+    long duration_ms = o.duration_ms, warmup = args.warmup;
+    int json = args.json;
+    if(b.threads > b.conns) b.threads = b.conns;
+    b.addr.sin_family = AF_INET;
+    b.addr.sin_port = htons(atoi(argv[idx + 1]));
+    if(inet_pton(AF_INET, argv[idx], &b.addr.sin_addr) != 1) error_handling("bad address");
+
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    g_payload = malloc((size_t)b.depth * b.size);
+    if(!g_payload) error_handling("malloc() error");
+    memset(g_payload, 'x', (size_t)b.depth * b.size);
+
+    struct worker *ws = calloc(b.threads, sizeof(*ws));
+    if(!ws) error_handling("calloc() error");
+    for(int i = 0; i < b.threads; i ++ ) {
+        ws[i].b = &b;
+        ws[i].id = i;
+        ws[i].nconns = b.conns / b.threads + (i < b.conns % b.threads ? 1 : 0);
+        ws[i].conns = calloc(ws[i].nconns, sizeof(struct bconn));
+        if(!ws[i].conns) error_handling("calloc() error");
+    }
+    // 时间线在线程启动前定好，线程只读：先给建连留 1 秒，再预热 warmup 秒，最后统计 duration 秒
+    b.start_ns = now_ns() + 1000000000ull;
+    b.measure_ns = b.start_ns + (uint64_t)warmup * 1000000000ull;
+    b.end_ns = b.measure_ns + (uint64_t)duration_ms * 1000000ull;
+    for(int i = 0; i < b.threads; i ++ ) {
+        if(pthread_create(&ws[i].tid, NULL, worker_loop, &ws[i]) != 0) error_handling("pthread_create() error");
+    }
+
+    struct hist *total = calloc(1, sizeof(*total));
+    unsigned long long completed = 0, errors = 0;
+    for(int i = 0; i < b.threads; i ++ ) {
+        pthread_join(ws[i].tid, NULL);
+        for(int k = 0; k < HIST_BUCKETS; k ++ ) total->count[k] += ws[i].hist.count[k];
+        total->total += ws[i].hist.total;
+        if(ws[i].hist.max > total->max) total->max = ws[i].hist.max;
+        completed += ws[i].completed;
+        errors += ws[i].errors;
+        free(ws[i].conns);
+    }
+    double duration = duration_ms / 1e3;
+    double rps = completed / duration;
+    double mbps = rps * b.size * 2 / 1e6;  // 请求加应答
+    uint64_t p50 = hist_percentile(total, 0.50), p99 = hist_percentile(total, 0.99);
+    uint64_t p999 = hist_percentile(total, 0.999);
+    printf("conns=%d depth=%d size=%d threads=%d buf_size=%zu duration=%.3gs\n", b.conns, b.depth, b.size, b.threads,
+           b.rbuf_size, duration);
+    printf("requests=%llu rps=%.0f MB/s=%.1f errors=%llu\n", completed, rps, mbps, errors);
+    printf("rtt p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n", p50 / 1e3, p99 / 1e3, p999 / 1e3, total->max / 1e3);
+    if(json) {
+        printf("{\"conns\":%d,\"depth\":%d,\"size\":%d,\"threads\":%d,\"duration_s\":%.3f,\"requests\":%llu,"
+               "\"rps\":%.0f,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu,\"errors\":%llu}\n",
+               b.conns, b.depth, b.size, b.threads, duration, completed, rps, (unsigned long long)p50,
+               (unsigned long long)p99, (unsigned long long)p999, total->max, errors);
+    }
+    free(total);
+    free(ws);
+    free(g_payload);
+    return errors ? 2 : 0;
+}
+
+void error_handling(const char *message)
+{
+    perror(message);
+    exit(1);
+}
@@ -0,0 +1,797 @@
+// 生产模式的 echo server：多 reactor + SO_REUSEPORT + 边缘触发
+//
+// server.c 是教学用的单线程水平触发版本（4 字节的 buffer，每次 read 之后阻塞 write），这里是它的生产版本：
+//   - N 个 reactor 线程，每个都有自己的 epoll 实例和自己的监听 socket（SO_REUSEPORT），
+//     内核按四元组把新连接分给各个监听 socket，reactor 之间不共享任何状态，也没有锁
+//   - 所有 socket 都是非阻塞 + 边缘触发（EPOLLET），accept4(SOCK_NONBLOCK) 一次系统调用拿到非阻塞的连接
+//   - 每个 reactor 一块 64KB 的读缓冲区；每个连接一个输出队列：
+//     先直接 send，发不完的部分才进队列，并且只有这时才注册 EPOLLOUT，队列清空后立刻取消
+//   - 输出队列超过 OUTQ_HIGH_WATER 时暂停读这个连接（对端不收，我们也不再读），降到 OUTQ_LOW_WATER 以下再恢复
+// -b uring 换成 io_uring 后端（需要 liburing，见文件后半部分），两个后端跑同一个负载，对比系统调用次数和尾延迟
+//
+// 用法: ./echo_server [-t reactors] [-b epoll|uring] [--buf-size=BYTES] <port>
+//       reactors 默认为 CPU 核数；Ctrl-C 退出时打印每个 reactor 的统计
+//       选项由 ../getopt/bench_opts.h 解析：-t 就是 --reactors；--buf-size 是 epoll 后端每个 reactor 的读缓冲区
+//       和 io_uring 后端 buffer ring 里每块缓冲区的大小（默认分别是 64K 和 16K）
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "bench_opts.h"
+
+#if defined(__has_include)
+#if __has_include(<liburing.h>)
+#define HAVE_LIBURING 1
+#include <liburing.h>
+#endif
+#endif
+
+#define MAX_EVENTS 256
+#define RBUF_SIZE (64 * 1024)  // 默认的读缓冲区大小
+#define OUTQ_HIGH_WATER (4 * 1024 * 1024)
+#define OUTQ_LOW_WATER (1 * 1024 * 1024)
+
+static size_t g_rbuf_size = RBUF_SIZE;  // --buf-size，启动 reactor 之前设置，之后只读
+
+// 连接的输出队列：[head, tail) 是还没发出去的数据
+struct outq {
+    char *data;
+    size_t head, tail, cap;
+};
+
+struct conn {
+    int fd;
+    int reading_paused;  // 输出队列太长，暂时不读
+    int peer_closed;     // 收到过 EPOLLRDHUP / EPOLLHUP：对端已经关闭写方向，读到 0（EOF）为止
+    int read_eof;        // 已经读到 EOF，但输出队列里还有回显没发完：不再读，on_writable 发完后关闭
+    uint32_t events;     // 当前注册在 epoll 上的事件
+    struct outq out;
+    struct conn *prev, *next;  // 本 reactor 的连接链表，退出时统一释放
+};
+
+struct reactor_stats {
+    unsigned long long accepted, closed;
+    unsigned long long bytes_in, bytes_out;
+    unsigned long long short_writes;  // send 没发完、需要 EPOLLOUT 的次数
+    unsigned long long syscalls;      // 数据路径上的系统调用：epoll 后端数 epoll_wait/accept4/recv/send/epoll_ctl，uring 后端数 io_uring_enter
+    unsigned long long cqes;          // 只有 uring 后端：处理过的 CQE 个数
+};
+
+struct reactor {
+    int id;
+    int port;
+    int epfd;  // 只有 epoll 后端
+    int listen_fd;
+    int wake_fd;  // 主线程通过它通知 reactor 退出
+    pthread_t tid;
+    char *rbuf;
+    struct conn *conns;
+    struct reactor_stats stats;
+};
+
+// epoll_event.data.ptr 指向 conn；监听 socket 和 wake_fd 用这两个地址区分
+static char LISTEN_TAG, WAKE_TAG;
+static atomic_int g_stop = 0;
+
+void error_handling(const char *message);
+
+static size_t outq_len(const struct outq *q) { return q->tail - q->head; }
+
+static int outq_append(struct outq *q, const char *p, size_t n)
+{
+    if(q->tail + n > q->cap) {
+        // 先把已发送的部分挪掉，还不够再扩容
+        size_t len = outq_len(q);
+        if(q->head > 0) {
+            memmove(q->data, q->data + q->head, len);
+            q->head = 0;
+            q->tail = len;
+        }
+        if(len + n > q->cap) {
+            size_t cap = q->cap ? q->cap : 16 * 1024;
+            while(cap < len + n) cap *= 2;
+            char *data = realloc(q->data, cap);
+            if(!data) return -1;
+            q->data = data;
+            q->cap = cap;
+        }
+    }
+    memcpy(q->data + q->tail, p, n);
+    q->tail += n;
+    return 0;
+}
+
+static int set_events(struct reactor *r, struct conn *c, uint32_t events)
+{
+    if(c->events == events) return 0;
+    r->stats.syscalls ++ ;
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = c;
+    if(epoll_ctl(r->epfd, EPOLL_CTL_MOD, c->fd, &ev) == -1) return -1;
+    c->events = events;
+    return 0;
+}
+
+static void conn_close(struct reactor *r, struct conn *c)
+{
+    close(c->fd);  // close 会自动把 fd 从 epoll 中移除
+    if(c->prev) c->prev->next = c->next;
+    else r->conns = c->next;
+    if(c->next) c->next->prev = c->prev;
+    free(c->out.data);
+    free(c);
+    r->stats.closed ++ ;
+}
+
+// 有序发送：队列里还有数据时只能排在后面；否则直接 send，发不完的部分进队列并注册 EPOLLOUT
+static int conn_send(struct reactor *r, struct conn *c, const char *p, size_t n)
+{
+    if(outq_len(&c->out) == 0) {
+        while(n > 0) {
+            ssize_t sent = send(c->fd, p, n, MSG_NOSIGNAL);
+            r->stats.syscalls ++ ;
+            if(sent > 0) {
+                r->stats.bytes_out += sent;
+                p += sent;
+                n -= sent;
+                continue;
+            }
+            if(sent < 0 && errno == EINTR) continue;
+            if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return -1;
+        }
+        if(n == 0) return 0;
+        r->stats.short_writes ++ ;
+    }
+    if(outq_append(&c->out, p, n) == -1) return -1;
+    return set_events(r, c, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+}
+
+// on_writable / on_readable 返回 -1 表示连接已经被关闭、c 已经释放
+// on_readable 的 ev 是这次 epoll 事件（主动去读时传 0）
+static int on_readable(struct reactor *r, struct conn *c, uint32_t ev);
+
+static int on_writable(struct reactor *r, struct conn *c)
+{
+    struct outq *q = &c->out;
+    while(outq_len(q) > 0) {
+        ssize_t sent = send(c->fd, q->data + q->head, outq_len(q), MSG_NOSIGNAL);
+        r->stats.syscalls ++ ;
+        if(sent > 0) {
+            r->stats.bytes_out += sent;
+            q->head += sent;
+            continue;
+        }
+        if(sent < 0 && errno == EINTR) continue;
+        if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        conn_close(r, c);
+        return -1;
+    }
+    if(outq_len(q) == 0) {
+        q->head = q->tail = 0;
+        if(c->read_eof) {  // 半关闭的对端已经收齐了回显
+            conn_close(r, c);
+            return -1;
+        }
+        if(set_events(r, c, EPOLLIN | EPOLLRDHUP | EPOLLET) == -1) {
+            conn_close(r, c);
+            return -1;
+        }
+    }
+    // 边缘触发下暂停期间到达的数据不会再通知一次，恢复时要自己去读
+    if(c->reading_paused && outq_len(q) < OUTQ_LOW_WATER) {
+        c->reading_paused = 0;
+        return on_readable(r, c, 0);
+    }
+    return 0;
+}
+
+static int on_readable(struct reactor *r, struct conn *c, uint32_t ev)
+{
+    if(ev & (EPOLLRDHUP | EPOLLHUP)) c->peer_closed = 1;
+    while(1) {
+        if(outq_len(&c->out) >= OUTQ_HIGH_WATER) {
+            c->reading_paused = 1;
+            return 0;
+        }
+        ssize_t n = recv(c->fd, r->rbuf, g_rbuf_size, 0);
+        r->stats.syscalls ++ ;
+        if(n > 0) {
+            r->stats.bytes_in += n;
+            if(conn_send(r, c, r->rbuf, n) == -1) {
+                conn_close(r, c);
+                return -1;
+            }
+            // 对流式 socket，读到的比要的少说明内核缓冲区已经读空了（见 epoll(7)），省掉一次注定 EAGAIN 的 recv
+            // 但对端已经关闭时不能省：数据和 FIN 可能在同一个边缘里到达，不再读一次就看不到 EOF，
+            // 之后也不会再有事件，连接永远不会关闭
+            if((size_t)n < g_rbuf_size && !c->peer_closed) return 0;
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        // 对端只是关闭了写方向（半关闭）时还在等回显：队列里有没发完的就先不关，只等 EPOLLOUT
+        // （与 io_uring 后端的 uconn_maybe_free 一致）
+        if(n == 0 && outq_len(&c->out) > 0) {
+            c->read_eof = 1;
+            if(set_events(r, c, EPOLLOUT | EPOLLET) == 0) return 0;
+        }
+        conn_close(r, c);  // 对端关闭且没有待发的数据，或者出错
+        return -1;
+    }
+}
+
+static void on_accept(struct reactor *r)
+{
+    while(1) {
+        int fd = accept4(r->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        r->stats.syscalls ++ ;
+        if(fd == -1) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            // EAGAIN：本轮的连接都接完了；EMFILE 等资源错误也先退出，下一次边缘到来时再试
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct conn *c = calloc(1, sizeof(*c));
+        if(!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        struct epoll_event ev;
+        ev.events = c->events;
+        ev.data.ptr = c;
+        r->stats.syscalls ++ ;
+        if(epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->next = r->conns;
+        if(r->conns) r->conns->prev = c;
+        r->conns = c;
+        r->stats.accepted ++ ;
+    }
+}
+
+static int create_listener(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd == -1) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    // 每个 reactor 绑定同一个端口，内核在它们之间做负载均衡
+    if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == -1) {
+        close(fd);
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// uring 后端的 ring 和缓冲区在 reactor 线程里创建（SINGLE_ISSUER 要求提交者就是创建者），这里只准备监听 socket 和 wake_fd
+static int reactor_init(struct reactor *r, int id, int port, int use_uring)
+{
+    memset(r, 0, sizeof(*r));
+    r->id = id;
+    r->port = port;
+    r->epfd = -1;
+    r->listen_fd = create_listener(port);
+    r->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(r->listen_fd == -1 || r->wake_fd == -1) return -1;
+    if(use_uring) return 0;
+
+    r->epfd = epoll_create1(EPOLL_CLOEXEC);
+    r->rbuf = malloc(g_rbuf_size);
+    if(r->epfd == -1 || !r->rbuf) return -1;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &LISTEN_TAG;
+    if(epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->listen_fd, &ev) == -1) return -1;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &WAKE_TAG;
+    if(epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->wake_fd, &ev) == -1) return -1;
+    return 0;
+}
+
+static void *reactor_loop(void *arg)
+{
+    struct reactor *r = arg;
+    struct epoll_event events[MAX_EVENTS];
+    while(!g_stop) {
+        int n = epoll_wait(r->epfd, events, MAX_EVENTS, -1);
+        r->stats.syscalls ++ ;
+        if(n == -1) {
+            if(errno == EINTR) continue;
+            perror("epoll_wait() error");
+            break;
+        }
+        for(int i = 0; i < n; i ++ ) {
+            void *tag = events[i].data.ptr;
+            if(tag == &LISTEN_TAG) {
+                on_accept(r);
+                continue;
+            }
+            if(tag == &WAKE_TAG) continue;  // g_stop 已经置位，处理完这一轮就退出
+
+            struct conn *c = tag;
+            uint32_t ev = events[i].events;
+            if(ev & (EPOLLERR | EPOLLHUP)) {
+                conn_close(r, c);
+                continue;
+            }
+            // 先写后读：写完可能恢复被暂停的读；写的时候连接被关掉了就不能再读
+            if((ev & EPOLLOUT) && on_writable(r, c) == -1) continue;
+            if((ev & (EPOLLIN | EPOLLRDHUP)) && !c->read_eof) on_readable(r, c, ev);
+        }
+    }
+
+    for(struct conn *c = r->conns, *next; c; c = next) {
+        next = c->next;
+        close(c->fd);
+        free(c->out.data);
+        free(c);
+    }
+    r->conns = NULL;
+    return NULL;
+}
+
+#ifdef HAVE_LIBURING
+// ---------------------------------------------------------------------------
+// io_uring 后端：每个 reactor 一个 ring，监听 socket 仍然是各自的 SO_REUSEPORT socket
+//   - 多发 accept（IORING_ACCEPT_MULTISHOT）：一个 SQE 持续产出新连接
+//   - 多发 recv + provided buffer ring：每个连接一个 recv SQE，数据落在内核从 buffer ring 中挑的缓冲区里，
+//     空闲连接不占缓冲区；CQE 里带回缓冲区编号 bid
+//   - 回显直接发送这块缓冲区（零拷贝），send 完成后才把它还给 buffer ring；
+//     同一个连接的多个待发缓冲区用 IOSQE_IO_LINK 串成一条链，保证按顺序发出
+//   - 一轮循环把所有 CQE 处理完、攒下新的 SQE，再用一次 io_uring_submit_and_wait 全部提交并等待下一批
+// ---------------------------------------------------------------------------
+#define URING_ENTRIES 4096
+#define BR_ENTRIES 1024  // buffer ring 的大小，必须是 2 的幂
+#define BR_BUF_SIZE (16 * 1024)  // 默认的每块缓冲区大小
+#define BR_GROUP 0
+
+static size_t g_br_buf_size = BR_BUF_SIZE;  // --buf-size，同 g_rbuf_size
+#define SEND_CHAIN_MAX 16  // 一条 send 链最多几个 SQE
+
+// user_data：uconn 的地址（至少 8 字节对齐）| 操作类型
+enum { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_WAKE = 4 };
+#define OP_MASK 7ULL
+
+// 一块待发送（或正在发送）的缓冲区
+struct pend {
+    unsigned short bid;
+    unsigned len;
+};
+
+struct uconn {
+    int fd;
+    int recv_armed;  // 多发 recv 还会产出 CQE
+    int eof;         // 对端已经关闭写端：把剩下的数据发完再关
+    int failed;      // 出错：丢掉没发的数据，等在途的操作都结束后释放
+    int starved;     // 多发 recv 因为缓冲区用完（-ENOBUFS）停了，已经在 starved 链表里
+    unsigned inflight;  // 已提交的 send 个数，它们是 q 的前 inflight 项
+    struct pend *q;     // q[head & (cap - 1)] .. q[(tail - 1) & (cap - 1)]，cap 是 2 的幂
+    unsigned head, tail, cap;
+    struct uconn *prev, *next;
+    struct uconn *next_starved;
+};
+
+struct uring_reactor {
+    struct reactor *r;
+    struct io_uring ring;
+    struct io_uring_buf_ring *br;
+    char *bufs;
+    int recycled;  // 本轮还回 buffer ring、还没 advance 的缓冲区个数
+    struct uconn *conns;
+    struct uconn *starved;
+};
+
+static inline uint64_t make_data(struct uconn *c, int op) { return (uint64_t)(uintptr_t)c | (uint64_t)op; }
+
+// SQ 满了就先把已经攒下的提交掉
+static struct io_uring_sqe *get_sqe(struct uring_reactor *u)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&u->ring);
+    if(!sqe) {
+        io_uring_submit(&u->ring);
+        u->r->stats.syscalls ++ ;
+        sqe = io_uring_get_sqe(&u->ring);
+    }
+    return sqe;
+}
+
+static void arm_accept(struct uring_reactor *u)
+{
+    struct io_uring_sqe *sqe = get_sqe(u);
+    io_uring_prep_multishot_accept(sqe, u->r->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    io_uring_sqe_set_data64(sqe, make_data(NULL, OP_ACCEPT));
+}
+
+static void arm_wake(struct uring_reactor *u)
+{
+    struct io_uring_sqe *sqe = get_sqe(u);
+    // wake_fd 是非阻塞的，直接 read 会立刻以 -EAGAIN 完成，所以等它可读
+    io_uring_prep_poll_add(sqe, u->r->wake_fd, POLLIN);
+    io_uring_sqe_set_data64(sqe, make_data(NULL, OP_WAKE));
+}
+
+static void arm_recv(struct uring_reactor *u, struct uconn *c)
+{
+    struct io_uring_sqe *sqe = get_sqe(u);
+    io_uring_prep_recv_multishot(sqe, c->fd, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BR_GROUP;
+    io_uring_sqe_set_data64(sqe, make_data(c, OP_RECV));
+    c->recv_armed = 1;
+}
+
+// 还给 buffer ring；本轮结束时统一 advance，内核一次看到所有还回来的缓冲区
+static void recycle(struct uring_reactor *u, unsigned short bid)
+{
+    io_uring_buf_ring_add(u->br, u->bufs + (size_t)bid * g_br_buf_size, (unsigned)g_br_buf_size, bid,
+                          io_uring_buf_ring_mask(BR_ENTRIES), u->recycled);
+    u->recycled ++ ;
+}
+
+static int pend_push(struct uconn *c, unsigned short bid, unsigned len)
+{
+    if(c->tail - c->head == c->cap) {
+        unsigned cap = c->cap ? c->cap * 2 : 8;
+        struct pend *q = malloc(cap * sizeof(*q));
+        if(!q) return -1;
+        for(unsigned i = c->head; i != c->tail; i ++ ) q[i - c->head] = c->q[i & (c->cap - 1)];
+        free(c->q);
+        c->tail -= c->head;
+        c->head = 0;
+        c->q = q;
+        c->cap = cap;
+    }
+    c->q[c->tail & (c->cap - 1)] = (struct pend){bid, len};
+    c->tail ++ ;
+    return 0;
+}
+
+// 出错时：关掉读写两端，让多发 recv 以 0 结束；还没提交的缓冲区直接还回去
+static void uconn_fail(struct uring_reactor *u, struct uconn *c)
+{
+    if(c->failed) return;
+    c->failed = 1;
+    shutdown(c->fd, SHUT_RDWR);
+    while(c->tail - c->head > c->inflight) {
+        c->tail -- ;
+        recycle(u, c->q[c->tail & (c->cap - 1)].bid);
+    }
+}
+
+// 在途的 recv 和 send 都结束后才能释放，否则后到的 CQE 会指向已释放的内存
+static void uconn_maybe_free(struct uring_reactor *u, struct uconn *c)
+{
+    if(c->recv_armed || c->inflight || c->starved) return;
+    if(!c->failed && !(c->eof && c->head == c->tail)) return;
+    close(c->fd);
+    if(c->prev) c->prev->next = c->next;
+    else u->conns = c->next;
+    if(c->next) c->next->prev = c->prev;
+    free(c->q);
+    free(c);
+    u->r->stats.closed ++ ;
+}
+
+// 没有在途的 send 时，把待发的缓冲区串成一条链提交
+// 链内 SQE 严格按顺序执行；MSG_WAITALL 让内核在 socket 缓冲区满时自己重试，不会出现中途的短写
+static void flush_sends(struct uring_reactor *u, struct uconn *c)
+{
+    if(c->inflight || c->failed || c->head == c->tail) return;
+    unsigned n = c->tail - c->head;
+    if(n > SEND_CHAIN_MAX) n = SEND_CHAIN_MAX;
+    // 一条链不能被一次 submit 从中间截开
+    if(io_uring_sq_space_left(&u->ring) < n) {
+        io_uring_submit(&u->ring);
+        u->r->stats.syscalls ++ ;
+    }
+    for(unsigned i = 0; i < n; i ++ ) {
+        struct pend *p = &c->q[(c->head + i) & (c->cap - 1)];
+        struct io_uring_sqe *sqe = get_sqe(u);
+        io_uring_prep_send(sqe, c->fd, u->bufs + (size_t)p->bid * g_br_buf_size, p->len, MSG_WAITALL | MSG_NOSIGNAL);
+        io_uring_sqe_set_data64(sqe, make_data(c, OP_SEND));
+        if(i + 1 < n) sqe->flags |= IOSQE_IO_LINK;
+    }
+    c->inflight = n;
+}
+
+static void on_uring_accept(struct uring_reactor *u, struct io_uring_cqe *cqe)
+{
+    if(!(cqe->flags & IORING_CQE_F_MORE) && !g_stop) arm_accept(u);
+    if(cqe->res < 0) return;  // EMFILE 之类：丢掉这个连接，多发 accept 继续
+    int fd = cqe->res;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct uconn *c = calloc(1, sizeof(*c));
+    if(!c) {
+        close(fd);
+        return;
+    }
+    c->fd = fd;
+    c->next = u->conns;
+    if(u->conns) u->conns->prev = c;
+    u->conns = c;
+    u->r->stats.accepted ++ ;
+    arm_recv(u, c);
+}
+
+static void on_uring_recv(struct uring_reactor *u, struct uconn *c, struct io_uring_cqe *cqe)
+{
+    if(!(cqe->flags & IORING_CQE_F_MORE)) c->recv_armed = 0;
+    if(cqe->res > 0) {
+        unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        u->r->stats.bytes_in += cqe->res;
+        if(c->failed || pend_push(c, bid, cqe->res) == -1) {
+            recycle(u, bid);
+            uconn_fail(u, c);
+        }
+        else {
+            flush_sends(u, c);
+        }
+        // 多发 recv 偶尔也会在成功后结束（例如 CQ 溢出），重新 arm 就行
+        if(!c->recv_armed && !c->failed) arm_recv(u, c);
+    }
+    else if(cqe->res == -ENOBUFS && !c->failed) {
+        // 所有缓冲区都压在还没发完的 send 上：等有缓冲区还回来再重新 arm
+        if(!c->recv_armed && !c->starved) {
+            c->starved = 1;
+            c->next_starved = u->starved;
+            u->starved = c;
+        }
+    }
+    else if(cqe->res == 0) {
+        c->eof = 1;
+    }
+    else {
+        uconn_fail(u, c);
+    }
+    uconn_maybe_free(u, c);
+}
+
+static void on_uring_send(struct uring_reactor *u, struct uconn *c, struct io_uring_cqe *cqe)
+{
+    struct pend *p = &c->q[c->head & (c->cap - 1)];
+    c->head ++ ;
+    c->inflight -- ;
+    recycle(u, p->bid);
+    if(cqe->res > 0) u->r->stats.bytes_out += cqe->res;
+    // 链中前面的 send 失败后，后面的都以 -ECANCELED 完成
+    if(cqe->res != (int)p->len) uconn_fail(u, c);
+    if(c->inflight == 0) flush_sends(u, c);
+    uconn_maybe_free(u, c);
+}
+
+static int uring_reactor_init(struct uring_reactor *u, struct reactor *r)
+{
+    memset(u, 0, sizeof(*u));
+    u->r = r;
+    // 多发 accept 要求监听 socket 是阻塞的，否则 io_uring 会把 EAGAIN 直接返回给我们
+    int flags = fcntl(r->listen_fd, F_GETFL);
+    if(flags == -1 || fcntl(r->listen_fd, F_SETFL, flags & ~O_NONBLOCK) == -1) return -1;
+
+    // 只有本线程提交（SINGLE_ISSUER），完成事件推迟到 io_uring_enter 里处理（DEFER_TASKRUN），
+    // 不会在任意时刻打断线程；CQ 开大一些，多发请求的 CQE 来得比 SQE 多
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_CQSIZE;
+    p.cq_entries = URING_ENTRIES * 4;
+    int ret = io_uring_queue_init_params(URING_ENTRIES, &u->ring, &p);
+    if(ret == -EINVAL) {
+        // 6.1 之前的内核不认识这些标志
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = URING_ENTRIES * 4;
+        ret = io_uring_queue_init_params(URING_ENTRIES, &u->ring, &p);
+    }
+    if(ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    u->br = io_uring_setup_buf_ring(&u->ring, BR_ENTRIES, BR_GROUP, 0, &ret);
+    u->bufs = malloc((size_t)BR_ENTRIES * g_br_buf_size);
+    if(!u->br || !u->bufs) {
+        errno = u->br ? ENOMEM : -ret;
+        return -1;
+    }
+    for(int i = 0; i < BR_ENTRIES; i ++ ) recycle(u, i);
+    io_uring_buf_ring_advance(u->br, u->recycled);
+    u->recycled = 0;
+    return 0;
+}
+
+static void *uring_reactor_loop(void *arg)
+{
+    struct uring_reactor u;
+    if(uring_reactor_init(&u, arg) == -1) {
+        perror("uring_reactor_init() error");
+        return NULL;
+    }
+    struct reactor *r = u.r;
+    arm_accept(&u);
+    arm_wake(&u);
+    while(!g_stop) {
+        // 一次系统调用：提交上一轮攒下的所有 SQE，并等待至少一个 CQE
+        int ret = io_uring_submit_and_wait(&u.ring, 1);
+        r->stats.syscalls ++ ;
+        if(ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            errno = -ret;
+            perror("io_uring_submit_and_wait() error");
+            break;
+        }
+
+        struct io_uring_cqe *cqe;
+        unsigned head, count = 0;
+        io_uring_for_each_cqe(&u.ring, head, cqe) {
+            count ++ ;
+            uint64_t data = io_uring_cqe_get_data64(cqe);
+            struct uconn *c = (struct uconn *)(uintptr_t)(data & ~OP_MASK);
+            switch(data & OP_MASK) {
+                case OP_ACCEPT: on_uring_accept(&u, cqe); break;
+                case OP_RECV: on_uring_recv(&u, c, cqe); break;
+                case OP_SEND: on_uring_send(&u, c, cqe); break;
+                case OP_WAKE: break;  // g_stop 已经置位，处理完这一轮就退出
+            }
+        }
+        io_uring_cq_advance(&u.ring, count);
+        r->stats.cqes += count;
+
+        if(u.recycled) {
+            io_uring_buf_ring_advance(u.br, u.recycled);
+            u.recycled = 0;
+            // 有缓冲区了，重新 arm 因为 -ENOBUFS 停下的连接
+            struct uconn *c = u.starved;
+            u.starved = NULL;
+            while(c) {
+                struct uconn *next = c->next_starved;
+                c->starved = 0;
+                if(c->failed || c->eof) uconn_maybe_free(&u, c);
+                else arm_recv(&u, c);
+                c = next;
+            }
+        }
+    }
+
+    // 先销毁 ring（取消所有在途请求），再释放它们引用的连接和缓冲区
+    io_uring_free_buf_ring(&u.ring, u.br, BR_ENTRIES, BR_GROUP);
+    io_uring_queue_exit(&u.ring);
+    for(struct uconn *c = u.conns, *next; c; c = next) {
+        next = c->next;
+        close(c->fd);
+        free(c->q);
+        free(c);
+    }
+    free(u.bufs);
+    return NULL;
+}
+#endif
+
+static const struct bench_extra server_opts[] = {
+    {NULL, 't', required_argument, BENCH_ID_REACTORS, "N", "same as --reactors (default: CPU count)"},
+    {"backend", 'b', required_argument, 'b', "epoll|uring", "I/O backend (default epoll)"},
+    {NULL, 0, 0, 0, NULL, NULL},
+};
+
+static int on_option(int id, const char *arg, void *ctx)
+{
+    if(id != 'b' || (strcmp(arg, "epoll") != 0 && strcmp(arg, "uring") != 0)) return -1;
+    *(const char **)ctx = arg;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *backend = "epoll";
+    struct bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_REACTORS | BENCH_OPT_BUF_SIZE, "<Port>");
+    bench_list_set(&o.reactors, ncpu > 0 ? ncpu : 1);
+    int idx = bench_opts_parse(&o, argc, argv, server_opts, on_option, &backend);
+    if(idx <= 0) return idx < 0;
+    if(idx + 1 != argc || (o.buf_size.n && o.buf_size.v[0] > 1L << 30)) {
+        bench_opts_usage(stderr, argv[0], &o, server_opts);
+        exit(1);
+    }
+    int reactors = (int)o.reactors.v[0];
+    int use_uring = strcmp(backend, "uring") == 0;
+    if(o.buf_size.n) {
+        g_rbuf_size = (size_t)o.buf_size.v[0];
+#ifdef HAVE_LIBURING
+        g_br_buf_size = (size_t)o.buf_size.v[0];
+#endif
+    }
+#ifndef HAVE_LIBURING
+    if(use_uring) {
+        fprintf(stderr, "built without liburing, only -b epoll is available\n");
+        exit(1);
+    }
+    void *(*loop)(void *) = reactor_loop;
+#else
+    void *(*loop)(void *) = use_uring ? uring_reactor_loop : reactor_loop;
+#endif
+    int port = atoi(argv[idx]);
+
+    // 信号只由主线程用 sigwait 处理，reactor 线程继承这个屏蔽字
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct reactor *rs = calloc(reactors, sizeof(*rs));
+    if(!rs) error_handling("calloc() error");
+    for(int i = 0; i < reactors; i ++ ) {
+        if(reactor_init(&rs[i], i, port, use_uring) == -1) error_handling("reactor_init() error");
+    }
+    for(int i = 0; i < reactors; i ++ ) {
+        if(pthread_create(&rs[i].tid, NULL, loop, &rs[i]) != 0) error_handling("pthread_create() error");
+    }
+    printf("echo server listening on port %d with %d %s reactor(s)\n", port, reactors, backend);
+
+    int sig;
+    sigwait(&set, &sig);
+    g_stop = 1;
+    for(int i = 0; i < reactors; i ++ ) {
+        uint64_t one = 1;
+        if(write(rs[i].wake_fd, &one, sizeof(one)) != sizeof(one)) perror("write(wake_fd)");
+    }
+
+    struct reactor_stats total;
+    memset(&total, 0, sizeof(total));
+    for(int i = 0; i < reactors; i ++ ) {
+        pthread_join(rs[i].tid, NULL);
+        struct reactor_stats *s = &rs[i].stats;
+        printf("reactor %d: accepted=%llu closed=%llu in=%llu out=%llu short_writes=%llu syscalls=%llu cqes=%llu\n",
+               i, s->accepted, s->closed, s->bytes_in, s->bytes_out, s->short_writes, s->syscalls, s->cqes);
+        total.accepted += s->accepted;
+        total.bytes_in += s->bytes_in;
+        total.bytes_out += s->bytes_out;
+        total.syscalls += s->syscalls;
+        close(rs[i].listen_fd);
+        if(rs[i].epfd != -1) close(rs[i].epfd);
+        close(rs[i].wake_fd);
+        free(rs[i].rbuf);
+    }
+    printf("total: accepted=%llu in=%llu out=%llu syscalls=%llu\n", total.accepted, total.bytes_in, total.bytes_out, total.syscalls);
+    free(rs);
+    return 0;
+}
+
+void error_handling(const char *message)
+{
+    perror(message);
+    exit(1);
+}
@@ -0,0 +1,442 @@
+// 零拷贝的文件服务器：sendfile / splice，和经过用户态缓冲区的 read + send 对比
+//
+// 协议：客户端发送一行相对路径（以 '\n' 结尾），服务器回送文件内容后关闭连接；
+//       路径不合法或者打不开时回送一行 "ERR ..." 后关闭
+// 三种发送方式（-m）：
+//   sendfile : sendfile(sock, file)，页缓存里的数据直接进 socket，不经过用户态
+//   splice   : file -> pipe -> socket 两次 splice，管道里搬的是页的引用，不复制数据
+//   copy     : pread 到用户态缓冲区再 send，作为对照（每个字节复制两次）
+// 单个 epoll reactor，非阻塞 socket；发送缓冲区满时注册 EPOLLOUT，可写后从上次的偏移继续
+//
+// 用法: ./file_server [-m sendfile|splice|copy] [-r root_dir] [--buf-size=BYTES] <port>
+//       Ctrl-C 退出时打印统计
+//       选项由 ../getopt/bench_opts.h 解析：--buf-size 是 copy 方式的用户态缓冲区大小（默认 64K）；-h 列出全部选项
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <limits.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#if defined(SYS_openat2) && __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#define HAVE_OPENAT2 1
+#endif
+
+#include "bench_opts.h"
+
+#define MAX_EVENTS 256
+#define MAX_REQ 1024          // 请求行（路径）的最大长度
+#define CHUNK (1024 * 1024)   // 每次 sendfile / splice 最多搬这么多
+#define COPY_BUF (64 * 1024)  // copy 方式的用户态缓冲区，--buf-size 的默认值
+#define PIPE_SIZE (1024 * 1024)
+
+enum mode { MODE_SENDFILE, MODE_SPLICE, MODE_COPY };
+
+struct conn {
+    int fd;
+    int file_fd;  // -1 表示还在读请求
+    off_t off, size;
+    int pipe_fd[2];     // 只有 splice 方式
+    size_t in_pipe;     // 已经进了管道、还没进 socket 的字节数
+    char req[MAX_REQ];
+    size_t req_len;
+};
+
+struct server_stats {
+    unsigned long long requests, errors;
+    unsigned long long bytes_out, syscalls;
+};
+
+struct server {
+    int epfd;
+    int listen_fd;
+    int signal_fd;
+    int root_fd;
+    enum mode mode;
+    char *buf;  // copy 方式用
+    size_t buf_size;
+    struct server_stats stats;
+};
+
+static char LISTEN_TAG, SIGNAL_TAG;
+
+void error_handling(const char *message);
+
+static void conn_close(struct conn *c)
+{
+    close(c->fd);
+    if(c->file_fd != -1) close(c->file_fd);
+    if(c->pipe_fd[0] != -1) {
+        close(c->pipe_fd[0]);
+        close(c->pipe_fd[1]);
+    }
+    free(c);
+}
+
+// 只接受根目录下的相对路径：不能以 '/' 开头，也不能有 ".." 这一级
+static int path_ok(const char *path)
+{
+    if(path[0] == '\0' || path[0] == '/') return 0;
+    for(const char *p = path; *p; ) {
+        const char *slash = strchr(p, '/');
+        size_t len = slash ? (size_t)(slash - p) : strlen(p);
+        if(len == 2 && p[0] == '.' && p[1] == '.') return 0;
+        if(!slash) break;
+        p = slash + 1;
+    }
+    return 1;
+}
+
+// 请求出错时尽力回送一行错误信息；socket 刚建立，发送缓冲区是空的，不会阻塞
+static void reply_error(struct server *s, struct conn *c, const char *why)
+{
+    char line[128];
+    int n = snprintf(line, sizeof(line), "ERR %s\n", why);
+    send(c->fd, line, n, MSG_NOSIGNAL);
+    s->stats.errors ++ ;
+}
+
+// 打开根目录下的文件，保证解析结果不会跑到根目录外面。
+// path_ok 只挡住了字面上的 ".."，根目录里的符号链接（或者中间某一级目录是符号链接）照样能指到外面：
+//   - 有 openat2 时用 RESOLVE_BENEATH，内核保证解析不离开 root_fd（树内的符号链接仍然可以用）
+//   - 内核或头文件没有 openat2 时逐级 openat(O_NOFOLLOW)，任何一级是符号链接都拒绝
+// 最后一级带 O_NONBLOCK：根目录下的 FIFO 之类没有写者时 open 会一直阻塞，单线程的 reactor 就被卡死了；
+// 对普通文件 O_NONBLOCK 没有影响，不是普通文件的由调用方 fstat 之后拒绝
+static int open_beneath(int root_fd, const char *path)
+{
+#ifdef HAVE_OPENAT2
+    struct open_how how = {
+        .flags = O_RDONLY | O_CLOEXEC | O_NONBLOCK,
+        .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+    };
+    int fd = syscall(SYS_openat2, root_fd, path, &how, sizeof(how));
+    if(fd != -1 || errno != ENOSYS) return fd;
+#endif
+    int dir = root_fd;
+    for(const char *p = path; ; ) {
+        const char *slash = strchr(p, '/');
+        if(!slash) {
+            int fd = openat(dir, p, O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+            if(dir != root_fd) close(dir);
+            return fd;
+        }
+        char name[NAME_MAX + 1];
+        size_t len = (size_t)(slash - p);
+        if(len > NAME_MAX) {
+            if(dir != root_fd) close(dir);
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        memcpy(name, p, len);
+        name[len] = '\0';
+        int next = len == 0 ? dup(dir) : openat(dir, name, O_RDONLY | O_CLOEXEC | O_DIRECTORY | O_NOFOLLOW);
+        if(dir != root_fd) close(dir);
+        if(next == -1) return -1;
+        dir = next;
+        p = slash + 1;
+    }
+}
+
+static int open_request(struct server *s, struct conn *c)
+{
+    c->req[c->req_len] = '\0';
+    if(!path_ok(c->req)) {
+        reply_error(s, c, "bad path");
+        return -1;
+    }
+    int fd = open_beneath(s->root_fd, c->req);
+    struct stat st;
+    if(fd == -1 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        if(fd != -1) close(fd);
+        reply_error(s, c, "not found");
+        return -1;
+    }
+    c->file_fd = fd;
+    c->size = st.st_size;
+    if(s->mode == MODE_SPLICE) {
+        if(pipe2(c->pipe_fd, O_NONBLOCK | O_CLOEXEC) == -1) {
+            c->pipe_fd[0] = c->pipe_fd[1] = -1;
+            return -1;
+        }
+        fcntl(c->pipe_fd[1], F_SETPIPE_SZ, PIPE_SIZE);  // 失败了就用默认的 64KB
+    }
+    s->stats.requests ++ ;
+    return 0;
+}
+
+// 返回 1 表示发完了，0 表示发送缓冲区满了、等 EPOLLOUT，-1 表示出错
+static int send_sendfile(struct server *s, struct conn *c)
+{
+    while(c->off < c->size) {
+        size_t n = c->size - c->off < CHUNK ? c->size - c->off : CHUNK;
+        ssize_t sent = sendfile(c->fd, c->file_fd, &c->off, n);  // 内核负责推进 c->off
+        s->stats.syscalls ++ ;
+        if(sent > 0) {
+            s->stats.bytes_out += sent;
+            continue;
+        }
+        if(sent == 0) return -1;  // 文件被截短了
+        if(errno == EINTR) continue;
+        return errno == EAGAIN ? 0 : -1;
+    }
+    return 1;
+}
+
+static int send_splice(struct server *s, struct conn *c)
+{
+    while(c->off < c->size || c->in_pipe > 0) {
+        // 管道空了才从文件灌；SPLICE_F_NONBLOCK 只管管道这一端，文件这一端读页缓存
+        if(c->in_pipe == 0) {
+            size_t n = c->size - c->off < CHUNK ? c->size - c->off : CHUNK;
+            ssize_t in = splice(c->file_fd, &c->off, c->pipe_fd[1], NULL, n, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            s->stats.syscalls ++ ;
+            if(in == 0) return -1;
+            if(in < 0) {
+                if(errno == EINTR) continue;
+                return -1;
+            }
+            c->in_pipe = in;
+        }
+        unsigned flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK | (c->off < c->size ? SPLICE_F_MORE : 0);
+        ssize_t out = splice(c->pipe_fd[0], NULL, c->fd, NULL, c->in_pipe, flags);
+        s->stats.syscalls ++ ;
+        if(out > 0) {
+            c->in_pipe -= out;
+            s->stats.bytes_out += out;
+            continue;
+        }
+        if(out < 0 && errno == EINTR) continue;
+        return out < 0 && errno == EAGAIN ? 0 : -1;
+    }
+    return 1;
+}
+
+// 对照组：没发完的部分下次从 c->off 重新 pread，不为每个连接保留缓冲区
+static int send_copy(struct server *s, struct conn *c)
+{
+    while(c->off < c->size) {
+        size_t left = (size_t)(c->size - c->off);
+        size_t n = left < s->buf_size ? left : s->buf_size;
+        ssize_t got = pread(c->file_fd, s->buf, n, c->off);
+        s->stats.syscalls ++ ;
+        if(got <= 0) {
+            if(got < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        ssize_t sent = send(c->fd, s->buf, got, MSG_NOSIGNAL);
+        s->stats.syscalls ++ ;
+        if(sent > 0) {
+            c->off += sent;
+            s->stats.bytes_out += sent;
+            continue;
+        }
+        if(errno == EINTR) continue;
+        return errno == EAGAIN ? 0 : -1;
+    }
+    return 1;
+}
+
+static int conn_send(struct server *s, struct conn *c)
+{
+    switch(s->mode) {
+        case MODE_SENDFILE: return send_sendfile(s, c);
+        case MODE_SPLICE: return send_splice(s, c);
+        default: return send_copy(s, c);
+    }
+}
+
+// 返回 -1 表示连接已经关闭、c 已经释放
+static int on_event(struct server *s, struct conn *c, uint32_t revents)
+{
+    if(revents & (EPOLLERR | EPOLLHUP)) goto done;
+    if(c->file_fd == -1) {
+        // 读请求行，直到 '\n'
+        while(1) {
+            ssize_t n = recv(c->fd, c->req + c->req_len, MAX_REQ - 1 - c->req_len, 0);
+            if(n > 0) {
+                c->req_len += n;
+                char *nl = memchr(c->req, '\n', c->req_len);
+                if(nl) {
+                    c->req_len = nl - c->req;
+                    if(c->req_len > 0 && c->req[c->req_len - 1] == '\r') c->req_len -- ;
+                    break;
+                }
+                if(c->req_len == MAX_REQ - 1) {
+                    reply_error(s, c, "request too long");
+                    goto done;
+                }
+                continue;
+            }
+            if(n < 0 && errno == EINTR) continue;
+            if(n < 0 && errno == EAGAIN) return 0;
+            goto done;
+        }
+        if(open_request(s, c) == -1) goto done;
+    }
+    int r = conn_send(s, c);
+    if(r == 0) {
+        struct epoll_event ev;
+        ev.events = EPOLLOUT;
+        ev.data.ptr = c;
+        if(epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &ev) == 0) return 0;
+    }
+done:
+    conn_close(c);
+    return -1;
+}
+
+static void on_accept(struct server *s)
+{
+    while(1) {
+        int fd = accept4(s->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd == -1) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        struct conn *c = calloc(1, sizeof(*c));
+        if(!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->file_fd = -1;
+        c->pipe_fd[0] = c->pipe_fd[1] = -1;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        if(epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) conn_close(c);
+    }
+}
+
+static int create_listener(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd == -1) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static const struct bench_extra server_opts[] = {
+    {"mode", 'm', required_argument, 'm', "sendfile|splice|copy", "how file data is sent (default sendfile)"},
+    {"root", 'r', required_argument, 'r', "DIR", "directory files are served from (default .)"},
+    {NULL, 0, 0, 0, NULL, NULL},
+};
+
+struct server_args {
+    struct server *s;
+    const char *root;
+};
+
+static int on_option(int id, const char *arg, void *ctx)
+{
+    struct server_args *a = ctx;
+    switch(id) {
+        case 'm':
+            if(strcmp(arg, "sendfile") == 0) a->s->mode = MODE_SENDFILE;
+            else if(strcmp(arg, "splice") == 0) a->s->mode = MODE_SPLICE;
+            else if(strcmp(arg, "copy") == 0) a->s->mode = MODE_COPY;
+            else return -1;
+            return 0;
+        case 'r': a->root = arg; return 0;
+        default: return -1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct server s;
+    memset(&s, 0, sizeof(s));
+    s.mode = MODE_SENDFILE;
+    struct server_args args = {&s, "."};
+    const char *mode_names[] = {"sendfile", "splice", "copy"};
+    struct bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_BUF_SIZE, "<port>");
+    bench_list_set(&o.buf_size, COPY_BUF);
+    int idx = bench_opts_parse(&o, argc, argv, server_opts, on_option, &args);
+    if(idx <= 0) return idx < 0;
+    if(idx + 1 != argc || o.buf_size.v[0] > 1L << 30) {
+        bench_opts_usage(stderr, argv[0], &o, server_opts);
+        return 1;
+    }
+    const char *root = args.root;
+    s.buf_size = (size_t)o.buf_size.v[0];
+
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+
+    s.root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    s.listen_fd = create_listener(atoi(argv[idx]));
+    s.signal_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    s.epfd = epoll_create1(EPOLL_CLOEXEC);
+    s.buf = malloc(s.buf_size);
+    if(s.root_fd == -1 || s.listen_fd == -1 || s.signal_fd == -1 || s.epfd == -1 || !s.buf) error_handling("init error");
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &LISTEN_TAG;
+    if(epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.listen_fd, &ev) == -1) error_handling("epoll_ctl() error");
+    ev.events = EPOLLIN;
+    ev.data.ptr = &SIGNAL_TAG;
+    if(epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.signal_fd, &ev) == -1) error_handling("epoll_ctl() error");
+    printf("file server listening on port %s (mode=%s, root=%s)\n", argv[idx], mode_names[s.mode], root);
+
+    struct epoll_event events[MAX_EVENTS];
+    int stop = 0;
+    while(!stop) {
+        int n = epoll_wait(s.epfd, events, MAX_EVENTS, -1);
+        if(n == -1) {
+            if(errno == EINTR) continue;
+            perror("epoll_wait() error");
+            break;
+        }
+        for(int i = 0; i < n; i ++ ) {
+            void *tag = events[i].data.ptr;
+            if(tag == &LISTEN_TAG) on_accept(&s);
+            else if(tag == &SIGNAL_TAG) stop = 1;
+            else on_event(&s, tag, events[i].events);
+        }
+    }
+
+    // 退出时还没发完的连接随进程一起关闭
+    printf("requests=%llu errors=%llu bytes_out=%llu syscalls=%llu\n",
+           s.stats.requests, s.stats.errors, s.stats.bytes_out, s.stats.syscalls);
+    close(s.listen_fd);
+    close(s.signal_fd);
+    close(s.epfd);
+    close(s.root_fd);
+    free(s.buf);
+    return 0;
+}
+
+void error_handling(const char *message)
+{
+    perror(message);
+    exit(1);
+}
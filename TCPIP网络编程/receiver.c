@@ -1,48 +1,282 @@
+// 高速率的 UDP（组播）接收端，配合 sender.c 使用
+//
+// 原来的版本每个数据报一次 recvfrom + printf，十万 pps 左右就到顶了。这里：
+//   - recvmmsg 一次系统调用收一批数据报，缓冲区是启动时分配好的一整块（batch 个槽位），循环复用
+//   - -G 打开 UDP_GRO：内核把同一个流的多个数据报合并成一个大的交上来，cmsg 里带回每段的长度，这里再切开
+//   - -b 设置 SO_RCVBUF（没有权限时退回普通的 SO_RCVBUF，内核会把它限制在 rmem_max 以内）
+//   - SO_RXQ_OVFL：每个数据报带回接收队列溢出的累计丢包数
+//   - 不再逐个打印，每秒输出一行：pps、Mbps、按序号算出的丢包 / 乱序、内核丢包
+//   - sender.c 发出的每个数据报都带着流 id 和序号，不认识的数据报只计数
+//
+// 用法: ./receiver [-g group] [-b rcvbuf_bytes] [-B batch] [-G] [-p] <Port>
+//       -g 加入一个组播组，不给时只收发到本机的单播 / 广播；-p 像原来一样打印每个数据报的内容
+//       选项由 ../getopt/bench_opts.h 解析：-b 就是 --buf-size（可以写 8M）；-h 列出全部选项
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
+#include <stdint.h>
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
 #include <signal.h>
-#include <sys/wait.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 
-#define BUF_SIZE 1024
+#include "bench_opts.h"
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define BUF_SIZE 2048    // 不开 GRO 时每个槽位的大小，够放一个以太网 MTU 的数据报
+#define GRO_BUF_SIZE 65536
+#define MAX_STREAMS 64
+#define PKT_MAGIC 0x55445031u  // "UDP1"，和 sender.c 一致
+
+// 数据报开头的头部，和 sender.c 一致
+struct pkt_hdr {
+    uint32_t magic;
+    uint32_t stream;
+    uint64_t seq;
+    uint64_t send_ns;
+};
+
+// 一个发送端的序号状态：序号跳过的算丢失，之后又收到了就改记为乱序
+struct stream {
+    uint32_t id;
+    uint64_t next;  // 期望的下一个序号
+    unsigned long long received, lost, reordered;
+};
+
+struct rx_stats {
+    unsigned long long datagrams, bytes, syscalls, foreign;
+    uint32_t kernel_drops;  // SO_RXQ_OVFL 的累计值
+};
+
+static volatile sig_atomic_t g_stop = 0;
+static struct stream streams[MAX_STREAMS];
+static int nstreams = 0;
+
 void error_handling(const char* message);
 
+static void on_signal(int sig) { (void)sig; g_stop = 1; }
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static struct stream *find_stream(uint32_t id)
+{
+    for(int i = 0; i < nstreams; i ++ ) {
+        if(streams[i].id == id) return &streams[i];
+    }
+    if(nstreams == MAX_STREAMS) return NULL;
+    struct stream *s = &streams[nstreams ++ ];
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    return s;
+}
+
+static void on_datagram(struct rx_stats *st, const char *p, size_t n, int print)
+{
+    st->datagrams ++ ;
+    st->bytes += n;
+    if(print) printf("[%llu] %.*s", st->datagrams, (int)n, p);
+    struct pkt_hdr h;
+    if(n < sizeof(h)) {
+        st->foreign ++ ;
+        return;
+    }
+    memcpy(&h, p, sizeof(h));
+    struct stream *s = h.magic == PKT_MAGIC ? find_stream(h.stream) : NULL;
+    if(!s) {
+        st->foreign ++ ;
+        return;
+    }
+    s->received ++ ;
+    if(h.seq >= s->next) {
+        s->lost += h.seq - s->next;
+        s->next = h.seq + 1;
+    }
+    else if(s->lost > 0) {
+        s->lost -- ;
+        s->reordered ++ ;
+    }
+}
+
+static void totals(unsigned long long *lost, unsigned long long *reordered)
+{
+    *lost = *reordered = 0;
+    for(int i = 0; i < nstreams; i ++ ) {
+        *lost += streams[i].lost;
+        *reordered += streams[i].reordered;
+    }
+}
+
+static const struct bench_extra receiver_opts[] = {
+    {"group", 'g', required_argument, 'g', "ADDR", "multicast group to join"},
+    {NULL, 'b', required_argument, BENCH_ID_BUF_SIZE, "BYTES", "same as --buf-size: SO_RCVBUF (default: system)"},
+    {"batch", 'B', required_argument, 'B', "N", "datagrams per recvmmsg, at most 1024 (default 64)"},
+    {"gro", 'G', no_argument, 'G', NULL, "enable UDP_GRO"},
+    {"print", 'p', no_argument, 'p', NULL, "print every datagram"},
+    {NULL, 0, 0, 0, NULL, NULL},
+};
+
+struct receiver_args {
+    const char *group;
+    int batch, gro, print;
+};
+
+static int on_option(int id, const char *arg, void *ctx)
+{
+    struct receiver_args *a = ctx;
+    long v;
+    switch(id) {
+        case 'g': a->group = arg; return 0;
+        case 'G': a->gro = 1; return 0;
+        case 'p': a->print = 1; return 0;
+        case 'B':
+            if(bench_parse_long(arg, 1, &v) == -1 || v > 1024) return -1;
+            a->batch = (int)v;
+            return 0;
+        default: return -1;
+    }
+}
+
 int main(int argc, char **argv)
 {
-    // check command line argument 
-    if(argc != 2) {
-        printf("Usage : %s <Port> n", argv[0]);
-        exit(1);
+    struct receiver_args args = {NULL, 64, 0, 0};
+    struct bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_BUF_SIZE, "<Port>");
+    int idx = bench_opts_parse(&o, argc, argv, receiver_opts, on_option, &args);
+    if(idx <= 0) return idx < 0;
+    if(idx + 1 != argc || (o.buf_size.n && o.buf_size.v[0] > INT_MAX)) {
+        bench_opts_usage(stderr, argv[0], &o, receiver_opts);
+        return 1;
     }
+    const char *group = args.group;
+    int rcvbuf = o.buf_size.n ? (int)o.buf_size.v[0] : 0;
+    int batch = args.batch, gro = args.gro, print = args.print;
 
     // create receive socket and bind address
     int recv_sock = socket(PF_INET, SOCK_DGRAM, 0);
+    if(recv_sock == -1) error_handling("socket() error");
+    int one = 1;
+    setsockopt(recv_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));  // 同一台机器上可以开多个接收端
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof addr);
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(atoi(argv[1]));
+    addr.sin_port = htons(atoi(argv[idx]));
     if(bind(recv_sock, (struct sockaddr*)&addr, sizeof(addr)) == -1)
         error_handling("bind() error");
 
-    // receive multicast data 
-    char buf[BUF_SIZE];
-    int line = 0;
-    while(1)
-    {
-        ssize_t read_len = recvfrom(recv_sock, buf, BUF_SIZE- 1, 0, NULL, 0);
-        if(read_len < 0)
-            break;
-        buf[read_len] = 0;
-        printf("[%d] %s", ++ line, buf);
+    if(group) {
+        struct ip_mreq mreq;
+        if(inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1) error_handling("bad group address");
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if(setsockopt(recv_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
+            error_handling("setsockopt(IP_ADD_MEMBERSHIP) error");
+    }
+    if(rcvbuf > 0 && setsockopt(recv_sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) == -1)
+        setsockopt(recv_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    getsockopt(recv_sock, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+    setsockopt(recv_sock, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+    if(gro && setsockopt(recv_sock, IPPROTO_UDP, UDP_GRO, &one, sizeof(one)) == -1) {
+        perror("setsockopt(UDP_GRO) error, GRO disabled");
+        gro = 0;
+    }
+    // 阻塞的 recvmmsg 每 200ms 至少返回一次，好按时打印统计、响应 Ctrl-C
+    struct timeval tv = {0, 200000};
+    setsockopt(recv_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;  // 不带 SA_RESTART：recvmmsg 被信号打断后返回 EINTR
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // 预先分配好的 batch 个槽位，每次 recvmmsg 都从头填一遍
+    size_t slot = gro ? GRO_BUF_SIZE : BUF_SIZE;
+    char *bufs = malloc((size_t)batch * slot);
+    struct mmsghdr *msgs = calloc(batch, sizeof(*msgs));
+    struct iovec *iovs = calloc(batch, sizeof(*iovs));
+    size_t cspace = CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(int));
+    char *controls = calloc(batch, cspace);
+    if(!bufs || !msgs || !iovs || !controls) error_handling("malloc() error");
+    for(int i = 0; i < batch; i ++ ) {
+        iovs[i].iov_base = bufs + (size_t)i * slot;
+        iovs[i].iov_len = slot;
     }
+    printf("receiving on port %s%s%s (batch=%d, rcvbuf=%d, gro=%s)\n", argv[idx], group ? " group " : "",
+           group ? group : "", batch, actual, gro ? "on" : "off");
+
+    struct rx_stats st, last;
+    memset(&st, 0, sizeof(st));
+    last = st;
+    unsigned long long last_lost = 0;
+    uint64_t start = now_ns(), tick = start;
+    while(!g_stop) {
+        for(int i = 0; i < batch; i ++ ) {
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = controls + (size_t)i * cspace;
+            msgs[i].msg_hdr.msg_controllen = cspace;
+        }
+        // MSG_WAITFORONE：等到第一个数据报，之后有多少拿多少，不再等
+        int n = recvmmsg(recv_sock, msgs, batch, MSG_WAITFORONE, NULL);
+        st.syscalls ++ ;
+        if(n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) error_handling("recvmmsg() error");
+        for(int i = 0; i < n; i ++ ) {
+            int seg = 0;
+            for(struct cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cm; cm = CMSG_NXTHDR(&msgs[i].msg_hdr, cm)) {
+                if(cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) memcpy(&st.kernel_drops, CMSG_DATA(cm), sizeof(uint32_t));
+                if(cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO) memcpy(&seg, CMSG_DATA(cm), sizeof(int));
+            }
+            const char *p = iovs[i].iov_base;
+            size_t total = msgs[i].msg_len;
+            if(seg <= 0) seg = total;  // 没有被合并
+            for(size_t off = 0; off < total; off += seg) {
+                size_t len = total - off < (size_t)seg ? total - off : (size_t)seg;
+                on_datagram(&st, p + off, len, print);
+            }
+        }
 
+        uint64_t now = now_ns();
+        if(now - tick >= 1000000000ull) {
+            double secs = (now - tick) / 1e9;
+            unsigned long long lost, reordered;
+            totals(&lost, &reordered);
+            printf("rx %.0f pps %.1f Mbps  lost=%llu (+%llu) reordered=%llu kernel_drops=%u dgrams/syscall=%.1f\n",
+                   (st.datagrams - last.datagrams) / secs, (st.bytes - last.bytes) * 8 / secs / 1e6,
+                   lost, lost - last_lost, reordered, st.kernel_drops,
+                   st.syscalls > last.syscalls ? (double)(st.datagrams - last.datagrams) / (st.syscalls - last.syscalls) : 0.0);
+            fflush(stdout);
+            last = st;
+            last_lost = lost;
+            tick = now;
+        }
+    }
+
+    double secs = (now_ns() - start) / 1e9;
+    unsigned long long lost, reordered;
+    totals(&lost, &reordered);
+    printf("total: datagrams=%llu bytes=%llu syscalls=%llu avg_pps=%.0f streams=%d lost=%llu reordered=%llu "
+           "kernel_drops=%u foreign=%llu\n", st.datagrams, st.bytes, st.syscalls, st.datagrams / secs, nstreams,
+           lost, reordered, st.kernel_drops, st.foreign);
     close(recv_sock);
+    free(bufs);
+    free(msgs);
+    free(iovs);
+    free(controls);
     return 0;
 }
 
@@ -50,4 +284,4 @@ void error_handling(const char* message)
 {
     perror(message);
     exit(1);
-}
\ No newline at end of file
+}
@@ -0,0 +1,248 @@
+// UDP（组播）发送端 / 负载发生器，配合 receiver.c 测 pps 和丢包
+//
+// 每个数据报开头是 struct pkt_hdr：流 id（每个发送进程一个）+ 递增的序号 + 发送时间，接收端据此统计丢包和乱序
+//   - sendmmsg 一次系统调用发一批
+//   - -S N 打开 UDP_SEGMENT（GSO）：一个 N 倍大小的缓冲区交给内核，由内核（或网卡）切成 N 个数据报，
+//     N 个数据报只走一遍协议栈
+//   - -r 限速（令牌桶，按已经过去的时间算出允许发多少），0 表示不限速
+//   - 每秒打印一行发送速率，结束时打印总数；都只算 sendmmsg 真正接受的数据报，出错没发出去的退回序号重发，另计 unsent
+//
+// 用法: ./sender [-r pps] [-s payload_bytes] [-d seconds] [-n count] [-B batch] [-S segments] [-t ttl] <IP> <Port>
+//       IP 是组播地址时按组播发送（本机的接收端同样收得到），否则按单播发送
+//       选项由 ../getopt/bench_opts.h 解析：-d 就是 --duration（也可以写 500ms）；-h 列出全部选项
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#include "bench_opts.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#define PKT_MAGIC 0x55445031u  // "UDP1"，和 receiver.c 一致
+#define MAX_PAYLOAD 1472       // 1500 字节的 MTU 减去 IP 和 UDP 头
+#define MAX_SEGMENTS 64        // 内核对一次 GSO 的段数限制
+
+// 数据报开头的头部，和 receiver.c 一致
+struct pkt_hdr {
+    uint32_t magic;
+    uint32_t stream;
+    uint64_t seq;
+    uint64_t send_ns;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+void error_handling(const char* message);
+
+static void on_signal(int sig) { (void)sig; g_stop = 1; }
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static const struct bench_extra sender_opts[] = {
+    {"rate", 'r', required_argument, 'r', "PPS", "datagrams per second, 0 is unlimited (default 0)"},
+    {"size", 's', required_argument, 's', "BYTES", "payload per datagram (default 1024)"},
+    {NULL, 'd', required_argument, BENCH_ID_DURATION, "TIME", "same as --duration (default 5s)"},
+    {"count", 'n', required_argument, 'n', "N", "stop after N datagrams instead of after the duration"},
+    {"batch", 'B', required_argument, 'B', "N", "entries per sendmmsg, at most 1024 (default 64)"},
+    {"segments", 'S', required_argument, 'S', "N", "UDP_SEGMENT datagrams per entry (default 1)"},
+    {"ttl", 't', required_argument, 't', "N", "multicast TTL (default 1)"},
+    {NULL, 0, 0, 0, NULL, NULL},
+};
+
+struct sender_args {
+    long rate, count;
+    int payload, batch, segments, ttl;
+};
+
+static int on_option(int id, const char *arg, void *ctx)
+{
+    struct sender_args *a = ctx;
+    long v;
+    if(bench_parse_long(arg, id == 'r' || id == 'n' ? 0 : 1, &v) == -1) return -1;
+    switch(id) {
+        case 'r': a->rate = v; return 0;
+        case 'n': a->count = v; return 0;
+        case 's':
+            if(v < (long)sizeof(struct pkt_hdr) || v > MAX_PAYLOAD) return -1;
+            a->payload = (int)v;
+            return 0;
+        case 'B':
+            if(v > 1024) return -1;
+            a->batch = (int)v;
+            return 0;
+        case 'S':
+            if(v > MAX_SEGMENTS) return -1;
+            a->segments = (int)v;
+            return 0;
+        case 't':
+            if(v > 255) return -1;
+            a->ttl = (int)v;
+            return 0;
+        default: return -1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct sender_args args = {0, 0, 1024, 64, 1, 1};
+    struct bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_DURATION, "<IP> <Port>");
+    o.duration_ms = 5000;
+    int idx = bench_opts_parse(&o, argc, argv, sender_opts, on_option, &args);
+    if(idx <= 0) return idx < 0;
+    if(idx + 2 != argc) {
+        bench_opts_usage(stderr, argv[0], &o, sender_opts);
+        return 1;
+    }
+    long rate = args.rate, count = args.count;
+    int payload = args.payload, batch = args.batch, segments = args.segments, ttl = args.ttl;
+
+    int send_sock = socket(PF_INET, SOCK_DGRAM, 0);
+    if(send_sock == -1) error_handling("socket() error");
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(atoi(argv[idx + 1]));
+    if(inet_pton(AF_INET, argv[idx], &addr.sin_addr) != 1) error_handling("bad address");
+    if(IN_MULTICAST(ntohl(addr.sin_addr.s_addr))) {
+        // TTL 默认 1：不出本网段；IP_MULTICAST_LOOP 默认打开，本机的接收端也能收到
+        setsockopt(send_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    }
+    if(connect(send_sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) error_handling("connect() error");
+    int sndbuf = 4 * 1024 * 1024;
+    setsockopt(send_sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // batch 个 sendmmsg 条目，每个条目 segments 个数据报；开了 GSO 时条目上带一个 UDP_SEGMENT 的 cmsg
+    size_t entry = (size_t)payload * segments;
+    char *bufs = calloc(batch, entry);
+    struct mmsghdr *msgs = calloc(batch, sizeof(*msgs));
+    struct iovec *iovs = calloc(batch, sizeof(*iovs));
+    size_t cspace = CMSG_SPACE(sizeof(uint16_t));
+    char *controls = calloc(batch, cspace);
+    if(!bufs || !msgs || !iovs || !controls) error_handling("malloc() error");
+    for(int i = 0; i < batch; i ++ ) {
+        for(size_t k = sizeof(struct pkt_hdr); k < entry; k ++ ) bufs[(size_t)i * entry + k] = 'a' + k % 26;
+        iovs[i].iov_base = bufs + (size_t)i * entry;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if(segments > 1) {
+            msgs[i].msg_hdr.msg_control = controls + (size_t)i * cspace;
+            msgs[i].msg_hdr.msg_controllen = cspace;
+            struct cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+            cm->cmsg_level = IPPROTO_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso = payload;
+            memcpy(CMSG_DATA(cm), &gso, sizeof(gso));
+        }
+    }
+
+    struct pkt_hdr h;
+    h.magic = PKT_MAGIC;
+    h.stream = (uint32_t)getpid() ^ (uint32_t)now_ns();
+    h.seq = 0;
+    printf("sending to %s:%s (payload=%d, batch=%d, segments=%d, rate=%ld pps, stream=%08x)\n",
+           argv[idx], argv[idx + 1], payload, batch, segments, rate, h.stream);
+
+    unsigned long long syscalls = 0, errors = 0, last_sent = 0;
+    unsigned long long unsent = 0;  // sendmmsg 出错时没能发出去、之后重发的数据报数
+    uint64_t start = now_ns(), tick = start, end = start + (uint64_t)o.duration_ms * 1000000ull;
+    while(!g_stop && (count ? h.seq < (uint64_t)count : now_ns() < end)) {
+        uint64_t now = now_ns();
+        long budget = batch * segments;
+        if(rate > 0) {
+            // 令牌桶：到现在为止允许发 rate * 已过时间 个，还没到就睡到下一个数据报的时刻
+            long allowed = (long)((double)rate * (now - start) / 1e9) - (long)h.seq;
+            if(allowed <= 0) {
+                struct timespec ts = {0, 1000000000L / rate > 50000 ? 1000000000L / rate : 50000};
+                nanosleep(&ts, NULL);
+                continue;
+            }
+            if(allowed < budget) budget = allowed;
+        }
+        if(count && (uint64_t)budget > count - h.seq) budget = count - h.seq;
+
+        // 填好每个数据报的头部；最后一个条目可能不满 segments 个
+        int entries = 0;
+        while(budget > 0) {
+            int segs = budget < segments ? (int)budget : segments;
+            char *p = iovs[entries].iov_base;
+            for(int k = 0; k < segs; k ++ ) {
+                h.send_ns = now;
+                memcpy(p + (size_t)k * payload, &h, sizeof(h));
+                h.seq ++ ;
+            }
+            iovs[entries].iov_len = (size_t)segs * payload;
+            // 只剩一段时不能带 UDP_SEGMENT（段长等于总长时有的内核会拒绝）
+            msgs[entries].msg_hdr.msg_controllen = segs > 1 ? cspace : 0;
+            budget -= segs;
+            entries ++ ;
+        }
+        int done = 0;
+        while(done < entries) {
+            int n = sendmmsg(send_sock, msgs + done, entries - done, 0);
+            syscalls ++ ;
+            if(n > 0) {
+                done += n;
+                continue;
+            }
+            if(errno == EINTR && !g_stop) continue;
+            // ENOBUFS 等：本地队列满了，这一批剩下的没发出去。它们是一段后缀，把序号退回去，
+            // 下一轮用同样的序号重新填，这样 h.seq 只算真正交给内核的数据报，接收端也不会把它们算成网络丢包
+            errors ++ ;
+            break;
+        }
+        for(int i = done; i < entries; i ++ ) {
+            uint64_t segs = iovs[i].iov_len / payload;
+            h.seq -= segs;
+            unsent += segs;
+        }
+
+        if(now - tick >= 1000000000ull) {
+            double secs = (now - tick) / 1e9;
+            printf("tx %.0f pps %.1f Mbps\n", (h.seq - last_sent) / secs, (h.seq - last_sent) * payload * 8 / secs / 1e6);
+            fflush(stdout);
+            last_sent = h.seq;
+            tick = now;
+        }
+    }
+
+    double secs = (now_ns() - start) / 1e9;
+    printf("total: datagrams=%llu syscalls=%llu errors=%llu unsent=%llu avg_pps=%.0f avg_Mbps=%.1f\n",
+           (unsigned long long)h.seq, syscalls, errors, unsent, h.seq / secs, h.seq * payload * 8 / secs / 1e6);
+    close(send_sock);
+    free(bufs);
+    free(msgs);
+    free(iovs);
+    free(controls);
+    return 0;
+}
+
+void error_handling(const char* message)
+{
+    perror(message);
+    exit(1);
+}
@@ -1,9 +1,16 @@
 #pragma once
+#include <algorithm>
+#include <cassert>
 #include <concepts>
+#include <cstddef>
+#include <exception>
 #include <functional>
+#include <future>
 #include <memory>
+#include <span>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "core/logger.hpp"
@@ -30,6 +37,22 @@ concept Stage = requires(F f, int x) {
     { f(x) } -> std::convertible_to<int>;
 };
 
+/**
+ * @brief 可以在编译期求值的阶段：无状态、可默认构造，且 `F{}(1)` 是常量表达式
+ *
+ * 无捕获且函数体满足 constexpr 要求的 lambda 都满足它。
+ */
+template <class F>
+concept ConstexprStage = std::is_empty_v<F> && std::default_initializable<F> &&
+                         requires { typename std::integral_constant<int, F{}(1)>; };
+
+/** @brief 仿射变换 a*x + b，Pipeline 的 Add / Mul 链在编译期折叠成的形式 */
+struct Affine {
+    int a = 1;
+    int b = 0;
+    constexpr int operator()(int x) const noexcept { return a * x + b; }
+};
+
 /**
  * @brief 可组合的整数处理管线
  * @tparam S 可变参数阶段（满足 Stage）
@@ -40,7 +63,14 @@ class Pipeline {
     explicit Pipeline(S... s) : stages_{std::move(s)...} {}
 
     /**
-     * @brief 从 Reader 读取、经过各阶段，构建 AST 并求值
+     * @brief 从 Reader 读取一个值，用各阶段构建 AST 并求值
+     *
+     * 注意这里的阶段不是直接作用在输入上的函数：第 I 个阶段只贡献常量 s(1)，偶数下标是 Add、
+     * 奇数下标是 Mul，结果是 ((v + s0(1)) * s1(1)) + s2(1) ...。consume() / run_batch() 的含义不同，
+     * 它们依次调用各阶段 s2(s1(s0(v)))；例如 main.cpp 的 +1、*2、+3 对 5：run() 得 18，run_batch() 得 15。
+     *
+     * 所有阶段都满足 ConstexprStage（kFoldable）时，AST 在编译期折叠成 kAffine：
+     * run() 不分配内存，求值只是一次乘法加一次加法，只有 Logger 打开了 info 级别时才构建 AST 用于输出。
      *
      * @dot
      * digraph seq {
@@ -58,19 +88,181 @@ class Pipeline {
     int run(Reader& r) {
         auto res = r.read_one();
         if (!res.has_value()) {
-            Logger::instance().error("read failed: " + res.error());
+            Logger::instance().errorf("read failed: %s", demo::io::to_string(res.error()));
             return 0;
         }
         int v = res.value();
-        std::unique_ptr<Node> ast = std::make_unique<Literal>(v);
-        build_ast<0>(ast);
-        Logger::instance().info("AST = " + to_string(*ast));
-        return ast->eval();
+        if constexpr (kFoldable) {
+            if (Logger::instance().info_enabled()) Logger::instance().info("AST = " + to_string(*make_ast(v)));
+            return kAffine(v);
+        } else {
+            std::unique_ptr<Node> ast = make_ast(v);
+            if (Logger::instance().info_enabled()) Logger::instance().info("AST = " + to_string(*ast));
+            return ast->eval();
+        }
+    }
+
+    /// 所有阶段都能在编译期求值，build_ast 生成的表达式可以折叠
+    static constexpr bool kFoldable = (ConstexprStage<S> && ...);
+
+    /// 折叠后的表达式：kAffine(v) 与 run() 中 AST 的 eval() 结果相同；不可折叠时为恒等变换
+    static constexpr Affine kAffine = [] {
+        Affine f;
+        if constexpr (kFoldable) {
+            std::size_t i = 0;
+            // 与 build_ast 一致：偶数下标的阶段是 Add，奇数下标的是 Mul，常量都是 s(1)
+            ((f = i++ % 2 == 0 ? Affine{f.a, f.b + S{}(1)} : Affine{f.a * S{}(1), f.b * S{}(1)}), ...);
+        }
+        return f;
+    }();
+
+    /**
+     * @brief 流式处理 Reader 中的全部输入
+     *
+     * 每次 read_batch() 读入一批（kBatch 个），逐个值依次经过各阶段，再把这一批结果交给 sink。
+     * 结果与 run_batch() 相同，与 run() 的 AST 求值不同（见 run()）。
+     * 每批只有一次虚调用，也不构建 AST，适合百万级的输入。
+     *
+     * @param sink 以 `std::span<const int>` 接收每一批结果
+     * @return 处理过的值的个数；读取失败时记录错误，返回失败之前处理过的个数
+     */
+    template <class Sink>
+    std::size_t consume(Reader& r, Sink&& sink) {
+        std::vector<int> buf(kBatch);
+        std::size_t total = 0;
+        while (true) {
+            auto res = r.read_batch(buf);
+            if (!res.has_value()) {
+                Logger::instance().errorf("read failed: %s", demo::io::to_string(res.error()));
+                break;
+            }
+            std::size_t n = res.value();
+            if (n == 0) break;
+            run_batch(std::span<const int>(buf.data(), n), std::span<int>(buf.data(), n));
+            sink(std::span<const int>(buf.data(), n));
+            total += n;
+        }
+        return total;
+    }
+
+    /**
+     * @brief 批量执行：out[i] = 各阶段依次作用于 in[i]
+     *
+     * 即 out[i] = s2(s1(s0(in[i])))，不是 run() 那种用 s(1) 常量构建的 AST（见 run()）。
+     *
+     * 按 kBatch 个值分块处理，一块的输入输出（32 KiB）留在 L1/L2 里：
+     *  - 所有阶段都无状态（kFusable，例如无捕获的 lambda）时，各阶段在编译期通过 std::tuple 融合成
+     *    一个表达式，每块只走一遍循环，编译器可以自动向量化；
+     *  - 否则逐个阶段扫一遍这一块，每个阶段看到的值仍然按输入顺序。
+     *
+     * in 和 out 可以是同一块内存（原地处理），但不能部分重叠。
+     * @pre out.size() >= in.size()
+     */
+    void run_batch(std::span<const int> in, std::span<int> out) {
+        assert(out.size() >= in.size());
+        for (std::size_t off = 0; off < in.size(); off += kBatch) {
+            std::size_t n = in.size() - off;
+            // 整块走常量长度的版本：循环次数编译期已知，-O2 下也能向量化
+            if (n >= kBatch) run_chunk<kBatch>(in.data() + off, out.data() + off);
+            else run_chunk(in.data() + off, out.data() + off, n);
+        }
+    }
+
+    /**
+     * @brief 同 run_batch(in, out)，输入较大时把分块分给线程池并行处理
+     *
+     * 每个任务至少处理 kParallelMin 个值，最后一段在调用线程上执行，然后等待其它任务完成。
+     * 无论是任务、调用线程上的最后一段还是 add_future_task() 抛出异常，都先等已经提交的任务全部结束
+     * （它们引用着 this、in 和 out），再重新抛出第一个异常。Pool 只需提供返回 std::future 的 add_future_task()，
+     * 例如 thread_pool/src/v4.hpp 中的 ThreadPool。阶段会被多个线程同时调用，所以要求 kConcurrent：
+     * 可以融合的阶段走融合的循环，带捕获的阶段逐阶段处理各自的分段，结果都与单线程的 run_batch 相同。
+     * @pre 通过 const 引用调用阶段是线程安全的（std::function 也能 const 调用，包装的目标需要自己保证这一点）
+     */
+    template <class Pool>
+    requires requires(Pool& pool) { pool.add_future_task([] {}).get(); }
+    void run_batch(std::span<const int> in, std::span<int> out, Pool& pool) {
+        static_assert(kConcurrent, "parallel run_batch requires stages callable through a const reference");
+        assert(out.size() >= in.size());
+        if (in.size() < 2 * kParallelMin) {
+            run_batch(in, out);
+            return;
+        }
+        std::size_t parts = in.size() / kParallelMin;
+        // 每段长度向上取整到 kBatch 的倍数，让分块的边界和单线程时一致
+        std::size_t step = (in.size() / parts + kBatch - 1) / kBatch * kBatch;
+        std::vector<std::future<void>> futures;
+        futures.reserve(parts);  // 任务数不超过 parts：提交之后的 push_back 不会再分配、不会抛出
+        std::exception_ptr error;
+        try {
+            std::size_t off = 0;
+            for (; in.size() - off > step; off += step) {
+                futures.push_back(pool.add_future_task(
+                    [this, in = in.subspan(off, step), out = out.subspan(off, step)] { run_batch(in, out); }));
+            }
+            run_batch(in.subspan(off), out.subspan(off));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // std::future 析构时不会等待，所以每一个都要 get() 完再返回
+        for (auto& f : futures) {
+            try {
+                f.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
     }
 
+    /// consume() 每批读取的值的个数，也是 run_batch() 分块的大小（16 KiB 的 int，能留在 L1/L2 里）
+    static constexpr std::size_t kBatch = 4096;
+
+    /// 并行 run_batch() 中每个任务至少处理的值的个数，再小的话任务调度的开销比计算还大
+    static constexpr std::size_t kParallelMin = 64 * 1024;
+
+    /// 所有阶段都不带状态（空类型，例如无捕获的 lambda），可以融合，也可以被多个线程同时调用
+    static constexpr bool kFusable = (std::is_empty_v<S> && ...);
+
+    /// 所有阶段都可以被多个线程同时调用：无状态，或者能通过 const 引用调用（例如不带 mutable 的捕获 lambda）
+    static constexpr bool kConcurrent = ((std::is_empty_v<S> || std::is_invocable_r_v<int, const S&, int>) && ...);
+
    private:
     std::tuple<S...> stages_;
 
+    /// 依次应用各阶段
+    int apply(int x) {
+        return std::apply([x](auto&... s) mutable { ((x = s(x)), ...); return x; }, stages_);
+    }
+
+    template <std::size_t N>
+    void run_chunk(const int* in, int* out) {
+        run_chunk(in, out, N);
+    }
+
+    void run_chunk(const int* in, int* out, std::size_t n) {
+        if constexpr (kFusable) {
+            // in / out 要么相同要么不重叠，不存在跨迭代的依赖，省掉编译器为可能的别名生成的运行时检查
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#endif
+            for (std::size_t i = 0; i < n; ++i) out[i] = apply(in[i]);
+        } else {
+            if (in != out) std::copy(in, in + n, out);
+            std::apply([&](auto&... s) { (stage_pass(s, out, n), ...); }, stages_);
+        }
+    }
+
+    template <class F>
+    static void stage_pass(F& s, int* p, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) p[i] = s(p[i]);
+    }
+
+    std::unique_ptr<Node> make_ast(int v) {
+        std::unique_ptr<Node> ast = std::make_unique<Literal>(v);
+        build_ast<0>(ast);
+        return ast;
+    }
+
     template <std::size_t I, std::size_t N = sizeof...(S)>
     requires(I >= N) void build_ast(std::unique_ptr<Node>&) { /* 终止：无操作 */
     }
@@ -0,0 +1,159 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+#include "core/node.hpp"
+
+/**
+ * @file
+ * @brief 基于 std::variant 的 AST 与静态分发的访问者
+ * @ingroup Core
+ */
+
+namespace demo::core::expr {
+
+using Id = std::uint32_t;
+
+struct Literal { int value; };
+struct Add { Id lhs, rhs; };
+struct Mul { Id lhs, rhs; };
+
+/// 节点是值类型的 variant，没有虚表；子节点用下标引用
+using Node = std::variant<Literal, Add, Mul>;
+
+/**
+ * @brief 用 variant 节点表示的表达式，所有节点连续存放
+ *
+ * 每个节点最多被一个父节点引用（树），IncrementalEvaluator 依赖这一点。
+ */
+class Expr {
+public:
+  Id literal(int v) { return push(Literal{v}); }
+  Id add(Id a, Id b) { return push(Add{a, b}); }
+  Id mul(Id a, Id b) { return push(Mul{a, b}); }
+
+  /// 求值的起点；不调用 set_root() 时是最近一次 literal() / add() / mul() 返回的 Id
+  Id root() const noexcept { return root_; }
+  void set_root(Id i) noexcept { root_ = i; }
+
+  std::size_t size() const noexcept { return nodes_.size(); }
+  const Node& operator[](Id i) const noexcept { return nodes_[i]; }
+  Node& operator[](Id i) noexcept { return nodes_[i]; }
+
+  /// 由 core::post_order() 逐个节点加入；Mul 共享的子树复制成多份，所以结果总是一棵树
+  static Expr from_tree(const core::Node& root);
+
+private:
+  Id push(Node n) {
+    root_ = static_cast<Id>(nodes_.size());
+    nodes_.push_back(n);
+    return root_;
+  }
+
+  std::vector<Node> nodes_;
+  Id root_ = 0;
+};
+
+/**
+ * @brief 访问者（CRTP），与 core::Visitor 的分发方式相同，作用于 expr::Node 的各个分支
+ *
+ * Derived 为每种节点提供 `R visit(const X&)`；apply(id) 通过 std::visit 分发到对应的 visit，
+ * 全部是编译期确定的调用，可以内联，没有虚表加载。
+ */
+template <class Derived, class R>
+struct Visitor {
+  explicit Visitor(const Expr& e) noexcept : expr(e) {}
+
+  R apply(Id id) { return std::visit(static_cast<Derived&>(*this), expr[id]); }
+
+  R operator()(const Add& n)    { return static_cast<Derived*>(this)->visit(n); }
+  R operator()(const Mul& n)    { return static_cast<Derived*>(this)->visit(n); }
+  R operator()(const Literal& n){ return static_cast<Derived*>(this)->visit(n); }
+
+  const Expr& expr;
+};
+
+/** @brief 求值 */
+struct Evaluator : Visitor<Evaluator, int> {
+  using Visitor::Visitor;
+  int visit(const Literal& n) const noexcept { return n.value; }
+  int visit(const Add& n) { return apply(n.lhs) + apply(n.rhs); }
+  int visit(const Mul& n) { return apply(n.lhs) * apply(n.rhs); }
+};
+
+/** @brief 输出，与 core::Node::dump() 的格式相同 */
+struct Printer : Visitor<Printer, void> {
+  Printer(const Expr& e, std::ostream& o) noexcept : Visitor(e), os(o) {}
+  void visit(const Literal& n) { os << n.value; }
+  void visit(const Add& n) { os << "("; apply(n.lhs); os << " + "; apply(n.rhs); os << ")"; }
+  void visit(const Mul& n) { os << "("; apply(n.lhs); os << " * "; apply(n.rhs); os << ")"; }
+  std::ostream& os;
+};
+
+inline int eval(const Expr& e) { return e.size() ? Evaluator(e).apply(e.root()) : 0; }
+
+inline std::ostream& operator<<(std::ostream& os, const Expr& e){
+  if (e.size()) Printer(e, os).apply(e.root());
+  return os;
+}
+
+/**
+ * @brief 增量求值：缓存每个子树的结果，修改 Literal 后只重新计算它到根的路径
+ *
+ * set_literal() 只把这条路径标记为脏（遇到已经脏的祖先就停），value() 从根往下只进入脏的节点，
+ * 干净的子树直接用缓存。一批修改共享的路径只算一次。
+ *
+ * 缓存、脏标记和父节点表在构造时按 Expr 当时的节点数建好，之后不能再往 Expr 里加节点
+ * （要改结构就重新构造一个 IncrementalEvaluator）；set_literal() / value() 碰到构造之后才有的节点会抛异常。
+ */
+class IncrementalEvaluator : public Visitor<IncrementalEvaluator, int> {
+public:
+  /// @throw std::invalid_argument 某个节点被多个父节点引用
+  explicit IncrementalEvaluator(Expr& e);
+
+  /// 根节点的当前值
+  /// @throw std::out_of_range 根节点是构造之后才加入的
+  int value() { return expr_.size() ? cached(known(expr_.root())) : 0; }
+
+  /// 修改一个 Literal 的值；id 必须是 Literal 节点
+  /// @throw std::out_of_range id 是构造之后才加入的节点
+  void set_literal(Id id, int v) {
+    auto& lit = std::get<Literal>(expr_[known(id)]);
+    if (lit.value == v) return;
+    lit.value = v;
+    for (Id i = id; i != kNoParent && !dirty_[i]; i = parent_[i]) dirty_[i] = 1;
+  }
+
+  /// 到目前为止重新计算过的节点数（统计用）
+  std::size_t recomputed() const noexcept { return recomputed_; }
+
+  int visit(const Literal& n) const noexcept { return n.value; }
+  int visit(const Add& n) { return cached(n.lhs) + cached(n.rhs); }
+  int visit(const Mul& n) { return cached(n.lhs) * cached(n.rhs); }
+
+private:
+  static constexpr Id kNoParent = ~Id{0};
+
+  Id known(Id id) const {
+    if (id >= cache_.size()) throw std::out_of_range("IncrementalEvaluator: node added after construction");
+    return id;
+  }
+
+  int cached(Id id) {
+    if (!dirty_[id]) return cache_[id];
+    cache_[id] = apply(id);
+    dirty_[id] = 0;
+    ++recomputed_;
+    return cache_[id];
+  }
+
+  Expr& expr_;
+  std::vector<int> cache_;
+  std::vector<std::uint8_t> dirty_;  // 一开始全是脏的，第一次 value() 就是完整求值
+  std::vector<Id> parent_;
+  std::size_t recomputed_ = 0;
+};
+
+} // namespace demo::core::expr
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "core/node.hpp"
+
+/**
+ * @file
+ * @brief 扁平（基于下标）的 AST 表示
+ * @ingroup Core
+ */
+
+namespace demo::core {
+
+/**
+ * @brief 扁平 AST：所有节点连续存放在一个 vector 里，子节点用下标引用
+ *
+ * 与 Node 树相比：没有虚函数、没有散落在堆上的指针，也没有 Mul 里 shared_ptr 的原子引用计数。
+ * 子节点总是先于父节点加入（下标更小），所以节点数组天然是拓扑序，
+ * eval() 从前往后扫一遍就能算出每个节点的值，不递归，树再深也不会栈溢出。
+ */
+class FlatAst {
+public:
+  using Index = std::uint32_t;
+
+  /// 16 字节的节点：Literal 用 value，Add / Mul 用 lhs / rhs
+  struct FlatNode {
+    Kind kind;
+    int value;
+    Index lhs, rhs;
+  };
+
+  Index literal(int v);
+  Index add(Index a, Index b);
+  Index mul(Index a, Index b);
+
+  /// 根节点，默认是最后加入的节点
+  Index root() const noexcept { return root_; }
+  void set_root(Index i) noexcept { root_ = i; }
+
+  std::size_t size() const noexcept { return nodes_.size(); }
+  bool empty() const noexcept { return nodes_.empty(); }
+  const FlatNode& operator[](Index i) const noexcept { return nodes_[i]; }
+  void reserve(std::size_t n) { nodes_.reserve(n); }
+  void clear() noexcept { nodes_.clear(); root_ = 0; }
+
+  /// 计算根节点的值；scratch 存放每个节点的中间结果，重复求值时传同一个就不会再分配
+  int eval(std::vector<int>& scratch) const;
+  int eval() const { std::vector<int> scratch; return eval(scratch); }
+
+  /// 与 Node::dump() 相同的格式
+  void dump(std::ostream& os) const;
+
+  /// 把现有的 Node 树转换过来（显式栈的后序遍历）；Mul 共享的子树会被展开成多份
+  static FlatAst from_tree(const Node& root);
+
+private:
+  Index push(FlatNode n);
+
+  std::vector<FlatNode> nodes_;
+  Index root_ = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const FlatAst& ast){ ast.dump(os); return os; }
+
+} // namespace demo::core
@@ -1,25 +1,171 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 
 /**
  * @file
- * @brief 线程安全 Logger（PImpl）
+ * @brief 线程安全 Logger（PImpl），可切换为异步后端
  * @ingroup Core
  */
 
 namespace demo::core {
 
+namespace detail {
+
+/// 一条日志记录的参数区大小，整条记录 256 字节
+inline constexpr std::size_t kLogPayload = 224;
+
+/**
+ * @brief 定长的日志记录：格式串 + 按值编码的参数，格式化推迟到真正输出的时候
+ *
+ * 字符串参数复制进 payload（超长时截断），其它参数按原样 memcpy；
+ * format 是按参数类型实例化出来的解码函数，解码后交给 snprintf。
+ */
+struct LogRecord {
+  using FormatFn = int (*)(const LogRecord&, char* out, std::size_t cap);
+  FormatFn format;
+  const char* tag;
+  const char* fmt;                 ///< 必须是字符串字面量之类的静态存储，异步输出时才会读取
+  std::uint32_t used;              ///< payload 已用的字节数
+  alignas(8) unsigned char payload[kLogPayload];
+};
+static_assert(sizeof(LogRecord) == 256);
+
+template <class T>
+inline constexpr bool is_log_string_v =
+    std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+    std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+/// 参数在记录里按什么类型保存：数组退化成指针，去掉引用和 const
+template <class T>
+using log_arg_t = std::decay_t<const T&>;
+
+/// 可以写进日志记录的参数：字符串、算术类型和指针（按 %p 输出地址）
+template <class T>
+concept LogArg = is_log_string_v<log_arg_t<T>> || std::is_arithmetic_v<log_arg_t<T>> ||
+                 std::is_pointer_v<log_arg_t<T>>;
+
+/// 参数在 payload 里至少占的字节数；字符串是 2 字节长度 + 结尾的 '\0'
+template <class T>
+inline constexpr std::size_t log_min_size_v = is_log_string_v<T> ? 3 : sizeof(T);
+
+/// 解码后交给 snprintf 的类型：字符串变成指向 payload 的 const char*
+template <class T>
+using log_decoded_t = std::conditional_t<is_log_string_v<T>, const char*, T>;
+
+inline void log_put_string(LogRecord& r, std::string_view s, std::size_t reserve) {
+  std::size_t room = kLogPayload - r.used - reserve - 3;  // reserve：后面的参数至少还要这么多
+  std::uint16_t n = static_cast<std::uint16_t>(s.size() < room ? s.size() : room);
+  std::memcpy(r.payload + r.used, &n, sizeof(n));
+  std::memcpy(r.payload + r.used + 2, s.data(), n);
+  r.payload[r.used + 2 + n] = '\0';
+  r.used += 3 + n;
+}
+
+template <class T>
+void log_put(LogRecord& r, const T& v, std::size_t reserve) {
+  if constexpr (is_log_string_v<T> && std::is_pointer_v<T>) {
+    log_put_string(r, v ? std::string_view(v) : std::string_view("(null)"), reserve);
+  } else if constexpr (is_log_string_v<T>) {
+    log_put_string(r, v, reserve);
+  } else {
+    std::memcpy(r.payload + r.used, &v, sizeof(T));
+    r.used += sizeof(T);
+  }
+}
+
+template <class T>
+log_decoded_t<T> log_get(const unsigned char*& p) {
+  if constexpr (is_log_string_v<T>) {
+    std::uint16_t n;
+    std::memcpy(&n, p, sizeof(n));
+    const char* s = reinterpret_cast<const char*>(p + 2);
+    p += 3 + n;
+    return s;
+  } else {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+  }
+}
+
+template <class... Args>
+int log_format(const LogRecord& r, char* out, std::size_t cap) {
+  int n = std::snprintf(out, cap, "[%s] ", r.tag);
+  if (n < 0 || static_cast<std::size_t>(n) >= cap) return n;
+  if constexpr (sizeof...(Args) == 0) {
+    return n + std::snprintf(out + n, cap - n, "%s", r.fmt);
+  } else {
+    const unsigned char* p = r.payload;
+    // 花括号初始化保证按从左到右的顺序解码
+    std::tuple<log_decoded_t<Args>...> vals{log_get<Args>(p)...};
+    return n + std::apply([&](auto... v) { return std::snprintf(out + n, cap - n, r.fmt, v...); }, vals);
+  }
+}
+
+/// Args 是 log_arg_t 之后的类型，由调用方显式给出
+template <class... Args>
+void log_encode(LogRecord& r, const char* tag, const char* fmt, const Args&... args) {
+  static_assert((log_min_size_v<Args> + ... + 0) <= kLogPayload, "too many log arguments");
+  r.format = &log_format<Args...>;
+  r.tag = tag;
+  r.fmt = fmt;
+  r.used = 0;
+  [[maybe_unused]] std::size_t reserve = (log_min_size_v<Args> + ... + 0);
+  ((reserve -= log_min_size_v<Args>, log_put(r, args, reserve)), ...);
+}
+
+} // namespace detail
+
 /**
  * @brief 线程安全的 Logger（PImpl）
+ *
+ * 默认同步输出：调用线程持锁写 std::cout。set_async(true) 之后：
+ *  - 调用线程只把一条定长记录写进自己的 SPSC 环形缓冲区（无锁、不做格式化、不做系统调用），
+ *    缓冲区满了就丢弃这一条并计数，不阻塞调用方。error() / errorf() 也不例外：
+ *    错误日志同样可能被丢弃，只体现在 dropped() 和退出时 stderr 上的一行统计里；
+ *  - 后台线程轮询各线程的缓冲区，格式化后用 writev 成批写到 stdout。
+ *
+ * infof() / errorf() 是 printf 风格的接口：级别被过滤时什么都不做，
+ * 格式化推迟到输出时（异步模式下在后台线程），调用方不构建任何 std::string。
  */
 class Logger {
 public:
   static Logger& instance();                  ///< 单例
   void set_level(int level);
-  void info(const std::string& msg) const;
+  void info(const std::string& msg) const;   ///< 异步模式下超过约 220 字节的 msg 会被截断
+  bool info_enabled() const noexcept;        ///< info() 是否会输出，用于跳过昂贵的消息构建
   void error(const std::string& msg) const;
 
+  /// printf 风格、延迟格式化；fmt 必须是字符串字面量（异步模式下记录被输出时才读取）
+  template <detail::LogArg... Args>
+  void infof(const char* fmt, const Args&... args) const {
+    if (info_enabled()) submit("INFO", fmt, args...);
+  }
+  template <detail::LogArg... Args>
+  void errorf(const char* fmt, const Args&... args) const {
+    submit("ERROR", fmt, args...);
+  }
+
+  /**
+   * @brief 切换同步 / 异步后端
+   *
+   * 关闭异步时会先把所有缓冲区里的记录输出完。切换时不能有其它线程正在写日志。
+   */
+  void set_async(bool on);
+  /// 等待调用之前写入的记录全部输出（同步模式下只刷新 std::cout）
+  void flush() const;
+  /// 异步模式下因为缓冲区满被丢弃的记录数（包括 ERROR 级别的）
+  std::uint64_t dropped() const noexcept;
+
   // 移动语义以便演示
   Logger(Logger&&) noexcept;
   Logger& operator=(Logger&&) noexcept;
@@ -33,6 +179,28 @@ private:
   struct Impl;
   std::unique_ptr<Impl> p_;
   Logger();                                   // 私有构造
+
+  template <class... Args>
+  void submit(const char* tag, const char* fmt, const Args&... args) const {
+    bool async = false;
+    detail::LogRecord* r = reserve(async);
+    if (async) {
+      if (!r) return;                         // 本线程的缓冲区满了，reserve() 已经计数
+      detail::log_encode<detail::log_arg_t<Args>...>(*r, tag, fmt, args...);
+      commit();
+    } else {
+      detail::LogRecord local;
+      detail::log_encode<detail::log_arg_t<Args>...>(local, tag, fmt, args...);
+      write_now(local);
+    }
+  }
+
+  /// 异步模式下返回本线程缓冲区的下一个空槽位（满了返回 nullptr），同步模式返回 nullptr
+  detail::LogRecord* reserve(bool& async) const;
+  /// 发布 reserve() 拿到的槽位
+  void commit() const noexcept;
+  /// 同步模式：立即格式化并输出
+  void write_now(const detail::LogRecord& r) const;
 };
 
 } // namespace demo::core
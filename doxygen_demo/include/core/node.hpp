@@ -3,6 +3,7 @@
 #include <variant>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -49,4 +50,49 @@ struct Mul final : Node {
 
 inline std::ostream& operator<<(std::ostream& os, const Node& n){ n.dump(os); return os; }
 
+/**
+ * @brief 用显式栈后序遍历 Node 树，把它折叠成另一种表示，树再深也不会栈溢出
+ *
+ * 每个节点在两个子节点之后处理：Literal 调用 `literal(value)`，Add / Mul 调用 `add(lhs, rhs)` /
+ * `mul(lhs, rhs)`，参数是子节点回调的返回值。Mul 共享的子树每被引用一次就处理一次。
+ * FlatAst::from_tree 和 expr::Expr::from_tree 都用它，回调返回新节点的下标。
+ * @return 根节点回调的返回值
+ */
+template <class R, class OnLiteral, class OnAdd, class OnMul>
+R post_order(const Node& root, OnLiteral&& literal, OnAdd&& add, OnMul&& mul) {
+  // 节点第一次出栈时压入两个子节点，第二次出栈时两个子节点的结果已经在 done 的栈顶
+  std::vector<std::pair<const Node*, bool>> st{{&root, false}};
+  std::vector<R> done;
+  while (!st.empty()) {
+    auto [n, expanded] = st.back();
+    st.pop_back();
+    const Node *a = nullptr, *b = nullptr;
+    switch (n->kind()) {
+      case Kind::Literal:
+        done.push_back(literal(static_cast<const Literal*>(n)->value));
+        continue;
+      case Kind::Add: {
+        auto* x = static_cast<const Add*>(n);
+        a = x->a.get(); b = x->b.get();
+        break;
+      }
+      case Kind::Mul: {
+        auto* x = static_cast<const Mul*>(n);
+        a = x->a.get(); b = x->b.get();
+        break;
+      }
+    }
+    if (!expanded) {
+      st.push_back({n, true});
+      st.push_back({b, false});
+      st.push_back({a, false});
+      continue;
+    }
+    R rhs = std::move(done.back()); done.pop_back();
+    R lhs = std::move(done.back()); done.pop_back();
+    done.push_back(n->kind() == Kind::Add ? add(std::move(lhs), std::move(rhs)) : mul(std::move(lhs), std::move(rhs)));
+  }
+  return std::move(done.back());
+}
+
 } // namespace demo::core
@@ -1,6 +1,9 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <span>
 #include "util/result.hpp"
 
 /**
@@ -12,12 +15,40 @@
 namespace demo::io {
 using demo::util::Result;
 
+/** @brief Reader 的错误码 */
+enum class ReadError : std::uint8_t { OpenFailed, ParseFailed, EndOfInput };
+
+constexpr const char* to_string(ReadError e) noexcept {
+  switch (e) {
+    case ReadError::OpenFailed:  return "open failed";
+    case ReadError::ParseFailed: return "parse failed";
+    case ReadError::EndOfInput:  return "end of input";
+  }
+  return "unknown";
+}
+
 /** @brief 把一行字符串解析为整数 */
 struct Reader {
   virtual ~Reader() = default;
-  virtual Result<int> read_one() = 0;
+  virtual Result<int, ReadError> read_one() = 0;
+
+  /**
+   * @brief 批量读取：填满 out 或读到输入末尾为止
+   * @return 实际填入的个数，0 表示输入已经读完；一个都没读出来就失败时返回错误（不会是 EndOfInput）
+   *
+   * 默认实现逐个调用 read_one()；流式 Reader 应当覆盖它，一次虚调用处理一整批
+   */
+  virtual Result<std::size_t, ReadError> read_batch(std::span<int> out);
 };
 
 std::unique_ptr<Reader> make_file_reader(const std::string& path);
 
+/**
+ * @brief 基于 mmap 的流式 Reader
+ *
+ * 文件只打开、映射一次，read_one() / read_batch() 依次返回文件里以空白分隔的整数，
+ * 读完后 read_one() 返回 ReadError::EndOfInput，read_batch() 返回 0
+ */
+std::unique_ptr<Reader> make_mmap_reader(const std::string& path);
+
 } // namespace demo::io
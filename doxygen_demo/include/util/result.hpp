@@ -1,31 +1,41 @@
 #pragma once
-#include <optional>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <variant>
 
 /**
  * @file
- * @brief 轻量 Result<T>
+ * @brief 轻量 Result<T, E>
  * @ingroup Util
  */
 
 namespace demo::util {
 
-/** @brief 成功时含值，失败时含错误消息 */
-template<class T>
+/**
+ * @brief 成功时含值，失败时含错误
+ *
+ * 值和错误共用一块存储（std::variant），成功时不构造 E；E 用错误码枚举时整个 Result 只比 T 多一个字节的标签，
+ * 也没有任何分配。E 默认为 std::string，兼容原来只带错误消息的用法。
+ */
+template<class T, class E = std::string>
 class Result {
 public:
-  static Result ok(T v) { return Result(std::move(v), {}); }
-  static Result err(std::string e) { return Result({}, std::move(e)); }
+  static Result ok(T v) { return Result(std::in_place_index<0>, std::move(v)); }
+  static Result err(E e) { return Result(std::in_place_index<1>, std::move(e)); }
 
-  bool has_value() const noexcept { return val_.has_value(); }
-  T& value() { return *val_; }
-  const std::string& error() const { return err_; }
+  bool has_value() const noexcept { return v_.index() == 0; }
+  explicit operator bool() const noexcept { return has_value(); }
+  /// @pre has_value()
+  T& value() noexcept { return *std::get_if<0>(&v_); }
+  const T& value() const noexcept { return *std::get_if<0>(&v_); }
+  /// @pre !has_value()
+  const E& error() const noexcept { return *std::get_if<1>(&v_); }
 
 private:
-  std::optional<T> val_;
-  std::string err_;
-  Result(std::optional<T> v, std::string e): val_(std::move(v)), err_(std::move(e)) {}
+  std::variant<T, E> v_;
+  template<std::size_t I, class U>
+  Result(std::in_place_index_t<I> i, U&& u): v_(i, std::forward<U>(u)) {}
 };
 
 } // namespace demo::util
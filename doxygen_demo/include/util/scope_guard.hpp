@@ -1,4 +1,5 @@
 #pragma once
+#include <type_traits>
 #include <utility>
 
 /**
@@ -11,30 +12,36 @@ namespace demo::util {
 
 /**
  * @brief 作用域守卫：确保作用域退出时执行清理
+ *
+ * 可调用对象直接存放在守卫里，退出时直接调用，不分配、没有虚调用。
+ * 用 make_scope_guard() 或类模板实参推导创建：`auto g = ScopeGuard([&]{ ... });`
  */
+template<class F>
 class ScopeGuard {
 public:
-  template<class F>
-  explicit ScopeGuard(F&& f) noexcept : fn_(new Model<F>(std::forward<F>(f))) {}
+  explicit ScopeGuard(F f) noexcept(std::is_nothrow_move_constructible_v<F>) : fn_(std::move(f)) {}
 
-  // 不可拷贝，可移动
+  // 不可拷贝，可移动（被移走的守卫不再执行）
   ScopeGuard(const ScopeGuard&) = delete;
   ScopeGuard& operator=(const ScopeGuard&) = delete;
-  ScopeGuard(ScopeGuard&& other) noexcept : fn_(other.fn_) { other.fn_ = nullptr; }
-  ScopeGuard& operator=(ScopeGuard&& other) noexcept {
-    if (this != &other) { delete fn_; fn_ = other.fn_; other.fn_ = nullptr; }
-    return *this;
-  }
+  ScopeGuard(ScopeGuard&& other) noexcept(std::is_nothrow_move_constructible_v<F>)
+      : fn_(std::move(other.fn_)), active_(std::exchange(other.active_, false)) {}
+  ScopeGuard& operator=(ScopeGuard&&) = delete;
 
-  ~ScopeGuard() { if (fn_) fn_->call(); }
+  ~ScopeGuard() { if (active_) fn_(); }
+
+  /// 取消清理
+  void dismiss() noexcept { active_ = false; }
 
 private:
-  struct Concept { virtual ~Concept() = default; virtual void call() noexcept = 0; };
-  template<class F> struct Model : Concept {
-    F f; explicit Model(F&& ff): f(std::forward<F>(ff)) {}
-    void call() noexcept override { f(); }
-  };
-  Concept* fn_ = nullptr;
+  F fn_;
+  bool active_ = true;
 };
 
+/** @brief 创建一个 ScopeGuard，F 按值保存 */
+template<class F>
+[[nodiscard]] ScopeGuard<std::decay_t<F>> make_scope_guard(F&& f) {
+  return ScopeGuard<std::decay_t<F>>(std::forward<F>(f));
+}
+
 } // namespace demo::util
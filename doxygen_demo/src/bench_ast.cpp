@@ -0,0 +1,95 @@
+// Node 树、FlatAst 与 expr::Expr 的求值吞吐对比
+//   - deep : 左偏的长链 ((((x + 1) * -1) + 2) * 1) ...，测指针追逐 + 递归的代价
+//   - wide : 满二叉的 Add 树，叶子是 Literal * Literal（Mul 里是 shared_ptr），测大量分散节点的代价
+// 每种树先确认几种表示求值结果一致，再各自重复求值，输出每个节点的平均耗时；
+// 最后测 IncrementalEvaluator 每修改一个 Literal 后重新取值的耗时
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <variant>
+#include <vector>
+
+#include "core/expr.hpp"
+#include "core/flat_ast.hpp"
+#include "core/node.hpp"
+
+using namespace demo::core;
+
+// 链长控制在 Node::eval() 的递归不会把栈用光的范围内
+static std::unique_ptr<Node> make_deep(int depth) {
+  std::unique_ptr<Node> n = std::make_unique<Literal>(0);
+  for (int i = 0; i < depth; ++i) {
+    if (i % 2 == 0) {
+      n = std::make_unique<Add>(std::move(n), std::make_unique<Literal>(i % 7));
+    } else {
+      std::shared_ptr<Node> left(std::move(n));
+      n = std::make_unique<Mul>(left, std::make_shared<Literal>(i % 4 == 1 ? -1 : 1));
+    }
+  }
+  return n;
+}
+
+static std::unique_ptr<Node> make_wide(int levels, int& leaf) {
+  if (levels == 0) {
+    ++leaf;
+    return std::make_unique<Mul>(std::make_shared<Literal>(leaf % 5), std::make_shared<Literal>(leaf % 3 == 0 ? -1 : 1));
+  }
+  auto a = make_wide(levels - 1, leaf);
+  auto b = make_wide(levels - 1, leaf);
+  return std::make_unique<Add>(std::move(a), std::move(b));
+}
+
+template <class F>
+static double ns_per_eval(int reps, F&& f) {
+  volatile int sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; ++i) sink = sink + f();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / reps;
+}
+
+static void run(const char* name, const Node& tree, int reps) {
+  FlatAst flat = FlatAst::from_tree(tree);
+  expr::Expr e = expr::Expr::from_tree(tree);
+  std::vector<int> scratch;
+  int want = tree.eval();
+  if (flat.eval(scratch) != want || expr::eval(e) != want) {
+    std::printf("%s: result mismatch (%d vs %d vs %d)\n", name, want, flat.eval(scratch), expr::eval(e));
+    return;
+  }
+  double nodes = static_cast<double>(flat.size());
+  double t_tree = ns_per_eval(reps, [&] { return tree.eval(); });
+  double t_flat = ns_per_eval(reps, [&] { return flat.eval(scratch); });
+  double t_expr = ns_per_eval(reps, [&] { return expr::eval(e); });
+  std::printf("%-5s nodes=%-8zu Node::eval %6.2f ns/node   FlatAst::eval %6.2f ns/node   expr::eval %6.2f ns/node\n",
+              name, flat.size(), t_tree / nodes, t_flat / nodes, t_expr / nodes);
+
+  // 每次随机改一个 Literal 再取值
+  std::vector<expr::Id> literals;
+  for (expr::Id i = 0; i < e.size(); ++i) {
+    if (std::holds_alternative<expr::Literal>(e[i])) literals.push_back(i);
+  }
+  expr::IncrementalEvaluator inc(e);
+  inc.value();
+  std::size_t before = inc.recomputed();
+  std::mt19937 rng(42);
+  const int updates = 100000;
+  double t_inc = ns_per_eval(updates, [&] {
+    inc.set_literal(literals[rng() % literals.size()], static_cast<int>(rng() % 5));
+    return inc.value();
+  });
+  bool same = inc.value() == expr::eval(e);
+  std::printf("%-5s incremental: %.1f ns/update, %.1f nodes recomputed/update, full eval %.0f ns%s\n", name, t_inc,
+              static_cast<double>(inc.recomputed() - before) / updates, t_expr, same ? "" : "  (MISMATCH)");
+}
+
+int main() {
+  auto deep = make_deep(20000);
+  run("deep", *deep, 500);
+
+  int leaf = 0;
+  auto wide = make_wide(18, leaf);  // 2^18 个叶子，约 100 万个节点
+  run("wide", *wide, 20);
+  return 0;
+}
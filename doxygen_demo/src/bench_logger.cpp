@@ -0,0 +1,93 @@
+// 同步 Logger 与异步后端的吞吐和调用方延迟对比
+//   - sync  : 原来的写法，调用方拼好 std::string，info() 持锁写 std::cout
+//   - async : set_async(true) + infof()，调用方只往本线程的环形缓冲区写一条定长记录
+//   - 最后是级别被过滤掉时每次调用的开销
+// 日志本身写到 stdout，统计结果写到 stderr，运行时把 stdout 重定向掉：./bench_logger > /dev/null
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/logger.hpp"
+
+using demo::core::Logger;
+using Clock = std::chrono::steady_clock;
+
+constexpr int kPerThread = 200000;
+
+struct Result {
+  double seconds = 0;                 // 从开始到所有日志都写出去
+  std::vector<double> latency_ns;     // 每次调用的耗时（所有线程合并）
+};
+
+template <class F>
+static Result run(int threads, F&& log_one) {
+  Result res;
+  std::vector<std::vector<double>> lat(threads);
+  auto t0 = Clock::now();
+  std::vector<std::thread> ts;
+  for (int t = 0; t < threads; ++t) {
+    ts.emplace_back([&, t] {
+      lat[t].reserve(kPerThread);
+      for (int i = 0; i < kPerThread; ++i) {
+        auto a = Clock::now();
+        log_one(i);
+        auto b = Clock::now();
+        lat[t].push_back(std::chrono::duration<double, std::nano>(b - a).count());
+        // 模拟调用方在两条日志之间做点别的事，让异步后端有机会跟上
+        if (i % 64 == 63) std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    });
+  }
+  for (auto& th : ts) th.join();
+  Logger::instance().flush();
+  res.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+  for (auto& v : lat) res.latency_ns.insert(res.latency_ns.end(), v.begin(), v.end());
+  std::sort(res.latency_ns.begin(), res.latency_ns.end());
+  return res;
+}
+
+static double pct(const std::vector<double>& v, double p) { return v[static_cast<std::size_t>(p * (v.size() - 1))]; }
+
+// 吞吐只算真正写出去的记录：异步后端丢掉的那些不算
+static void report(const char* name, int threads, const Result& r, unsigned long long dropped) {
+  double n = static_cast<double>(threads) * kPerThread;
+  std::fprintf(stderr,
+               "%-6s threads=%d  %8.0f delivered msgs/s  caller p50=%6.0f ns p99=%7.0f ns p99.9=%8.0f ns  "
+               "dropped=%llu (%.1f%%)\n",
+               name, threads, (n - static_cast<double>(dropped)) / r.seconds, pct(r.latency_ns, 0.5),
+               pct(r.latency_ns, 0.99), pct(r.latency_ns, 0.999), dropped, 100.0 * static_cast<double>(dropped) / n);
+}
+
+template <class F>
+static double ns_per_call(F&& f) {
+  constexpr int n = 1000000;
+  auto t0 = Clock::now();
+  for (int i = 0; i < n; ++i) f(i);
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / n;
+}
+
+int main() {
+  Logger& log = Logger::instance();
+  log.set_level(1);
+  const std::string name = "pipeline";
+
+  for (int threads : {1, 4}) {
+    auto sync = run(threads, [&](int i) { log.info("value " + std::to_string(i) + " from " + name); });
+    report("sync", threads, sync, 0);
+
+    log.set_async(true);
+    std::uint64_t before = log.dropped();
+    auto async = run(threads, [&](int i) { log.infof("value %d from %s", i, name); });
+    report("async", threads, async, log.dropped() - before);
+    log.set_async(false);
+  }
+
+  log.set_level(2);
+  double str = ns_per_call([&](int i) { log.info("value " + std::to_string(i) + " from " + name); });
+  double lazy = ns_per_call([&](int i) { log.infof("value %d from %s", i, name); });
+  std::fprintf(stderr, "filtered: info(std::string) %.1f ns/call, infof %.1f ns/call\n", str, lazy);
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Pipeline::run_batch 单线程与线程池版本的对比
+//   - fused  : 三个无捕获的 lambda，各阶段融合成一个循环
+//   - staged : 带捕获的 lambda（不能融合），每块逐阶段扫一遍
+// 每种管线先在几种长度上确认并行版本与单线程版本的结果逐个相同，并且阶段抛异常时等所有任务结束才传出
+// （任何一项不满足都返回 1，ctest 里作为检查运行），
+// 再各自重复处理 20M 个值，输出吞吐
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "algo/pipeline.hpp"
+#include "v4.hpp"
+
+using demo::algo::Pipeline;
+using Clock = std::chrono::steady_clock;
+
+template <class P>
+static bool check(const char* name, P& p, ThreadPool& pool) {
+  constexpr std::size_t kMin = P::kParallelMin;
+  // 低于并行阈值、刚好够分两段、分段不是 kBatch 的整数倍并带一个零头
+  for (std::size_t n : {kMin, 2 * kMin, 4 * kMin + 123, 9 * kMin + P::kBatch / 2}) {
+    std::vector<int> in(n);
+    std::iota(in.begin(), in.end(), -static_cast<int>(n / 2));
+    std::vector<int> want(n), got(n, 0);
+    p.run_batch(in, want);
+    p.run_batch(in, got, pool);
+    std::vector<int> inplace = in;  // 原地处理
+    p.run_batch(inplace, inplace, pool);
+    if (got != want || inplace != want) {
+      std::printf("%s: parallel run_batch differs from serial at n=%zu\n", name, n);
+      return false;
+    }
+  }
+  return true;
+}
+
+// 阶段在 bad 处抛异常：异常要传出来，而且传出来时其它分段的任务都已经结束，不再碰 in / out
+// bad 落在调用线程的最后一段或者某个任务的分段里，两种情况都要覆盖
+static bool check_throw(ThreadPool& pool) {
+  constexpr std::size_t n = 4 * (64 * 1024) + 123;
+  for (int bad : {static_cast<int>(n) - 1, 1}) {
+    std::atomic<std::size_t> calls{0};
+    Pipeline p{[&calls, bad](int x) {
+      calls.fetch_add(1, std::memory_order_relaxed);
+      if (x == bad) throw std::runtime_error("bad value");
+      return x;
+    }};
+    std::vector<int> in(n), out(n);
+    std::iota(in.begin(), in.end(), 0);
+    bool thrown = false;
+    try {
+      p.run_batch(in, out, pool);
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    std::size_t after = calls.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    if (!thrown || calls.load() != after) {
+      std::printf("throwing stage at %d: %s\n", bad, thrown ? "tasks still running after the rethrow" : "no exception");
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class F>
+static double mvals_per_s(std::size_t n, F&& f) {
+  constexpr int reps = 10;
+  f();  // 预热：页面、线程池里的线程
+  auto t0 = Clock::now();
+  for (int i = 0; i < reps; ++i) f();
+  return static_cast<double>(n) * reps / std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+template <class P>
+static void bench(const char* name, P& p, ThreadPool& pool) {
+  constexpr std::size_t n = 20'000'000;
+  std::vector<int> in(n), out(n);
+  std::iota(in.begin(), in.end(), 0);
+  double serial = mvals_per_s(n, [&] { p.run_batch(in, out); });
+  double parallel = mvals_per_s(n, [&] { p.run_batch(in, out, pool); });
+  std::printf("%-6s serial %7.0f Mvals/s  pool %7.0f Mvals/s\n", name, serial, parallel);
+}
+
+int main() {
+  ThreadPool pool;
+
+  Pipeline fused{[](int x) { return x + 1; }, [](int x) { return x * 2; }, [](int x) { return x + 3; }};
+  static_assert(decltype(fused)::kFusable);
+
+  int add = 1, mul = 2;
+  Pipeline staged{[add](int x) { return x + add; }, [mul](int x) { return x * mul; }, [add](int x) { return x + 3 * add; }};
+  static_assert(!decltype(staged)::kFusable && decltype(staged)::kConcurrent);
+
+  if (!check("fused", fused, pool) || !check("staged", staged, pool)) return 1;
+  std::printf("parallel run_batch matches serial run_batch\n");
+  if (!check_throw(pool)) return 1;
+  std::printf("parallel run_batch waits for every task before rethrowing\n");
+
+  bench("fused", fused, pool);
+  bench("staged", staged, pool);
+  return 0;
+}
@@ -0,0 +1,29 @@
+#include "core/expr.hpp"
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace demo::core::expr {
+
+Expr Expr::from_tree(const core::Node& root) {
+  Expr e;
+  core::post_order<Id>(
+      root, [&](int v) { return e.literal(v); }, [&](Id a, Id b) { return e.add(a, b); },
+      [&](Id a, Id b) { return e.mul(a, b); });
+  return e;
+}
+
+IncrementalEvaluator::IncrementalEvaluator(Expr& e)
+    : Visitor(e), expr_(e), cache_(e.size()), dirty_(e.size(), 1), parent_(e.size(), kNoParent) {
+  for (Id i = 0; i < e.size(); ++i) {
+    auto link = [&](Id child) {
+      if (parent_[child] != kNoParent) throw std::invalid_argument("IncrementalEvaluator: node has multiple parents");
+      parent_[child] = i;
+    };
+    std::visit([&](const auto& n) {
+      if constexpr (!std::is_same_v<std::decay_t<decltype(n)>, Literal>) { link(n.lhs); link(n.rhs); }
+    }, e[i]);
+  }
+}
+
+} // namespace demo::core::expr
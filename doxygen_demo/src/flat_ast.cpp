@@ -0,0 +1,68 @@
+#include "core/flat_ast.hpp"
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace demo::core {
+
+FlatAst::Index FlatAst::push(FlatNode n) {
+  if (nodes_.size() >= UINT32_MAX) throw std::length_error("FlatAst: too many nodes");
+  root_ = static_cast<Index>(nodes_.size());
+  nodes_.push_back(n);
+  return root_;
+}
+
+FlatAst::Index FlatAst::literal(int v) { return push({Kind::Literal, v, 0, 0}); }
+
+FlatAst::Index FlatAst::add(Index a, Index b) {
+  assert(a < nodes_.size() && b < nodes_.size());
+  return push({Kind::Add, 0, a, b});
+}
+
+FlatAst::Index FlatAst::mul(Index a, Index b) {
+  assert(a < nodes_.size() && b < nodes_.size());
+  return push({Kind::Mul, 0, a, b});
+}
+
+int FlatAst::eval(std::vector<int>& scratch) const {
+  if (nodes_.empty()) return 0;
+  // 根之后的节点不会被根用到，只算到根为止
+  std::size_t n = std::size_t(root_) + 1;
+  scratch.resize(n);
+  int* val = scratch.data();
+  const FlatNode* p = nodes_.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    switch (p[i].kind) {
+      case Kind::Literal: val[i] = p[i].value; break;
+      case Kind::Add:     val[i] = val[p[i].lhs] + val[p[i].rhs]; break;
+      case Kind::Mul:     val[i] = val[p[i].lhs] * val[p[i].rhs]; break;
+    }
+  }
+  return val[root_];
+}
+
+void FlatAst::dump(std::ostream& os) const {
+  if (nodes_.empty()) return;
+  // 显式栈模拟 Node::dump() 的递归：(节点, 已经输出了几个部分)
+  std::vector<std::pair<Index, int>> st{{root_, 0}};
+  while (!st.empty()) {
+    auto& [i, step] = st.back();
+    const FlatNode& n = nodes_[i];
+    if (n.kind == Kind::Literal) { os << n.value; st.pop_back(); continue; }
+    switch (step++) {
+      case 0: os << "("; st.push_back({n.lhs, 0}); break;
+      case 1: os << (n.kind == Kind::Add ? " + " : " * "); st.push_back({n.rhs, 0}); break;
+      default: os << ")"; st.pop_back(); break;
+    }
+  }
+}
+
+FlatAst FlatAst::from_tree(const Node& root) {
+  FlatAst ast;
+  post_order<Index>(
+      root, [&](int v) { return ast.literal(v); }, [&](Index a, Index b) { return ast.add(a, b); },
+      [&](Index a, Index b) { return ast.mul(a, b); });
+  return ast;
+}
+
+} // namespace demo::core
@@ -1,17 +1,167 @@
 #include "core/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include <ctime>
 
+#include <sys/uio.h>
+#include <unistd.h>
+
 namespace demo::core {
 
+namespace {
+
+/// 每个写日志的线程一个：调用线程生产，后台线程消费
+struct Ring {
+  static constexpr std::size_t kCapacity = 1024;  // 256 KiB，2 的幂
+  alignas(64) std::atomic<std::size_t> head{0};   // 消费者：下一个要输出的位置
+  alignas(64) std::atomic<std::size_t> tail{0};   // 生产者：下一个要写的位置
+  std::size_t cached_head = 0;                    // 生产者看到的 head，满了才重新读
+  std::atomic<std::uint64_t> dropped{0};
+  std::atomic<bool> retired{false};               // 线程已经退出，输出完就可以回收
+  detail::LogRecord slots[kCapacity];
+};
+
+void write_all(const iovec* iov, int n) {
+  // 处理部分写入：跳过已经写出去的 iovec
+  std::vector<iovec> rest;
+  while (n > 0) {
+    ssize_t w = ::writev(STDOUT_FILENO, iov, n);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      return;                                     // stdout 坏了，没有更好的去处
+    }
+    while (n > 0 && static_cast<std::size_t>(w) >= iov->iov_len) { w -= iov->iov_len; ++iov; --n; }
+    if (n > 0 && w > 0) {
+      rest.assign(iov, iov + n);
+      rest[0].iov_base = static_cast<char*>(rest[0].iov_base) + w;
+      rest[0].iov_len -= w;
+      iov = rest.data();
+    }
+  }
+}
+
+} // namespace
+
 struct Logger::Impl {
-  int level = 1;
+  std::atomic<int> level{1};
   mutable std::mutex m;
   void log(const char* tag, const std::string& msg) const {
     std::lock_guard<std::mutex> lk(m);
     std::cout << "[" << tag << "] " << msg << "\n";
   }
+
+  // ---- 异步后端 ----
+  static constexpr int kIov = 64;                 // 一次 writev 最多几条
+  static constexpr std::size_t kLine = 512;       // 一条格式化后的最大长度，超出截断
+
+  std::atomic<bool> async{false};
+  std::atomic<bool> running{false};
+  std::thread worker;
+  mutable std::mutex rings_m;                     // 只保护 rings 的增删，不在写日志的路径上
+  std::vector<std::shared_ptr<Ring>> rings;
+  std::atomic<std::uint64_t> dropped_retired{0};
+
+  /// 本线程的缓冲区，第一次写日志时注册
+  Ring& my_ring() {
+    struct Holder {
+      const Impl* owner = nullptr;
+      std::shared_ptr<Ring> ring;
+      ~Holder() { if (ring) ring->retired.store(true, std::memory_order_release); }
+    };
+    thread_local Holder h;
+    if (h.owner != this) {
+      if (h.ring) h.ring->retired.store(true, std::memory_order_release);
+      h.ring = std::make_shared<Ring>();
+      h.owner = this;
+      std::lock_guard<std::mutex> lk(rings_m);
+      rings.push_back(h.ring);
+    }
+    return *h.ring;
+  }
+
+  /// 输出所有缓冲区里现有的记录，返回输出了几条
+  std::size_t drain() {
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    {
+      std::lock_guard<std::mutex> lk(rings_m);
+      snapshot = rings;
+    }
+    static thread_local std::vector<char> buf(kIov * kLine);
+    iovec iov[kIov];
+    std::size_t total = 0;
+    for (auto& r : snapshot) {
+      std::size_t head = r->head.load(std::memory_order_relaxed);
+      std::size_t tail = r->tail.load(std::memory_order_acquire);
+      while (head != tail) {
+        int n = 0;
+        for (; n < kIov && head != tail; ++n, ++head) {
+          const detail::LogRecord& rec = r->slots[head & (Ring::kCapacity - 1)];
+          char* out = buf.data() + n * kLine;
+          int len = rec.format(rec, out, kLine - 1);
+          len = std::clamp(len, 0, static_cast<int>(kLine - 2));  // 截断时 snprintf 返回的是完整长度
+          out[len] = '\n';
+          iov[n].iov_base = out;
+          iov[n].iov_len = static_cast<std::size_t>(len) + 1;
+        }
+        write_all(iov, n);
+        // 写出去之后才归还槽位：head == tail 就意味着之前的记录都已经输出
+        r->head.store(head, std::memory_order_release);
+        total += n;
+      }
+    }
+    // 回收已经退出、并且输出完的线程的缓冲区
+    std::lock_guard<std::mutex> lk(rings_m);
+    std::erase_if(rings, [&](const std::shared_ptr<Ring>& r) {
+      if (!r->retired.load(std::memory_order_acquire) ||
+          r->head.load(std::memory_order_relaxed) != r->tail.load(std::memory_order_acquire)) return false;
+      dropped_retired.fetch_add(r->dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      return true;
+    });
+    return total;
+  }
+
+  void run() {
+    int idle = 0;
+    while (running.load(std::memory_order_acquire)) {
+      if (drain() > 0) { idle = 0; continue; }
+      // 闲下来先让出几次 CPU，再退到每毫秒检查一次
+      if (++idle < 64) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drain();
+  }
+
+  void start() {
+    if (async.load()) return;
+    std::cout.flush();                            // 之前同步写的内容先出去，避免和 writev 交错
+    running.store(true, std::memory_order_release);
+    worker = std::thread([this] { run(); });
+    async.store(true, std::memory_order_release);
+  }
+
+  void stop() {
+    if (!async.exchange(false)) return;
+    running.store(false, std::memory_order_release);
+    worker.join();
+  }
+
+  ~Impl() {
+    stop();
+    if (std::uint64_t d = dropped_count()) std::fprintf(stderr, "[logger] dropped %llu records\n", (unsigned long long)d);
+  }
+
+  std::uint64_t dropped_count() const {
+    std::uint64_t d = dropped_retired.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lk(rings_m);
+    for (auto& r : rings) d += r->dropped.load(std::memory_order_relaxed);
+    return d;
+  }
 };
 
 Logger::Logger(): p_(std::make_unique<Impl>()) {}
@@ -24,8 +174,65 @@ Logger& Logger::instance() {
   return g;
 }
 
-void Logger::set_level(int level){ p_->level = level; }
-void Logger::info(const std::string& msg) const { if (p_->level <= 1) p_->log("INFO", msg); }
-void Logger::error(const std::string& msg) const { p_->log("ERROR", msg); }
+void Logger::set_level(int level){ p_->level.store(level, std::memory_order_relaxed); }
+// 异步模式下 msg 被复制进定长记录，超过 payload 的部分会被截断
+void Logger::info(const std::string& msg) const {
+  if (!info_enabled()) return;
+  if (p_->async.load(std::memory_order_acquire)) submit("INFO", "%s", msg);
+  else p_->log("INFO", msg);
+}
+bool Logger::info_enabled() const noexcept { return p_->level.load(std::memory_order_relaxed) <= 1; }
+void Logger::error(const std::string& msg) const {
+  if (p_->async.load(std::memory_order_acquire)) submit("ERROR", "%s", msg);
+  else p_->log("ERROR", msg);
+}
+
+void Logger::set_async(bool on) { on ? p_->start() : p_->stop(); }
+
+void Logger::flush() const {
+  if (!p_->async.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lk(p_->m);
+    std::cout.flush();
+    return;
+  }
+  std::vector<std::pair<std::shared_ptr<Ring>, std::size_t>> wait;
+  {
+    std::lock_guard<std::mutex> lk(p_->rings_m);
+    for (auto& r : p_->rings) wait.emplace_back(r, r->tail.load(std::memory_order_acquire));
+  }
+  for (auto& [r, tail] : wait) {
+    while (r->head.load(std::memory_order_acquire) < tail) std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+std::uint64_t Logger::dropped() const noexcept { return p_->dropped_count(); }
+
+detail::LogRecord* Logger::reserve(bool& async) const {
+  async = p_->async.load(std::memory_order_acquire);
+  if (!async) return nullptr;
+  Ring& r = p_->my_ring();
+  std::size_t tail = r.tail.load(std::memory_order_relaxed);
+  if (tail - r.cached_head == Ring::kCapacity) {
+    r.cached_head = r.head.load(std::memory_order_acquire);
+    if (tail - r.cached_head == Ring::kCapacity) {
+      r.dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  return &r.slots[tail & (Ring::kCapacity - 1)];
+}
+
+void Logger::commit() const noexcept {
+  Ring& r = p_->my_ring();
+  r.tail.store(r.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Logger::write_now(const detail::LogRecord& r) const {
+  char line[Impl::kLine];
+  int len = r.format(r, line, sizeof(line));
+  len = std::clamp(len, 0, static_cast<int>(sizeof(line) - 1));
+  std::lock_guard<std::mutex> lk(p_->m);
+  std::cout.write(line, len) << '\n';
+}
 
 } // namespace demo::core
@@ -7,13 +7,14 @@
 
 using demo::algo::Pipeline;
 using demo::io::make_file_reader;
+using demo::io::make_mmap_reader;
 using demo::core::Logger;
-using demo::util::ScopeGuard;
+using demo::util::make_scope_guard;
 
 /// @brief 业务主流程
 int run(const std::string& path){
   auto reader = make_file_reader(path);
-  auto cleanup = ScopeGuard([&]{ Logger::instance().info("cleanup done"); });
+  auto cleanup = make_scope_guard([]{ Logger::instance().info("cleanup done"); });
 
   // 三个阶段：+1、*2、+3（通过 lambda 提供策略）
   auto s1 = [](int x){ return x + 1; };
@@ -25,10 +26,29 @@ int run(const std::string& path){
   return p.run(*reader);
 }
 
+/// @brief 用 mmap Reader 流式处理一个大文件，返回所有结果之和
+long long run_stream(const std::string& path){
+  auto reader = make_mmap_reader(path);
+  Pipeline p{[](int x){ return x + 1; }, [](int x){ return x * 2; }, [](int x){ return x + 3; }};
+  long long sum = 0;
+  std::size_t n = p.consume(*reader, [&](std::span<const int> batch){
+    for (int v : batch) sum += v;
+  });
+  std::cout << "streamed " << n << " values\n";
+  return sum;
+}
+
 int main(){
   // 准备输入文件
   std::ofstream("input.txt") << 5;
   int v = run("input.txt");
   std::cout << "result = " << v << "\n";
+
+  {
+    std::ofstream os("numbers.txt");
+    for (int i = 0; i < 100000; ++i) os << i << '\n';
+  }
+  long long sum = run_stream("numbers.txt");
+  std::cout << "stream sum = " << sum << "\n";
   return 0;
 }
@@ -1,21 +1,130 @@
 #include "io/reader.hpp"
+#include <charconv>
 #include <fstream>
 #include <sstream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace demo::io {
 
+using IntResult = Result<int, ReadError>;
+using BatchResult = Result<std::size_t, ReadError>;
+
+BatchResult Reader::read_batch(std::span<int> out) {
+  std::size_t n = 0;
+  for (; n < out.size(); ++n) {
+    auto res = read_one();
+    if (!res.has_value()) {
+      if (n == 0 && res.error() != ReadError::EndOfInput) return BatchResult::err(res.error());
+      break;
+    }
+    out[n] = res.value();
+  }
+  return BatchResult::ok(n);
+}
+
 namespace {
 struct FileReader : Reader {
   explicit FileReader(std::string path): path_(std::move(path)) {}
-  Result<int> read_one() override {
+  IntResult read_one() override {
     std::ifstream ifs(path_);
-    if (!ifs) return Result<int>::err("open failed");
+    if (!ifs) return IntResult::err(ReadError::OpenFailed);
     int x{};
     ifs >> x;
-    if (!ifs) return Result<int>::err("parse failed");
-    return Result<int>::ok(x);
+    if (!ifs) return IntResult::err(ReadError::ParseFailed);
+    return IntResult::ok(x);
+  }
+  // read_one() 每次都从头读第一个值；批量读取改用一个一直打开的流，按顺序读下去
+  BatchResult read_batch(std::span<int> out) override {
+    if (!stream_.is_open()) {
+      stream_.open(path_);
+      if (!stream_) return BatchResult::err(ReadError::OpenFailed);
+    }
+    std::size_t n = 0;
+    while (n < out.size() && stream_ >> out[n]) ++n;
+    if (n == 0 && !stream_.eof()) return BatchResult::err(ReadError::ParseFailed);
+    return BatchResult::ok(n);
   }
   std::string path_;
+  std::ifstream stream_;
+};
+
+constexpr bool is_space(char c) noexcept {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+struct MmapReader : Reader {
+  explicit MmapReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return;
+    struct stat st{};
+    if (::fstat(fd, &st) == 0) {
+      size_ = static_cast<std::size_t>(st.st_size);
+      if (size_ == 0) {
+        ok_ = true;
+      } else {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+          ::madvise(p, size_, MADV_SEQUENTIAL);  // 顺序扫描，让内核积极预读
+          base_ = static_cast<const char*>(p);
+          cur_ = base_;
+          end_ = base_ + size_;
+          ok_ = true;
+        }
+      }
+    }
+    ::close(fd);  // 映射建立后 fd 就不需要了
+  }
+  ~MmapReader() override {
+    if (base_) ::munmap(const_cast<char*>(base_), size_);
+  }
+  MmapReader(const MmapReader&) = delete;
+  MmapReader& operator=(const MmapReader&) = delete;
+
+  IntResult read_one() override {
+    if (!ok_) return IntResult::err(ReadError::OpenFailed);
+    int x{};
+    switch (next(x)) {
+      case Scan::Value: return IntResult::ok(x);
+      case Scan::End:   return IntResult::err(ReadError::EndOfInput);
+      default:          return IntResult::err(ReadError::ParseFailed);
+    }
+  }
+
+  BatchResult read_batch(std::span<int> out) override {
+    if (!ok_) return BatchResult::err(ReadError::OpenFailed);
+    std::size_t n = 0;
+    while (n < out.size()) {
+      Scan s = next(out[n]);
+      if (s == Scan::Value) { ++n; continue; }
+      // 坏数据前面已经读出的值先交出去，下一次调用再报错
+      if (s == Scan::Bad && n == 0) return BatchResult::err(ReadError::ParseFailed);
+      break;
+    }
+    return BatchResult::ok(n);
+  }
+
+ private:
+  enum class Scan { Value, End, Bad };
+
+  /// 跳过空白，用 from_chars 解析一个整数（不分配、不看 locale），成功后 cur_ 移到数字之后
+  Scan next(int& x) noexcept {
+    while (cur_ != end_ && is_space(*cur_)) ++cur_;
+    if (cur_ == end_) return Scan::End;
+    auto [ptr, ec] = std::from_chars(cur_, end_, x);
+    if (ec != std::errc{}) return Scan::Bad;
+    cur_ = ptr;
+    return Scan::Value;
+  }
+
+  const char* base_ = nullptr;
+  const char* cur_ = nullptr;
+  const char* end_ = nullptr;
+  std::size_t size_ = 0;
+  bool ok_ = false;
 };
 }
 
@@ -23,4 +132,8 @@ std::unique_ptr<Reader> make_file_reader(const std::string& path) {
   return std::make_unique<FileReader>(path);
 }
 
+std::unique_ptr<Reader> make_mmap_reader(const std::string& path) {
+  return std::make_unique<MmapReader>(path);
+}
+
 } // namespace demo::io
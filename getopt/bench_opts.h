@@ -0,0 +1,359 @@
+#ifndef BENCH_OPTS_H
+#define BENCH_OPTS_H
+
+// 基准驱动和服务器共用的命令行选项层（getopt_long），C 和 C++ 都可以直接包含
+//
+// 公共选项都是长选项，名字和含义在所有程序里一致，脚本扫参数时不用记每个程序自己的写法：
+//   --threads=LIST     线程数                     --reactors=LIST   reactor（事件循环线程）数
+//   --queue=NAMES      任务队列后端               --lock=NAMES      锁的实现
+//   --spin=LIST        自旋预算（单位由程序决定）  --buf-size=LIST   缓冲区大小，可以带 K / M / G 后缀
+//   --duration=TIME    运行时间，默认单位秒，也可以写 500ms / 2s / 1m
+//   --format=json|csv  输出格式，--header 只打印 CSV 表头
+//   -h, --help
+// LIST 是逗号分隔的整数（例如 1,2,4,8），NAMES 是逗号分隔的名字；只需要一个值的程序取第一个
+//
+// 程序在 bench_opts_init 的 mask 里选择自己支持哪些公共选项，没选的不会被接受；
+// 程序自己的选项通过 bench_extra 表加进来，由回调处理。bench_extra 的 id 等于某个 BENCH_ID_* 时，
+// 它就是那个公共选项的别名，用来保留程序原来的短选项（例如 echo_server 的 -t 就是 --reactors）
+//
+//   struct bench_opts o;
+//   bench_opts_init(&o, BENCH_OPT_REACTORS | BENCH_OPT_BUF_SIZE, "<Port>");
+//   bench_list_set(&o.reactors, 4);
+//   int idx = bench_opts_parse(&o, argc, argv, extras, on_extra, &ctx);
+//   if(idx <= 0) return idx < 0;     // 参数错误返回 -1，--help 返回 0，用法都已经打印过了
+//   ... argv[idx] 是第一个位置参数
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_LIST_MAX 16   // 一个列表最多几个值
+#define BENCH_NAME_MAX 32   // 一个名字最长几个字符（含结尾的 '\0'）
+#define BENCH_EXTRA_MAX 32  // 程序自己的选项最多几个
+
+// bench_opts_init 的 mask
+enum {
+    BENCH_OPT_THREADS = 1 << 0,
+    BENCH_OPT_QUEUE = 1 << 1,
+    BENCH_OPT_LOCK = 1 << 2,
+    BENCH_OPT_SPIN = 1 << 3,
+    BENCH_OPT_BUF_SIZE = 1 << 4,
+    BENCH_OPT_REACTORS = 1 << 5,
+    BENCH_OPT_DURATION = 1 << 6,
+    BENCH_OPT_FORMAT = 1 << 7,
+};
+
+// 公共选项在 getopt_long 里的返回值，也是 bench_extra::id 里表示别名的值
+enum {
+    BENCH_ID_THREADS = 0x1000,
+    BENCH_ID_QUEUE,
+    BENCH_ID_LOCK,
+    BENCH_ID_SPIN,
+    BENCH_ID_BUF_SIZE,
+    BENCH_ID_REACTORS,
+    BENCH_ID_DURATION,
+    BENCH_ID_FORMAT,
+    BENCH_ID_HEADER,
+};
+
+struct bench_list {
+    int n;
+    long v[BENCH_LIST_MAX];
+};
+
+// 名字直接存在结构体里：结构体可以随意复制，不指向 argv
+struct bench_names {
+    int n;
+    char v[BENCH_LIST_MAX][BENCH_NAME_MAX];
+};
+
+struct bench_opts {
+    unsigned mask;
+    const char *usage_args;  // usage 里位置参数的说明，例如 "<IP> <Port>"
+    struct bench_list threads;
+    struct bench_names queue;
+    struct bench_names lock;
+    struct bench_list spin;
+    struct bench_list buf_size;
+    struct bench_list reactors;
+    long duration_ms;
+    int csv;
+    int header;  // 给了 --header：程序只打印 CSV 表头
+};
+
+// 程序自己的选项
+struct bench_extra {
+    const char *name;      // 长选项名，NULL 表示只有短选项
+    int short_name;        // 短选项字母，0 表示只有长选项
+    int has_arg;           // no_argument / required_argument
+    int id;                // 传给回调的值；等于 BENCH_ID_* 时是公共选项的别名，不调用回调
+    const char *arg_name;  // usage 里参数的名字，没有参数时为 NULL
+    const char *help;
+};
+
+// 处理程序自己的选项，arg 在 no_argument 时为 NULL；返回非 0 表示参数错误
+typedef int (*bench_extra_fn)(int id, const char *arg, void *ctx);
+
+static inline void bench_list_set(struct bench_list *l, long v)
+{
+    l->n = 1;
+    l->v[0] = v;
+}
+
+static inline void bench_names_set(struct bench_names *l, const char *name)
+{
+    l->n = 1;
+    snprintf(l->v[0], BENCH_NAME_MAX, "%s", name);
+}
+
+static inline int bench_names_contains(const struct bench_names *l, const char *name)
+{
+    for(int i = 0; i < l->n; i ++ ) {
+        if(strcmp(l->v[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+static inline void bench_opts_init(struct bench_opts *o, unsigned mask, const char *usage_args)
+{
+    memset(o, 0, sizeof(*o));
+    o->mask = mask;
+    o->usage_args = usage_args;
+}
+
+// 解析一个整数，K / M / G 是 1024 的幂；整个字符串都要被用掉，乘上后缀溢出 long 的拒绝
+static inline int bench_parse_long(const char *s, long min, long *out)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if(end == s || errno == ERANGE) return -1;
+    long scale = 1;
+    switch(*end) {
+        case 'k': case 'K': scale = 1L << 10; end ++ ; break;
+        case 'm': case 'M': scale = 1L << 20; end ++ ; break;
+        case 'g': case 'G': scale = 1L << 30; end ++ ; break;
+        default: break;
+    }
+    if(*end != '\0' || v < min) return -1;
+    if(v > LONG_MAX / scale || v < LONG_MIN / scale) return -1;
+    *out = v * scale;
+    return 0;
+}
+
+// 运行时间：默认单位秒，可以写 ms / s / m 后缀；返回毫秒
+static inline int bench_parse_duration(const char *s, long *out_ms)
+{
+    char *end;
+    errno = 0;
+    double v = strtod(s, &end);
+    if(end == s || errno == ERANGE || v < 0) return -1;
+    double scale = 1000;
+    if(strcmp(end, "ms") == 0) scale = 1;
+    else if(strcmp(end, "m") == 0) scale = 60000;
+    else if(*end != '\0' && strcmp(end, "s") != 0) return -1;
+    *out_ms = (long)(v * scale);
+    return 0;
+}
+
+static inline int bench_parse_list(const char *s, long min, struct bench_list *l)
+{
+    char item[64];
+    l->n = 0;
+    while(*s) {
+        size_t len = strcspn(s, ",");
+        if(len == 0 || len >= sizeof(item) || l->n == BENCH_LIST_MAX) return -1;
+        memcpy(item, s, len);
+        item[len] = '\0';
+        if(bench_parse_long(item, min, &l->v[l->n ++ ]) == -1) return -1;
+        s += len;
+        if(*s == ',') s ++ ;
+    }
+    return l->n > 0 ? 0 : -1;
+}
+
+static inline int bench_parse_names(const char *s, struct bench_names *l)
+{
+    l->n = 0;
+    while(*s) {
+        size_t len = strcspn(s, ",");
+        if(len == 0 || len >= BENCH_NAME_MAX || l->n == BENCH_LIST_MAX) return -1;
+        memcpy(l->v[l->n], s, len);
+        l->v[l->n ++ ][len] = '\0';
+        s += len;
+        if(*s == ',') s ++ ;
+    }
+    return l->n > 0 ? 0 : -1;
+}
+
+// 公共选项的说明，顺序和 BENCH_OPT_* 的位一致
+struct bench_common_opt {
+    const char *name;
+    int has_arg;
+    int id;
+    unsigned bit;
+    const char *arg_name;
+    const char *help;
+};
+
+static const struct bench_common_opt bench_common_opts[] = {
+    {"threads", required_argument, BENCH_ID_THREADS, BENCH_OPT_THREADS, "LIST", "thread counts"},
+    {"queue", required_argument, BENCH_ID_QUEUE, BENCH_OPT_QUEUE, "NAMES", "task queue backends"},
+    {"lock", required_argument, BENCH_ID_LOCK, BENCH_OPT_LOCK, "NAMES", "lock implementations"},
+    {"spin", required_argument, BENCH_ID_SPIN, BENCH_OPT_SPIN, "LIST", "spin budgets"},
+    {"buf-size", required_argument, BENCH_ID_BUF_SIZE, BENCH_OPT_BUF_SIZE, "LIST", "buffer sizes in bytes (K/M/G)"},
+    {"reactors", required_argument, BENCH_ID_REACTORS, BENCH_OPT_REACTORS, "LIST", "reactor thread counts"},
+    {"duration", required_argument, BENCH_ID_DURATION, BENCH_OPT_DURATION, "TIME", "run time (s by default, or ms/s/m)"},
+    {"format", required_argument, BENCH_ID_FORMAT, BENCH_OPT_FORMAT, "json|csv", "output format"},
+    {"header", no_argument, BENCH_ID_HEADER, BENCH_OPT_FORMAT, NULL, "print the CSV header and exit"},
+};
+
+#define BENCH_COMMON_COUNT (sizeof(bench_common_opts) / sizeof(bench_common_opts[0]))
+
+static inline unsigned bench_id_bit(int id)
+{
+    for(size_t i = 0; i < BENCH_COMMON_COUNT; i ++ ) {
+        if(bench_common_opts[i].id == id) return bench_common_opts[i].bit;
+    }
+    return 0;
+}
+
+static inline void bench_opts_usage(FILE *f, const char *prog, const struct bench_opts *o,
+                                    const struct bench_extra *extra)
+{
+    fprintf(f, "Usage : %s [options]%s%s\n", prog, o->usage_args ? " " : "", o->usage_args ? o->usage_args : "");
+    char left[64];
+    for(const struct bench_extra *e = extra; e && (e->name || e->short_name); e ++ ) {
+        int n = 0;
+        if(e->short_name) n += snprintf(left + n, sizeof(left) - n, "-%c%s", e->short_name, e->name ? ", " : "");
+        if(e->name) n += snprintf(left + n, sizeof(left) - n, "--%s", e->name);
+        if(e->arg_name) snprintf(left + n, sizeof(left) - n, "%s%s", e->name ? "=" : " ", e->arg_name);
+        fprintf(f, "  %-28s %s\n", left, e->help ? e->help : "");
+    }
+    for(size_t i = 0; i < BENCH_COMMON_COUNT; i ++ ) {
+        const struct bench_common_opt *c = &bench_common_opts[i];
+        if(!(o->mask & c->bit)) continue;
+        snprintf(left, sizeof(left), "--%s%s%s", c->name, c->arg_name ? "=" : "", c->arg_name ? c->arg_name : "");
+        fprintf(f, "  %-28s %s\n", left, c->help);
+    }
+    fprintf(f, "  %-28s %s\n", "-h, --help", "show this help");
+}
+
+static inline int bench_set_common(struct bench_opts *o, int id, const char *arg)
+{
+    switch(id) {
+        case BENCH_ID_THREADS: return bench_parse_list(arg, 1, &o->threads);
+        case BENCH_ID_QUEUE: return bench_parse_names(arg, &o->queue);
+        case BENCH_ID_LOCK: return bench_parse_names(arg, &o->lock);
+        case BENCH_ID_SPIN: return bench_parse_list(arg, 0, &o->spin);
+        case BENCH_ID_BUF_SIZE: return bench_parse_list(arg, 1, &o->buf_size);
+        case BENCH_ID_REACTORS: return bench_parse_list(arg, 1, &o->reactors);
+        case BENCH_ID_DURATION: return bench_parse_duration(arg, &o->duration_ms);
+        case BENCH_ID_FORMAT:
+            if(strcmp(arg, "csv") == 0) o->csv = 1;
+            else if(strcmp(arg, "json") == 0) o->csv = 0;
+            else return -1;
+            return 0;
+        case BENCH_ID_HEADER: o->header = 1; return 0;
+        default: return -1;
+    }
+}
+
+// 解析 argv；extra 以一个 name 和 short_name 都为空的元素结尾，可以为 NULL
+// 返回第一个位置参数的下标；参数错误返回 -1（用法打印到 stderr），--help 返回 0（用法打印到 stdout）
+static inline int bench_opts_parse(struct bench_opts *o, int argc, char **argv,
+                                   const struct bench_extra *extra, bench_extra_fn fn, void *ctx)
+{
+    struct option longopts[BENCH_COMMON_COUNT + BENCH_EXTRA_MAX + 2];
+    char shortopts[2 * BENCH_EXTRA_MAX + 2] = "h";
+    size_t nl = 0, ns = 1;
+    for(size_t i = 0; i < BENCH_COMMON_COUNT; i ++ ) {
+        const struct bench_common_opt *c = &bench_common_opts[i];
+        if(!(o->mask & c->bit)) continue;
+        longopts[nl].name = c->name;
+        longopts[nl].has_arg = c->has_arg;
+        longopts[nl].flag = NULL;
+        longopts[nl ++ ].val = c->id;
+    }
+    size_t ne = 0;
+    for(const struct bench_extra *e = extra; e && (e->name || e->short_name); e ++ ) {
+        if(ne ++ == BENCH_EXTRA_MAX) {
+            fprintf(stderr, "%s: too many options\n", argv[0]);
+            return -1;
+        }
+        // 别名顺带打开对应的公共选项
+        o->mask |= bench_id_bit(e->id);
+        if(e->name) {
+            longopts[nl].name = e->name;
+            longopts[nl].has_arg = e->has_arg;
+            longopts[nl].flag = NULL;
+            longopts[nl ++ ].val = e->short_name ? e->short_name : e->id;
+        }
+        if(e->short_name) {
+            shortopts[ns ++ ] = (char)e->short_name;
+            if(e->has_arg == required_argument) shortopts[ns ++ ] = ':';
+        }
+    }
+    longopts[nl].name = "help";
+    longopts[nl].has_arg = no_argument;
+    longopts[nl].flag = NULL;
+    longopts[nl ++ ].val = 'h';
+    memset(&longopts[nl], 0, sizeof(longopts[nl]));
+    shortopts[ns] = '\0';
+
+    int c;
+    optind = 1;
+    while((c = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1) {
+        if(c == 'h') {
+            bench_opts_usage(stdout, argv[0], o, extra);
+            return 0;
+        }
+        if(c == '?') goto usage;  // getopt_long 已经打印了错误
+        const struct bench_extra *hit = NULL;
+        for(const struct bench_extra *e = extra; !hit && e && (e->name || e->short_name); e ++ ) {
+            if(e->short_name ? e->short_name == c : e->id == c) hit = e;
+        }
+        int id = hit ? hit->id : c;
+        int bad = bench_id_bit(id) ? bench_set_common(o, id, optarg) : (fn ? fn(id, optarg, ctx) : -1);
+        if(bad) {
+            fprintf(stderr, "%s: bad value '%s'\n", argv[0], optarg ? optarg : "");
+            goto usage;
+        }
+    }
+    return optind;
+
+usage:
+    bench_opts_usage(stderr, argv[0], o, extra);
+    return -1;
+}
+
+static inline void bench_print_list(FILE *f, const char *name, const struct bench_list *l)
+{
+    fprintf(f, " %s=", name);
+    for(int i = 0; i < l->n; i ++ ) fprintf(f, "%s%ld", i ? "," : "", l->v[i]);
+}
+
+static inline void bench_print_names(FILE *f, const char *name, const struct bench_names *l)
+{
+    fprintf(f, " %s=", name);
+    for(int i = 0; i < l->n; i ++ ) fprintf(f, "%s%s", i ? "," : "", l->v[i]);
+}
+
+// 把生效的公共选项打印成一行 key=value，放在输出开头，扫参数的结果可以按配置归类
+static inline void bench_opts_print(FILE *f, const struct bench_opts *o)
+{
+    fprintf(f, "config:");
+    if(o->mask & BENCH_OPT_THREADS) bench_print_list(f, "threads", &o->threads);
+    if(o->mask & BENCH_OPT_QUEUE) bench_print_names(f, "queue", &o->queue);
+    if(o->mask & BENCH_OPT_LOCK) bench_print_names(f, "lock", &o->lock);
+    if(o->mask & BENCH_OPT_SPIN) bench_print_list(f, "spin", &o->spin);
+    if(o->mask & BENCH_OPT_BUF_SIZE) bench_print_list(f, "buf_size", &o->buf_size);
+    if(o->mask & BENCH_OPT_REACTORS) bench_print_list(f, "reactors", &o->reactors);
+    if(o->mask & BENCH_OPT_DURATION) fprintf(f, " duration=%ldms", o->duration_ms);
+    fprintf(f, "\n");
+}
+
+#endif
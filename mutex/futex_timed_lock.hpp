@@ -0,0 +1,228 @@
+// 基于 futex 的定时锁 / 可重入定时锁
+//
+// timed_lock.cpp 中的 TimedLock、recursive_timed_lock.cpp 中的 RecursiveTimedLock
+// 每次加锁都要经过 std::mutex + condition_variable + flag_：哪怕没有竞争，lock/unlock 也是两次 mutex 操作外加一次 notify_one
+// 这里改成一个原子状态字（与 spin_lock.hpp 相同，Drepper《Futexes Are Tricky》中的 mutex）：
+//   0 : 未加锁
+//   1 : 已加锁，没有睡眠的等待者
+//   2 : 已加锁，可能有睡眠的等待者（unlock 时需要 futex wake）
+// 无竞争时 lock / unlock 各只有一次原子操作；try_lock_for / try_lock_until 睡在带超时的 futex wait 上
+//
+// FutexRecursiveTimedLock 在此基础上加一个 owner / depth：重入时只比较 owner_ 并 ++ depth_，不碰任何共享的锁
+#ifndef MUTEX_FUTEX_TIMED_LOCK_H
+#define MUTEX_FUTEX_TIMED_LOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace futex {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) &&
+              std::atomic<std::uint32_t>::is_always_lock_free, "futex word must be a plain 32-bit integer");
+
+#if defined(__linux__)
+
+namespace detail {
+
+inline int* addr(std::atomic<std::uint32_t>& word) noexcept {
+    return reinterpret_cast<int*>(&word);
+}
+
+// 返回 false 表示超时，其它情况（被唤醒、值已经变了、被信号打断）都返回 true，由调用方重新检查状态字
+inline bool wait_abs(std::atomic<std::uint32_t>& word, std::uint32_t expected, const timespec* ts, int clock_flag) noexcept {
+    // FUTEX_WAIT_BITSET 的超时是绝对时间：默认 CLOCK_MONOTONIC，带 FUTEX_CLOCK_REALTIME 时是 CLOCK_REALTIME
+    long r = ::syscall(SYS_futex, addr(word), FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG | clock_flag,
+                       static_cast<int>(expected), ts, nullptr, FUTEX_BITSET_MATCH_ANY);
+    return !(r == -1 && errno == ETIMEDOUT);
+}
+
+template<typename Duration>
+timespec to_timespec(Duration since_epoch) noexcept {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+    if(ns < 0) ns = 0;
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    return ts;
+}
+
+} // namespace detail
+
+// 状态字仍等于 expected 时睡眠，直到被 wake_one 唤醒
+inline void wait(std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept {
+    detail::wait_abs(word, expected, nullptr, 0);
+}
+
+// 同上，但最多睡到 abs_time；超时返回 false
+// steady_clock / system_clock 直接交给内核按绝对时间等待，其它时钟换算成 steady_clock 的时间点，醒来后再按原时钟检查
+template<typename Clock, typename Duration>
+bool wait_until(std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                const std::chrono::time_point<Clock, Duration>& abs_time) noexcept {
+    if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+        if(Clock::now() >= abs_time) return false;
+        timespec ts = detail::to_timespec(abs_time.time_since_epoch());
+        return detail::wait_abs(word, expected, &ts, 0);
+    } else if constexpr (std::is_same_v<Clock, std::chrono::system_clock>) {
+        if(Clock::now() >= abs_time) return false;
+        timespec ts = detail::to_timespec(abs_time.time_since_epoch());
+        return detail::wait_abs(word, expected, &ts, FUTEX_CLOCK_REALTIME);
+    } else {
+        while(true) {
+            auto now = Clock::now();
+            if(now >= abs_time) return false;
+            auto deadline = std::chrono::steady_clock::now() +
+                            std::chrono::ceil<std::chrono::steady_clock::duration>(abs_time - now);
+            if(wait_until(word, expected, deadline)) return true;
+        }
+    }
+}
+
+inline void wake_one(std::atomic<std::uint32_t>& word) noexcept {
+    ::syscall(SYS_futex, detail::addr(word), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, nullptr, nullptr, 0);
+}
+
+#else
+
+// 没有 futex 的平台：无超时的等待用 std::atomic::wait，带超时的等待退化为 yield 轮询
+inline void wait(std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept {
+    word.wait(expected, std::memory_order_relaxed);
+}
+
+template<typename Clock, typename Duration>
+bool wait_until(std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                const std::chrono::time_point<Clock, Duration>& abs_time) noexcept {
+    while(word.load(std::memory_order_relaxed) == expected) {
+        if(Clock::now() >= abs_time) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+inline void wake_one(std::atomic<std::uint32_t>& word) noexcept {
+    word.notify_one();
+}
+
+#endif
+
+} // namespace futex
+
+class FutexTimedLock {
+public:
+    constexpr FutexTimedLock() = default;
+    FutexTimedLock(const FutexTimedLock&) = delete;
+    FutexTimedLock& operator=(const FutexTimedLock&) = delete;
+
+    void lock() noexcept {
+        if(try_lock()) return ;
+        // 把状态设为 2（告诉持有者 unlock 时要叫人），换回来是 0 就说明拿到了锁
+        // 醒来后同样用 2 去抢，因为不知道身后还有没有其它睡着的线程
+        while(state_.exchange(2, std::memory_order_acquire) != 0) {
+            futex::wait(state_, 2);
+        }
+    }
+
+    bool try_lock() noexcept {
+        std::uint32_t expected = 0;
+        return state_.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& rel_time) {
+        return try_lock_until(std::chrono::steady_clock::now() + rel_time);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& abs_time) {
+        if(try_lock()) return true;
+        while(state_.exchange(2, std::memory_order_acquire) != 0) {
+            // 超时后再抢最后一次：醒来和超时同时发生时不至于白白放弃一把刚空出来的锁
+            // 抢不到时状态字留在 2，最多让下一次 unlock 多一次 futex wake
+            if(!futex::wait_until(state_, 2, abs_time)) {
+                return state_.exchange(2, std::memory_order_acquire) == 0;
+            }
+        }
+        return true;
+    }
+
+    // 这里和 TimedLock 一样不检查是否是由加锁的那个线程去释放
+    void unlock() noexcept {
+        if(state_.exchange(0, std::memory_order_release) == 2) futex::wake_one(state_);
+    }
+
+private:
+    std::atomic<std::uint32_t> state_{0};
+};
+
+class FutexRecursiveTimedLock {
+public:
+    FutexRecursiveTimedLock() = default;
+    FutexRecursiveTimedLock(const FutexRecursiveTimedLock&) = delete;
+    FutexRecursiveTimedLock& operator=(const FutexRecursiveTimedLock&) = delete;
+
+    void lock() {
+        if(reenter_()) return ;
+        inner_.lock();
+        acquired_();
+    }
+
+    bool try_lock() noexcept {
+        if(reenter_()) return true;
+        if(!inner_.try_lock()) return false;
+        acquired_();
+        return true;
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& rel_time) {
+        return try_lock_until(std::chrono::steady_clock::now() + rel_time);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& abs_time) {
+        if(reenter_()) return true;
+        if(!inner_.try_lock_until(abs_time)) return false;
+        acquired_();
+        return true;
+    }
+
+    void unlock() {
+        if(owner_.load(std::memory_order_relaxed) != std::this_thread::get_id() || depth_ == 0)
+            std::terminate();
+        if(-- depth_ == 0) {
+            owner_.store(std::thread::id{}, std::memory_order_relaxed);
+            inner_.unlock();
+        }
+    }
+
+private:
+    // owner_ 只有持有者会写成自己的 id，所以某个线程用 relaxed 读到自己的 id，就说明它正持有这把锁；
+    // 读到别的值（哪怕是过期的）都不可能等于自己的 id，此时去抢 inner_ 就行
+    bool reenter_() noexcept {
+        if(owner_.load(std::memory_order_relaxed) != std::this_thread::get_id()) return false;
+        ++ depth_;
+        return true;
+    }
+
+    void acquired_() noexcept {
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        depth_ = 1;
+    }
+
+    FutexTimedLock inner_;
+    std::atomic<std::thread::id> owner_{};
+    std::uint64_t depth_{0};  // 只有持有者读写，由 inner_ 的 acquire / release 保护；暂时不考虑溢出问题
+};
+
+#endif
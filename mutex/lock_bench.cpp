@@ -0,0 +1,292 @@
+// mutex/ 下所有锁的统一基准
+//
+// 每个 .cpp 自己的 main() 只测自己那把锁，参数和输出各不相同；这里把它们放进同一个驱动，
+// 在线程数 × 临界区长度 × 读写比例的组合上逐一测量，每个组合输出一行 JSON（--format=csv 输出 CSV）
+//
+// 被测的锁：
+//   spin / mcs / futex_timed / futex_recursive_timed       独占锁：读操作也用 lock()
+//   reader_pref / writer_pref / fair_fifo / big_reader      shared_mutex.hpp 中的读写锁：读操作用 lock_shared()
+//   std::mutex / std::timed_mutex / std::recursive_mutex / std::shared_mutex
+//
+// 指标：
+//   - ops_per_sec       : 所有线程的加锁次数 / 实际运行时间
+//   - p50/p99/max_ns    : 从调用 lock() / lock_shared() 到返回的时间（纳秒）
+//
+// 参数（由 getopt/bench_opts.h 解析）：
+//       --lock=a,b,...       只测这些锁（默认全部，--list 列出名字；--locks 是同一个选项）
+//       --threads=1,2,4,8    线程数
+//       --cs=0,100,1000      临界区内 busy_work 的迭代次数
+//       --read-pct=0,90      读操作的百分比
+//       --duration=TIME      每个组合运行的时间（默认 100ms；--duration-ms=N 是旧写法）
+//       --format=json|csv    --header 只打印 CSV 表头
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_opts.h"
+#include "futex_timed_lock.hpp"
+#include "mcs_lock.hpp"
+#include "shared_mutex.hpp"
+#include "spin_lock.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static void busy_work(int iters) {
+    volatile std::uint64_t x = 0x12345678ULL;
+    for (int i = 0; i < iters; ++i) x = x * 1103515245ULL + 12345ULL;
+}
+
+template<typename Lock>
+concept SharedLockable = requires(Lock& m) {
+    m.lock_shared();
+    m.unlock_shared();
+};
+
+struct Config {
+    std::vector<std::string> locks;  // 为空表示全部
+    std::vector<int> threads{1, 2, 4, 8};
+    std::vector<int> cs{0, 100, 1000};
+    std::vector<int> read_pct{0, 90};
+    int duration_ms = 100;
+    bool csv = false;
+};
+
+struct Result {
+    const char* lock = "";
+    int threads = 1;
+    int cs = 0;
+    int read_pct = 0;
+    std::uint64_t ops = 0;
+    double seconds = 0;
+    std::int64_t p50 = 0, p99 = 0, max = 0;
+};
+
+// 每个线程自己的计数和延迟样本，各占一个缓存行，互不干扰
+struct alignas(64) PerThread {
+    std::uint64_t ops = 0;
+    std::uint64_t writes = 0;
+    std::vector<std::int64_t> lat;
+};
+
+// 每个线程最多保留这么多个延迟样本，避免长时间运行时内存无限增长
+static constexpr std::size_t kMaxSamples = 1 << 20;
+
+template<typename Lock>
+static Result run(const char* name, int threads, int cs, int read_pct, int duration_ms) {
+    Lock m;
+    std::uint64_t value = 0;  // 受 m 保护
+    std::atomic<bool> stop{false};
+    std::vector<PerThread> per(static_cast<std::size_t>(threads));
+    std::barrier start(threads + 1);
+
+    std::vector<std::thread> ts;
+    ts.reserve(static_cast<std::size_t>(threads));
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&, t] {
+            PerThread& me = per[static_cast<std::size_t>(t)];
+            me.lat.reserve(1 << 16);
+            std::uint64_t rng = 0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(t + 1);
+            start.arrive_and_wait();
+            while (!stop.load(std::memory_order_relaxed)) {
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+                bool read = static_cast<int>(rng % 100) < read_pct;
+                std::int64_t t0 = now_ns();
+                if constexpr (SharedLockable<Lock>) {
+                    if (read) m.lock_shared();
+                    else m.lock();
+                }
+                else {
+                    m.lock();
+                }
+                std::int64_t t1 = now_ns();
+                if (read) {
+                    volatile std::uint64_t v = value;
+                    (void)v;
+                }
+                else {
+                    ++value;
+                    ++me.writes;
+                }
+                busy_work(cs);
+                if constexpr (SharedLockable<Lock>) {
+                    if (read) m.unlock_shared();
+                    else m.unlock();
+                }
+                else {
+                    m.unlock();
+                }
+                ++me.ops;
+                if (me.lat.size() < kMaxSamples) me.lat.push_back(t1 - t0);
+            }
+        });
+    }
+
+    start.arrive_and_wait();
+    std::int64_t begin = now_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& th : ts) th.join();
+
+    Result r;
+    r.lock = name;
+    r.threads = threads;
+    r.cs = cs;
+    r.read_pct = read_pct;
+    r.seconds = static_cast<double>(now_ns() - begin) / 1e9;
+
+    std::uint64_t writes = 0;
+    std::vector<std::int64_t> lat;
+    for (auto& p : per) {
+        r.ops += p.ops;
+        writes += p.writes;
+        lat.insert(lat.end(), p.lat.begin(), p.lat.end());
+    }
+    if (value != writes) {
+        std::fprintf(stderr, "%s: lost update (value=%llu, writes=%llu)\n", name,
+                     static_cast<unsigned long long>(value), static_cast<unsigned long long>(writes));
+        std::exit(1);
+    }
+    if (!lat.empty()) {
+        auto at = [&](double p) {
+            std::size_t k = std::min(lat.size() - 1, static_cast<std::size_t>(p * static_cast<double>(lat.size() - 1)));
+            std::nth_element(lat.begin(), lat.begin() + static_cast<std::ptrdiff_t>(k), lat.end());
+            return lat[k];
+        };
+        r.p50 = at(0.50);
+        r.p99 = at(0.99);
+        r.max = *std::max_element(lat.begin(), lat.end());
+    }
+    return r;
+}
+
+struct LockEntry {
+    const char* name;
+    Result (*run)(const char*, int, int, int, int);
+};
+
+static const LockEntry kLocks[] = {
+    {"spin", run<SpinLock>},
+    {"mcs", run<MCSLock>},
+    {"futex_timed", run<FutexTimedLock>},
+    {"futex_recursive_timed", run<FutexRecursiveTimedLock>},
+    {"reader_pref", run<reader_pref::shared_mutex>},
+    {"writer_pref", run<writer_pref::shared_mutex>},
+    {"fair_fifo", run<fair_fifo::shared_mutex>},
+    {"big_reader", run<big_reader::shared_mutex>},
+    {"std::mutex", run<std::mutex>},
+    {"std::timed_mutex", run<std::timed_mutex>},
+    {"std::recursive_mutex", run<std::recursive_mutex>},
+    {"std::shared_mutex", run<std::shared_mutex>},
+};
+
+static void print(const Config& cfg, const Result& r) {
+    double ops = r.seconds > 0 ? static_cast<double>(r.ops) / r.seconds : 0;
+    if (cfg.csv) {
+        std::printf("%s,%d,%d,%d,%llu,%.6f,%.0f,%lld,%lld,%lld\n", r.lock, r.threads, r.cs, r.read_pct,
+                    static_cast<unsigned long long>(r.ops), r.seconds, ops, static_cast<long long>(r.p50),
+                    static_cast<long long>(r.p99), static_cast<long long>(r.max));
+    }
+    else {
+        std::printf("{\"lock\":\"%s\",\"threads\":%d,\"cs\":%d,\"read_pct\":%d,\"ops\":%llu,\"seconds\":%.6f,"
+                    "\"ops_per_sec\":%.0f,\"p50_ns\":%lld,\"p99_ns\":%lld,\"max_ns\":%lld}\n",
+                    r.lock, r.threads, r.cs, r.read_pct, static_cast<unsigned long long>(r.ops), r.seconds, ops,
+                    static_cast<long long>(r.p50), static_cast<long long>(r.p99), static_cast<long long>(r.max));
+    }
+    std::fflush(stdout);
+}
+
+static bool selected(const Config& cfg, const char* name) {
+    return cfg.locks.empty() || std::find(cfg.locks.begin(), cfg.locks.end(), name) != cfg.locks.end();
+}
+
+// 程序自己的选项（--locks 是 --lock 的别名）
+enum { OPT_CS = 0x100, OPT_READ_PCT, OPT_DURATION_MS, OPT_LIST };
+
+static const bench_extra kExtra[] = {
+    {"locks", 0, required_argument, BENCH_ID_LOCK, "NAMES", "same as --lock"},
+    {"cs", 0, required_argument, OPT_CS, "LIST", "busy_work iterations inside the critical section"},
+    {"read-pct", 0, required_argument, OPT_READ_PCT, "LIST", "percentage of shared (read) acquisitions"},
+    {"duration-ms", 0, required_argument, OPT_DURATION_MS, "N", "same as --duration=Nms"},
+    {"list", 0, no_argument, OPT_LIST, nullptr, "list the lock names and exit"},
+    {nullptr, 0, 0, 0, nullptr, nullptr},
+};
+
+// 程序自己的选项解析到这里，bench_list 再转成 Config 里的 vector
+struct ExtraArgs {
+    bench_list cs{};
+    bench_list read_pct{};
+    long duration_ms = 0;
+};
+
+static int on_option(int id, const char* arg, void* ctx) {
+    auto& x = *static_cast<ExtraArgs*>(ctx);
+    switch (id) {
+        case OPT_CS:
+            return bench_parse_list(arg, 0, &x.cs);
+        case OPT_READ_PCT:
+            if (bench_parse_list(arg, 0, &x.read_pct) == -1) return -1;
+            return std::all_of(x.read_pct.v, x.read_pct.v + x.read_pct.n, [](long p) { return p <= 100; }) ? 0 : -1;
+        case OPT_DURATION_MS:
+            return bench_parse_long(arg, 1, &x.duration_ms);
+        case OPT_LIST:
+            for (auto& e : kLocks) std::printf("%s\n", e.name);
+            std::exit(0);
+        default:
+            return -1;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    ExtraArgs x;
+    bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_THREADS | BENCH_OPT_LOCK | BENCH_OPT_DURATION | BENCH_OPT_FORMAT, nullptr);
+    int idx = bench_opts_parse(&o, argc, argv, kExtra, on_option, &x);
+    if (idx <= 0) return idx < 0;
+    if (idx != argc) {
+        bench_opts_usage(stderr, argv[0], &o, kExtra);
+        return 1;
+    }
+    if (o.header) {
+        std::printf("lock,threads,cs,read_pct,ops,seconds,ops_per_sec,p50_ns,p99_ns,max_ns\n");
+        return 0;
+    }
+    cfg.csv = o.csv;
+    if (x.duration_ms > 0) cfg.duration_ms = static_cast<int>(x.duration_ms);
+    if (o.duration_ms > 0) cfg.duration_ms = static_cast<int>(o.duration_ms);
+    cfg.locks.assign(o.lock.v, o.lock.v + o.lock.n);
+    if (o.threads.n) cfg.threads.assign(o.threads.v, o.threads.v + o.threads.n);
+    if (x.cs.n) cfg.cs.assign(x.cs.v, x.cs.v + x.cs.n);
+    if (x.read_pct.n) cfg.read_pct.assign(x.read_pct.v, x.read_pct.v + x.read_pct.n);
+    for (auto& name : cfg.locks) {
+        bool known = std::any_of(std::begin(kLocks), std::end(kLocks), [&](auto& e) { return name == e.name; });
+        if (!known) {
+            std::fprintf(stderr, "unknown lock: %s (see --list)\n", name.c_str());
+            return 1;
+        }
+    }
+
+    for (auto& e : kLocks) {
+        if (!selected(cfg, e.name)) continue;
+        for (int t : cfg.threads)
+            for (int cs : cfg.cs)
+                for (int rp : cfg.read_pct) print(cfg, e.run(e.name, t, cs, rp, cfg.duration_ms));
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// MCS 队列锁的测试与竞争基准
+//
+// 用法: ./mcs_lock [每组测试的总加锁次数，默认 200000，平分给各线程]
+// 依次在 1 ~ 64 个线程下对比 TAS、TTAS（以前 spin_lock.cpp 中的两种写法）、自适应 SpinLock、MCSLock 和 std::mutex
+// 线程数超过核数时，纯自旋的 TAS / TTAS / MCS 都会因为持有者（或 MCS 中排在前面的等待者）被抢占而变慢，
+// 这正是 SpinLock 最后睡到 futex 上的原因；MCS 适合线程数不超过核数、核数很多的场景
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mcs_lock.hpp"
+#include "spin_lock.hpp"
+
+// 对照组：以前的 TAS / TTAS 自旋锁，一直自旋
+class TASLock {
+public:
+    void lock() {
+        while(flag_.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+    void unlock() { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+class TTASLock {
+public:
+    void lock() {
+        while(true) {
+            while(flag_.test(std::memory_order_relaxed)) {
+            }
+            if(!flag_.test_and_set(std::memory_order_acquire)) return ;
+        }
+    }
+    void unlock() { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+};
+
+// 先让 0 号线程持有锁，其余线程按 1, 2, 3 ... 的顺序依次排队，释放后应当按同样的顺序拿到锁
+static void test_fifo_handoff() {
+    MCSLock m;
+    constexpr int kWaiters = 4;
+    std::atomic<int> queued{0};
+    std::vector<int> order;
+    m.lock();
+    std::vector<std::thread> ts;
+    for(int i = 1; i <= kWaiters; i ++ ) {
+        // 等上一个线程进入队列（此时它正在自旋）之后再启动下一个
+        while(queued.load() != i - 1) std::this_thread::yield();
+        ts.emplace_back([&, i] {
+            queued.store(i);
+            std::lock_guard<MCSLock> lock(m);
+            order.push_back(i);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    m.unlock();
+    for(auto& t : ts) t.join();
+    assert((order == std::vector<int>{1, 2, 3, 4}));
+    std::cout << "fifo handoff test passed" << std::endl;
+}
+
+// 同一个线程同时持有多把 MCSLock（每把一个节点），以及 try_lock
+static void test_nested_and_try_lock() {
+    MCSLock a, b;
+    {
+        std::scoped_lock lock(a, b);  // std::lock 会用到 try_lock
+        assert(!a.try_lock() && !b.try_lock());
+    }
+    assert(a.try_lock());
+    std::thread([&] { assert(!a.try_lock()); }).join();
+    a.unlock();
+    std::cout << "nested / try_lock test passed" << std::endl;
+}
+
+static void busy_work(int iters) {
+    volatile int x = 0;
+    for(int i = 0; i < iters; i ++ ) x = x + i;
+}
+
+template<typename Mutex>
+static double bench(int threads, int ops) {
+    Mutex m;
+    long long counter = 0;
+    std::vector<std::thread> ts;
+    ts.reserve(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    for(int t = 0; t < threads; t ++ ) {
+        ts.emplace_back([&] {
+            for(int i = 0; i < ops; i ++ ) {
+                std::lock_guard<Mutex> lock(m);
+                ++ counter;
+                busy_work(20);
+            }
+        });
+    }
+    for(auto& t : ts) t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(counter != static_cast<long long>(threads) * ops) {
+        std::cerr << "lost update: " << counter << std::endl;
+        std::exit(1);
+    }
+    return static_cast<double>(counter) / sec;
+}
+
+int main(int argc, char** argv) {
+    test_fifo_handoff();
+    test_nested_and_try_lock();
+
+    int ops = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200000;
+    std::cout << "\nops/s (hardware_concurrency = " << std::thread::hardware_concurrency() << ")\n";
+    std::cout << "threads         TAS        TTAS    SpinLock     MCSLock  std::mutex\n";
+    for(int n : {1, 2, 4, 8, 16, 32, 64}) {
+        int per = std::max(1, ops / n);
+        std::cout << std::setw(7) << n << std::fixed << std::setprecision(0)
+                  << std::setw(12) << bench<TASLock>(n, per)
+                  << std::setw(12) << bench<TTASLock>(n, per)
+                  << std::setw(12) << bench<SpinLock>(n, per)
+                  << std::setw(12) << bench<MCSLock>(n, per)
+                  << std::setw(12) << bench<std::mutex>(n, per) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+// MCS 队列锁（Mellor-Crummey & Scott, 1991）
+//
+// TTAS 自旋锁的所有等待者都盯着同一个缓存行，锁一释放，所有核同时去抢，
+// 缓存一致性流量随核数线性增长；MCS 让每个等待者排成一个链表，各自只在自己的节点上自旋：
+//   - lock  : 把自己的节点 exchange 到 tail_，有前驱就挂到前驱的 next 上，然后盯着自己的 locked
+//   - unlock: 把后继的 locked 置为 false，只有这一个核的缓存行失效；没有后继就把 tail_ 还原为空
+// 锁严格按到达顺序（FIFO）交接，不会饿死任何等待者
+//
+// 标准的 MCS 要求调用方提供节点，这里的节点来自每个线程自己的节点池，
+// lock() / unlock() 不带参数，满足 Lockable，可以直接配合 std::lock_guard / my_std_like::scoped_lock 使用
+// 一个线程可以同时持有多把 MCSLock，每持有一把占用一个节点；unlock 必须由加锁的线程调用
+#ifndef MUTEX_MCS_LOCK_H
+#define MUTEX_MCS_LOCK_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "spin_lock.hpp"
+
+class MCSLock {
+public:
+    // 等待者自旋这么多次 pause 之后改为每次 yield：前面的等待者被抢占时，后面的人不能一直死等
+    static constexpr int kSpinBeforeYield = 1024;
+
+    MCSLock() = default;
+    MCSLock(const MCSLock&) = delete;
+    MCSLock& operator=(const MCSLock&) = delete;
+
+    void lock() {
+        Node* me = NodePool::local().acquire();
+        me->next.store(nullptr, std::memory_order_relaxed);
+        me->locked.store(true, std::memory_order_relaxed);
+        // acq_rel：release 发布上面两次初始化，acquire 保证能看到前驱节点的内容
+        Node* pred = tail_.exchange(me, std::memory_order_acq_rel);
+        if(pred) {
+            pred->next.store(me, std::memory_order_release);
+            int spins = 0;
+            while(me->locked.load(std::memory_order_acquire)) {
+                if(++ spins < kSpinBeforeYield) spin::cpu_relax();
+                else std::this_thread::yield();
+            }
+        }
+        // 持有者独占 holder_，unlock 时据此找到自己的节点
+        holder_ = me;
+    }
+
+    bool try_lock() {
+        Node* me = NodePool::local().acquire();
+        me->next.store(nullptr, std::memory_order_relaxed);
+        me->locked.store(false, std::memory_order_relaxed);
+        Node* expected = nullptr;
+        if(!tail_.compare_exchange_strong(expected, me, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            NodePool::local().release(me);
+            return false;
+        }
+        holder_ = me;
+        return true;
+    }
+
+    void unlock() {
+        Node* me = holder_;
+        Node* succ = me->next.load(std::memory_order_acquire);
+        if(!succ) {
+            // 没有后继：tail_ 仍然是自己就直接清空
+            Node* expected = me;
+            if(tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+                NodePool::local().release(me);
+                return ;
+            }
+            // 有人已经 exchange 了 tail_，但还没来得及挂到 me->next 上，等它一下
+            while(!(succ = me->next.load(std::memory_order_acquire))) spin::cpu_relax();
+        }
+        succ->locked.store(false, std::memory_order_release);
+        // 后继只在自己的节点上自旋，交接之后不会再访问 me，可以立即复用
+        NodePool::local().release(me);
+    }
+
+private:
+    // 每个节点独占一个缓存行，等待者之间不会伪共享
+    struct alignas(64) Node {
+        std::atomic<Node*> next{nullptr};
+        std::atomic<bool> locked{false};
+        Node* free_next = nullptr;  // 节点池的空闲链表，只有本线程访问
+    };
+
+    // 每个线程的节点池：只增不减，线程退出时统一释放
+    // 线程不应该在持有 MCSLock 时退出，所以那时所有节点都已经空闲
+    class NodePool {
+    public:
+        static NodePool& local() {
+            thread_local NodePool pool;
+            return pool;
+        }
+
+        Node* acquire() {
+            if(free_) {
+                Node* n = free_;
+                free_ = n->free_next;
+                return n;
+            }
+            nodes_.push_back(std::make_unique<Node>());
+            return nodes_.back().get();
+        }
+
+        void release(Node* n) noexcept {
+            n->free_next = free_;
+            free_ = n;
+        }
+
+    private:
+        std::vector<std::unique_ptr<Node>> nodes_;
+        Node* free_ = nullptr;
+    };
+
+    alignas(64) std::atomic<Node*> tail_{nullptr};
+    Node* holder_ = nullptr;  // 当前持有者的节点，只在持锁期间由持有者读写
+};
+
+#endif
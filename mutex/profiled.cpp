@@ -0,0 +1,181 @@
+// profiled<Mutex> 的测试和演示
+//
+// 用法: ./profiled
+// 先模拟三把竞争程度不同的锁，打印按总等待时间排序的报告，
+// 再验证各种锁（std::mutex、SpinLock、FutexTimedLock、std::recursive_mutex、std::shared_mutex）包上之后计数正确
+// 用 -DMUTEX_PROFILING=0（或 -DNDEBUG）编译时 profiled<Mutex> 就是 Mutex 本身，报告是空的
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "futex_timed_lock.hpp"
+#include "profiled.hpp"
+#include "spin_lock.hpp"
+
+using namespace std::chrono;
+
+// 关掉统计时没有任何额外字段
+static_assert(sizeof(basic_profiled<SpinLock, false>) == sizeof(SpinLock));
+static_assert(std::is_base_of_v<std::mutex, basic_profiled<std::mutex, false>>);
+
+static lock_profiler::LockStats stats_of(const std::string& name) {
+    for(auto& s : lock_profiler::snapshot()) {
+        if(s.name == name) return s;
+    }
+    return {};
+}
+
+static void test_uncontended() {
+    basic_profiled<std::mutex, true> m("test: uncontended");
+    for(int i = 0; i < 1000; i ++ ) {
+        std::lock_guard<basic_profiled<std::mutex, true>> lock(m);
+    }
+    auto s = stats_of("test: uncontended");
+    assert(s.acquisitions == 1000 && s.contended == 0 && s.wait_ns == 0);
+    std::cout << "uncontended test passed" << std::endl;
+}
+
+// 持有者拿着锁睡 50ms，另一个线程的等待和持有者的持有都应该被记下来
+static void test_contended_wait_and_hold() {
+    basic_profiled<SpinLock, true> m("test: contended");
+    m.lock();
+    std::thread t([&] {
+        m.lock();
+        m.unlock();
+    });
+    std::this_thread::sleep_for(50ms);
+    m.unlock();
+    t.join();
+    auto s = stats_of("test: contended");
+    assert(s.acquisitions == 2 && s.contended == 1);
+    assert(s.wait_ns >= 30'000'000 && s.hold_ns >= 50'000'000);
+    std::cout << "contended test passed (wait=" << s.wait_ns / 1000000 << "ms)" << std::endl;
+}
+
+// try_lock_for 超时失败：等待时间照样计入，但不算一次成功加锁
+static void test_timed_timeout() {
+    basic_profiled<FutexTimedLock, true> m("test: timed");
+    m.lock();
+    std::thread([&] { assert(!m.try_lock_for(20ms)); }).join();
+    m.unlock();
+    assert(m.try_lock_until(steady_clock::now() + 10ms));
+    m.unlock();
+    auto s = stats_of("test: timed");
+    assert(s.acquisitions == 2 && s.contended == 1 && s.wait_ns >= 15'000'000);
+    std::cout << "timed test passed" << std::endl;
+}
+
+// 可重入：每一层都算一次加锁，持有时间只在最外层结算一次
+static void test_recursive() {
+    basic_profiled<std::recursive_mutex, true> m("test: recursive");
+    m.lock();
+    m.lock();
+    assert(m.try_lock());
+    std::this_thread::sleep_for(10ms);
+    m.unlock();
+    m.unlock();
+    m.unlock();
+    auto s = stats_of("test: recursive");
+    assert(s.acquisitions == 3 && s.contended == 0);
+    assert(s.hold_ns >= 10'000'000 && s.hold_ns < 1'000'000'000);
+    std::cout << "recursive test passed" << std::endl;
+}
+
+// 共享锁：读者之间不算竞争，写者持有时读者要等
+static void test_shared() {
+    basic_profiled<std::shared_mutex, true> m("test: shared");
+    m.lock_shared();
+    std::thread([&] {
+        m.lock_shared();
+        m.unlock_shared();
+    }).join();
+    m.unlock_shared();
+
+    m.lock();
+    std::thread reader([&] {
+        std::shared_lock<basic_profiled<std::shared_mutex, true>> lock(m);
+    });
+    std::this_thread::sleep_for(20ms);
+    m.unlock();
+    reader.join();
+    auto s = stats_of("test: shared");
+    assert(s.acquisitions == 4 && s.contended == 1 && s.wait_ns >= 10'000'000);
+    std::cout << "shared test passed" << std::endl;
+}
+
+// 同名的锁合并成一行，按总等待时间排序
+static void test_merge_by_name() {
+    basic_profiled<std::mutex, true> a("test: per-object"), b("test: per-object");
+    a.lock();
+    a.unlock();
+    b.lock();
+    b.unlock();
+    auto s = stats_of("test: per-object");
+    assert(s.locks == 2 && s.acquisitions == 2);
+    auto all = lock_profiler::snapshot();
+    for(std::size_t i = 1; i < all.size(); i ++ ) assert(all[i - 1].wait_ns >= all[i].wait_ns);
+    std::cout << "merge by name test passed" << std::endl;
+}
+
+// 锁不断创建、销毁：id 按名字回收，超过 kMaxLocks 个实例也照常统计；共享持有记录用完即还
+static void test_recycle_ids() {
+    const std::size_t n = lock_profiler::detail::ThreadTable::kMaxLocks + 1000;
+    for(std::size_t i = 0; i < n; i ++ ) {
+        basic_profiled<std::shared_mutex, true> m("test: churn");
+        m.lock_shared();
+        m.unlock_shared();
+    }
+    auto s = stats_of("test: churn");
+    assert(s.locks == n && s.acquisitions == n);
+    assert(lock_profiler::Registry::instance().untracked() == 0);
+    assert(lock_profiler::detail::shared_holds().used == 0);
+    std::cout << "recycle ids test passed" << std::endl;
+}
+
+static void busy_work(int iters) {
+    volatile int x = 0;
+    for(int i = 0; i < iters; i ++ ) x = x + i;
+}
+
+// 三把锁：临界区越长、线程越多，等待越多，报告里就排得越靠前
+static void demo() {
+    profiled<std::mutex> hot("demo: hot (8 threads, long cs)");
+    profiled<SpinLock> warm("demo: warm (4 threads)");
+    profiled<std::mutex> cold("demo: cold (1 thread)");
+    auto run = [](auto& m, int threads, int ops, int cs) {
+        std::vector<std::thread> ts;
+        for(int t = 0; t < threads; t ++ ) {
+            ts.emplace_back([&] {
+                for(int i = 0; i < ops; i ++ ) {
+                    std::lock_guard lock(m);
+                    busy_work(cs);
+                }
+            });
+        }
+        for(auto& t : ts) t.join();
+    };
+    run(hot, 8, 20000, 2000);
+    run(warm, 4, 20000, 200);
+    run(cold, 1, 20000, 200);
+    lock_profiler::dump(std::cout, 3);
+}
+
+int main() {
+    demo();
+    std::cout << "\n";
+    // 测试里直接用 basic_profiled<Mutex, true>，不受 MUTEX_PROFILING 影响
+    test_uncontended();
+    test_contended_wait_and_hold();
+    test_timed_timeout();
+    test_recursive();
+    test_shared();
+    test_merge_by_name();
+    test_recycle_ids();
+    return 0;
+}
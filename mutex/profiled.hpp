@@ -0,0 +1,459 @@
+// 锁竞争分析：profiled<Mutex> 可以包住任何 Lockable（SpinLock、TimedLock、RecursiveLock、各种 shared_mutex、std::mutex ...）
+//
+//   profiled<SpinLock> mtx{"cache.cpp: lru_mtx"};   // 名字相同的锁在报告里合并成一行
+//   ...
+//   lock_profiler::dump(std::cout, 10);             // 按总等待时间打印最热的 10 把锁
+//
+// 思路来自 scoped_lock.cpp 中的 TracedMutex：转发 lock / unlock，顺便记一笔
+//   - 等待时间：先 try_lock，成功就算无竞争（不读时钟）；失败才计一次 contended，并计时阻塞的 lock
+//   - 持有时间：拿到锁到最外层 unlock 之间的时间（可重入锁只算最外层，共享锁每个读者各算各的）
+// 计数写在每个线程自己的桶里：只有本线程写（relaxed load + store，没有 RMW，也没有共享缓存行），
+// dump 时再把所有线程的桶加起来，所以被统计的锁本身不会因为统计多出竞争
+//
+// 发布版本里可以完全去掉：-DMUTEX_PROFILING=0（默认跟随 NDEBUG），
+// 或者直接写 basic_profiled<Mutex, false>：此时它就是 Mutex 本身，没有任何字段和额外开销
+#ifndef MUTEX_PROFILED_H
+#define MUTEX_PROFILED_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef MUTEX_PROFILING
+#  ifdef NDEBUG
+#    define MUTEX_PROFILING 0
+#  else
+#    define MUTEX_PROFILING 1
+#  endif
+#endif
+
+namespace lock_profiler {
+
+// dump 里的一行：同名的锁合并之后的总数
+struct LockStats {
+    std::string name;
+    std::uint64_t locks = 0;        // 各个实例加起来的个数
+    std::uint64_t acquisitions = 0; // 成功加锁次数（含 try_lock、共享锁）
+    std::uint64_t contended = 0;    // 第一次 try_lock 没拿到、需要等待的次数
+    std::uint64_t wait_ns = 0;      // 总等待时间
+    std::uint64_t hold_ns = 0;      // 总持有时间
+};
+
+namespace detail {
+
+using clock = std::chrono::steady_clock;
+
+inline std::uint64_t now_ns() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock::now().time_since_epoch()).count());
+}
+
+// 一个线程对一把锁的计数；只有所属线程写，dump 时其它线程只读
+struct Bucket {
+    std::atomic<std::uint64_t> acquisitions{0};
+    std::atomic<std::uint64_t> contended{0};
+    std::atomic<std::uint64_t> wait_ns{0};
+    std::atomic<std::uint64_t> hold_ns{0};
+
+    static void add(std::atomic<std::uint64_t>& field, std::uint64_t v) noexcept {
+        field.store(field.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+};
+
+// 一个线程的所有桶，按锁的 id 分块懒分配：块一经发布就不再移动，dump 可以安全地并发读
+class ThreadTable {
+public:
+    static constexpr std::size_t kChunkSize = 64;
+    static constexpr std::size_t kMaxChunks = 1024;
+    static constexpr std::size_t kMaxLocks = kChunkSize * kMaxChunks;
+
+    ~ThreadTable() {
+        for(auto& c : chunks_) delete[] c.load(std::memory_order_relaxed);
+    }
+
+    Bucket& at(std::uint32_t id) {
+        auto& slot = chunks_[id / kChunkSize];
+        Bucket* chunk = slot.load(std::memory_order_acquire);
+        if(!chunk) {
+            chunk = new Bucket[kChunkSize];
+            slot.store(chunk, std::memory_order_release);
+        }
+        return chunk[id % kChunkSize];
+    }
+
+    // 没分配过就返回 nullptr（dump 用）
+    const Bucket* find(std::uint32_t id) const {
+        const Bucket* chunk = chunks_[id / kChunkSize].load(std::memory_order_acquire);
+        return chunk ? chunk + id % kChunkSize : nullptr;
+    }
+
+private:
+    std::array<std::atomic<Bucket*>, kMaxChunks> chunks_{};
+};
+
+// 一个线程当前持有的共享锁和各自的持有起点，按锁的地址线性查找
+// 放掉最外层时就腾出槽位，所以大小只取决于同时持有的共享锁个数，不会随锁的创建 / 销毁增长
+// 同时持有超过 kSlots 把时，多出来的那几把不统计持有时间（次数和等待照常统计）
+struct SharedHolds {
+    static constexpr std::size_t kSlots = 16;
+    struct Slot {
+        const void* lock;
+        std::uint32_t depth;
+        std::uint64_t since;
+    };
+
+    Slot* find(const void* lock) noexcept {
+        for(std::size_t i = 0; i < used; i ++ ) {
+            if(slots[i].lock == lock) return &slots[i];
+        }
+        return nullptr;
+    }
+    Slot* insert(const void* lock) noexcept {
+        if(used == kSlots) return nullptr;
+        slots[used] = Slot{lock, 0, 0};
+        return &slots[used ++ ];
+    }
+    void erase(Slot* slot) noexcept { *slot = slots[-- used]; }
+
+    std::array<Slot, kSlots> slots;
+    std::size_t used;
+};
+
+inline SharedHolds& shared_holds() noexcept {
+    constinit thread_local SharedHolds holds{};
+    return holds;
+}
+
+} // namespace detail
+
+// 全局登记处：给每把锁分配 id、记住名字，管理所有线程的桶
+// 线程退出时它的表不会丢掉，而是放回空闲链表给之后的线程复用（计数本来就是累加的）
+class Registry {
+public:
+    static constexpr std::uint32_t kNoId = UINT32_MAX;
+
+    static Registry& instance() {
+        static Registry r;
+        return r;
+    }
+
+    // 锁析构时 id 按名字回收，之后同名的锁（没有名字的锁之间也一样）直接复用：
+    // 桶里的计数本来就按名字合并，复用不需要清零，报告里也只是这个名字的实例数加一
+    // 返回 kNoId 表示同时存在的锁名太多、id 用完了，这把锁不做统计（dump 里会提示有多少把）
+    std::uint32_t register_lock(const char* name) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = free_ids_.find(name ? name : "");
+        if(it != free_ids_.end() && !it->second.empty()) {
+            std::uint32_t id = it->second.back();
+            it->second.pop_back();
+            ++ instances_[id];
+            return id;
+        }
+        if(names_.size() >= detail::ThreadTable::kMaxLocks) {
+            ++ untracked_;
+            return kNoId;
+        }
+        auto id = static_cast<std::uint32_t>(names_.size());
+        names_.push_back(name ? std::string(name) : "lock#" + std::to_string(id));
+        named_.push_back(name != nullptr);
+        instances_.push_back(1);
+        return id;
+    }
+
+    void unregister_lock(std::uint32_t id) {
+        if(id == kNoId) return;
+        std::lock_guard<std::mutex> lock(mtx_);
+        free_ids_[named_[id] ? names_[id] : std::string()].push_back(id);
+    }
+
+    // 因为 id 用完而没有统计的锁的个数
+    std::uint64_t untracked() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return untracked_;
+    }
+
+    detail::ThreadTable* acquire_table() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if(!free_.empty()) {
+            auto* t = free_.back();
+            free_.pop_back();
+            return t;
+        }
+        tables_.push_back(std::make_unique<detail::ThreadTable>());
+        return tables_.back().get();
+    }
+
+    void release_table(detail::ThreadTable* t) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        free_.push_back(t);
+    }
+
+    // 所有锁按名字合并后的统计，按总等待时间从大到小排序
+    std::vector<LockStats> snapshot() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::map<std::string, LockStats> by_name;
+        for(std::uint32_t id = 0; id < names_.size(); id ++ ) {
+            LockStats& s = by_name[names_[id]];
+            s.name = names_[id];
+            s.locks += instances_[id];
+            for(auto& t : tables_) {
+                const detail::Bucket* b = t->find(id);
+                if(!b) continue;
+                s.acquisitions += b->acquisitions.load(std::memory_order_relaxed);
+                s.contended += b->contended.load(std::memory_order_relaxed);
+                s.wait_ns += b->wait_ns.load(std::memory_order_relaxed);
+                s.hold_ns += b->hold_ns.load(std::memory_order_relaxed);
+            }
+        }
+        std::vector<LockStats> out;
+        out.reserve(by_name.size());
+        for(auto& [_, s] : by_name) out.push_back(std::move(s));
+        std::stable_sort(out.begin(), out.end(), [](const LockStats& a, const LockStats& b) {
+            return a.wait_ns > b.wait_ns;
+        });
+        return out;
+    }
+
+private:
+    Registry() = default;
+
+    mutable std::mutex mtx_;
+    std::vector<std::string> names_;                          // 下标就是锁的 id
+    std::vector<bool> named_;                                 // 构造时有没有给名字
+    std::vector<std::uint64_t> instances_;                    // 用过这个 id 的锁的个数
+    std::map<std::string, std::vector<std::uint32_t>> free_ids_;  // 已析构的锁留下的 id，按名字（没有名字是 ""）
+    std::uint64_t untracked_ = 0;
+    std::vector<std::unique_ptr<detail::ThreadTable>> tables_;
+    std::vector<detail::ThreadTable*> free_;                   // 线程已经退出的表
+};
+
+namespace detail {
+
+struct ThreadHandle {
+    ThreadTable* table = Registry::instance().acquire_table();
+    ~ThreadHandle() { Registry::instance().release_table(table); }
+};
+
+inline Bucket& local_bucket(std::uint32_t id) {
+    thread_local ThreadHandle h;
+    return h.table->at(id);
+}
+
+} // namespace detail
+
+inline std::vector<LockStats> snapshot() {
+    return Registry::instance().snapshot();
+}
+
+// 打印按总等待时间排序的前 top_n 把锁；MUTEX_PROFILING=0 时没有锁登记，只打印表头
+inline void dump(std::ostream& os, std::size_t top_n = 10) {
+    auto stats = snapshot();
+    if(stats.size() > top_n) stats.resize(top_n);
+    auto ms = [](std::uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    os << "lock profile (top " << stats.size() << " by total wait)\n"
+       << std::left << std::setw(32) << "name" << std::right
+       << std::setw(12) << "acquires" << std::setw(12) << "contended"
+       << std::setw(14) << "wait(ms)" << std::setw(14) << "avg wait(us)" << std::setw(14) << "hold(ms)" << "\n";
+    for(auto& s : stats) {
+        double avg_us = s.contended ? static_cast<double>(s.wait_ns) / 1e3 / static_cast<double>(s.contended) : 0.0;
+        std::string name = s.locks > 1 ? s.name + " (x" + std::to_string(s.locks) + ")" : s.name;
+        os << std::left << std::setw(32) << name << std::right
+           << std::setw(12) << s.acquisitions << std::setw(12) << s.contended
+           << std::fixed << std::setprecision(3)
+           << std::setw(14) << ms(s.wait_ns) << std::setw(14) << avg_us << std::setw(14) << ms(s.hold_ns) << "\n";
+    }
+    if(std::uint64_t n = Registry::instance().untracked()) {
+        os << "warning: " << n << " lock(s) not profiled, more than " << detail::ThreadTable::kMaxLocks
+           << " distinct locks alive at once\n";
+    }
+}
+
+} // namespace lock_profiler
+
+template<typename Mutex, bool Enabled = MUTEX_PROFILING>
+class basic_profiled;
+
+// 关掉统计时就是 Mutex 本身，只多接受一个被忽略的名字
+template<typename Mutex>
+class basic_profiled<Mutex, false> : public Mutex {
+public:
+    explicit basic_profiled(const char* = nullptr) {}
+};
+
+template<typename Mutex>
+class basic_profiled<Mutex, true> {
+public:
+    explicit basic_profiled(const char* name = nullptr) : id_(lock_profiler::Registry::instance().register_lock(name)) {}
+    ~basic_profiled() { lock_profiler::Registry::instance().unregister_lock(id_); }
+    basic_profiled(const basic_profiled&) = delete;
+    basic_profiled& operator=(const basic_profiled&) = delete;
+
+    void lock() {
+        if(mtx_.try_lock()) {
+            exclusive_acquired_(0, false);
+            return ;
+        }
+        std::uint64_t t0 = lock_profiler::detail::now_ns();
+        mtx_.lock();
+        exclusive_acquired_(lock_profiler::detail::now_ns() - t0, true);
+    }
+
+    bool try_lock() {
+        if(!mtx_.try_lock()) return false;
+        exclusive_acquired_(0, false);
+        return true;
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& rel_time)
+        requires requires(Mutex& m) { m.try_lock_for(rel_time); }
+    {
+        return timed_<false>([&] { return mtx_.try_lock_for(rel_time); });
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& abs_time)
+        requires requires(Mutex& m) { m.try_lock_until(abs_time); }
+    {
+        return timed_<false>([&] { return mtx_.try_lock_until(abs_time); });
+    }
+
+    void unlock() {
+        // 可重入锁只在最外层 unlock 时结算持有时间；先读出来再放锁，放锁之后这些字段就归别人了
+        // （锁也可能马上被析构、id 被回收，所以桶也在放锁之前找好）
+        bool outermost = -- depth_ == 0;
+        std::uint64_t since = hold_since_;
+        auto* b = outermost ? bucket_() : nullptr;
+        mtx_.unlock();
+        if(b) record_hold_(b, since);
+    }
+
+    void lock_shared()
+        requires requires(Mutex& m) { m.lock_shared(); m.try_lock_shared(); }
+    {
+        if(mtx_.try_lock_shared()) {
+            shared_acquired_(0, false);
+            return ;
+        }
+        std::uint64_t t0 = lock_profiler::detail::now_ns();
+        mtx_.lock_shared();
+        shared_acquired_(lock_profiler::detail::now_ns() - t0, true);
+    }
+
+    bool try_lock_shared()
+        requires requires(Mutex& m) { m.try_lock_shared(); }
+    {
+        if(!mtx_.try_lock_shared()) return false;
+        shared_acquired_(0, false);
+        return true;
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_shared_for(const std::chrono::duration<Rep, Period>& rel_time)
+        requires requires(Mutex& m) { m.try_lock_shared_for(rel_time); }
+    {
+        return timed_<true>([&] { return mtx_.try_lock_shared_for(rel_time); });
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_shared_until(const std::chrono::time_point<Clock, Duration>& abs_time)
+        requires requires(Mutex& m) { m.try_lock_shared_until(abs_time); }
+    {
+        return timed_<true>([&] { return mtx_.try_lock_shared_until(abs_time); });
+    }
+
+    void unlock_shared()
+        requires requires(Mutex& m) { m.unlock_shared(); }
+    {
+        // 读者可能很多，持有时间的起点记在本线程的 SharedHolds 里；同一线程重复持有共享锁时只算最外层
+        auto& holds = lock_profiler::detail::shared_holds();
+        lock_profiler::detail::Bucket* b = nullptr;
+        std::uint64_t since = 0;
+        if(auto* slot = holds.find(this); slot && -- slot->depth == 0) {
+            since = slot->since;
+            holds.erase(slot);
+            b = bucket_();
+        }
+        mtx_.unlock_shared();
+        if(b) record_hold_(b, since);
+    }
+
+    Mutex& native() noexcept { return mtx_; }
+
+private:
+    lock_profiler::detail::Bucket* bucket_() {
+        return id_ == lock_profiler::Registry::kNoId ? nullptr : &lock_profiler::detail::local_bucket(id_);
+    }
+
+    void count_(std::uint64_t wait_ns, bool contended) {
+        if(auto* b = bucket_()) {
+            lock_profiler::detail::Bucket::add(b->acquisitions, 1);
+            if(contended) {
+                lock_profiler::detail::Bucket::add(b->contended, 1);
+                lock_profiler::detail::Bucket::add(b->wait_ns, wait_ns);
+            }
+        }
+    }
+
+    static void record_hold_(lock_profiler::detail::Bucket* b, std::uint64_t since) {
+        lock_profiler::detail::Bucket::add(b->hold_ns, lock_profiler::detail::now_ns() - since);
+    }
+
+    // hold_since_ / depth_ 只有持有者读写：拿到锁之后写，放锁之前读
+    void exclusive_acquired_(std::uint64_t wait_ns, bool contended) {
+        if(depth_ ++ == 0) hold_since_ = lock_profiler::detail::now_ns();
+        count_(wait_ns, contended);
+    }
+
+    void shared_acquired_(std::uint64_t wait_ns, bool contended) {
+        auto& holds = lock_profiler::detail::shared_holds();
+        auto* slot = holds.find(this);
+        if(!slot && (slot = holds.insert(this))) slot->since = lock_profiler::detail::now_ns();
+        if(slot) ++ slot->depth;
+        count_(wait_ns, contended);
+    }
+
+    // 带超时的加锁：先 try 一次，失败时计入等待（超时失败也算，等待时间同样花出去了）
+    template<bool Shared, typename F>
+    bool timed_(F&& try_wait) {
+        bool contended;
+        if constexpr (Shared) contended = !mtx_.try_lock_shared();
+        else contended = !mtx_.try_lock();
+        std::uint64_t wait_ns = 0;
+        if(contended) {
+            std::uint64_t t0 = lock_profiler::detail::now_ns();
+            bool ok = try_wait();
+            wait_ns = lock_profiler::detail::now_ns() - t0;
+            if(!ok) {
+                if(auto* b = bucket_()) {
+                    lock_profiler::detail::Bucket::add(b->contended, 1);
+                    lock_profiler::detail::Bucket::add(b->wait_ns, wait_ns);
+                }
+                return false;
+            }
+        }
+        if constexpr (Shared) shared_acquired_(wait_ns, contended);
+        else exclusive_acquired_(wait_ns, contended);
+        return true;
+    }
+
+    Mutex mtx_;
+    std::uint32_t id_;
+    std::uint32_t depth_ = 0;
+    std::uint64_t hold_since_ = 0;
+};
+
+template<typename Mutex>
+using profiled = basic_profiled<Mutex>;
+
+#endif
@@ -1,4 +1,5 @@
 // 实现一个可重入锁
+// 测试用的全局锁包了一层 profiled<>（profiled.hpp），结束时打印它的等待 / 持有时间
 #include <iostream>
 #include <mutex>
 #include <thread>
@@ -6,6 +7,8 @@
 #include <chrono>
 #include <vector>
 
+#include "profiled.hpp"
+
 class RecursiveLock {
 public:
     RecursiveLock() = default;
@@ -72,11 +75,11 @@ private:
     uint64_t cnt_{0}; // 暂时不考虑 cnt_ 溢出的问题
 };
 
-RecursiveLock mtx_;
+profiled<RecursiveLock> mtx_{"recursive_lock.cpp: mtx_"};
 int value_ = 0;
 
 void recursive_increment(int depth, int max_depth, int thread_id) {
-    std::lock_guard<RecursiveLock> lock(mtx_);
+    std::lock_guard<profiled<RecursiveLock>> lock(mtx_);
     std::cout << "[thread " << thread_id 
             << "] depth=" << depth 
             << " value=" << value_ << std::endl;
@@ -131,6 +134,7 @@ int main()
     // => N * 3 * 3
     std::cout << "final value = " << value_ << std::endl;
     std::cout << "expected value = " << N * 3 * 3 << std::endl;
+    lock_profiler::dump(std::cout);
 
     return 0;
 }
\ No newline at end of file
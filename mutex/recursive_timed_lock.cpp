@@ -6,6 +6,11 @@
 // lock：阻塞到成功
 // try_lock：立即返回
 // try_lock_for/try_lock_until：带超时
+//
+// futex_timed_lock.hpp 中的 FutexRecursiveTimedLock 是同样语义的原子状态字版本：重入只比较 owner_，不碰内部锁
+// 下面的测试对两者都跑一遍，最后的基准对比 RecursiveTimedLock、FutexRecursiveTimedLock 和 std::recursive_timed_mutex
+//
+// 用法: ./recursive_timed_lock [每组基准的总加锁次数，默认 200000]
 #include <thread>
 #include <chrono>
 #include <mutex>
@@ -17,6 +22,11 @@
 #include <atomic>
 #include <sstream>
 #include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+
+#include "futex_timed_lock.hpp"
 
 class RecursiveTimedLock {
 public:
@@ -112,7 +122,8 @@ private:
 
 // ------------------------ Tests ------------------------
 
-static RecursiveTimedLock g_lock;
+template<typename Lock>
+static Lock g_lock;
 static int g_value = 0;
 
 static std::string tid() {
@@ -122,12 +133,13 @@ static std::string tid() {
 }
 
 // 测试1：同线程递归可重入
+template<typename Lock>
 void test_reentrant_single_thread() {
     std::cout << "\n[Test1] reentrant in same thread\n";
     g_value = 0;
 
     std::function<void(int)> dfs = [&](int d) {
-        std::lock_guard<RecursiveTimedLock> lg(g_lock);
+        std::lock_guard<Lock> lg(g_lock<Lock>);
         ++g_value;
         if (d > 0) dfs(d - 1);
     };
@@ -137,6 +149,7 @@ void test_reentrant_single_thread() {
 }
 
 // 测试2：try_lock_for 超时失败 + 后续成功
+template<typename Lock>
 void test_timeout_then_success() {
     std::cout << "\n[Test2] timeout then success\n";
     g_value = 0;
@@ -144,10 +157,10 @@ void test_timeout_then_success() {
     std::atomic<bool> holder_entered{false};
 
     std::thread holder([&]{
-        g_lock.lock();
+        g_lock<Lock>.lock();
         holder_entered.store(true, std::memory_order_release);
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        g_lock.unlock();
+        g_lock<Lock>.unlock();
     });
 
     // 等待 holder 确实持锁
@@ -156,19 +169,19 @@ void test_timeout_then_success() {
     }
 
     auto t0 = std::chrono::steady_clock::now();
-    bool ok1 = g_lock.try_lock_for(std::chrono::milliseconds(50));
+    bool ok1 = g_lock<Lock>.try_lock_for(std::chrono::milliseconds(50));
     auto t1 = std::chrono::steady_clock::now();
 
     std::cout << "  try_lock_for(50ms) => " << (ok1 ? "true" : "false")
               << ", waited " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()
               << "ms (expect false, ~>=50ms)\n";
 
-    bool ok2 = g_lock.try_lock_for(std::chrono::milliseconds(400));
+    bool ok2 = g_lock<Lock>.try_lock_for(std::chrono::milliseconds(400));
     std::cout << "  try_lock_for(400ms) => " << (ok2 ? "true" : "false")
               << " (expect true)\n";
     if (ok2) {
         ++g_value;
-        g_lock.unlock();
+        g_lock<Lock>.unlock();
     }
 
     holder.join();
@@ -176,12 +189,13 @@ void test_timeout_then_success() {
 }
 
 // 测试3：多线程互斥 + 递归调用，最终值校验
+template<typename Lock>
 void test_multi_thread_final_value() {
     std::cout << "\n[Test3] multi-thread mutual exclusion + recursion\n";
     g_value = 0;
 
     auto recursive_work = [&](auto&& self, int depth, int max_depth, int id) -> void {
-        std::lock_guard<RecursiveTimedLock> lg(g_lock);
+        std::lock_guard<Lock> lg(g_lock<Lock>);
         ++g_value;
         // 模拟一些工作
         std::this_thread::sleep_for(std::chrono::milliseconds(5));
@@ -208,15 +222,16 @@ void test_multi_thread_final_value() {
 }
 
 // 测试4：try_lock_until（用 system_clock 的绝对时间点）
+template<typename Lock>
 void test_try_lock_until_system_clock() {
     std::cout << "\n[Test4] try_lock_until(system_clock)\n";
     std::atomic<bool> holder_entered{false};
 
     std::thread holder([&]{
-        g_lock.lock();
+        g_lock<Lock>.lock();
         holder_entered.store(true, std::memory_order_release);
         std::this_thread::sleep_for(std::chrono::milliseconds(120));
-        g_lock.unlock();
+        g_lock<Lock>.unlock();
     });
 
     while (!holder_entered.load(std::memory_order_acquire)) {
@@ -224,25 +239,98 @@ void test_try_lock_until_system_clock() {
     }
 
     auto deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(50);
-    bool ok1 = g_lock.try_lock_until(deadline);
+    bool ok1 = g_lock<Lock>.try_lock_until(deadline);
     std::cout << "  try_lock_until(now+50ms) => " << (ok1 ? "true" : "false")
               << " (expect false)\n";
 
     auto deadline2 = std::chrono::system_clock::now() + std::chrono::milliseconds(300);
-    bool ok2 = g_lock.try_lock_until(deadline2);
+    bool ok2 = g_lock<Lock>.try_lock_until(deadline2);
     std::cout << "  try_lock_until(now+300ms) => " << (ok2 ? "true" : "false")
               << " (expect true)\n";
-    if (ok2) g_lock.unlock();
+    if (ok2) g_lock<Lock>.unlock();
 
     holder.join();
 }
 
-int main() {
+template<typename Lock>
+static void run_tests(const char* name) {
+    std::cout << "\n== " << name << " ==\n";
+    test_reentrant_single_thread<Lock>();
+    test_timeout_then_success<Lock>();
+    test_multi_thread_final_value<Lock>();
+    test_try_lock_until_system_clock<Lock>();
+}
+
+// 单线程：先拿一层锁，再在其中重入 depth 层，返回平均每次 lock + unlock 的纳秒数
+// depth = 0 就是无竞争的首次加锁
+template<typename Lock>
+static double bench_reentry(int ops, int depth) {
+    Lock m;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; ++i) {
+        m.lock();
+        for (int d = 0; d < depth; ++d) m.lock();
+        for (int d = 0; d < depth; ++d) m.unlock();
+        m.unlock();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    return ns / (static_cast<double>(ops) * (depth + 1));
+}
+
+// 有竞争：threads 个线程各加锁 ops 次，每次在锁内重入一层，返回每秒加锁次数
+template<typename Lock>
+static double bench_contended(int threads, int ops) {
+    Lock m;
+    long long counter = 0;
+    std::vector<std::thread> ts;
+    ts.reserve(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&, t]{
+            for (int i = 0; i < ops; ++i) {
+                if (t % 2 == 0) m.lock();
+                else while (!m.try_lock_for(std::chrono::milliseconds(1))) {}
+                std::lock_guard<Lock> inner(m);
+                ++counter;
+                m.unlock();
+            }
+        });
+    }
+    for (auto& th : ts) th.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (counter != static_cast<long long>(threads) * ops) {
+        std::cerr << "lost update: " << counter << "\n";
+        std::exit(1);
+    }
+    return static_cast<double>(counter) / sec;
+}
+
+int main(int argc, char** argv) {
     std::cout << "__cplusplus=" << __cplusplus << "\n";
-    test_reentrant_single_thread();
-    test_timeout_then_success();
-    test_multi_thread_final_value();
-    test_try_lock_until_system_clock();
+    run_tests<RecursiveTimedLock>("RecursiveTimedLock");
+    run_tests<FutexRecursiveTimedLock>("FutexRecursiveTimedLock");
     std::cout << "\nAll tests finished.\n";
+
+    int ops = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200000;
+    std::cout << "\nsingle thread lock+unlock (ns/op)\n"
+              << "depth  RecursiveTimedLock  FutexRecursiveTimedLock  std::recursive_timed_mutex\n"
+              << std::fixed << std::setprecision(1);
+    for (int depth : {0, 1, 4}) {
+        std::cout << std::setw(5) << depth
+                  << std::setw(20) << bench_reentry<RecursiveTimedLock>(ops, depth)
+                  << std::setw(25) << bench_reentry<FutexRecursiveTimedLock>(ops, depth)
+                  << std::setw(28) << bench_reentry<std::recursive_timed_mutex>(ops, depth) << "\n";
+    }
+
+    std::cout << "\ncontended lock / try_lock_for + 1 level reentry (ops/s)\n"
+              << "threads  RecursiveTimedLock  FutexRecursiveTimedLock  std::recursive_timed_mutex\n"
+              << std::setprecision(0);
+    for (int n : {2, 4, 8, 16}) {
+        int per = std::max(1, ops / n);
+        std::cout << std::setw(7) << n
+                  << std::setw(20) << bench_contended<RecursiveTimedLock>(n, per)
+                  << std::setw(25) << bench_contended<FutexRecursiveTimedLock>(n, per)
+                  << std::setw(28) << bench_contended<std::recursive_timed_mutex>(n, per) << "\n";
+    }
     return 0;
-}
\ No newline at end of file
+}
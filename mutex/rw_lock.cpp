@@ -16,462 +16,83 @@
 #include <algorithm>
 #include <barrier>
 #include <cassert>
+#include <cstring>
 
-using namespace std::chrono;
-
-// ============================================================
-// 1) Reader-preference shared_mutex (may starve writers)
-// ============================================================
-namespace reader_pref {
-
-class shared_mutex {
-public:
-    shared_mutex() = default;
-    shared_mutex(const shared_mutex&) = delete;
-    shared_mutex& operator=(const shared_mutex&) = delete;
-
-    void lock() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        cond_.wait(lock, [&]{ return !has_writer_ && reader_cnt_ == 0; });
-        has_writer_ = true;
-    }
-    bool try_lock() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        if(!has_writer_ && reader_cnt_ == 0) {
-            has_writer_ = true;
-            return true;
-        }
-        return false;
-    }
-    void unlock() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        has_writer_ = false;
-        cond_.notify_all();
-    }
-    void lock_shared() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        cond_.wait(lock, [&]{ return !has_writer_; });
-        ++ reader_cnt_;
-    }
-    bool try_lock_shared() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        if(has_writer_) return false;
-        ++ reader_cnt_;
-        return true;
-    }
-    void unlock_shared() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        if( -- reader_cnt_ == 0) cond_.notify_all();
-    }
-private:
-    std::mutex mtx_;
-    std::condition_variable cond_;
-    bool has_writer_{false};
-    int reader_cnt_{0};
-};
-
-} // namespace reader_pref
-
-// ============================================================
-// 2) Writer-preference shared_mutex (avoid writer starvation)
-// ============================================================
-namespace writer_pref {
-
-class shared_mutex {
-public:
-    shared_mutex() = default;
-    shared_mutex(const shared_mutex&) = delete;
-    shared_mutex& operator=(const shared_mutex&) = delete;
-
-    void lock() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        ++ writer_waiter_;
-        cond_.wait(lock, [&]{ return !has_writer_ && reader_cnt_ == 0; });
-        -- writer_waiter_;
-        has_writer_ = true;
-    }
-    bool try_lock() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        if(has_writer_ || reader_cnt_ != 0) return false;
-        has_writer_ = true;
-        return true;
-    }
-    void unlock() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        has_writer_ = false;
-        cond_.notify_all();
-    }
-    void lock_shared() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        cond_.wait(lock, [&]{ return !has_writer_ && writer_waiter_ == 0; });
-        ++ reader_cnt_;
-    }
-    bool try_lock_shared() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        if(has_writer_ || writer_waiter_ != 0) return false;
-        ++ reader_cnt_;
-        return true;
-    }
-    void unlock_shared() {
-        std::unique_lock<std::mutex> lock(mtx_);
-        if( -- reader_cnt_ == 0) cond_.notify_all();
-    }
-private:
-    std::mutex mtx_;
-    std::condition_variable cond_;
-    bool has_writer_{false};
-    int writer_waiter_{0};
-    int reader_cnt_{0};
-};
-
-} // namespace writer_pref
-
-// ============================================================
-// 3) Fair FIFO shared_mutex (no starvation, queue-based)
-// ============================================================
-namespace fair_fifo {
-
-#define COMPLEX_FIFO_SHARED_MUTEX
-
-#if defined(SIMPLE_FIFO_SHARED_MUTEX)
-
-// 一个简单的，基于 FIFO 思想的公平读写锁
-class shared_mutex {
-public:
-    shared_mutex() = default;
-    shared_mutex(const shared_mutex&) = delete;
-    shared_mutex& operator=(const shared_mutex&) = delete;
-
-    // ---- writer ----
-    void lock() {
-        std::unique_lock<std::mutex> lk(m_);
-        q_.push_back(Mode::Write);
-        cv_.wait(lk, [&] { return can_run_writer_(); });
-
-        // consume head write request
-        q_.pop_front();
-        writer_active_ = true;
-    }
-
-    bool try_lock() {
-        std::lock_guard<std::mutex> lk(m_);
-        if (writer_active_ || active_readers_ != 0) return false;
-        if (!q_.empty() || reader_batch_remaining_ != 0) return false; // no cutting
-        writer_active_ = true;
-        return true;
-    }
-
-    void unlock() {
-        std::lock_guard<std::mutex> lk(m_);
-        writer_active_ = false;
-        cv_.notify_all();
-    }
-
-    // ---- reader ----
-    void lock_shared() {
-        std::unique_lock<std::mutex> lk(m_);
-        q_.push_back(Mode::Read);
-
-        // wait until we're in an opened reader batch
-        cv_.wait(lk, [&] { return can_run_reader_(); });
-
-        // enter as reader
-        ++active_readers_;
-        --reader_batch_remaining_;
-
-        // if batch just got consumed, wake others (writers may become eligible later)
-        if (reader_batch_remaining_ == 0) {
-            cv_.notify_all();
-        }
-    }
-
-    bool try_lock_shared() {
-        std::lock_guard<std::mutex> lk(m_);
-        if (writer_active_) return false;
-        if (!q_.empty() || reader_batch_remaining_ != 0) return false; // no cutting
-        ++active_readers_;
-        return true;
-    }
-
-    void unlock_shared() {
-        std::lock_guard<std::mutex> lk(m_);
-        --active_readers_;
-        if (active_readers_ == 0) {
-            cv_.notify_all();
-        }
-    }
-
-private:
-    enum class Mode { Read, Write };
-
-    // Open a reader batch if possible: head is Read, no active writer, no batch currently open.
-    void maybe_open_reader_batch_() {
-        if (reader_batch_remaining_ != 0) return;
-        if (writer_active_) return;
-        if (q_.empty() || q_.front() != Mode::Read) return;
-
-        // Count head consecutive reads
-        std::size_t k = 0;
-        while (k < q_.size() && q_[k] == Mode::Read) ++k;
-
-        // Remove those k read requests from the queue
-        for (std::size_t i = 0; i < k; ++i) q_.pop_front();
-
-        reader_batch_remaining_ = static_cast<int>(k);
-    }
-
-    bool can_run_writer_() {
-        // Writers can run only when:
-        // - no active writer
-        // - no active readers
-        // - no open reader batch
-        // - head of queue is Write
-        maybe_open_reader_batch_();
-        return !writer_active_
-            && active_readers_ == 0
-            && reader_batch_remaining_ == 0
-            && !q_.empty()
-            && q_.front() == Mode::Write;
-    }
-
-    bool can_run_reader_() {
-        // Readers can run only inside an opened reader batch
-        maybe_open_reader_batch_();
-        return !writer_active_ && reader_batch_remaining_ > 0;
-    }
-
-private:
-    std::mutex m_;
-    std::condition_variable cv_;
-    std::deque<Mode> q_;
-
-    int  active_readers_ = 0;
-    bool writer_active_ = false;
-
-    // how many readers are permitted in the current FIFO head batch
-    int reader_batch_remaining_ = 0;
-};
-#else 
-
-// 基于 FIFO 思想的读写锁
-// 相较于上一份代码，在唤醒时不在 notify_all 广播，
-// 而是给每个等待线程一个私有闸门（私有 cond），调度器只打开该打开的闸门
-// 主要理解 lock() 和 lock_shared()
-
-class shared_mutex {
-public:
-    shared_mutex() = default;
-    shared_mutex(const shared_mutex&) = delete;
-    shared_mutex& operator=(const shared_mutex&) = delete;
-
-    // ==========================================
-    // 独占锁 (Writer)
-    // ==========================================
-    void lock() {
-        Waiter w; // 创建一个当前等待调度的对象
-        std::unique_lock<std::mutex> lk(mtx_);
-
-        const std::uint64_t my_ticket = next_ticket_++;
-        q_.push_back(Node{Mode::Write, my_ticket, &w});
-
-        // 入队后尝试触发调度（尤其是队列原本为空时）
-        wake_next_();
-
-        // 仅在被“精准唤醒”后继续
-        w.cv.wait(lk, [&]{ return w.go; });
-
-        // 断言：当前唤醒节点为对头写者节点
-        assert(!q_.empty() && q_.front().mode == Mode::Write);
-        assert(q_.front().ticket == my_ticket);
-
-        // 写者获取锁：自己出队
-        q_.pop_front();
-        has_writer_ = true;
-    }
-
-    bool try_lock() {
-        std::unique_lock<std::mutex> lk(mtx_);
-
-        // 没有正在进行的写者
-        // 没有正在进行的或等待进行的读者
-        // 不能插队
-        if (has_writer_) return false;
-        if (reader_cnt_ != 0 || pending_readers_ != 0) return false;
-        if (!q_.empty()) return false;             // 严格公平：有人排队就不能抢
-
-        has_writer_ = true;
-        return true;
-    }
-
-    void unlock() {
-        std::unique_lock<std::mutex> lk(mtx_);
-        has_writer_ = false;
-        wake_next_();
-    }
-
-    // ==========================================
-    // 共享锁 (Reader)
-    // ==========================================
-    void lock_shared() {
-        Waiter w;
-        std::unique_lock<std::mutex> lk(mtx_);
-
-        const std::uint64_t my_ticket = next_ticket_++;
-        q_.push_back(Node{Mode::Read, my_ticket, &w});
-
-        // 入队后尝试触发调度（尤其是队列原本为空时）
-        wake_next_();
-
-        // 等待被批次调度“精准唤醒”
-        w.cv.wait(lk, [&]{ return w.go; });
-
-        // 注意读者无法在这里断言，因为节点 node 已经在批量出中被处理了
-        // assert(!q_.empty() && q_.front().mode == Mode::Read);
-        // assert(q_.front().ticket == my_ticket);
-
-        // 读者正式入场
-        ++ reader_cnt_;
-        -- pending_readers_;
-
-        // 不需要 wake_next_：因为只要 reader_cnt_ > 0 写者就不能跑
-    }
-
-    bool try_lock_shared() {
-        std::unique_lock<std::mutex> lk(mtx_);
-
-        // 不能有正在写的线程
-        // 不能有未完成的读
-        // 不能插队
-        if (has_writer_) return false;
-        if (pending_readers_ != 0) return false;   // 有批次在“入场中”，视为忙
-        if (!q_.empty()) return false;             // 严格公平：有人排队就不能抢
-
-        ++ reader_cnt_;
-        return true;
-    }
-
-    void unlock_shared() {
-        std::unique_lock<std::mutex> lk(mtx_);
-        if (--reader_cnt_ == 0) {
-            wake_next_(); // 若仍有 pending_readers_，wake_next_ 会自动不放行写者
-        }
-    }
-
-private:
-    enum class Mode { Read, Write };
-
-    struct Waiter {
-        std::condition_variable cv; // 通知信号：唤醒线程
-        bool go{false}; // 状态位：线程醒来后检查自己是不是真的被允许通过
-                        // 可以防止伪唤醒和“先 notify，后 wait 导致通知信号丢失的情况”
-    };
-
-    struct Node {
-        Mode mode;
-        std::uint64_t ticket; 
-        Waiter* waiter;       // Read/Write 都用私有 waiter；try_lock* 不入队则无 waiter
-    };
-
-    // 注意：以下 *_unsafe_ 仅在已持有 mtx_ 时调用
-    bool can_run_writer_unsafe_() const {
-        // 没有正在进行的写
-        // 没有正在进行或等待进行的读
-        // 可以写
-        return !has_writer_
-            && reader_cnt_ == 0 && pending_readers_ == 0
-            && !q_.empty() && q_.front().mode == Mode::Write;
-    }
-
-    // 开启读批次：弹出队头连续 Read，并仅唤醒这一批读者（无 notify_all 惊群）
-    void open_read_batch_and_wake_unsafe_() {
-        std::vector<Waiter*> to_wake;
-        to_wake.reserve(32);
-
-        std::size_t count = 0;
-        while (!q_.empty() && q_.front().mode == Mode::Read) {
-            Waiter* w = q_.front().waiter;
-            q_.pop_front();
-            if (w) {
-                to_wake.push_back(w);
-            }
-            ++ count;
-        }
-
-        // 标记：已批准但尚未入场的读者数
-        pending_readers_ = count;
-
-        // 精准唤醒该批次的读者（每个读者一个 notify_one）
-        for (Waiter* w : to_wake) {
-            w->go = true;
-            w->cv.notify_one();
-        }
-    }
-
-    // 核心调度器：所有调用都在持有 mtx_ 的情况下进行
-    void wake_next_() {
-        // 1) 有人在持锁：不调度
-        if (has_writer_ || reader_cnt_ != 0) return;
-
-        // 2) 读批次“入场中”：不调度写者/下一批
-        if (pending_readers_ != 0) return;
-
-        // 3) 队列空：结束
-        if (q_.empty()) return;
-
-        // 4) 按队头调度
-        if (q_.front().mode == Mode::Write) {
-            // 精准唤醒队头写者（无惊群）
-            Waiter* w = q_.front().waiter;
-            if (w) {
-                w->go = true;
-                w->cv.notify_one();
-            }
-        } else {
-            // 开启读批次并精准唤醒该批次读者（无 notify_all 惊群）
-            open_read_batch_and_wake_unsafe_();
-        }
-    }
-
-private:
-    std::mutex mtx_;
-    std::deque<Node> q_;
-
-    bool has_writer_{false};
-    std::size_t reader_cnt_{0};      // 已经入场的读者
-    std::size_t pending_readers_{0}; // 已经批准（被唤醒）但尚未完成“入场”的读者数量
-    
-    std::uint64_t next_ticket_{0};   // 等待线程的票号
-                                     // ticket 在这里无实际价值，它仅用于辅助用途
-                                     //     1. 调试/日志/可观察性：打印 ticket 能查看入队/出队/排队情况
-                                     //     2. 防御性校验：等待线程醒来后断言“我真的是对头那个节点对应的线程”，可以在开发期更早的发现 bug
-};
-
-#endif
-} // namespace fair_fifo
+#include "bench_opts.h"
+#include "profiled.hpp"
+#include "seqlock.hpp"
+#include "shared_mutex.hpp"
+#include "snapshot_ptr.hpp"
 
+using namespace std::chrono;
 
 // ============================================================
-// Choose ONE namespace here by changing #define
+// 默认测哪个实现：打开这里的一个 #define 或者 g++ -DWRITER_PREF 之类（各实现在 shared_mutex.hpp 中），
+// 都不定义时是 fair_fifo；运行时用 --lock=a,b 选择则不受这里影响
 // ============================================================
 
 // #define READER_PREF  
 // #define WRITER_PREF
-#define FAIR_FIFO 
+// #define BIG_READER
+// #define SEQLOCK             // 不是 shared_mutex：读者拿到一份拷贝，冲突时重试（seqlock.hpp）
+// #define SNAPSHOT_PTR        // 不是 shared_mutex：读者拿到 RCU 快照，写者拷贝后发布（snapshot_ptr.hpp）
+// #define FAIR_FIFO
 
+// #define PROFILE_RW_LOCK     // 给 shared_mutex 变体包一层 profiled<>，结束时打印等待 / 持有时间（profiled.hpp）
 
-#if defined(FAIR_FIFO)
-#  define RWLOCK_IMPL_NAME "fair_fifo"
-using rw_mutex = fair_fifo::shared_mutex;
 
+#if defined(SEQLOCK)
+#  define RWLOCK_IMPL_NAME "seqlock"
+#elif defined(SNAPSHOT_PTR)
+#  define RWLOCK_IMPL_NAME "snapshot_ptr"
+#elif defined(BIG_READER)
+#  define RWLOCK_IMPL_NAME "big_reader"
 #elif defined(WRITER_PREF)
 #  define RWLOCK_IMPL_NAME "writer_pref"
-using rw_mutex = writer_pref::shared_mutex;
-
 #elif defined(READER_PREF)
 #  define RWLOCK_IMPL_NAME "reader_pref"
-using rw_mutex = reader_pref::shared_mutex;
+#else
+#  define RWLOCK_IMPL_NAME "fair_fifo"
+#endif
+
+// 被保护的数据（一个 uint64_t）和对它的读 / 写操作，让 harness 对所有实现一视同仁
+//   - read(f) : f(const uint64_t&) 在读临界区内执行（seqlock 是对一份一致的拷贝执行）
+//   - write(f): f(uint64_t&) 在写临界区内执行，进入 f 的时刻就是写者拿到锁的时刻
+struct seqlock_value {
+    explicit seqlock_value(const char*) {}
+    template<typename F> void read(F&& f) { f(v.load()); }
+    template<typename F> void write(F&& f) { v.update(f); }
+    SeqLock<std::uint64_t> v;
+};
+
+struct snapshot_value {
+    explicit snapshot_value(const char*) {}
+    template<typename F> void read(F&& f) { auto snap = v.read(); f(*snap); }
+    template<typename F> void write(F&& f) { v.update(f); }
+    snapshot_ptr<std::uint64_t> v{std::make_unique<std::uint64_t>(0)};
+};
 
+template<typename Mutex>
+struct locked_value {
+    template<typename F> void read(F&& f) {
+        m.lock_shared();
+        f(static_cast<const std::uint64_t&>(value));
+        m.unlock_shared();
+    }
+    template<typename F> void write(F&& f) {
+        m.lock();
+        f(value);
+        m.unlock();
+    }
+#if defined(PROFILE_RW_LOCK)
+    explicit locked_value(const char* name) : m((std::string("rw_lock.cpp: ") + name).c_str()) {}
+    profiled<Mutex> m;
+#else
+    explicit locked_value(const char*) {}
+    Mutex m;
 #endif
+    alignas(64) std::uint64_t value = 0;
+};
 
 // ============================================================
 // Test harness
@@ -508,22 +129,14 @@ static void busy_work(int iters) {
     (void)x;
 }
 
-int main(int argc, char** argv) {
-    // Parameters tuned to make differences visible.
-    // You can override by command line:
-    // ./a.out [seconds=5] [readers=12] [writers=2]
-    int seconds = (argc > 1) ? std::stoi(argv[1]) : 5;
-    int readers = (argc > 2) ? std::stoi(argv[2]) : 12;
-    int writers = (argc > 3) ? std::stoi(argv[3]) : 2;
-
-    std::cout << "Testing namespace: " << RWLOCK_IMPL_NAME << std::endl;
+template<typename Value>
+static int run(const char* name, int seconds, int readers, int writers) {
+    std::cout << "Testing namespace: " << name << std::endl;
     std::cout << "Duration: " << seconds << "s, readers=" << readers << ", writers=" << writers << "\n\n";
 
-    rw_mutex m;
-    std::atomic<bool> stop{false};
-
     // Shared state under the lock
-    alignas(64) std::uint64_t shared_value = 0;
+    Value shared(name);
+    std::atomic<bool> stop{false};
 
     // Metrics
     std::atomic<uint64_t> read_ops{0}, write_ops{0};
@@ -544,12 +157,11 @@ int main(int argc, char** argv) {
             std::mt19937_64 rng(0xBADC0FFEEULL + i);
             start_bar.arrive_and_wait();
             while (!stop.load(std::memory_order_relaxed)) {
-                m.lock_shared();
-                // simulate read critical section
-                auto v = shared_value;
-                (void)v;
-                busy_work(80); // adjust to tune read-hold time
-                m.unlock_shared();
+                shared.read([](const std::uint64_t& v) {
+                    // simulate read critical section
+                    (void)v;
+                    busy_work(80); // adjust to tune read-hold time
+                });
 
                 read_ops.fetch_add(1, std::memory_order_relaxed);
 
@@ -572,17 +184,16 @@ int main(int argc, char** argv) {
                 if ((rng() % 8) == 0) std::this_thread::sleep_for(100us);
 
                 auto t0 = steady_clock::now();
-                m.lock();
-                auto t1 = steady_clock::now();
+                shared.write([&](std::uint64_t& v) {
+                    auto t1 = steady_clock::now();
 
-                double us = duration<double, std::micro>(t1 - t0).count();
-                writer_wait_us[wi].push_back(us);
+                    double us = duration<double, std::micro>(t1 - t0).count();
+                    writer_wait_us[wi].push_back(us);
 
-                // simulate write critical section
-                ++shared_value;
-                busy_work(200); // adjust to tune write-hold time
-
-                m.unlock();
+                    // simulate write critical section
+                    ++v;
+                    busy_work(200); // adjust to tune write-hold time
+                });
                 write_ops.fetch_add(1, std::memory_order_relaxed);
             }
         });
@@ -596,6 +207,14 @@ int main(int argc, char** argv) {
 
     for (auto& t : ts) t.join();
 
+    // 每次写都把值加一：最后读出来的值必须等于写的次数
+    std::uint64_t final_value = 0;
+    shared.read([&](const std::uint64_t& v) { final_value = v; });
+    if (final_value != write_ops.load()) {
+        std::cerr << "lost update: value=" << final_value << " writes=" << write_ops.load() << "\n";
+        return 1;
+    }
+
     // Aggregate writer latencies
     std::vector<double> all;
     size_t total_samples = 0;
@@ -619,8 +238,73 @@ int main(int argc, char** argv) {
     std::cout << "  p99  : " << stats.p99_us << " us\n";
     std::cout << "  max  : " << stats.max_us << " us\n\n";
 
+    return 0;
+}
+
+struct RwEntry {
+    const char* name;
+    int (*run)(const char*, int, int, int);
+};
+
+static const RwEntry kImpls[] = {
+    {"reader_pref", run<locked_value<reader_pref::shared_mutex>>},
+    {"writer_pref", run<locked_value<writer_pref::shared_mutex>>},
+    {"fair_fifo", run<locked_value<fair_fifo::shared_mutex>>},
+    {"big_reader", run<locked_value<big_reader::shared_mutex>>},
+    {"seqlock", run<seqlock_value>},
+    {"snapshot_ptr", run<snapshot_value>},
+};
+
+static int on_option(int id, const char* arg, void* ctx) {
+    if (id != 'w') return -1;
+    return bench_parse_long(arg, 0, static_cast<long*>(ctx));
+}
+
+int main(int argc, char** argv) {
+    // Parameters tuned to make differences visible.
+    // 可以用选项覆盖：--duration=5 --threads=12（读者数，可以是列表）--writers=2 --lock=fair_fifo,seqlock
+    // 以前的位置参数写法 ./a.out [seconds=5] [readers=12] [writers=2] 仍然可用
+    long writers = 2;
+    bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_LOCK | BENCH_OPT_THREADS | BENCH_OPT_DURATION, "[seconds] [readers] [writers]");
+    bench_names_set(&o.lock, RWLOCK_IMPL_NAME);
+    bench_list_set(&o.threads, 12);
+    o.duration_ms = 5000;
+    static const bench_extra extra[] = {
+        {"readers", 'r', required_argument, BENCH_ID_THREADS, "LIST", "same as --threads"},
+        {"writers", 'w', required_argument, 'w', "N", "writer threads (default 2)"},
+        {nullptr, 0, 0, 0, nullptr, nullptr},
+    };
+    int idx = bench_opts_parse(&o, argc, argv, extra, on_option, &writers);
+    if (idx <= 0) return idx < 0;
+    if (idx < argc) o.duration_ms = std::stol(argv[idx++]) * 1000;
+    if (idx < argc) bench_list_set(&o.threads, std::stoi(argv[idx++]));
+    if (idx < argc) writers = std::stoi(argv[idx++]);
+    int seconds = static_cast<int>(std::max(1L, o.duration_ms / 1000));
+
+    for (int i = 0; i < o.lock.n; ++i) {
+        const RwEntry* impl = nullptr;
+        for (auto& e : kImpls) {
+            if (std::strcmp(e.name, o.lock.v[i]) == 0) impl = &e;
+        }
+        if (!impl) {
+            std::cerr << "unknown lock: " << o.lock.v[i] << " (reader_pref, writer_pref, fair_fifo, big_reader, seqlock, snapshot_ptr)\n";
+            return 1;
+        }
+        for (int t = 0; t < o.threads.n; ++t) {
+            if (int rc = impl->run(impl->name, seconds, static_cast<int>(o.threads.v[t]), static_cast<int>(writers))) return rc;
+        }
+    }
+
+#if defined(PROFILE_RW_LOCK)
+    lock_profiler::dump(std::cout);
+    std::cout << "\n";
+#endif
     std::cout << "Interpretation tips:\n";
     std::cout << "  - reader_pref: reads/s usually highest, but writer wait max/p99 can explode (writer starvation).\n";
     std::cout << "  - writer_pref: writer waits stay bounded, but reads/s may drop under sustained writers.\n";
     std::cout << "  - fair_fifo  : waits are stable (no starvation), throughput often between the two.\n";
+    std::cout << "  - big_reader : reads/s scales with cores (no shared reader counter), writers pay a scan of all slots.\n";
+    std::cout << "  - seqlock    : readers never write shared memory; they retry while a writer is publishing.\n";
+    std::cout << "  - snapshot_ptr: readers never wait; writers copy + publish, old versions freed after a grace period.\n";
 }
@@ -5,20 +5,37 @@
 // 难点主要在于如何实现对多个锁的“原子”加锁，标准库提供了 std::lock
 // 但我们肯定要自己实现，这里的思路也是仿照 std::lock，使用递归加锁
 // 从第一个锁开始递归加锁，如果失败就全部回退（解锁）
-
+//
+// 上面这种“阻塞在第一把锁上，失败就从头再来”的写法在竞争激烈时会活锁：
+// 每一轮都阻塞在 m1 上，再 try_lock 后面那把刚被别人拿走的锁，失败后又回退重来，反复 lock/unlock 白白烧 CPU
+// 所以多锁加锁的策略可以在编译时选择（-DSCOPED_LOCK_STRATEGY=N）：
+//   0 : Restart      原来的写法，默认：阻塞在第一把锁上，其余 try_lock，失败就全部回退、从第一把锁重来
+//   1 : AddressOrder 按地址全局排序后依次阻塞加锁：所有线程加锁顺序一致，不会死锁，也不需要回退
+//                    前提是程序里其它地方不会绕开 scoped_lock，以别的顺序去锁同一组锁
+//   2 : Rotate       标准库（libstdc++）的做法：回退后下一轮阻塞在刚才 try_lock 失败的那把锁上，
+//                    每轮之间 yield 一下，让持有者有机会把锁放掉
+
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <random>
+#include <stdexcept>
 #include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "mcs_lock.hpp"
+
 /*===================================================*/
 /*                   Scoped lock                     */
 /*===================================================*/
@@ -47,7 +64,7 @@ struct TryLockImpl {
 };
 
 template<typename Mutex1, typename Mutex2, typename... Mutex3>
-void Lock(Mutex1& m1, Mutex2& m2, Mutex3&... m3) {
+void LockRestart(Mutex1& m1, Mutex2& m2, Mutex3&... m3) {
     while(true) {
         // 先获取第一把锁，再对后面的锁递归加锁
         std::unique_lock<Mutex1> first(m1);
@@ -70,6 +87,110 @@ void Lock(Mutex1& m1, Mutex2& m2, Mutex3&... m3) {
         }
     }
 }
+// 把不同类型的锁擦除成同一种表项，方便按运行时的下标 / 顺序去操作
+struct ErasedMutex {
+    void* addr;
+    void (*lock)(void*);
+    bool (*try_lock)(void*);
+    void (*unlock)(void*);
+};
+
+template<typename Mutex>
+ErasedMutex Erase(Mutex& m) {
+    return ErasedMutex{
+        std::addressof(m),
+        [](void* p) { static_cast<Mutex*>(p)->lock(); },
+        [](void* p) { return static_cast<bool>(static_cast<Mutex*>(p)->try_lock()); },
+        [](void* p) { static_cast<Mutex*>(p)->unlock(); },
+    };
+}
+
+// 已经拿到的锁，作用和 LockRestart 里的 unique_lock 一样：
+// 中途某个 lock() / try_lock() 抛出异常时，析构函数把已经拿到的锁全部放掉；全部拿到之后 release()
+template<std::size_t N>
+class HeldLocks {
+public:
+    HeldLocks() = default;
+    HeldLocks(const HeldLocks&) = delete;
+    HeldLocks& operator=(const HeldLocks&) = delete;
+    ~HeldLocks() { unlock_all(); }
+
+    void add(ErasedMutex& e) noexcept { held_[n_ ++ ] = &e; }
+    // 逆序解锁
+    void unlock_all() noexcept {
+        while(n_ > 0) {
+            ErasedMutex* e = held_[-- n_];
+            e->unlock(e->addr);
+        }
+    }
+    void release() noexcept { n_ = 0; }
+
+private:
+    std::array<ErasedMutex*, N> held_{};
+    std::size_t n_ = 0;
+};
+
+template<typename... Mutexes>
+void LockAddressOrder(Mutexes&... ms) {
+    std::array<ErasedMutex, sizeof...(Mutexes)> es{Erase(ms)...};
+    // std::less 对任意指针都给出全序，直接比较不相关对象的地址是未指定的
+    std::sort(es.begin(), es.end(), [](const ErasedMutex& x, const ErasedMutex& y) {
+        return std::less<void*>{}(x.addr, y.addr);
+    });
+    HeldLocks<sizeof...(Mutexes)> held;
+    for(auto& e : es) {
+        e.lock(e.addr);
+        held.add(e);
+    }
+    held.release();
+}
+
+template<typename... Mutexes>
+void LockRotate(Mutexes&... ms) {
+    constexpr std::size_t n = sizeof...(Mutexes);
+    std::array<ErasedMutex, n> es{Erase(ms)...};
+    std::size_t first = 0;
+    HeldLocks<n> held;
+    while(true) {
+        // 阻塞在 first 上，再从 first 往后（绕回开头）依次 try_lock 其余的锁
+        es[first].lock(es[first].addr);
+        held.add(es[first]);
+        std::size_t k = 1;
+        for(; k < n; k ++ ) {
+            auto& e = es[(first + k) % n];
+            if(!e.try_lock(e.addr)) break;
+            held.add(e);
+        }
+        if(k == n) {
+            held.release();
+            return ;
+        }
+        held.unlock_all();
+        // 下一轮阻塞在刚才拿不到的那把锁上：它的持有者放锁之前我们不会再去打扰其它锁
+        first = (first + k) % n;
+        std::this_thread::yield();
+    }
+}
+
+enum class LockStrategy { Restart = 0, AddressOrder = 1, Rotate = 2 };
+
+template<LockStrategy S, typename Mutex1, typename Mutex2, typename... Mutex3>
+void LockWith(Mutex1& m1, Mutex2& m2, Mutex3&... m3) {
+    if constexpr (S == LockStrategy::Restart) LockRestart(m1, m2, m3...);
+    else if constexpr (S == LockStrategy::AddressOrder) LockAddressOrder(m1, m2, m3...);
+    else LockRotate(m1, m2, m3...);
+}
+
+#ifndef SCOPED_LOCK_STRATEGY
+#define SCOPED_LOCK_STRATEGY 0
+#endif
+static_assert(SCOPED_LOCK_STRATEGY >= 0 && SCOPED_LOCK_STRATEGY <= 2, "SCOPED_LOCK_STRATEGY must be 0, 1 or 2");
+inline constexpr LockStrategy kLockStrategy = static_cast<LockStrategy>(SCOPED_LOCK_STRATEGY);
+
+template<typename Mutex1, typename Mutex2, typename... Mutex3>
+void Lock(Mutex1& m1, Mutex2& m2, Mutex3&... m3) {
+    LockWith<kLockStrategy>(m1, m2, m3...);
+}
 }  // namespace detail
 
 
@@ -165,10 +286,10 @@ struct SpinBarrier {
 };
 
 // A tiny mutex wrapper that records lock/unlock order (for single-threaded
-// order testing). Not for concurrent correctness testing; it just forwards to
-// std::mutex.
+// order testing) and counts failed try_lock calls. The log is not thread-safe,
+// pass nullptr when sharing it between threads; the counters are atomic.
 struct TracedMutex {
-    explicit TracedMutex(int id, std::vector<int>* log) : id(id), log(log) {}
+    explicit TracedMutex(int id, std::vector<int>* log = nullptr) : id(id), log(log) {}
     void lock() {
         m.lock();
         if (log) log->push_back(+id);  // +id means lock
@@ -179,12 +300,15 @@ struct TracedMutex {
     }
     bool try_lock() {
         bool ok = m.try_lock();
+        if (!ok) try_fails.fetch_add(1, std::memory_order_relaxed);
         if (ok && log) log->push_back(+id);
         return ok;
     }
     std::mutex m;
     int id;
     std::vector<int>* log;
+    // 每次 try_lock 失败都意味着一次回退重来，即一次 retry
+    std::atomic<long long> try_fails{0};
 };
 
 // ================================================================
@@ -323,8 +447,135 @@ static void test_contention_many_mutexes() {
             "contention: sum mismatch (hang or missed)");
 }
 
+// MCSLock 满足 Lockable（lock / try_lock / unlock 都不带参数），可以和 std::mutex 一样组合使用
+static void test_mcs_lock_composes() {
+    MCSLock a, b;
+    long long counter = 0;
+    std::thread t1([&] {
+        for (int i = 0; i < 20000; ++i) {
+            my_std_like::scoped_lock lock(a, b);
+            ++counter;
+        }
+    });
+    std::thread t2([&] {
+        for (int i = 0; i < 20000; ++i) {
+            my_std_like::scoped_lock lock(b, a);
+            ++counter;
+        }
+    });
+    t1.join();
+    t2.join();
+    require(counter == 40000, "mcs lock: counter mismatch under scoped_lock");
+}
+
+// 单线程下的加锁顺序：Restart / Rotate 无竞争时按参数顺序加锁，AddressOrder 按地址顺序
+static void test_strategy_lock_order() {
+    using my_std_like::detail::LockStrategy;
+    using my_std_like::detail::LockWith;
+    std::vector<int> log;
+    TracedMutex ms[3] = {TracedMutex(1, &log), TracedMutex(2, &log), TracedMutex(3, &log)};
+
+    LockWith<LockStrategy::Restart>(ms[2], ms[0], ms[1]);
+    require((log == std::vector<int>{3, 1, 2}), "restart: lock order should follow arguments");
+    for (auto& m : ms) m.unlock();
+
+    log.clear();
+    LockWith<LockStrategy::Rotate>(ms[2], ms[0], ms[1]);
+    require((log == std::vector<int>{3, 1, 2}), "rotate: uncontended lock order should follow arguments");
+    for (auto& m : ms) m.unlock();
+
+    // ms 是数组，地址顺序就是 1, 2, 3
+    log.clear();
+    LockWith<LockStrategy::AddressOrder>(ms[2], ms[0], ms[1]);
+    require((log == std::vector<int>{1, 2, 3}), "address order: should lock by address");
+    for (auto& m : ms) m.unlock();
+}
+
+// lock() / try_lock() 都抛异常的锁：用来检查加锁中途失败时，已经拿到的锁有没有被放掉
+struct ThrowingMutex {
+    void lock() { throw std::runtime_error("lock failed"); }
+    bool try_lock() { throw std::runtime_error("try_lock failed"); }
+    void unlock() noexcept {}
+};
+
+template<my_std_like::detail::LockStrategy S>
+static void check_strategy_exception_safety(const char* msg) {
+    std::mutex a, b;
+    ThrowingMutex bad;
+    bool thrown = false;
+    try {
+        my_std_like::detail::LockWith<S>(a, b, bad);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    bool released = a.try_lock() && b.try_lock();
+    require(thrown && released, msg);
+    a.unlock();
+    b.unlock();
+}
+
+static void test_strategy_exception_safety() {
+    using my_std_like::detail::LockStrategy;
+    check_strategy_exception_safety<LockStrategy::Restart>("restart: acquired locks should be released on exception");
+    check_strategy_exception_safety<LockStrategy::AddressOrder>("address order: acquired locks should be released on exception");
+    check_strategy_exception_safety<LockStrategy::Rotate>("rotate: acquired locks should be released on exception");
+}
+
+// 同一组竞争下对比三种策略的 retry 次数（try_lock 失败、回退重来的次数）
+// 每种策略跑固定的时间而不是固定的次数：Restart 活锁严重时（比如在 TSAN 下）也不会把测试拖得没完没了
+template<my_std_like::detail::LockStrategy S>
+static void run_strategy_contention(const char* name) {
+    TracedMutex a(1), b(2), c(3);
+    long long counter = 0;
+    std::atomic<bool> stop{false};
+
+    constexpr int threads = 8;
+    constexpr auto budget = std::chrono::milliseconds(200);
+
+    SpinBarrier bar(threads + 1);
+    std::vector<std::thread> ts;
+    ts.reserve(threads);
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&, t] {
+            std::mt19937 rng(777u + (unsigned)t);
+            bar.wait();
+            while (!stop.load(std::memory_order_relaxed)) {
+                switch (rng() % 3) {
+                    case 0: my_std_like::detail::LockWith<S>(a, b, c); break;
+                    case 1: my_std_like::detail::LockWith<S>(b, c, a); break;
+                    case 2: my_std_like::detail::LockWith<S>(c, a, b); break;
+                }
+                ++counter;
+                a.unlock();
+                b.unlock();
+                c.unlock();
+            }
+        });
+    }
+    bar.wait();
+    std::this_thread::sleep_for(budget);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& th : ts) th.join();
+
+    require(counter > 0, "strategy contention: no acquisition at all");
+    long long retries = a.try_fails + b.try_fails + c.try_fails;
+    if constexpr (S == my_std_like::detail::LockStrategy::AddressOrder)
+        require(retries == 0, "address order: should never back off");
+    std::cout << "    " << std::left << std::setw(14) << name << std::right
+              << std::setw(12) << counter << std::setw(12) << retries
+              << std::fixed << std::setprecision(2) << std::setw(14) << (double)retries / counter << "\n";
+}
+
+static void test_strategy_retries() {
+    using my_std_like::detail::LockStrategy;
+    std::cout << "    strategy      acquisitions     retries   retries/acq\n";
+    run_strategy_contention<LockStrategy::Restart>("Restart");
+    run_strategy_contention<LockStrategy::AddressOrder>("AddressOrder");
+    run_strategy_contention<LockStrategy::Rotate>("Rotate");
+}
+
 int main() {
-    std::cout << "Running tests...\n";
+    std::cout << "Running tests (SCOPED_LOCK_STRATEGY=" << SCOPED_LOCK_STRATEGY << ")...\n";
 
     test_compile_shape();
     std::cout << "  [OK] basic instantiation\n";
@@ -341,6 +592,18 @@ int main() {
     test_contention_many_mutexes();
     std::cout << "  [OK] stress with 3 mutexes\n";
 
+    test_mcs_lock_composes();
+    std::cout << "  [OK] MCSLock with scoped_lock\n";
+
+    test_strategy_lock_order();
+    std::cout << "  [OK] lock order of each strategy\n";
+
+    test_strategy_exception_safety();
+    std::cout << "  [OK] exception safety of each strategy\n";
+
+    test_strategy_retries();
+    std::cout << "  [OK] retries of each strategy\n";
+
     std::cout << "All tests passed.\n";
     return 0;
 }
@@ -0,0 +1,95 @@
+// 顺序锁（seqlock）：适合很小、读极多、写很少的数据（路由表项、开关配置）
+//
+// 读写锁哪怕只有一个读者计数器，每次读也要写一次共享的缓存行；seqlock 的读者完全不写共享内存：
+//   - 写者：seq_ 变为奇数 -> 写数据 -> seq_ 变为偶数（写者之间用 SpinLock 互斥）
+//   - 读者：读 seq_（偶数）-> 拷贝数据 -> 再读 seq_，两次相同说明拷贝期间没有写者，否则重试
+// 读者可能读到写了一半的数据，所以 T 必须可平凡复制，而且只能拿到一份拷贝，不能持有引用
+//
+// 数据按 8 字节一个字存放在 std::atomic 里，用 relaxed 读写，配合两道栅栏
+// （Boehm, "Can Seqlocks Get Along With Programming Language Memory Models?"），
+// 拷贝过程中与写者并发不算数据竞争（TSAN 不支持栅栏，会给出 -Wtsan 警告）
+#ifndef MUTEX_SEQLOCK_H
+#define MUTEX_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+#include "spin_lock.hpp"
+
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock<T> requires a trivially copyable T");
+
+public:
+    SeqLock() : SeqLock(T{}) {}
+    explicit SeqLock(const T& init) { write_words_(init); }
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // 读出一份一致的拷贝；有写者正在写时自旋重试
+    T load() const {
+        while(true) {
+            std::uint64_t s0 = seq_.load(std::memory_order_acquire);
+            if(s0 & 1) {
+                spin::cpu_relax();
+                continue;
+            }
+            T out = read_words_();
+            // 保证上面对数据的读取不会被重排到第二次读 seq_ 之后
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(seq_.load(std::memory_order_relaxed) == s0) return out;
+        }
+    }
+
+    void store(const T& v) {
+        std::lock_guard<SpinLock> lock(writer_);
+        begin_write_();
+        write_words_(v);
+        end_write_();
+    }
+
+    // 读-改-写：在写者锁内对当前值调用 f(T&)，再整体写回
+    template<typename F>
+    void update(F&& f) {
+        std::lock_guard<SpinLock> lock(writer_);
+        T v = read_words_();
+        f(v);
+        begin_write_();
+        write_words_(v);
+        end_write_();
+    }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(T) + 7) / 8;
+
+    void begin_write_() {
+        seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // 保证 seq_ 先变成奇数，之后对数据的写入才可能被读者看到
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void end_write_() {
+        seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    T read_words_() const {
+        std::uint64_t buf[kWords];
+        for(std::size_t i = 0; i < kWords; i ++ ) buf[i] = words_[i].load(std::memory_order_relaxed);
+        T out;
+        std::memcpy(&out, buf, sizeof(T));
+        return out;
+    }
+    void write_words_(const T& v) {
+        std::uint64_t buf[kWords] = {};
+        std::memcpy(buf, &v, sizeof(T));
+        for(std::size_t i = 0; i < kWords; i ++ ) words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+
+    alignas(64) std::atomic<std::uint64_t> seq_{0};  // 奇数表示写者正在写
+    std::atomic<std::uint64_t> words_[kWords];
+    SpinLock writer_;  // 写者之间的互斥，读者从不碰它
+};
+
+#endif
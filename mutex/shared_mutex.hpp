@@ -0,0 +1,576 @@
+// 几种读写锁（shared_mutex）的实现，rw_lock.cpp（读写比例 / 写者饥饿测试）和 lock_bench.cpp（统一基准）共用
+//   reader_pref : 读者优先，可能饿死写者
+//   writer_pref : 写者优先
+//   fair_fifo   : 按到达顺序排队，不会饿死任何一方；读者有原子快路径
+//   big_reader  : 按线程分片的读者计数，读多写少时读者之间没有共享的缓存行
+#ifndef MUTEX_SHARED_MUTEX_H
+#define MUTEX_SHARED_MUTEX_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================
+// 1) Reader-preference shared_mutex (may starve writers)
+// ============================================================
+namespace reader_pref {
+
+class shared_mutex {
+public:
+    shared_mutex() = default;
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    void lock() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [&]{ return !has_writer_ && reader_cnt_ == 0; });
+        has_writer_ = true;
+    }
+    bool try_lock() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if(!has_writer_ && reader_cnt_ == 0) {
+            has_writer_ = true;
+            return true;
+        }
+        return false;
+    }
+    void unlock() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        has_writer_ = false;
+        cond_.notify_all();
+    }
+    void lock_shared() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [&]{ return !has_writer_; });
+        ++ reader_cnt_;
+    }
+    bool try_lock_shared() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if(has_writer_) return false;
+        ++ reader_cnt_;
+        return true;
+    }
+    void unlock_shared() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if( -- reader_cnt_ == 0) cond_.notify_all();
+    }
+private:
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    bool has_writer_{false};
+    int reader_cnt_{0};
+};
+
+} // namespace reader_pref
+
+// ============================================================
+// 2) Writer-preference shared_mutex (avoid writer starvation)
+// ============================================================
+namespace writer_pref {
+
+class shared_mutex {
+public:
+    shared_mutex() = default;
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    void lock() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        ++ writer_waiter_;
+        cond_.wait(lock, [&]{ return !has_writer_ && reader_cnt_ == 0; });
+        -- writer_waiter_;
+        has_writer_ = true;
+    }
+    bool try_lock() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if(has_writer_ || reader_cnt_ != 0) return false;
+        has_writer_ = true;
+        return true;
+    }
+    void unlock() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        has_writer_ = false;
+        cond_.notify_all();
+    }
+    void lock_shared() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [&]{ return !has_writer_ && writer_waiter_ == 0; });
+        ++ reader_cnt_;
+    }
+    bool try_lock_shared() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if(has_writer_ || writer_waiter_ != 0) return false;
+        ++ reader_cnt_;
+        return true;
+    }
+    void unlock_shared() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if( -- reader_cnt_ == 0) cond_.notify_all();
+    }
+private:
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    bool has_writer_{false};
+    int writer_waiter_{0};
+    int reader_cnt_{0};
+};
+
+} // namespace writer_pref
+
+// ============================================================
+// 3) Fair FIFO shared_mutex (no starvation, queue-based)
+// ============================================================
+namespace fair_fifo {
+
+#define COMPLEX_FIFO_SHARED_MUTEX
+
+#if defined(SIMPLE_FIFO_SHARED_MUTEX)
+
+// 一个简单的，基于 FIFO 思想的公平读写锁
+class shared_mutex {
+public:
+    shared_mutex() = default;
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    // ---- writer ----
+    void lock() {
+        std::unique_lock<std::mutex> lk(m_);
+        q_.push_back(Mode::Write);
+        cv_.wait(lk, [&] { return can_run_writer_(); });
+
+        // consume head write request
+        q_.pop_front();
+        writer_active_ = true;
+    }
+
+    bool try_lock() {
+        std::lock_guard<std::mutex> lk(m_);
+        if (writer_active_ || active_readers_ != 0) return false;
+        if (!q_.empty() || reader_batch_remaining_ != 0) return false; // no cutting
+        writer_active_ = true;
+        return true;
+    }
+
+    void unlock() {
+        std::lock_guard<std::mutex> lk(m_);
+        writer_active_ = false;
+        cv_.notify_all();
+    }
+
+    // ---- reader ----
+    void lock_shared() {
+        std::unique_lock<std::mutex> lk(m_);
+        q_.push_back(Mode::Read);
+
+        // wait until we're in an opened reader batch
+        cv_.wait(lk, [&] { return can_run_reader_(); });
+
+        // enter as reader
+        ++active_readers_;
+        --reader_batch_remaining_;
+
+        // if batch just got consumed, wake others (writers may become eligible later)
+        if (reader_batch_remaining_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+    bool try_lock_shared() {
+        std::lock_guard<std::mutex> lk(m_);
+        if (writer_active_) return false;
+        if (!q_.empty() || reader_batch_remaining_ != 0) return false; // no cutting
+        ++active_readers_;
+        return true;
+    }
+
+    void unlock_shared() {
+        std::lock_guard<std::mutex> lk(m_);
+        --active_readers_;
+        if (active_readers_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+private:
+    enum class Mode { Read, Write };
+
+    // Open a reader batch if possible: head is Read, no active writer, no batch currently open.
+    void maybe_open_reader_batch_() {
+        if (reader_batch_remaining_ != 0) return;
+        if (writer_active_) return;
+        if (q_.empty() || q_.front() != Mode::Read) return;
+
+        // Count head consecutive reads
+        std::size_t k = 0;
+        while (k < q_.size() && q_[k] == Mode::Read) ++k;
+
+        // Remove those k read requests from the queue
+        for (std::size_t i = 0; i < k; ++i) q_.pop_front();
+
+        reader_batch_remaining_ = static_cast<int>(k);
+    }
+
+    bool can_run_writer_() {
+        // Writers can run only when:
+        // - no active writer
+        // - no active readers
+        // - no open reader batch
+        // - head of queue is Write
+        maybe_open_reader_batch_();
+        return !writer_active_
+            && active_readers_ == 0
+            && reader_batch_remaining_ == 0
+            && !q_.empty()
+            && q_.front() == Mode::Write;
+    }
+
+    bool can_run_reader_() {
+        // Readers can run only inside an opened reader batch
+        maybe_open_reader_batch_();
+        return !writer_active_ && reader_batch_remaining_ > 0;
+    }
+
+private:
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<Mode> q_;
+
+    int  active_readers_ = 0;
+    bool writer_active_ = false;
+
+    // how many readers are permitted in the current FIFO head batch
+    int reader_batch_remaining_ = 0;
+};
+#else 
+
+// 基于 FIFO 思想的读写锁
+// 相较于上一份代码，在唤醒时不在 notify_all 广播，
+// 而是给每个等待线程一个私有闸门（私有 cond），调度器只打开该打开的闸门
+// 主要理解 lock() 和 lock_shared()
+//
+// 读者快路径：没有写者在写、也没有任何人排队时，lock_shared / unlock_shared 只对 state_ 做一次原子操作，
+// 不碰 mtx_、不入队、不构造 Waiter。state_ 的低位是读者计数（快路径和慢路径进来的读者都算），
+// 最高位 kSlow 表示“有写者在写或有人在排队”，此时新来的读者全部走原来的排队调度，
+// 写者一入队就置上 kSlow，后来的读者只能排在它后面，FIFO / 不饿死的保证不变
+
+class shared_mutex {
+public:
+    shared_mutex() = default;
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    // ==========================================
+    // 独占锁 (Writer)
+    // ==========================================
+    void lock() {
+        Waiter w; // 创建一个当前等待调度的对象
+        std::unique_lock<std::mutex> lk(mtx_);
+
+        const std::uint64_t my_ticket = next_ticket_++;
+        q_.push_back(Node{Mode::Write, my_ticket, &w});
+        // 关闭读者快路径：之后的读者都得排队，已经进去的快路径读者由 unlock_shared 负责叫醒调度器
+        state_.fetch_or(kSlow, std::memory_order_acq_rel);
+
+        // 入队后尝试触发调度（尤其是队列原本为空时）
+        wake_next_();
+
+        // 仅在被“精准唤醒”后继续
+        w.cv.wait(lk, [&]{ return w.go; });
+
+        // 断言：当前唤醒节点为对头写者节点
+        assert(!q_.empty() && q_.front().mode == Mode::Write);
+        assert(q_.front().ticket == my_ticket);
+
+        // 写者获取锁：自己出队
+        q_.pop_front();
+        has_writer_ = true;
+    }
+
+    bool try_lock() {
+        std::unique_lock<std::mutex> lk(mtx_);
+
+        // 没有正在进行的写者
+        // 没有正在进行的或等待进行的读者
+        // 不能插队
+        if (has_writer_) return false;
+        if (pending_readers_ != 0) return false;
+        if (!q_.empty()) return false;             // 严格公平：有人排队就不能抢
+
+        // 没有读者时一次 CAS 同时确认读者数为 0 并关闭快路径
+        std::uint64_t expected = 0;
+        if (!state_.compare_exchange_strong(expected, kSlow, std::memory_order_acq_rel)) return false;
+        has_writer_ = true;
+        return true;
+    }
+
+    void unlock() {
+        std::unique_lock<std::mutex> lk(mtx_);
+        has_writer_ = false;
+        wake_next_();
+    }
+
+    // ==========================================
+    // 共享锁 (Reader)
+    // ==========================================
+    void lock_shared() {
+        if (try_lock_shared_fast_()) return;
+
+        Waiter w;
+        std::unique_lock<std::mutex> lk(mtx_);
+
+        // 拿到 mtx_ 之前写者可能已经走了：没人在写也没人排队就直接进去
+        if (!has_writer_ && q_.empty()) {
+            state_.fetch_and(~kSlow, std::memory_order_acq_rel);
+            state_.fetch_add(1, std::memory_order_acquire);
+            return;
+        }
+
+        const std::uint64_t my_ticket = next_ticket_++;
+        q_.push_back(Node{Mode::Read, my_ticket, &w});
+
+        // 入队后尝试触发调度（尤其是队列原本为空时）
+        wake_next_();
+
+        // 等待被批次调度“精准唤醒”
+        w.cv.wait(lk, [&]{ return w.go; });
+
+        // 注意读者无法在这里断言，因为节点 node 已经在批量出中被处理了
+        // assert(!q_.empty() && q_.front().mode == Mode::Read);
+        // assert(q_.front().ticket == my_ticket);
+
+        // 读者正式入场
+        state_.fetch_add(1, std::memory_order_acquire);
+        -- pending_readers_;
+
+        // 不需要 wake_next_：因为只要读者数 > 0 写者就不能跑
+    }
+
+    // 快路径关闭（有人在写或在排队）时直接失败，不去抢 mtx_
+    bool try_lock_shared() {
+        return try_lock_shared_fast_();
+    }
+
+    void unlock_shared() {
+        std::uint64_t prev = state_.fetch_sub(1, std::memory_order_acq_rel);
+        // 快路径开着说明没有人在等，什么都不用做；
+        // 否则最后一个离开的读者负责叫醒调度器（写者置 kSlow 与这里的 fetch_sub 作用在同一个原子量上，
+        // 两者谁先谁后都不会漏：要么写者看到读者数已经减了，要么这里看到 kSlow）
+        if ((prev & kSlow) && (prev & kReaderMask) == 1) {
+            std::unique_lock<std::mutex> lk(mtx_);
+            wake_next_(); // 若仍有 pending_readers_，wake_next_ 会自动不放行写者
+        }
+    }
+
+private:
+    enum class Mode { Read, Write };
+
+    struct Waiter {
+        std::condition_variable cv; // 通知信号：唤醒线程
+        bool go{false}; // 状态位：线程醒来后检查自己是不是真的被允许通过
+                        // 可以防止伪唤醒和“先 notify，后 wait 导致通知信号丢失的情况”
+    };
+
+    struct Node {
+        Mode mode;
+        std::uint64_t ticket; 
+        Waiter* waiter;       // Read/Write 都用私有 waiter；try_lock* 不入队则无 waiter
+    };
+
+    static constexpr std::uint64_t kSlow = std::uint64_t{1} << 63;
+    static constexpr std::uint64_t kReaderMask = kSlow - 1;
+
+    // 快路径：kSlow 没有置位时 CAS 读者数 + 1；用 CAS 而不是 fetch_add，保证写者置位之后一个读者也进不来
+    bool try_lock_shared_fast_() {
+        std::uint64_t s = state_.load(std::memory_order_relaxed);
+        while (!(s & kSlow)) {
+            if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::uint64_t readers_() const { return state_.load(std::memory_order_acquire) & kReaderMask; }
+
+    // 注意：以下 *_unsafe_ 仅在已持有 mtx_ 时调用
+    bool can_run_writer_unsafe_() const {
+        // 没有正在进行的写
+        // 没有正在进行或等待进行的读
+        // 可以写
+        return !has_writer_
+            && readers_() == 0 && pending_readers_ == 0
+            && !q_.empty() && q_.front().mode == Mode::Write;
+    }
+
+    // 开启读批次：弹出队头连续 Read，并仅唤醒这一批读者（无 notify_all 惊群）
+    void open_read_batch_and_wake_unsafe_() {
+        std::vector<Waiter*> to_wake;
+        to_wake.reserve(32);
+
+        std::size_t count = 0;
+        while (!q_.empty() && q_.front().mode == Mode::Read) {
+            Waiter* w = q_.front().waiter;
+            q_.pop_front();
+            if (w) {
+                to_wake.push_back(w);
+            }
+            ++ count;
+        }
+
+        // 标记：已批准但尚未入场的读者数
+        pending_readers_ = count;
+
+        // 精准唤醒该批次的读者（每个读者一个 notify_one）
+        for (Waiter* w : to_wake) {
+            w->go = true;
+            w->cv.notify_one();
+        }
+    }
+
+    // 核心调度器：所有调用都在持有 mtx_ 的情况下进行
+    void wake_next_() {
+        // 0) 没有写者在写、也没有人排队：重新打开读者快路径
+        if (!has_writer_ && q_.empty()) {
+            state_.fetch_and(~kSlow, std::memory_order_acq_rel);
+            return;
+        }
+
+        // 1) 有人在持锁：不调度
+        if (has_writer_ || readers_() != 0) return;
+
+        // 2) 读批次“入场中”：不调度写者/下一批
+        if (pending_readers_ != 0) return;
+
+        // 3) 队列空：结束（上面已经处理）
+
+        // 4) 按队头调度
+        if (q_.front().mode == Mode::Write) {
+            // 精准唤醒队头写者（无惊群）
+            Waiter* w = q_.front().waiter;
+            if (w) {
+                w->go = true;
+                w->cv.notify_one();
+            }
+        } else {
+            // 开启读批次并精准唤醒该批次读者（无 notify_all 惊群）
+            open_read_batch_and_wake_unsafe_();
+        }
+    }
+
+private:
+    std::mutex mtx_;
+    std::deque<Node> q_;
+
+    bool has_writer_{false};
+    // 已经入场的读者数（低 63 位）+ kSlow（最高位）；读者快路径只访问它
+    // kSlow 只在持有 mtx_ 时修改，读者数在快路径上不加锁修改
+    alignas(64) std::atomic<std::uint64_t> state_{0};
+    std::size_t pending_readers_{0}; // 已经批准（被唤醒）但尚未完成“入场”的读者数量
+    
+    std::uint64_t next_ticket_{0};   // 等待线程的票号
+                                     // ticket 在这里无实际价值，它仅用于辅助用途
+                                     //     1. 调试/日志/可观察性：打印 ticket 能查看入队/出队/排队情况
+                                     //     2. 防御性校验：等待线程醒来后断言“我真的是对头那个节点对应的线程”，可以在开发期更早的发现 bug
+};
+
+#endif
+} // namespace fair_fifo
+
+
+// ============================================================
+// 4) Big-reader (per-slot sharded) shared_mutex for read-mostly data
+// ============================================================
+namespace big_reader {
+
+// 分布式读写锁（Linux 内核的 brlock / percpu-rwsem 思路）
+// 即使有了 fair_fifo 的快路径，所有读者仍然在同一个计数器上 fetch_add，缓存行在核之间来回跳
+// 这里每个线程固定分到一个槽（cache line 对齐的计数器），读者只改自己槽里的计数：
+//   - lock_shared : 自己的槽 + 1，再看 writer_；有写者就撤回，等写者走了再来
+//   - lock        : writer_mtx_ 串行化写者，置 writer_，再等所有槽归零
+// 读者与写者之间是 Dekker 式的“先写自己的、再读对方的”，两边都用 seq_cst，
+// 保证不会出现读者没看到 writer_、写者也没看到这个读者的计数
+// 代价是写者要扫一遍所有槽，并且写者优先：写者连续不断时读者会一直等，只适合读远多于写的数据
+class shared_mutex {
+public:
+    static constexpr std::size_t kSlots = 64;  // 线程数多于槽数时几个线程共用一个槽，仍然正确
+
+    shared_mutex() = default;
+    shared_mutex(const shared_mutex&) = delete;
+    shared_mutex& operator=(const shared_mutex&) = delete;
+
+    void lock() {
+        writer_mtx_.lock();
+        writer_.store(true, std::memory_order_seq_cst);
+        // 等已经进去的读者全部离开；新来的读者看到 writer_ 会自己撤回
+        for (auto& slot : slots_) {
+            while (slot.readers.load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+        }
+    }
+    bool try_lock() {
+        if (!writer_mtx_.try_lock()) return false;
+        writer_.store(true, std::memory_order_seq_cst);
+        for (auto& slot : slots_) {
+            if (slot.readers.load(std::memory_order_seq_cst) != 0) {
+                release_writer_();
+                return false;
+            }
+        }
+        return true;
+    }
+    void unlock() {
+        release_writer_();
+    }
+    void lock_shared() {
+        Slot& slot = my_slot_();
+        while (true) {
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            if (!writer_.load(std::memory_order_seq_cst)) return;
+            // 有写者：撤回计数（写者可能正在等它），睡到写者离开
+            slot.readers.fetch_sub(1, std::memory_order_seq_cst);
+            writer_.wait(true, std::memory_order_seq_cst);
+        }
+    }
+    bool try_lock_shared() {
+        Slot& slot = my_slot_();
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writer_.load(std::memory_order_seq_cst)) return true;
+        slot.readers.fetch_sub(1, std::memory_order_seq_cst);
+        return false;
+    }
+    void unlock_shared() {
+        my_slot_().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::int64_t> readers{0};
+    };
+
+    // 线程第一次用到读锁时按到达顺序分一个槽，之后一直用它（不用 sched_getcpu：线程可能在加锁和解锁之间迁移）
+    // 槽号对所有 big_reader::shared_mutex 对象通用
+    Slot& my_slot_() {
+        static std::atomic<std::size_t> next_slot{0};
+        thread_local std::size_t idx = next_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+        return slots_[idx];
+    }
+
+    void release_writer_() {
+        writer_.store(false, std::memory_order_seq_cst);
+        writer_.notify_all();
+        writer_mtx_.unlock();
+    }
+
+    Slot slots_[kSlots];
+    alignas(64) std::atomic<bool> writer_{false};
+    std::mutex writer_mtx_;  // 写者之间的互斥
+};
+
+} // namespace big_reader
+
+#endif
@@ -0,0 +1,164 @@
+// RCU 风格的快照指针：读者拿到当前版本的只读快照，写者发布新版本，旧版本过了宽限期再释放
+//
+//   snapshot_ptr<Config> cfg(std::make_unique<Config>(...));
+//   {
+//       auto snap = cfg.read();          // 读者：不加锁，不等写者
+//       use(snap->field);
+//   }                                    // 离开作用域后旧版本才可能被回收
+//   cfg.update([](Config& c) { c.field = 42; });  // 写者：拷贝当前版本，修改，发布
+//
+// 回收用的是两相位的 epoch 计数（类似 Linux 的 SRCU）：
+//   - 读者进入时在自己线程的槽里给当前 epoch 的相位（epoch & 1）计数 + 1，离开时 - 1
+//   - 写者发布新版本后，把旧版本连同当前 epoch 挂到待回收链表上，然后尝试推进 epoch：
+//     从 e 推进到 e + 1 要求相位 (e + 1) & 1 上已经没有读者（那是 e - 1 时进来的读者）
+//   - epoch 推进了两次之后，发布旧版本时正在读的读者一定都已经离开，旧版本可以释放
+// 写者从不等待读者，只是释放会推迟到之后的某次 publish（或 synchronize()）
+// 槽按线程分配，几个线程共用一个槽也没关系（槽里是计数，不是线程独占的标记）
+#ifndef MUTEX_SNAPSHOT_PTR_H
+#define MUTEX_SNAPSHOT_PTR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class snapshot_ptr {
+    struct Slot;
+
+public:
+    static constexpr std::size_t kSlots = 64;
+
+    // 读者持有的快照，析构时退出读临界区；只可移动
+    class reader_guard {
+    public:
+        reader_guard(reader_guard&& other) noexcept
+            : p_(std::exchange(other.p_, nullptr)), cnt_(std::exchange(other.cnt_, nullptr)) {}
+        reader_guard& operator=(reader_guard&&) = delete;
+        reader_guard(const reader_guard&) = delete;
+        ~reader_guard() {
+            if(cnt_) cnt_->fetch_sub(1, std::memory_order_release);
+        }
+
+        const T* get() const noexcept { return p_; }
+        const T& operator*() const noexcept { return *p_; }
+        const T* operator->() const noexcept { return p_; }
+
+    private:
+        friend class snapshot_ptr;
+        reader_guard(const T* p, std::atomic<std::int64_t>* cnt) : p_(p), cnt_(cnt) {}
+
+        const T* p_;
+        std::atomic<std::int64_t>* cnt_;
+    };
+
+    explicit snapshot_ptr(std::unique_ptr<T> init) : cur_(init.release()) {}
+    snapshot_ptr(const snapshot_ptr&) = delete;
+    snapshot_ptr& operator=(const snapshot_ptr&) = delete;
+    // 析构时不能再有读者
+    ~snapshot_ptr() {
+        delete cur_.load(std::memory_order_relaxed);
+        for(auto& r : retired_) delete r.ptr;
+    }
+
+    reader_guard read() const {
+        Slot& slot = my_slot_();
+        while(true) {
+            std::uint64_t e = epoch_.load(std::memory_order_seq_cst);
+            auto& cnt = slot.readers[e & 1];
+            cnt.fetch_add(1, std::memory_order_seq_cst);
+            // epoch 没变才算进入了这个相位；变了就撤回，按新的相位重来
+            if(epoch_.load(std::memory_order_seq_cst) == e) {
+                return reader_guard(cur_.load(std::memory_order_seq_cst), &cnt);
+            }
+            cnt.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // 发布新版本；旧版本在宽限期之后释放
+    void publish(std::unique_ptr<T> next) {
+        std::lock_guard<std::mutex> lock(writer_);
+        publish_locked_(next.release());
+    }
+
+    // 拷贝当前版本，交给 f(T&) 修改后发布，写者之间串行
+    template<typename F>
+    void update(F&& f) {
+        std::lock_guard<std::mutex> lock(writer_);
+        auto next = std::make_unique<T>(*cur_.load(std::memory_order_relaxed));
+        f(*next);
+        publish_locked_(next.release());
+    }
+
+    // 阻塞直到所有已退役的版本都被释放（调用线程不能正持有 reader_guard）
+    void synchronize() {
+        std::unique_lock<std::mutex> lock(writer_);
+        while(!retired_.empty()) {
+            reclaim_locked_();
+            if(retired_.empty()) break;
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+
+    // 还没释放的旧版本数
+    std::size_t retired() const {
+        std::lock_guard<std::mutex> lock(writer_);
+        return retired_.size();
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::int64_t> readers[2]{};  // 两个相位上的读者数
+    };
+    struct Retired {
+        T* ptr;
+        std::uint64_t epoch;  // 退役时的 epoch
+    };
+
+    Slot& my_slot_() const {
+        static std::atomic<std::size_t> next_slot{0};
+        thread_local std::size_t idx = next_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+        return slots_[idx];
+    }
+
+    void publish_locked_(T* next) {
+        T* old = cur_.exchange(next, std::memory_order_seq_cst);
+        retired_.push_back(Retired{old, epoch_.load(std::memory_order_relaxed)});
+        reclaim_locked_();
+    }
+
+    bool phase_drained_(std::size_t phase) const {
+        for(auto& s : slots_) {
+            if(s.readers[phase].load(std::memory_order_seq_cst) != 0) return false;
+        }
+        return true;
+    }
+
+    // 最多推进两次 epoch，然后释放 epoch 已经前进了至少 2 的旧版本
+    void reclaim_locked_() {
+        for(int i = 0; i < 2; i ++ ) {
+            std::uint64_t e = epoch_.load(std::memory_order_relaxed);
+            if(!phase_drained_((e + 1) & 1)) break;
+            epoch_.store(e + 1, std::memory_order_seq_cst);
+        }
+        std::uint64_t now = epoch_.load(std::memory_order_relaxed);
+        std::erase_if(retired_, [now](const Retired& r) {
+            if(r.epoch + 2 > now) return false;
+            delete r.ptr;
+            return true;
+        });
+    }
+
+    std::atomic<T*> cur_;
+    alignas(64) std::atomic<std::uint64_t> epoch_{0};  // 只有写者（持有 writer_）修改
+    mutable Slot slots_[kSlots];
+    mutable std::mutex writer_;
+    std::vector<Retired> retired_;  // 受 writer_ 保护
+};
+
+#endif
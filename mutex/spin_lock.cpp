@@ -1,42 +1,20 @@
 // 实现一个阻塞互斥锁（自旋锁）
-// 基于 TAS 原语
-#include <thread>
-#include <atomic>
+// 以前基于 TAS / TTAS 原语一直自旋，现在换成 spin_lock.hpp 中的自适应自旋锁：
+// 指数退避自旋一段时间，还拿不到就睡在 futex 上
+//
+// 用法: ./spin_lock [每组测试的总加锁次数，默认 200000，平分给各线程]
+// 依次在 1 ~ 64 个线程下对比 std::mutex 与 SpinLock 的吞吐，并打印 ProfiledSpinLock 的竞争统计
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
-#include <vector>
 #include <mutex>
+#include <thread>
+#include <vector>
 
-class SpinLock {
-public:
-    constexpr SpinLock() = default;
-    SpinLock(const SpinLock&) = delete;
-    SpinLock& operator=(const SpinLock&) = delete;
-
-    void lock() {
-#if __cplusplus >= 202002L
-        // TTAS
-        while(true) {
-            while(flag_.test(std::memory_order_relaxed)) {
-                // std::this_thread::yield(); 
-            }
-            if(!flag_.test_and_set(std::memory_order_acquire)) return ;
-        }
-#else 
-        // TAS
-        while(flag_.test_and_set(std::memory_order_acquire)) {
-            // std::this_thread::yield(); 
-        }
-#endif 
-    }
-
-    void unlock() {
-        flag_.clear(std::memory_order_release);
-    }
-
-private:
-    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
-};
-
+#include "spin_lock.hpp"
 
 int sum = 0;
 SpinLock mtx;
@@ -50,7 +28,57 @@ void worker(int N = 10000000) {
     sum += local;
 }
 
-int main()
+// 持有者长时间不释放：等待者自旋 kSpinRounds 轮之后应当睡到 futex 上，而不是一直烧 CPU
+static void test_park() {
+    ProfiledSpinLock m;
+    m.lock();
+    std::thread t([&] {
+        m.lock();
+        m.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    m.unlock();
+    t.join();
+    SpinLockStats s = m.stats();
+    assert(s.acquisitions == 2 && s.contended == 1);
+    assert(s.parks >= 1 && s.spins <= static_cast<std::uint64_t>(ProfiledSpinLock::kSpinRounds));
+    assert(m.try_lock() && !m.try_lock());
+    m.unlock();
+    std::cout << "park test passed (spins=" << s.spins << ", parks=" << s.parks << ")" << std::endl;
+}
+
+// 模拟临界区内的一点点工作
+static void busy_work(int iters) {
+    volatile int x = 0;
+    for(int i = 0; i < iters; i ++ ) x = x + i;
+}
+
+// threads 个线程各加锁 ops 次，返回每秒加锁次数
+template<typename Mutex>
+static double bench(Mutex& m, int threads, int ops) {
+    long long counter = 0;
+    std::vector<std::thread> ts;
+    ts.reserve(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    for(int t = 0; t < threads; t ++ ) {
+        ts.emplace_back([&] {
+            for(int i = 0; i < ops; i ++ ) {
+                std::lock_guard<Mutex> lock(m);
+                ++ counter;
+                busy_work(20);
+            }
+        });
+    }
+    for(auto& t : ts) t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(counter != static_cast<long long>(threads) * ops) {
+        std::cerr << "lost update: " << counter << std::endl;
+        std::exit(1);
+    }
+    return static_cast<double>(counter) / sec;
+}
+
+int main(int argc, char** argv)
 {
     const int N = 3;
     std::vector<std::thread> threads;
@@ -58,5 +86,25 @@ int main()
     for(int i = 0; i < N; i ++ ) threads.emplace_back([&]{worker();});
     for(auto &t : threads) t.join();
     std::cout << "sum: " << sum << std::endl;
+    test_park();
+
+    int ops = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200000;
+    std::cout << "\nthreads   std::mutex(ops/s)   SpinLock(ops/s)   contended%   spins/acq   parks/acq\n";
+    for(int n : {1, 2, 4, 8, 16, 32, 64}) {
+        int per = std::max(1, ops / n);
+        std::mutex std_mtx;
+        SpinLock spin;
+        ProfiledSpinLock profiled;
+        double a = bench(std_mtx, n, per);
+        double b = bench(spin, n, per);
+        bench(profiled, n, per);
+        SpinLockStats s = profiled.stats();
+        double acq = static_cast<double>(s.acquisitions);
+        std::cout << std::setw(7) << n << std::fixed << std::setprecision(0)
+                  << std::setw(20) << a << std::setw(18) << b << std::setprecision(2)
+                  << std::setw(13) << 100.0 * s.contended / acq
+                  << std::setw(12) << s.spins / acq
+                  << std::setw(12) << s.parks / acq << "\n";
+    }
     return 0;
-}
\ No newline at end of file
+}
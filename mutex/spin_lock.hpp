@@ -0,0 +1,133 @@
+// 自适应自旋锁：先自旋（指数退避），自旋一定轮数还拿不到就睡在 futex 上（std::atomic::wait）
+//
+// 以前的 SpinLock 在 atomic_flag 上死等：持有者被抢占时（线程数多于核数），
+// 所有等待者都会把自己的整个时间片烧光；现在最多自旋 kSpinRounds 轮，之后交给内核
+//
+// 状态字（与 Drepper《Futexes Are Tricky》中的 mutex 相同）：
+//   0 : 未加锁
+//   1 : 已加锁，没有睡眠的等待者
+//   2 : 已加锁，可能有睡眠的等待者（unlock 时需要 notify）
+// 无竞争时 lock / unlock 各只有一次原子操作，不进内核
+#ifndef MUTEX_SPIN_LOCK_H
+#define MUTEX_SPIN_LOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 放在命名空间里：thread_pool/src/Backoff.hpp 也有一个全局的 cpu_relax()，两个头文件要能一起包含
+namespace spin {
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::this_thread::yield();
+#endif
+}
+} // namespace spin
+
+// 竞争统计，用来判断某个调用点到底适不适合用自旋锁：
+//   contended / acquisitions 高、parks 也高，说明临界区太长或线程太多，换 std::mutex 更好
+struct SpinLockStats {
+    std::uint64_t acquisitions = 0;  // 成功加锁次数（含 try_lock）
+    std::uint64_t contended = 0;     // 第一次 CAS 没拿到锁的次数
+    std::uint64_t spins = 0;         // 累计自旋轮数
+    std::uint64_t parks = 0;         // 睡到 futex 上的次数
+};
+
+// Stats = true 时统计 SpinLockStats，计数器放在单独的缓存行上，不和状态字互相干扰
+// Stats = false（默认）时计数器不存在，也没有任何额外开销
+template<bool Stats = false>
+class BasicSpinLock {
+public:
+    static constexpr int kSpinRounds = 16;   // 自旋这么多轮还拿不到锁就睡眠
+    static constexpr int kMaxPauseShift = 6; // 每轮 pause 的次数从 1 翻倍到 64 为止
+
+    constexpr BasicSpinLock() = default;
+    BasicSpinLock(const BasicSpinLock&) = delete;
+    BasicSpinLock& operator=(const BasicSpinLock&) = delete;
+
+    void lock() {
+        std::uint32_t expected = 0;
+        if(state_.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            count(&Counters::acquisitions);
+            return ;
+        }
+        count(&Counters::contended);
+        lock_slow();
+        count(&Counters::acquisitions);
+    }
+
+    bool try_lock() noexcept {
+        std::uint32_t expected = 0;
+        if(!state_.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        count(&Counters::acquisitions);
+        return true;
+    }
+
+    void unlock() noexcept {
+        // 状态为 2 说明可能有人睡着，叫醒一个；它醒来后会把状态再设为 2，保证后面的人也能被叫醒
+        if(state_.exchange(0, std::memory_order_release) == 2) state_.notify_one();
+    }
+
+    SpinLockStats stats() const noexcept {
+        SpinLockStats s;
+        if constexpr (Stats) {
+            s.acquisitions = counters_.acquisitions.load(std::memory_order_relaxed);
+            s.contended = counters_.contended.load(std::memory_order_relaxed);
+            s.spins = counters_.spins.load(std::memory_order_relaxed);
+            s.parks = counters_.parks.load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+private:
+    void lock_slow() {
+        // 1. TTAS + 指数退避：只读等待，看到锁空闲再去 CAS，避免所有等待者一起抢缓存行
+        for(int round = 0; round < kSpinRounds; round ++ ) {
+            int pauses = 1 << (round < kMaxPauseShift ? round : kMaxPauseShift);
+            for(int i = 0; i < pauses; i ++ ) spin::cpu_relax();
+            count(&Counters::spins);
+            std::uint32_t s = state_.load(std::memory_order_relaxed);
+            if(s == 0 && state_.compare_exchange_weak(s, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return ;
+            }
+            if(s == 2) break;  // 已经有人在睡了，再自旋也排不到前面
+        }
+        // 2. 睡眠：把状态设为 2（告诉持有者 unlock 时要叫人），换回来是 0 就说明拿到了锁
+        //    醒来后同样用 2 去抢，因为不知道身后还有没有其它睡着的线程
+        while(state_.exchange(2, std::memory_order_acquire) != 0) {
+            count(&Counters::parks);
+            state_.wait(2, std::memory_order_relaxed);
+        }
+    }
+
+    struct Counters {
+        std::atomic<std::uint64_t> acquisitions{0};
+        std::atomic<std::uint64_t> contended{0};
+        std::atomic<std::uint64_t> spins{0};
+        std::atomic<std::uint64_t> parks{0};
+    };
+    struct NoCounters {};
+
+    void count(std::atomic<std::uint64_t> Counters::* field) noexcept {
+        if constexpr (Stats) (counters_.*field).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint32_t> state_{0};
+    alignas(Stats ? 64 : 1) [[no_unique_address]] std::conditional_t<Stats, Counters, NoCounters> counters_;
+};
+
+using SpinLock = BasicSpinLock<false>;
+using ProfiledSpinLock = BasicSpinLock<true>;
+
+#endif
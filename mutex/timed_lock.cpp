@@ -2,7 +2,14 @@
 // lock() 阻塞到成功；
 // try_lock() 立即返回；
 // try_lock_for/try_lock_until 带超时
-
+//
+// 下面的 TimedLock 用 mutex + condition_variable + flag_ 实现，写法直观但每次加锁都要经过内部 mutex；
+// futex_timed_lock.hpp 中的 FutexTimedLock 只用一个原子状态字，同一组测试对两者都跑一遍，
+// 最后的基准对比 TimedLock、FutexTimedLock 和 std::timed_mutex
+//
+// 用法: ./timed_lock [每组基准的总加锁次数，默认 200000]
+
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
@@ -11,6 +18,10 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <cstdlib>
+#include <iomanip>
+
+#include "futex_timed_lock.hpp"
 
 class TimedLock {
 public:
@@ -70,9 +81,10 @@ private:
 
 using namespace std::chrono;
 
+template<typename Lock>
 static void test_try_lock_immediate() {
     std::cout << "[1] try_lock immediate...\n";
-    TimedLock m;
+    Lock m;
 
     bool ok1 = m.try_lock();
     assert(ok1 && "first try_lock should succeed");
@@ -87,9 +99,10 @@ static void test_try_lock_immediate() {
     m.unlock();
 }
 
+template<typename Lock>
 static void test_lock_blocks_until_unlock() {
     std::cout << "[2] lock blocks until unlock...\n";
-    TimedLock m;
+    Lock m;
     m.lock();
 
     std::atomic<bool> acquired{false};
@@ -117,9 +130,10 @@ static void test_lock_blocks_until_unlock() {
     assert(dt >= 100 && "waiter should have been blocked for a while");
 }
 
+template<typename Lock>
 static void test_try_lock_for_timeout_and_success() {
     std::cout << "[3] try_lock_for timeout then success...\n";
-    TimedLock m;
+    Lock m;
     m.lock();
 
     // 在锁被占用时应超时失败
@@ -137,9 +151,10 @@ static void test_try_lock_for_timeout_and_success() {
     m.unlock();
 }
 
+template<typename Lock>
 static void test_try_lock_until_timeout_and_success() {
     std::cout << "[4] try_lock_until timeout then success...\n";
-    TimedLock m;
+    Lock m;
     m.lock();
 
     auto deadline = steady_clock::now() + 120ms;
@@ -154,9 +169,10 @@ static void test_try_lock_until_timeout_and_success() {
     m.unlock();
 }
 
+template<typename Lock>
 static void test_stress_exclusion() {
     std::cout << "[5] stress: mutual exclusion...\n";
-    TimedLock m;
+    Lock m;
     std::atomic<int> in_cs{0};
     std::atomic<int> passes{0};
 
@@ -197,13 +213,75 @@ static void test_stress_exclusion() {
     assert(passes.load() == kThreads * kIters);
 }
 
-int main() {
-    test_try_lock_immediate();
-    test_lock_blocks_until_unlock();
-    test_try_lock_for_timeout_and_success();
-    test_try_lock_until_timeout_and_success();
-    test_stress_exclusion();
+template<typename Lock>
+static void run_tests(const char* name) {
+    std::cout << "== " << name << " ==\n";
+    test_try_lock_immediate<Lock>();
+    test_lock_blocks_until_unlock<Lock>();
+    test_try_lock_for_timeout_and_success<Lock>();
+    test_try_lock_until_timeout_and_success<Lock>();
+    test_stress_exclusion<Lock>();
+}
+
+// 无竞争：单线程反复 lock / unlock，返回每次的纳秒数
+template<typename Lock>
+static double bench_uncontended(int ops) {
+    Lock m;
+    auto t0 = steady_clock::now();
+    for (int i = 0; i < ops; ++i) {
+        m.lock();
+        m.unlock();
+    }
+    return duration<double, std::nano>(steady_clock::now() - t0).count() / ops;
+}
 
+// 有竞争：threads 个线程一半用 lock、一半用 try_lock_for 抢同一把锁，返回每秒加锁次数
+template<typename Lock>
+static double bench_contended(int threads, int ops) {
+    Lock m;
+    long long counter = 0;
+    std::vector<std::thread> ts;
+    ts.reserve(threads);
+    auto t0 = steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&, t]{
+            for (int i = 0; i < ops; ++i) {
+                if (t % 2 == 0) m.lock();
+                else while (!m.try_lock_for(1ms)) {}
+                ++counter;
+                m.unlock();
+            }
+        });
+    }
+    for (auto& th : ts) th.join();
+    double sec = duration<double>(steady_clock::now() - t0).count();
+    if (counter != static_cast<long long>(threads) * ops) {
+        std::cerr << "lost update: " << counter << "\n";
+        std::exit(1);
+    }
+    return static_cast<double>(counter) / sec;
+}
+
+int main(int argc, char** argv) {
+    run_tests<TimedLock>("TimedLock");
+    run_tests<FutexTimedLock>("FutexTimedLock");
     std::cout << "All tests passed ✅\n";
+
+    int ops = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200000;
+    std::cout << "\nuncontended lock+unlock (ns/op)\n"
+              << "      TimedLock  FutexTimedLock  std::timed_mutex\n" << std::fixed << std::setprecision(1)
+              << std::setw(15) << bench_uncontended<TimedLock>(ops)
+              << std::setw(16) << bench_uncontended<FutexTimedLock>(ops)
+              << std::setw(18) << bench_uncontended<std::timed_mutex>(ops) << "\n";
+
+    std::cout << "\ncontended lock / try_lock_for (ops/s)\n"
+              << "threads      TimedLock  FutexTimedLock  std::timed_mutex\n" << std::setprecision(0);
+    for (int n : {2, 4, 8, 16}) {
+        int per = std::max(1, ops / n);
+        std::cout << std::setw(7) << n
+                  << std::setw(15) << bench_contended<TimedLock>(n, per)
+                  << std::setw(16) << bench_contended<FutexTimedLock>(n, per)
+                  << std::setw(18) << bench_contended<std::timed_mutex>(n, per) << "\n";
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,40 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 自旋等待时的“让一让”：x86 上是 pause 指令，降低功耗并让出流水线给超线程的另一半
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// 指数退避：前 kSpinLimit 轮每轮 pause 的次数翻倍，之后每轮直接 yield 让出 CPU
+class Backoff {
+public:
+    void pause() noexcept {
+        if(round_ < kSpinLimit) {
+            for(unsigned i = 0; i < (1u << round_); i ++ ) cpu_relax();
+            ++ round_;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    void reset() noexcept { round_ = 0; }
+
+private:
+    static constexpr unsigned kSpinLimit = 6;  // 最多连续 pause 64 次
+    unsigned round_ = 0;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef THREAD_POOL_CORO_H
+#define THREAD_POOL_CORO_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// C++20 协程与 v4 ThreadPool 的适配
+//
+//   coro::task<int> fetch(ThreadPool& pool) {
+//       co_await pool.schedule();      // 切到 worker 上执行
+//       co_await pool.sleep_for(10);   // 挂起 10ms，期间不占用线程
+//       co_return 42;
+//   }
+//   int v = coro::sync_wait(fetch(pool));  // 只能在非 worker 线程上阻塞等待
+//
+// task<T> 是惰性的：创建时不执行，被 co_await（或 sync_wait / spawn）时才开始；
+// 它执行完时通过对称转移（symmetric transfer）直接在当前线程恢复等待它的协程，
+// 不经过线程池的队列，也不会因为长链的 co_await 而爆栈
+namespace coro {
+
+template<typename T = void>
+class task;
+
+namespace detail {
+
+struct promise_base {
+    std::coroutine_handle<> continuation;  // 等待这个 task 的协程，为空表示没有人等
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct final_awaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            if(auto c = h.promise().continuation) return c;
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+};
+
+template<typename T>
+struct promise : promise_base {
+    std::variant<std::monostate, T, std::exception_ptr> result;
+
+    task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& v) { result.template emplace<1>(std::forward<U>(v)); }
+    void unhandled_exception() noexcept { result.template emplace<2>(std::current_exception()); }
+
+    T get() {
+        if(result.index() == 2) std::rethrow_exception(std::get<2>(result));
+        return std::move(std::get<1>(result));
+    }
+};
+
+template<>
+struct promise<void> : promise_base {
+    std::exception_ptr error;
+
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    void get() {
+        if(error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+// 惰性协程任务，只可移动；析构时销毁协程帧
+template<typename T>
+class task {
+public:
+    static_assert(!std::is_reference_v<T>, "task<T&> is not supported");
+    using promise_type = detail::promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    task() noexcept = default;
+    explicit task(handle_type h) noexcept : h_(h) {}
+    task(task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+    task& operator=(task&& other) noexcept {
+        if(this != &other) {
+            if(h_) h_.destroy();
+            h_ = std::exchange(other.h_, {});
+        }
+        return *this;
+    }
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() {
+        if(h_) h_.destroy();
+    }
+
+    bool valid() const noexcept { return static_cast<bool>(h_); }
+
+    // co_await 一个 task：记下自己作为 continuation，然后直接转去执行它
+    auto operator co_await() && noexcept { return awaiter{h_}; }
+    auto operator co_await() & noexcept { return awaiter{h_}; }
+
+private:
+    struct awaiter {
+        handle_type h;
+        bool await_ready() const noexcept { return !h || h.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            h.promise().continuation = awaiting;
+            return h;
+        }
+        T await_resume() { return h.promise().get(); }
+    };
+
+    handle_type h_;
+};
+
+namespace detail {
+
+template<typename T>
+task<T> promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+// sync_wait / spawn 用的驱动协程：立即开始执行，由 Done 决定结束时做什么
+template<typename Done>
+struct driver {
+    struct promise_type {
+        Done done;
+
+        driver get_return_object() noexcept {
+            return driver{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct awaiter {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> h) noexcept { h.promise().done(h); }
+                void await_resume() const noexcept {}
+            };
+            return awaiter{};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> h;
+};
+
+// sync_wait：结束时唤醒阻塞的线程，协程帧由 sync_wait 销毁
+// 在锁内通知：sync_wait 拿到锁之前这里一定已经不再访问 sync_state（它在 sync_wait 的栈上）
+struct sync_state {
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool done = false;
+};
+
+struct signal_done {
+    sync_state* st = nullptr;
+    void operator()(std::coroutine_handle<>) const noexcept {
+        std::lock_guard<std::mutex> lock(st->mtx);
+        st->done = true;
+        st->cond.notify_one();
+    }
+};
+
+// spawn：没有人等待，结束时自己销毁协程帧
+struct destroy_done {
+    void operator()(std::coroutine_handle<> h) const noexcept { h.destroy(); }
+};
+
+// sync_wait 的结果：未完成 / 值 / 异常
+template<typename T>
+using sync_result = std::variant<std::monostate, std::conditional_t<std::is_void_v<T>, std::monostate, T>,
+                                 std::exception_ptr>;
+
+template<typename T>
+driver<signal_done> sync_wait_driver(task<T>& t, sync_result<T>& out) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await t;
+            out.template emplace<1>();
+        }
+        else {
+            out.template emplace<1>(co_await t);
+        }
+    }
+    catch(...) {
+        out.template emplace<2>(std::current_exception());
+    }
+}
+
+inline driver<destroy_done> spawn_driver(task<void> t) {
+    co_await t;
+}
+
+} // namespace detail
+
+// 在当前线程阻塞等待 t 完成并取回结果，异常原样抛出
+// 不要在 worker 里调用：它会占住这个 worker，和在 worker 里 future::get() 一样
+template<typename T>
+T sync_wait(task<T> t) {
+    detail::sync_result<T> out;
+    detail::sync_state st;
+    auto d = detail::sync_wait_driver(t, out);
+    d.h.promise().done.st = &st;
+    d.h.resume();
+    {
+        std::unique_lock<std::mutex> lock(st.mtx);
+        st.cond.wait(lock, [&] { return st.done; });
+    }
+    d.h.destroy();
+    if(out.index() == 2) std::rethrow_exception(std::get<2>(out));
+    if constexpr (!std::is_void_v<T>) return std::move(std::get<1>(out));
+}
+
+// 启动一个没有人等待的 task<void>：在当前线程执行到第一个挂起点后返回，结束时自动释放
+// 协程内未捕获的异常会导致 std::terminate（与 std::thread 相同）
+inline void spawn(task<void> t) {
+    auto d = detail::spawn_driver(std::move(t));
+    d.h.resume();
+}
+
+} // namespace coro
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Linux futex 的最小封装
+// std::atomic::wait 没有超时版本，而线程池的空闲回收需要“带超时的睡眠”，所以这里直接用系统调用
+namespace futex {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex word must be a plain 32-bit integer");
+
+// 如果 *word == expected，则睡眠直到被 wake 或超时，否则立即返回
+// 返回时不区分原因，调用方需要自己重新检查条件
+inline void wait(std::atomic<uint32_t> *word, uint32_t expected,
+                 std::chrono::nanoseconds timeout) {
+    if(timeout <= std::chrono::nanoseconds::zero()) return;
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+            expected, &ts, nullptr, 0);
+}
+
+// 无超时版本
+inline void wait(std::atomic<uint32_t> *word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+            expected, nullptr, nullptr, 0);
+}
+
+// 唤醒最多 n 个睡在 word 上的线程
+inline void wake(std::atomic<uint32_t> *word, int n) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE,
+            n, nullptr, nullptr, 0);
+}
+
+} // namespace futex
+
+#endif
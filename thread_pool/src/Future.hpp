@@ -0,0 +1,584 @@
+#ifndef THREAD_POOL_FUTURE_H
+#define THREAD_POOL_FUTURE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "Task.hpp"
+#include "v4.hpp"
+
+// 建立在 v4 ThreadPool 之上、可以挂 continuation 的 future / promise
+//
+//   auto a = fut::async(pool, load, 1);
+//   auto b = fut::async(pool, load, 2);
+//   auto c = fut::when_all(std::move(a), std::move(b))
+//                .then([](std::tuple<int, int> v) { return std::get<0>(v) + std::get<1>(v); });
+//   int v = c.get();   // 只有最外面的调用方阻塞，中间的每一步都不占线程
+//
+// std::future 只能用 get() 阻塞地取结果，汇聚 n 个结果就要有线程干等；这里改为结果就绪时推送：
+//   - then(f)：前驱就绪后把 f 作为一个普通任务提交给线程池，在 worker 上执行；
+//     f 本身返回 Future<U> 时结果自动展开成 Future<U>；前驱的异常跳过 f 直接传下去
+//   - when_all / when_any：汇聚时由完成前驱的那个线程顺手记一笔，不经过队列，也不占线程
+//   - get()：阻塞等待（futex），只给链条最外面的非 worker 线程用
+//
+// async() / then() 每一步只有一次堆分配，就是共享状态本身：continuation 以 Task 的形式保存在共享状态里，
+// Task 的内联缓冲区直接放下闭包（前驱和后继的两个指针 + f），就绪时整个 Task 搬进任务队列，不再复制也不分配；
+// 引用计数直接放在共享状态里，没有 shared_ptr 的控制块
+// when_all / when_any 不止一次：除了结果的共享状态，汇聚用的计数和暂存的值另外放在一个 make_shared 的
+// Shared 里（vector 版本的 when_all 暂存值的数组还要再分配一次），每个输入的 continuation 共享它
+namespace fut {
+
+template<typename T>
+class Future;
+template<typename T>
+class Promise;
+
+// Future<void> 的共享状态里保存的值；variadic when_all 的元组里 void 元素也用它占位
+struct Unit {};
+
+// when_any 的结果：最先完成的是第几个输入，以及它的值
+template<typename T>
+struct AnyResult {
+    std::size_t index;
+    T value;
+};
+template<>
+struct AnyResult<void> {
+    std::size_t index;
+};
+
+namespace detail {
+
+template<typename T>
+using stored_t = std::conditional_t<std::is_void_v<T>, Unit, T>;
+
+template<typename T>
+struct is_future : std::false_type {};
+template<typename T>
+struct is_future<Future<T>> : std::true_type {};
+
+inline std::exception_ptr broken_promise() {
+    return std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+}
+
+// 共享状态：结果（值或异常）+ 至多一个 continuation + 引用计数
+//
+// 结果和 continuation 可能由两个线程各自先到，用一个原子标志字“谁后到谁触发”：
+// 双方各自写好自己那一半，再 fetch_or 上自己的位；看到对方的位已经在的那一方负责执行 continuation
+template<typename T>
+class State {
+public:
+    explicit State(ThreadPool* pool) noexcept : pool_(pool) {}
+    State(const State&) = delete;
+    State& operator=(const State&) = delete;
+
+    void add_ref() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void release() noexcept {
+        if(refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    // 写入结果（每个状态只能写一次），publish() 之后其它线程才看得到
+    template<typename... A>
+    void store_value(A&&... a) { result_.template emplace<1>(std::forward<A>(a)...); }
+    void store_exception(std::exception_ptr e) noexcept { result_.template emplace<2>(std::move(e)); }
+
+    void publish() {
+        std::uint32_t prev = flags_.fetch_or(kValue, std::memory_order_acq_rel);
+        if(prev & kWaiter) flags_.notify_all();
+        if(prev & kCont) fire();
+    }
+
+    // 挂上 continuation（只能挂一次）；结果已经就绪时立即触发
+    // run_inline 为 true 时在发布结果的线程上直接执行（只用于 when_all 等内部的小闭包）
+    void set_continuation(Task t, bool run_inline) {
+        cont_ = std::move(t);
+        inline_ = run_inline;
+        if(flags_.fetch_or(kCont, std::memory_order_acq_rel) & kValue) fire();
+    }
+
+    bool ready() const noexcept { return flags_.load(std::memory_order_acquire) & kValue; }
+
+    void wait() {
+        std::uint32_t f = flags_.load(std::memory_order_acquire);
+        if(f & kValue) return;
+        // 先登记等待者，发布方只在看到这一位时才 notify，没人等的时候省掉一次系统调用
+        f = flags_.fetch_or(kWaiter, std::memory_order_acq_rel) | kWaiter;
+        while(!(f & kValue)) {
+            flags_.wait(f, std::memory_order_acquire);
+            f = flags_.load(std::memory_order_acquire);
+        }
+    }
+
+    // 以下只能在就绪之后调用
+    bool has_exception() const noexcept { return result_.index() == 2; }
+    std::exception_ptr exception() const { return std::get<2>(result_); }
+    stored_t<T>& value() { return std::get<1>(result_); }
+    T take() {
+        if(has_exception()) std::rethrow_exception(std::get<2>(result_));
+        if constexpr(!std::is_void_v<T>) return std::move(std::get<1>(result_));
+    }
+
+    ThreadPool* pool() const noexcept { return pool_; }
+
+private:
+    static constexpr std::uint32_t kValue = 1;   // 结果已发布
+    static constexpr std::uint32_t kCont = 2;    // continuation 已挂上
+    static constexpr std::uint32_t kWaiter = 4;  // 有线程在 wait()
+
+    // 没有线程池、线程池已经 stop() 或者队列满了，就在当前线程执行
+    void fire() {
+        Task t = std::move(cont_);
+        if(inline_ || !pool_ || !pool_->try_submit(t)) t();
+    }
+
+    ~State() = default;
+
+    std::atomic<std::uint32_t> refs_{1};
+    std::atomic<std::uint32_t> flags_{0};
+    bool inline_ = false;
+    ThreadPool* pool_;
+    std::variant<std::monostate, stored_t<T>, std::exception_ptr> result_;
+    Task cont_;
+};
+
+// 共享状态的侵入式引用
+template<typename T>
+class StateRef {
+public:
+    StateRef() noexcept = default;
+    explicit StateRef(State<T>* s) noexcept : s_(s) {}  // 接管一个引用
+    StateRef(const StateRef& o) noexcept : s_(o.s_) { if(s_) s_->add_ref(); }
+    StateRef(StateRef&& o) noexcept : s_(std::exchange(o.s_, nullptr)) {}
+    StateRef& operator=(StateRef o) noexcept {
+        std::swap(s_, o.s_);
+        return *this;
+    }
+    ~StateRef() { if(s_) s_->release(); }
+
+    State<T>* get() const noexcept { return s_; }
+    State<T>* operator->() const noexcept { return s_; }
+    State<T>& operator*() const noexcept { return *s_; }
+    explicit operator bool() const noexcept { return s_ != nullptr; }
+
+private:
+    State<T>* s_ = nullptr;
+};
+
+template<typename T>
+StateRef<T> make_state(ThreadPool* pool) {
+    return StateRef<T>(new State<T>(pool));
+}
+
+// 执行 g() 并把返回值或异常写进 s；publish() 放在 try 外面，continuation 里的异常不会被误当成 g() 的
+template<typename T, typename G>
+void fulfil(State<T>& s, G&& g) {
+    try {
+        if constexpr(std::is_void_v<T>) {
+            g();
+            s.store_value();
+        }
+        else {
+            s.store_value(g());
+        }
+    }
+    catch(...) {
+        s.store_exception(std::current_exception());
+    }
+    s.publish();
+}
+
+// 把 src 的结果原样转给 dst
+template<typename T>
+void forward_result(State<T>& src, State<T>& dst) {
+    if(src.has_exception()) dst.store_exception(src.exception());
+    else dst.store_value(std::move(src.value()));
+    dst.publish();
+}
+
+// then(f) 中 f 的返回类型：void 的前驱不传参数
+template<typename T, typename F>
+using invoke_t = typename std::conditional_t<std::is_void_v<T>, std::invoke_result<F&>,
+                                             std::invoke_result<F&, T>>::type;
+
+template<typename R>
+struct unwrap { using type = R; };
+template<typename U>
+struct unwrap<Future<U>> { using type = U; };
+
+template<typename T, typename F>
+using then_t = typename unwrap<invoke_t<T, F>>::type;
+
+// 取得 Future 的共享状态，combinator 用
+struct Access {
+    template<typename T>
+    static StateRef<T>& state(Future<T>& f) { return f.state_; }
+    template<typename T>
+    static Future<T> make(StateRef<T> s) { return Future<T>(std::move(s)); }
+};
+
+template<typename T>
+StateRef<T> take_state(Future<T>& f) {
+    StateRef<T> s = std::move(Access::state(f));
+    if(!s) throw std::future_error(std::future_errc::no_state);
+    return s;
+}
+
+// 没来得及执行就被销毁（例如线程池拒绝了任务）的 producer / continuation 把后继标记为 broken_promise，
+// 免得等在后继上的人永远等下去
+template<typename R, typename Fn>
+struct Producer {
+    StateRef<R> dst;
+    Fn fn;
+
+    Producer(StateRef<R> d, Fn f) : dst(std::move(d)), fn(std::move(f)) {}
+    Producer(Producer&&) noexcept = default;
+    ~Producer() {
+        if(dst) {
+            dst->store_exception(broken_promise());
+            dst->publish();
+        }
+    }
+
+    void operator()() {
+        StateRef<R> out = std::move(dst);
+        fulfil(*out, fn);
+    }
+};
+
+template<typename T, typename Fn>
+struct Continuation {
+    using Result = invoke_t<T, Fn>;
+    using R = then_t<T, Fn>;
+
+    StateRef<T> src;
+    StateRef<R> dst;
+    Fn fn;
+
+    Continuation(StateRef<T> s, StateRef<R> d, Fn f)
+        : src(std::move(s)), dst(std::move(d)), fn(std::move(f)) {}
+    Continuation(Continuation&&) noexcept = default;
+    ~Continuation() {
+        if(dst) {
+            dst->store_exception(broken_promise());
+            dst->publish();
+        }
+    }
+
+    void operator()() {
+        StateRef<R> out = std::move(dst);
+        if(src->has_exception()) {
+            out->store_exception(src->exception());
+            out->publish();
+            return;
+        }
+        auto call = [this]() -> Result {
+            if constexpr(std::is_void_v<T>) return std::invoke(fn);
+            else return std::invoke(fn, std::move(src->value()));
+        };
+        if constexpr(is_future<Result>::value) {
+            // f 返回了另一个 Future：等它就绪后把结果转过来，中间仍然不占线程
+            StateRef<R> inner;
+            try {
+                Result f = call();
+                inner = take_state(f);
+            }
+            catch(...) {
+                out->store_exception(std::current_exception());
+                out->publish();
+                return;
+            }
+            State<R>* p = inner.get();
+            p->set_continuation(Task([in = std::move(inner), out = std::move(out)] { forward_result(*in, *out); }),
+                                true);
+        }
+        else {
+            fulfil(*out, call);
+        }
+    }
+};
+
+} // namespace detail
+
+// 只可移动；then() / get() 都会消耗这个 Future（之后 valid() 为 false）
+template<typename T>
+class Future {
+public:
+    using value_type = T;
+
+    Future() noexcept = default;
+    Future(Future&&) noexcept = default;
+    Future& operator=(Future&&) noexcept = default;
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    bool valid() const noexcept { return static_cast<bool>(state_); }
+    bool ready() const noexcept { return state_ && state_->ready(); }
+
+    // 阻塞等待结果，异常在这里重新抛出；在 worker 里调用会占住这个 worker，应该改用 then()
+    T get() {
+        detail::StateRef<T> s = detail::take_state(*this);
+        s->wait();
+        return s->take();
+    }
+
+    // 前驱就绪后在线程池的 worker 上执行 f(value)（Future<void> 执行 f()）
+    // f 抛出的异常在返回的 Future 中传出；前驱带着异常时跳过 f，异常原样传给返回的 Future
+    template<typename F>
+    Future<detail::then_t<T, std::decay_t<F>>> then(F&& f) {
+        using Fn = std::decay_t<F>;
+        using R = detail::then_t<T, Fn>;
+        detail::StateRef<T> src = detail::take_state(*this);
+        detail::StateRef<R> next = detail::make_state<R>(src->pool());
+        detail::State<T>* p = src.get();
+        p->set_continuation(Task(detail::Continuation<T, Fn>(std::move(src), next, std::forward<F>(f))), false);
+        return Future<R>(std::move(next));
+    }
+
+private:
+    template<typename>
+    friend class Future;
+    friend class Promise<T>;
+    friend struct detail::Access;
+
+    explicit Future(detail::StateRef<T> s) noexcept : state_(std::move(s)) {}
+
+    detail::StateRef<T> state_;
+};
+
+// 手动完成的 Future：continuation 提交给构造时给出的线程池，不给线程池时在完成它的线程上执行
+// 没有完成就被销毁时，Future 拿到 std::future_errc::broken_promise
+template<typename T>
+class Promise {
+public:
+    Promise() : state_(detail::make_state<T>(nullptr)) {}
+    explicit Promise(ThreadPool& pool) : state_(detail::make_state<T>(&pool)) {}
+    Promise(Promise&&) noexcept = default;
+    Promise& operator=(Promise&& o) noexcept {
+        if(this != &o) {
+            abandon();
+            state_ = std::move(o.state_);
+            retrieved_ = o.retrieved_;
+        }
+        return *this;
+    }
+    ~Promise() { abandon(); }
+
+    // 只能调用一次
+    Future<T> get_future() {
+        if(!state_) throw std::future_error(std::future_errc::no_state);
+        if(retrieved_) throw std::future_error(std::future_errc::future_already_retrieved);
+        retrieved_ = true;
+        return Future<T>(state_);
+    }
+
+    template<typename... A>
+    void set_value(A&&... a) {
+        detail::StateRef<T> s = take();
+        s->store_value(std::forward<A>(a)...);
+        s->publish();
+    }
+
+    void set_exception(std::exception_ptr e) {
+        detail::StateRef<T> s = take();
+        s->store_exception(std::move(e));
+        s->publish();
+    }
+
+private:
+    detail::StateRef<T> take() {
+        if(!state_) throw std::future_error(std::future_errc::promise_already_satisfied);
+        return std::move(state_);
+    }
+
+    void abandon() {
+        if(state_) {
+            detail::StateRef<T> s = std::move(state_);
+            s->store_exception(detail::broken_promise());
+            s->publish();
+        }
+    }
+
+    detail::StateRef<T> state_;
+    bool retrieved_ = false;
+};
+
+// 把 f(args...) 提交给线程池，返回它的 Future
+// 与 add_task 一样：线程池已经 stop() 时抛出 std::runtime_error，队列满时按 overflow 策略处理
+template<typename F, typename... Args>
+auto async(ThreadPool& pool, F&& f, Args&&... args) -> Future<std::invoke_result_t<F, Args...>> {
+    using R = std::invoke_result_t<F, Args...>;
+    using Bound = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    detail::StateRef<R> s = detail::make_state<R>(&pool);
+    Future<R> res = detail::Access::make(s);
+    pool.add_task(detail::Producer<R, Bound>(std::move(s), std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+    return res;
+}
+
+// 已经就绪的 Future；没有线程池，挂在它上面的 then() 在调用 then() 的线程上执行
+template<typename T>
+Future<std::decay_t<T>> make_ready_future(T&& v) {
+    Promise<std::decay_t<T>> p;
+    Future<std::decay_t<T>> f = p.get_future();
+    p.set_value(std::forward<T>(v));
+    return f;
+}
+inline Future<void> make_ready_future() {
+    Promise<void> p;
+    Future<void> f = p.get_future();
+    p.set_value();
+    return f;
+}
+
+// 全部就绪后得到所有的值（按输入顺序）；任何一个带着异常，结果就是最先到达的那个异常，不再等其它的
+// 结果的 continuation 提交给第一个输入所属的线程池
+template<typename T>
+auto when_all(std::vector<Future<T>> fs)
+        -> Future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> {
+    using R = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+    std::vector<detail::StateRef<T>> in;
+    in.reserve(fs.size());
+    for(auto& f : fs) in.push_back(detail::take_state(f));
+    detail::StateRef<R> out = detail::make_state<R>(in.empty() ? nullptr : in.front()->pool());
+    Future<R> res = detail::Access::make(out);
+    if(in.empty()) {
+        detail::fulfil(*out, [] { return R(); });
+        return res;
+    }
+
+    // 汇聚状态单独分配（见文件开头）；vector 版本里暂存值的 values 还会再分配一次
+    struct Shared {
+        std::atomic<std::size_t> remaining;
+        std::atomic<bool> failed{false};
+        std::vector<std::optional<detail::stored_t<T>>> values;
+        detail::StateRef<R> out;
+    };
+    auto sh = std::make_shared<Shared>();
+    sh->remaining.store(in.size(), std::memory_order_relaxed);
+    if constexpr(!std::is_void_v<T>) sh->values.resize(in.size());
+    sh->out = std::move(out);
+
+    for(std::size_t i = 0; i < in.size(); i ++ ) {
+        detail::State<T>* p = in[i].get();
+        p->set_continuation(Task([src = std::move(in[i]), sh, i] {
+            if(src->has_exception()) {
+                if(!sh->failed.exchange(true, std::memory_order_acq_rel)) {
+                    sh->out->store_exception(src->exception());
+                    sh->out->publish();
+                }
+            }
+            else if constexpr(!std::is_void_v<T>) {
+                sh->values[i].emplace(std::move(src->value()));
+            }
+            // 失败的一方先置 failed 再减计数，最后一个减到 0 的一定看得到
+            if(sh->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1 ||
+               sh->failed.load(std::memory_order_relaxed)) {
+                return;
+            }
+            detail::fulfil(*sh->out, [&]() -> R {
+                if constexpr(!std::is_void_v<T>) {
+                    std::vector<T> v;
+                    v.reserve(sh->values.size());
+                    for(auto& x : sh->values) v.push_back(std::move(*x));
+                    return v;
+                }
+            });
+        }), true);
+    }
+    return res;
+}
+
+// 异构版本：结果是各个值组成的 tuple（Future<void> 的位置是 Unit）
+template<typename... T>
+auto when_all(Future<T>... fs) -> Future<std::tuple<detail::stored_t<T>...>> {
+    static_assert(sizeof...(T) > 0, "when_all needs at least one future");
+    using R = std::tuple<detail::stored_t<T>...>;
+    std::tuple<detail::StateRef<T>...> in{detail::take_state(fs)...};
+    ThreadPool* pool = std::get<0>(in)->pool();
+
+    // 汇聚状态单独分配（见文件开头）
+    struct Shared {
+        std::atomic<std::size_t> remaining{sizeof...(T)};
+        std::atomic<bool> failed{false};
+        std::tuple<std::optional<detail::stored_t<T>>...> values;
+        detail::StateRef<R> out;
+    };
+    auto sh = std::make_shared<Shared>();
+    sh->out = detail::make_state<R>(pool);
+    Future<R> res = detail::Access::make(sh->out);
+
+    auto attach = [&]<std::size_t I>(std::integral_constant<std::size_t, I>) {
+        auto& ref = std::get<I>(in);
+        auto* p = ref.get();
+        p->set_continuation(Task([src = std::move(ref), sh] {
+            if(src->has_exception()) {
+                if(!sh->failed.exchange(true, std::memory_order_acq_rel)) {
+                    sh->out->store_exception(src->exception());
+                    sh->out->publish();
+                }
+            }
+            else {
+                std::get<I>(sh->values).emplace(std::move(src->value()));
+            }
+            if(sh->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1 ||
+               sh->failed.load(std::memory_order_relaxed)) {
+                return;
+            }
+            detail::fulfil(*sh->out, [&] {
+                return std::apply([](auto&... v) { return R(std::move(*v)...); }, sh->values);
+            });
+        }), true);
+    };
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (attach(std::integral_constant<std::size_t, I>{}), ...);
+    }(std::index_sequence_for<T...>{});
+    return res;
+}
+
+// 最先就绪的那一个：它带着异常时结果就是这个异常；其它输入的结果被丢弃
+// fs 不能为空
+template<typename T>
+Future<AnyResult<T>> when_any(std::vector<Future<T>> fs) {
+    if(fs.empty()) throw std::invalid_argument("when_any: no futures");
+    std::vector<detail::StateRef<T>> in;
+    in.reserve(fs.size());
+    for(auto& f : fs) in.push_back(detail::take_state(f));
+
+    // 汇聚状态单独分配（见文件开头）
+    struct Shared {
+        std::atomic<bool> done{false};
+        detail::StateRef<AnyResult<T>> out;
+    };
+    auto sh = std::make_shared<Shared>();
+    sh->out = detail::make_state<AnyResult<T>>(in.front()->pool());
+    Future<AnyResult<T>> res = detail::Access::make(sh->out);
+
+    for(std::size_t i = 0; i < in.size(); i ++ ) {
+        detail::State<T>* p = in[i].get();
+        p->set_continuation(Task([src = std::move(in[i]), sh, i] {
+            if(sh->done.exchange(true, std::memory_order_acq_rel)) return;
+            // 只有赢家会走到这里，之后没有人再访问 sh->out，直接交出去
+            detail::StateRef<AnyResult<T>> out = std::move(sh->out);
+            if(src->has_exception()) out->store_exception(src->exception());
+            else if constexpr(std::is_void_v<T>) out->store_value(AnyResult<T>{i});
+            else out->store_value(AnyResult<T>{i, std::move(src->value())});
+            out->publish();
+        }), true);
+    }
+    return res;
+}
+
+} // namespace fut
+
+#endif
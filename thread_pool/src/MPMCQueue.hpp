@@ -0,0 +1,118 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// 缓存行大小，用于隔开生产者/消费者各自频繁写的原子变量，避免伪共享
+// 注：std::hardware_destructive_interference_size 在 GCC 下会给出 ABI 警告，这里直接写 64
+inline constexpr std::size_t kCacheLine = 64;
+
+// 有界的无锁多生产者多消费者环形队列（Dmitry Vyukov 的序号槽位算法）
+//
+// 每个槽位带一个序号 seq：
+//   - seq == pos       : 槽位空闲，等待位置为 pos 的生产者写入
+//   - seq == pos + 1   : 槽位已写入，等待位置为 pos 的消费者读取
+//   - 消费者读完后把 seq 置为 pos + capacity，即下一圈的生产者位置
+// 生产者只竞争 tail_，消费者只竞争 head_，两者在不同的缓存行上
+template<typename T>
+class MPMCQueue {
+public:
+    // capacity 会向上取整到 2 的幂，方便用掩码取模
+    explicit MPMCQueue(std::size_t capacity) {
+        if(capacity < 2) capacity = 2;
+        std::size_t cap = 1;
+        while(cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_ = std::make_unique<Slot[]>(cap);
+        for(std::size_t i = 0; i < cap; i ++ ) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~MPMCQueue() {
+        T tmp;
+        while(try_pop(tmp)) {}
+    }
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // 队列满时返回 false，且 item 不会被移走
+    bool try_push(T &&item) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for(;;) {
+            Slot &slot = slots_[pos & mask_];
+            std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if(diff == 0) {
+                // 槽位空闲，抢占这个位置
+                if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(slot.storage)) T(std::move(item));
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+                // CAS 失败时 pos 已被更新为最新值，重试
+            }
+            else if(diff < 0) {
+                // 这个槽位上一圈的数据还没被消费：队列已满
+                return false;
+            }
+            else {
+                // 被其它生产者抢先了，重新读取 tail_
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 队列空时返回 false
+    bool try_pop(T &item) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for(;;) {
+            Slot &slot = slots_[pos & mask_];
+            std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if(diff == 0) {
+                if(head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T *p = std::launder(reinterpret_cast<T*>(slot.storage));
+                    item = std::move(*p);
+                    p->~T();
+                    slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(diff < 0) {
+                // 生产者还没写到这里：队列为空
+                return false;
+            }
+            else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 近似元素个数（并发下只是一个快照）
+    std::size_t size_approx() const {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct alignas(kCacheLine) Slot {
+        std::atomic<std::size_t> seq{0};
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    alignas(kCacheLine) std::atomic<std::size_t> tail_{0}; // 生产者位置
+    alignas(kCacheLine) std::atomic<std::size_t> head_{0}; // 消费者位置
+    alignas(kCacheLine) std::size_t mask_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+// NUMA 拓扑与 CPU 亲和性的最小封装
+// 不依赖 libnuma，直接读 /sys/devices/system/node，读不到时退化为“只有一个节点”
+namespace numa {
+
+struct Node {
+    int id = 0;
+    std::vector<int> cpus;       // 该节点上的 CPU 编号
+    std::vector<int> distance;   // 到各节点的距离（按节点下标），读不到时为空
+};
+
+// 解析 "0-3,8,10-11" 这种 cpulist 格式
+inline std::vector<int> parse_cpulist(const std::string& s) {
+    std::vector<int> cpus;
+    std::stringstream ss(s);
+    std::string part;
+    while(std::getline(ss, part, ',')) {
+        if(part.empty() || part == "\n") continue;
+        auto dash = part.find('-');
+        try {
+            int lo = std::stoi(part.substr(0, dash));
+            int hi = dash == std::string::npos ? lo : std::stoi(part.substr(dash + 1));
+            for(int c = lo; c <= hi; c ++ ) cpus.push_back(c);
+        }
+        catch(const std::exception&) {
+            // 格式不对的片段直接忽略
+        }
+    }
+    return cpus;
+}
+
+// 当前进程允许运行的 CPU（受 taskset / cgroup 限制）
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for(int c = 0; c < CPU_SETSIZE; c ++ ) {
+            if(CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    return cpus;
+}
+
+// 读取系统的 NUMA 节点，只保留当前进程允许使用的 CPU，没有 CPU 的节点会被丢弃
+inline std::vector<Node> nodes() {
+    std::vector<int> allowed = allowed_cpus();
+    auto is_allowed = [&](int c) {
+        return allowed.empty() || std::find(allowed.begin(), allowed.end(), c) != allowed.end();
+    };
+
+    std::vector<Node> result;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string line;
+    if(online && std::getline(online, line)) {
+        for(int id : parse_cpulist(line)) {
+            std::string dir = "/sys/devices/system/node/node" + std::to_string(id);
+            std::ifstream cpulist(dir + "/cpulist");
+            std::string cl;
+            if(!cpulist || !std::getline(cpulist, cl)) continue;
+            Node n;
+            n.id = id;
+            for(int c : parse_cpulist(cl)) {
+                if(is_allowed(c)) n.cpus.push_back(c);
+            }
+            std::ifstream dist(dir + "/distance");
+            for(int d; dist >> d; ) n.distance.push_back(d);
+            if(!n.cpus.empty()) result.push_back(std::move(n));
+        }
+    }
+    if(result.empty()) {
+        Node n;
+        n.cpus = allowed;
+        result.push_back(std::move(n));
+    }
+    return result;
+}
+
+// 把当前线程绑定到 cpus 上，cpus 为空或绑定失败时返回 false（线程照常运行，只是不绑核）
+inline bool pin_current_thread(const std::vector<int>& cpus) {
+    if(cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int c : cpus) {
+        if(c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+} // namespace numa
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef THREAD_POOL_PARALLEL_H
+#define THREAD_POOL_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Backoff.hpp"
+#include "v4.hpp"
+
+// 建立在 v4 ThreadPool 之上的 fork-join 接口：TaskGroup、parallel_for、parallel_reduce、TaskGraph
+//
+// 所有等待都是协作式的：等待者（无论是 worker 还是外部线程）在任务组完成之前
+// 不断用 ThreadPool::try_run_one() 帮忙执行队列里的任务，队列里没有可做的任务时才短暂睡眠。
+// 所以在 worker 里嵌套 parallel_for 不会占着线程干等，线程数再少也不会死锁
+// （嵌套太深时每一层都会占用当前线程的一段栈）
+
+// 一组任务：run() 提交，wait() 协作式等待全部完成
+//   - 任务抛出的第一个异常在 wait() 中重新抛出，之后组内尚未开始的任务不再执行
+//   - 析构前必须 wait()（任务里引用着这个对象）
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+    ~TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // 提交一个任务；线程池已经 stop() 或队列已满时直接在当前线程执行
+    template<typename F>
+    void run(F&& f) {
+        TaskQueue::Task t([this, fn = std::forward<F>(f)]() mutable { finish(fn); });
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        if(!pool_.try_submit(t)) t();  // t() 完成时会把 pending_ 减一
+    }
+
+    // 一次提交 n 个任务，gen(i) 返回第 i 个可调用对象；整批只加一次锁（见 add_batch_task）
+    // 没能入队的任务（线程池已停止、队列已满）在当前线程执行
+    template<typename Gen>
+    void run_n(std::size_t n, Gen&& gen) {
+        if(n == 0) return;
+        std::vector<TaskQueue::Task> batch;
+        batch.reserve(n);
+        for(std::size_t i = 0; i < n; i ++ ) {
+            batch.emplace_back([this, fn = gen(i)]() mutable { finish(fn); });
+        }
+        pending_.fetch_add(n, std::memory_order_relaxed);
+        std::exception_ptr spawn_error;
+        try {
+            pool_.add_batch_task(std::move(batch));
+        }
+        catch(const std::system_error&) {
+            spawn_error = std::current_exception();  // 任务已经入队，只是扩容时创建线程失败
+        }
+        catch(const std::runtime_error&) {
+        }
+        // 已经入队的元素被移走了，剩下的就是被拒绝的；每个 t() 完成时都会把 pending_ 减一
+        for(auto& t : batch) {
+            if(t) t();
+        }
+        if(spawn_error) {
+            // 入队的任务引用着本对象（parallel_for 里还有调用者的 f），等它们全部结束再把异常抛出去；
+            // 任务自己的异常留给之后的 wait()
+            wait_idle();
+            std::rethrow_exception(spawn_error);
+        }
+    }
+
+    // 在当前线程执行 f，然后等待组内其它任务
+    template<typename F>
+    void run_and_wait(F&& f) {
+        invoke(f);
+        wait();
+    }
+
+    void wait() {
+        wait_idle();
+        std::lock_guard<std::mutex> lock(mtx_);
+        if(error_) std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+    // 是否已经有任务抛出异常（之后未开始的任务会被跳过）
+    bool failed() const noexcept { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    friend class TaskGraph;
+    static constexpr int kSpinRounds = 8;
+
+    // 等待组内任务全部结束，不抛出任务的异常
+    void wait_idle() {
+        using namespace std::chrono_literals;
+        Backoff backoff;
+        int idle_rounds = 0;
+        while(pending_.load(std::memory_order_acquire) != 0) {
+            if(pool_.try_run_one()) {
+                backoff.reset();
+                idle_rounds = 0;
+                continue;
+            }
+            if(++ idle_rounds < kSpinRounds) {
+                backoff.pause();
+                continue;
+            }
+            // 暂时没有可以帮忙的任务（剩下的都在别的线程上执行），睡一小会儿再看
+            // 组内最后一个任务完成时会提前唤醒；不能一直睡，期间可能又有新任务入队
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_.wait_for(lock, 200us, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+        }
+        // 最后一个任务在 mtx_ 下完成计数和唤醒，这里拿一次锁，保证它已经不再访问本对象
+        std::lock_guard<std::mutex> lock(mtx_);
+    }
+
+    // 执行 f 并捕获异常，组已经失败时直接跳过
+    template<typename F>
+    void invoke(F& f) {
+        if(failed()) return;
+        try {
+            f();
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if(!error_) error_ = std::current_exception();
+            failed_.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename F>
+    void finish(F& f) {
+        invoke(f);
+        std::lock_guard<std::mutex> lock(mtx_);
+        if(pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) cond_.notify_all();
+    }
+
+    ThreadPool& pool_;
+    std::atomic<std::size_t> pending_{0};  // 已提交、尚未完成的任务数
+    std::atomic<bool> failed_{false};
+    std::mutex mtx_;  // 保护 error_，并与 wait() 的最后一次检查同步
+    std::condition_variable cond_;
+    std::exception_ptr error_;
+};
+
+namespace detail {
+
+// f(lo, hi) 形式的区间版本，或者 f(i) 形式的逐个版本
+template<typename Index, typename F>
+void call_range(F& f, Index lo, Index hi) {
+    if constexpr (std::is_invocable_v<F&, Index, Index>) {
+        f(lo, hi);
+    }
+    else {
+        for(Index i = lo; i < hi; ++ i) f(i);
+    }
+}
+
+// 把 [first, last) 按 grain 切成若干块，返回块数
+template<typename Index>
+std::size_t chunk_count(Index first, Index last, Index grain) {
+    if(!(first < last)) return 0;
+    auto n = static_cast<std::size_t>(last - first);
+    auto g = static_cast<std::size_t>(std::max<Index>(grain, Index(1)));
+    return (n + g - 1) / g;
+}
+
+template<typename Index>
+std::pair<Index, Index> chunk_at(Index first, Index last, Index grain, std::size_t k) {
+    Index g = std::max<Index>(grain, Index(1));
+    Index lo = static_cast<Index>(first + static_cast<Index>(k) * g);
+    Index hi = last - lo > g ? static_cast<Index>(lo + g) : last;
+    return {lo, hi};
+}
+
+} // namespace detail
+
+// 对 [first, last) 并行执行 f，每 grain 个下标一个任务
+//   - f 可以是 f(i)，也可以是 f(lo, hi)（每块调用一次，适合块内还有自己的循环）
+//   - 最后一块由调用者自己执行，其余整批提交给 pool，然后协作式等待
+//   - 任意一块抛出的异常在所有块结束之后重新抛出
+template<typename Index, typename F>
+void parallel_for(ThreadPool& pool, Index first, std::type_identity_t<Index> last,
+                  std::type_identity_t<Index> grain, F&& f) {
+    std::size_t chunks = detail::chunk_count(first, last, grain);
+    if(chunks == 0) return;
+    if(chunks == 1) {
+        detail::call_range(f, first, last);
+        return;
+    }
+    TaskGroup group(pool);
+    group.run_n(chunks - 1, [&](std::size_t k) {
+        return [&f, r = detail::chunk_at(first, last, grain, k)] { detail::call_range(f, r.first, r.second); };
+    });
+    auto tail = detail::chunk_at(first, last, grain, chunks - 1);
+    group.run_and_wait([&] { detail::call_range(f, tail.first, tail.second); });
+}
+
+// 并行归约：每块 f(lo, hi) 算出一个部分结果，再按块的顺序用 combine 从 init 开始合并
+// 合并顺序固定，所以浮点求和之类的结果与线程调度无关（但与 grain 有关）
+template<typename Index, typename T, typename F, typename Combine>
+T parallel_reduce(ThreadPool& pool, Index first, std::type_identity_t<Index> last,
+                  std::type_identity_t<Index> grain, T init, F&& f, Combine&& combine) {
+    std::size_t chunks = detail::chunk_count(first, last, grain);
+    std::vector<std::optional<T>> partial(chunks);
+    if(chunks > 0) {
+        TaskGroup group(pool);
+        group.run_n(chunks - 1, [&](std::size_t k) {
+            return [&f, &partial, k, r = detail::chunk_at(first, last, grain, k)] {
+                partial[k].emplace(f(r.first, r.second));
+            };
+        });
+        auto tail = detail::chunk_at(first, last, grain, chunks - 1);
+        group.run_and_wait([&] { partial[chunks - 1].emplace(f(tail.first, tail.second)); });
+    }
+    for(auto& p : partial) init = combine(std::move(init), std::move(*p));
+    return init;
+}
+
+// 有依赖关系的任务图：所有前驱完成之后，后继才会被调度
+//
+//   TaskGraph g;
+//   auto load  = g.emplace([]{ ... });
+//   auto score = g.emplace([]{ ... });
+//   g.precede(load, score);
+//   g.run(pool);  // 协作式等待整张图执行完
+//
+// 一个节点完成时，第一个变为就绪的后继直接在当前线程接着执行，其余的提交给线程池
+// 图可以反复 run()，但同一张图不能同时 run() 两次，run() 期间也不能修改
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+
+    template<typename F>
+    NodeId emplace(F&& f) {
+        nodes_.emplace_back();
+        nodes_.back().fn = Task(std::forward<F>(f));
+        return nodes_.size() - 1;
+    }
+
+    // before 完成之后 after 才能开始
+    void precede(NodeId before, NodeId after) {
+        if(before >= nodes_.size() || after >= nodes_.size()) {
+            throw std::out_of_range("TaskGraph::precede: no such node");
+        }
+        nodes_[before].succ.push_back(after);
+        nodes_[after].n_pred ++ ;
+    }
+
+    std::size_t size() const noexcept { return nodes_.size(); }
+
+    // 执行整张图并等待完成
+    //   - 图中有环时抛出 std::logic_error，一个节点都不会执行
+    //   - 节点抛出的第一个异常会被重新抛出，之后尚未开始的节点不再执行
+    void run(ThreadPool& pool) {
+        check_acyclic();
+        std::vector<NodeId> roots;
+        for(NodeId i = 0; i < nodes_.size(); i ++ ) {
+            nodes_[i].remaining.store(nodes_[i].n_pred, std::memory_order_relaxed);
+            if(nodes_[i].n_pred == 0) roots.push_back(i);
+        }
+        if(roots.empty()) return;
+
+        TaskGroup group(pool);
+        group.run_n(roots.size() - 1, [&](std::size_t k) {
+            return [this, &group, id = roots[k]] { execute(group, id); };
+        });
+        group.run_and_wait([&] { execute(group, roots.back()); });
+    }
+
+private:
+    static constexpr NodeId kNone = static_cast<NodeId>(-1);
+
+    struct Node {
+        Task fn;
+        std::vector<NodeId> succ;
+        std::size_t n_pred = 0;
+        std::atomic<std::size_t> remaining{0};  // 本次 run() 中还没完成的前驱数
+    };
+
+    // 执行 id，然后沿着就绪的后继一路执行下去
+    void execute(TaskGroup& group, NodeId id) {
+        while(id != kNone) {
+            Node& n = nodes_[id];
+            group.invoke(n.fn);
+            NodeId next = kNone;
+            for(NodeId s : n.succ) {
+                if(nodes_[s].remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+                if(next == kNone) {
+                    next = s;
+                }
+                else {
+                    group.run([this, &group, s] { execute(group, s); });
+                }
+            }
+            id = next;
+        }
+    }
+
+    // Kahn 拓扑排序，能排完所有节点就说明无环
+    void check_acyclic() const {
+        std::vector<std::size_t> indeg(nodes_.size());
+        std::vector<NodeId> ready;
+        for(NodeId i = 0; i < nodes_.size(); i ++ ) {
+            indeg[i] = nodes_[i].n_pred;
+            if(indeg[i] == 0) ready.push_back(i);
+        }
+        std::size_t seen = 0;
+        while(!ready.empty()) {
+            NodeId i = ready.back();
+            ready.pop_back();
+            ++ seen;
+            for(NodeId s : nodes_[i].succ) {
+                if(-- indeg[s] == 0) ready.push_back(s);
+            }
+        }
+        if(seen != nodes_.size()) throw std::logic_error("TaskGraph::run: graph has a cycle");
+    }
+
+    std::deque<Node> nodes_;  // deque：emplace_back 不移动已有节点（Node 里有原子量）
+};
+
+#endif
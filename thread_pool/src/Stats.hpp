@@ -0,0 +1,178 @@
+#ifndef THREAD_POOL_STATS_H
+#define THREAD_POOL_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "Task.hpp"
+
+// 编译期开关：定义为 0 时所有统计代码都被编译掉，stats() 返回全 0 的快照
+#ifndef THREAD_POOL_ENABLE_STATS
+#define THREAD_POOL_ENABLE_STATS 1
+#endif
+
+// 对数分桶直方图（HDR 风格）：每个 2 的幂区间再均分为 2^kSubBits 个子桶，
+// 任意值的相对误差不超过 1 / 2^kSubBits，整个 uint64 范围只要 256 个桶
+//
+// 每个 worker 独占一个直方图，只有它自己写入，所以 record() 用 relaxed 的 load + store，
+// 不需要带 lock 前缀的原子加；其它线程随时可以读出一个（近似一致的）快照
+class LogHistogram {
+public:
+    static constexpr int kSubBits = 2;
+    static constexpr std::size_t kBuckets = 256;
+
+    static std::size_t index_of(std::uint64_t v) noexcept {
+        if(v < (1u << kSubBits)) return static_cast<std::size_t>(v);
+        int msb = 63 - std::countl_zero(v);
+        std::uint64_t sub = (v >> (msb - kSubBits)) & ((1u << kSubBits) - 1);
+        return (static_cast<std::size_t>(msb - kSubBits + 1) << kSubBits) + sub;
+    }
+
+    // 第 idx 个桶的下界（包含）
+    static std::uint64_t lower_bound_of(std::size_t idx) noexcept {
+        if(idx < (1u << kSubBits)) return idx;
+        int msb = static_cast<int>(idx >> kSubBits) + kSubBits - 1;
+        std::uint64_t sub = idx & ((1u << kSubBits) - 1);
+        return (std::uint64_t{1} << msb) + (sub << (msb - kSubBits));
+    }
+
+    // 只能由拥有者线程调用
+    void record(std::uint64_t v) noexcept {
+        bump(buckets_[index_of(v)], 1);
+        bump(count_, 1);
+        bump(sum_, v);
+        if(v > max_.load(std::memory_order_relaxed)) max_.store(v, std::memory_order_relaxed);
+    }
+
+    template<typename Snapshot>
+    void merge_into(Snapshot& out) const noexcept {
+        for(std::size_t i = 0; i < kBuckets; i ++ ) {
+            out.buckets[i] += buckets_[i].load(std::memory_order_relaxed);
+        }
+        out.count += count_.load(std::memory_order_relaxed);
+        out.sum += sum_.load(std::memory_order_relaxed);
+        out.max = std::max(out.max, max_.load(std::memory_order_relaxed));
+    }
+
+private:
+    static void bump(std::atomic<std::uint64_t>& a, std::uint64_t d) noexcept {
+        a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, kBuckets> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+// 合并之后的直方图，单位是纳秒
+struct HistogramSnapshot {
+    std::array<std::uint64_t, LogHistogram::kBuckets> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+    // p 取 [0, 1]，返回该分位所在桶的上界（不超过 max）
+    std::uint64_t percentile(double p) const {
+        if(count == 0) return 0;
+        auto target = static_cast<std::uint64_t>(p * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < buckets.size(); i ++ ) {
+            seen += buckets[i];
+            if(seen >= target) {
+                std::uint64_t upper = i + 1 < buckets.size() ? LogHistogram::lower_bound_of(i + 1) - 1 : max;
+                return std::min(upper, max);
+            }
+        }
+        return max;
+    }
+};
+
+// 每个 worker 一份，worker 退出后留给下一个新 worker 复用，数据一直累加
+struct WorkerStats {
+    LogHistogram queue_wait;  // 提交到开始执行
+    LogHistogram exec_time;   // 执行耗时
+};
+
+// stats() 返回的快照
+struct ThreadPoolStats {
+    bool enabled = false;             // 编译时是否打开了 THREAD_POOL_ENABLE_STATS
+    HistogramSnapshot queue_wait;     // 普通/优先级/QoS/future 任务的排队时间（延时、批量任务以及放不进内联缓冲区的 future 任务不计）
+    HistogramSnapshot exec_time;      // 所有任务的执行耗时
+    std::uint64_t grow_events = 0;      // try_expand_workers 真正扩容的次数
+    std::uint64_t threads_started = 0;  // 累计创建的 worker 数（含初始的核心线程）
+    std::uint64_t threads_retired = 0;  // 因空闲超时被回收的 worker 数
+    int active_threads = 0;  // 含停放的线程
+    int parked_threads = 0;  // 打开 ScalingPolicy 时停放的线程数
+    int pending = 0;
+};
+
+namespace detail {
+
+inline std::int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 当前 worker 的统计槽位，以及它开始执行当前任务的时间
+inline thread_local WorkerStats* tls_worker_stats = nullptr;
+inline thread_local std::int64_t tls_task_start_ns = 0;
+
+// 给可调用对象打上提交时间戳，开始执行时把排队时间记入当前 worker 的直方图
+// 只多 8 字节，一般的 lambda/bind 仍然放得进 Task 的内联缓冲区
+template<typename F>
+struct Stamped {
+    std::int64_t enqueue_ns;
+    F fn;
+
+    template<typename... A>
+    decltype(auto) operator()(A&&... args) {
+        if(WorkerStats* ws = tls_worker_stats) {
+            std::int64_t wait = tls_task_start_ns - enqueue_ns;
+            ws->queue_wait.record(wait > 0 ? static_cast<std::uint64_t>(wait) : 0);
+        }
+        return std::invoke(fn, std::forward<A>(args)...);
+    }
+};
+
+} // namespace detail
+
+// 关闭统计时原样返回，不改变任务的类型和大小
+template<typename F>
+auto stamp_task(F&& f) {
+#if THREAD_POOL_ENABLE_STATS
+    return detail::Stamped<std::decay_t<F>>{detail::now_ns(), std::forward<F>(f)};
+#else
+    return std::forward<F>(f);
+#endif
+}
+
+// 带时间戳的 make_future_task
+// promise 本身就占了 24 字节，再加 8 字节时间戳可能放不进 Task 的内联缓冲区；
+// 这种情况下宁可不统计这个任务的排队时间，也不为它多一次堆分配
+template<typename F, typename... Args>
+auto make_stamped_future_task(F&& f, Args&&... args) {
+#if THREAD_POOL_ENABLE_STATS
+    using R = std::invoke_result_t<F, Args...>;
+    using S = detail::Stamped<std::decay_t<F>>;
+    using Bound = decltype(std::bind(std::declval<S>(), std::declval<Args>()...));
+    if constexpr (Task::fits_inline<detail::PromiseTask<R, Bound>>) {
+        return make_future_task(stamp_task(std::forward<F>(f)), std::forward<Args>(args)...);
+    }
+    else {
+        return make_future_task(std::forward<F>(f), std::forward<Args>(args)...);
+    }
+#else
+    return make_future_task(std::forward<F>(f), std::forward<Args>(args)...);
+#endif
+}
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 只可移动的、带小对象缓冲区（SBO）的 void() 任务类型，用来替代 std::function<void()>
+//
+// 和 std::function 相比：
+//   - 不要求可调用对象可复制，packaged_task/promise 可以直接放进来，不再需要 make_shared 包一层
+//   - 内联缓冲区有 kInlineSize 字节（整个 Task 恰好占一个缓存行），
+//     libstdc++ 的 std::function 只有 16 字节，稍大一点的 lambda/bind 对象就要上堆
+//   - 放不进缓冲区（或移动构造可能抛异常）的可调用对象才会在堆上分配
+class Task {
+public:
+    static constexpr std::size_t kInlineSize = 64 - sizeof(void*);
+
+    // F 能否内联存储（不产生堆分配）
+    template<typename F>
+    static constexpr bool fits_inline = sizeof(F) <= kInlineSize &&
+                                        alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<F>;
+
+    Task() noexcept = default;
+    Task(std::nullptr_t) noexcept {}
+
+    template<typename F, typename D = std::decay_t<F>,
+             typename = std::enable_if_t<!std::is_same_v<D, Task> && std::is_invocable_v<D&>>>
+    Task(F &&f) {
+        if constexpr (fits_inline<D>) {
+            ::new (static_cast<void*>(buf_)) D(std::forward<F>(f));
+            ops_ = &InlineOps<D>::ops;
+        }
+        else {
+            ::new (static_cast<void*>(buf_)) D*(new D(std::forward<F>(f)));
+            ops_ = &HeapOps<D>::ops;
+        }
+    }
+
+    Task(Task &&other) noexcept : ops_(other.ops_) {
+        if(ops_) {
+            ops_->relocate(buf_, other.buf_);
+            other.ops_ = nullptr;
+        }
+    }
+    Task& operator=(Task &&other) noexcept {
+        if(this != &other) {
+            reset();
+            if(other.ops_) {
+                other.ops_->relocate(buf_, other.buf_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(buf_); }
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    void reset() noexcept {
+        if(ops_) {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*relocate)(void *dst, void *src) noexcept; // 移动构造到 dst，并析构 src
+        void (*destroy)(void*) noexcept;
+    };
+
+    template<typename D>
+    struct InlineOps {
+        static void invoke(void *p) { (*static_cast<D*>(p))(); }
+        static void relocate(void *dst, void *src) noexcept {
+            ::new (dst) D(std::move(*static_cast<D*>(src)));
+            static_cast<D*>(src)->~D();
+        }
+        static void destroy(void *p) noexcept { static_cast<D*>(p)->~D(); }
+        static constexpr Ops ops{&invoke, &relocate, &destroy};
+    };
+
+    // 缓冲区里只存一个指针，移动时只搬指针
+    template<typename D>
+    struct HeapOps {
+        static void invoke(void *p) { (**static_cast<D**>(p))(); }
+        static void relocate(void *dst, void *src) noexcept {
+            ::new (dst) D*(*static_cast<D**>(src));
+        }
+        static void destroy(void *p) noexcept { delete *static_cast<D**>(p); }
+        static constexpr Ops ops{&invoke, &relocate, &destroy};
+    };
+
+    alignas(std::max_align_t) unsigned char buf_[kInlineSize];
+    const Ops *ops_ = nullptr;
+};
+
+namespace detail {
+
+// 按 (Size, Align) 分的空闲块缓存：线程本地链表 + 全局仓库
+// promise 的共享状态和结果存储都是定长的小块，通常由提交线程分配，
+// 却常常在 worker 上释放（提交线程 get() 之后先放掉 future，worker 随后析构 Task 里的 promise）。
+// 所以本地链表超过 kMaxCached 时把 kBatch 块挪进全局仓库，本地为空时再从仓库整批取回：
+// 稳态下既不走 operator new，仓库的锁也只是每 kBatch 次分配 / 释放才拿一次
+template<std::size_t Size, std::size_t Align>
+class BlockCache {
+public:
+    static void* get() {
+        Cache& c = cache_;
+        if(!c.head && !c.closed) refill(c);
+        if(Node *n = c.head) {
+            c.head = n->next;
+            -- c.count;
+            return n;
+        }
+        if constexpr (Align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(Size, std::align_val_t(Align));
+        else return ::operator new(Size);
+    }
+
+    static void put(void *p) noexcept {
+        Node *n = ::new (p) Node{nullptr};
+        Cache& c = cache_;
+        if(c.closed) {
+            give_back(n, n, 1);
+            return;
+        }
+        register_drain();
+        n->next = c.head;
+        c.head = n;
+        if(++ c.count > kMaxCached) give_back_local(c, kBatch);
+    }
+
+private:
+    static constexpr std::size_t kBatch = 32;
+    static constexpr std::size_t kMaxCached = 2 * kBatch;  // 每个线程本地最多缓存的块数
+    static constexpr std::size_t kMaxDepot = 4096;         // 仓库最多保存的块数，再多就直接释放
+    static_assert(Size >= sizeof(void*), "block too small for the free list");
+
+    struct Node { Node *next; };
+    // 平凡析构，线程退出过程中（Drain 之后）再归还也能安全访问
+    struct Cache {
+        Node *head = nullptr;
+        std::size_t count = 0;
+        bool closed = false;
+    };
+    // 线程退出时把本地缓存交还仓库
+    struct Drain {
+        ~Drain() {
+            Cache& c = cache_;
+            c.closed = true;
+            give_back_local(c, c.count);
+        }
+    };
+
+    static void register_drain() {
+        thread_local Drain drain;
+        (void)drain;
+    }
+
+    static void refill(Cache& c) {
+        register_drain();
+        std::lock_guard<std::mutex> lock(depot_mtx_);
+        while(depot_ && c.count < kBatch) {
+            Node *n = depot_;
+            depot_ = n->next;
+            -- depot_count_;
+            n->next = c.head;
+            c.head = n;
+            ++ c.count;
+        }
+    }
+
+    // 把本地链表头部的 n 块交还仓库
+    static void give_back_local(Cache& c, std::size_t n) {
+        if(n == 0) return;
+        Node *first = c.head, *last = c.head;
+        for(std::size_t i = 1; i < n; i ++ ) last = last->next;
+        c.head = last->next;
+        c.count -= n;
+        give_back(first, last, n);
+    }
+
+    // [first, last] 是一条 n 块的链；仓库放不下就直接释放
+    static void give_back(Node *first, Node *last, std::size_t n) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(depot_mtx_);
+            if(depot_count_ + n <= kMaxDepot) {
+                last->next = depot_;
+                depot_ = first;
+                depot_count_ += n;
+                return;
+            }
+        }
+        last->next = nullptr;
+        while(first) {
+            Node *next = first->next;
+            release(first);
+            first = next;
+        }
+    }
+
+    static void release(void *p) noexcept {
+        if constexpr (Align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(p, std::align_val_t(Align));
+        else ::operator delete(p);
+    }
+
+    static inline constinit thread_local Cache cache_{};
+    // 仓库：进程退出时不释放（里面只是空闲的块），也就不存在静态析构顺序的问题
+    static inline constinit std::mutex depot_mtx_{};
+    static inline constinit Node *depot_ = nullptr;
+    static inline constinit std::size_t depot_count_ = 0;
+};
+
+// 单个对象走 BlockCache，其它情况交给 std::allocator；无状态，所有实例都相等
+template<typename T>
+struct RecyclingAllocator {
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+    template<typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if(n != 1)  return std::allocator<T>{}.allocate(n);
+        return static_cast<T*>(BlockCache<sizeof(T), alignof(T)>::get());
+    }
+    void deallocate(T *p, std::size_t n) noexcept {
+        if(n != 1)  std::allocator<T>{}.deallocate(p, n);
+        else BlockCache<sizeof(T), alignof(T)>::put(p);
+    }
+
+    template<typename U>
+    friend bool operator==(const RecyclingAllocator&, const RecyclingAllocator<U>&) noexcept { return true; }
+};
+
+// promise 和可调用对象直接放在 Task 里：
+// 以前 make_shared<packaged_task> + 再包一层 lambda 需要两次堆分配；
+// promise 自己的共享状态和结果存储用 RecyclingAllocator 分配，稳态下也不再有堆分配
+template<typename R, typename Fn>
+struct PromiseTask {
+    std::promise<R> promise;
+    Fn fn;
+
+    void operator()() {
+        try {
+            if constexpr (std::is_void_v<R>) {
+                fn();
+                promise.set_value();
+            }
+            else {
+                promise.set_value(fn());
+            }
+        }
+        catch(...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+};
+
+} // namespace detail
+
+// 把 f(args...) 打包成 Task，返回值或异常通过 future 取回
+template<typename F, typename... Args>
+auto make_future_task(F &&f, Args&&... args)
+        -> std::pair<Task, std::future<std::invoke_result_t<F, Args...>>> {
+    using return_type = std::invoke_result_t<F, Args...>;
+    using bound_type = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    detail::PromiseTask<return_type, bound_type> pt{
+        std::promise<return_type>{std::allocator_arg, detail::RecyclingAllocator<char>{}},
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...)};
+    std::future<return_type> res = pt.promise.get_future();
+    return {Task(std::move(pt)), std::move(res)};
+}
+
+#endif
@@ -12,16 +12,99 @@
 #include <condition_variable>
 #include <functional>
 #include <chrono>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <algorithm>
+#include <iterator>
+#include <array>
 #include <type_traits>
 #include <stdexcept>
 
+#include "Backoff.hpp"
+#include "Futex.hpp"
+#include "MPMCQueue.hpp"
+#include "Task.hpp"
+#include "TimingWheel.hpp"
+
+// 普通任务的存储后端
+//   - Locked   : 所有任务都在 mtx_ 保护的 deque 中，空闲线程睡在 cond_ 上
+//   - LockFree : 普通任务走有界无锁环形队列，空闲线程睡在 futex 上；
+//                Critical/Background 任务、延时任务以及环形队列满时溢出的普通任务仍走 mtx_
+enum class QueueBackend { Locked, LockFree };
+
+// 任务的服务等级，每个等级有自己的队列，按 qos_weights 加权公平地出队
+//   - Critical   : 延迟敏感任务，积压时线程池会优先据此扩容
+//   - Normal     : 普通任务
+//   - Background : 后台任务，不会触发扩容，但在高优先级任务持续涌入时仍能按权重得到执行
+enum class QoS : std::uint8_t { Critical = 0, Normal = 1, Background = 2 };
+inline constexpr std::size_t kQoSCount = 3;
+
+// 延时任务的存储引擎
+//   - Heap  : mtx_ 保护的小顶堆，插入/取出 O(log n)，由消费者线程按最早到期时间睡眠等待
+//   - Wheel : 分层时间轮（见 TimingWheel.hpp），插入/取消 O(1)，
+//             由独立的定时线程按 wheel_tick 的精度把到期任务搬到普通任务队列
+enum class DelayEngine { Heap, Wheel };
+
+// 队列满（就绪任务数达到 capacity）时 push 的处理方式
+//   - Block      : 阻塞等待空位，最多等 block_timeout，超时后按 Reject 处理
+//   - Reject     : 直接拒绝新来的任务（reject-newest）
+//   - CallerRuns : 在调用 push 的线程上直接执行这个任务，生产者自然就慢下来了
+enum class OverflowPolicy { Block, Reject, CallerRuns };
+
+// push 的结果
+//   - OK        : 已入队
+//   - Rejected  : 队列满，任务被拒绝；task 不会被移走，调用方可以自行处理
+//   - Stopped   : 队列已停止，任务被拒绝；task 同样不会被移走
+//   - RanInline : CallerRuns 策略下已经在当前线程执行完毕
+enum class PushResult { OK, Rejected, Stopped, RanInline };
+
+struct TaskQueueOptions {
+    QueueBackend backend = QueueBackend::Locked;
+    std::size_t ring_capacity = 4096;  // 仅 LockFree 使用，会向上取整到 2 的幂
+    DelayEngine delay_engine = DelayEngine::Heap;
+    std::chrono::microseconds wheel_tick{1000};  // 仅 Wheel 使用，延时任务最多晚一个 tick 执行
+    // Critical / Normal / Background 的出队权重：三类都有积压时，出队次数之比约为 16:4:1
+    std::array<unsigned, kQoSCount> qos_weights{16, 4, 1};
+
+    // 取不到任务时先自旋 spin_duration 再睡眠，省掉紧接着的 push 的一次 futex 唤醒（默认 0 即不自旋）
+    std::chrono::microseconds spin_duration{0};
+    int max_spinners = 1;  // 同时自旋的线程数上限
+    // 只有最近 spin_busy_window 内取到过任务的线程才自旋，机器空闲时不会白白烧 CPU
+    std::chrono::microseconds spin_busy_window{1000};
+
+    // 容量上限：就绪任务（各 QoS 等级的普通任务，以及到期后被搬进就绪队列的延时任务）最多 capacity 个
+    // 0 表示不限；还没到期的延时任务不占容量，到期的延时任务之前已经被接受过，总是放行
+    std::size_t capacity = 0;
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    std::chrono::milliseconds block_timeout{100};  // 仅 Block 使用
+    // 水位回调，供生产者限流：就绪任务数涨到 high_watermark 时调用 on_watermark(true)，
+    // 之后回落到 low_watermark 时调用 on_watermark(false)；high_watermark 为 0 表示不启用
+    // 回调在 push / pop 的线程上执行（不持有队列的锁），应当尽快返回，也不要在里面阻塞地 push
+    std::size_t high_watermark = 0;
+    std::size_t low_watermark = 0;
+    std::function<void(bool high)> on_watermark;
+};
+
+// 可取消延时任务的共享状态，由任务本身、队列中的延时条目和调用方的句柄共同持有
+//   - 调用方把 status 从 kPending 改为 kCancelled 后再调用 TaskQueue::cancel_delay
+//   - Heap 引擎下已取消的条目在到达堆顶时被直接丢弃（惰性删除），不会再分发给 worker
+//   - Wheel 引擎下 cancel_delay 通过 wheel_node 立即把条目从时间轮上摘掉
+struct DelayState {
+    enum : std::uint8_t { kPending, kStarted, kCancelled };
+    std::atomic<std::uint8_t> status{kPending};
+    std::atomic<std::uint64_t> wheel_node{0};  // 当前所在的时间轮节点 {index, gen}，0 表示没有
+
+    bool cancelled() const noexcept { return status.load(std::memory_order_acquire) == kCancelled; }
+};
+
 // 并发安全的，带优先级控制和延时功能的阻塞式任务队列
 class TaskQueue {
 public:
-    using Task = std::function<void()>;
+    using Task = ::Task;
+    using Options = TaskQueueOptions;
+    // push_delay 返回的句柄，用于 cancel_delay；Heap 引擎下始终为无效句柄
+    using DelayHandle = TimingWheel::Handle;
 
     // pop 操作的结果：
     // - OK:     : 成功取到任务
@@ -29,7 +112,31 @@ public:
     // - TIMEOUT : 在指定 idle_timeout 内一直没有新任务，用于线程池缩容
     enum class PopResult { OK, STOPPED, TIMEOUT };
 
-    TaskQueue() = default;
+    TaskQueue() : TaskQueue(Options{}) {}
+    explicit TaskQueue(const Options& opts) {
+        if(opts.backend == QueueBackend::LockFree) {
+            ring_ = std::make_unique<MPMCQueue<Task>>(opts.ring_capacity);
+        }
+        for(std::size_t c = 0; c < kQoSCount; c ++ ) {
+            stride_[c] = kStride / std::max(1u, opts.qos_weights[c]);
+        }
+        capacity_ = opts.capacity;
+        overflow_ = opts.overflow;
+        block_timeout_ = opts.block_timeout;
+        if(opts.high_watermark > 0 && opts.on_watermark) {
+            high_watermark_ = opts.high_watermark;
+            low_watermark_ = std::min(opts.low_watermark, opts.high_watermark);
+            on_watermark_ = opts.on_watermark;
+        }
+        accounting_ = capacity_ > 0 || high_watermark_ > 0;
+        spin_duration_ = opts.spin_duration;
+        spin_busy_window_ = opts.spin_busy_window;
+        max_spinners_ = opts.max_spinners;
+        if(opts.delay_engine == DelayEngine::Wheel) {
+            wheel_ = std::make_unique<TimingWheel>(
+                opts.wheel_tick, [this](std::vector<Task>& due) { enqueue_fired(due); });
+        }
+    }
     TaskQueue(const TaskQueue&) = delete;
     TaskQueue& operator=(const TaskQueue&) = delete;
 
@@ -39,46 +146,160 @@ public:
             // 注意对 stop_ 的访问需要加锁
             std::lock_guard<std::mutex> lock(mtx_);
             stop_ = true;
+            sweep_delays_.store(true, std::memory_order_relaxed);
         }
         // 唤醒所有等待线程，以便它们尽快检测到 stop_=true，并退出或完成剩余任务
         cond_.notify_all();
+        if(ring_) wake_parked(INT32_MAX);
+        // 阻塞在 Block 策略上的生产者也要醒来，它们会得到 PushResult::Stopped
+        if(accounting_) {
+            std::lock_guard<std::mutex> lock(space_mtx_);
+            space_cv_.notify_all();
+        }
     }
 
     // 当前队列中总剩余任务数量
+    // LockFree 后端下不加锁，返回的是近似值
     size_t size() const {
+        size_t wheel_cnt = wheel_pending_.load(std::memory_order_relaxed);
+        if(ring_) {
+            return ring_->size_approx() + locked_cnt_.load(std::memory_order_relaxed) + wheel_cnt;
+        }
         std::lock_guard<std::mutex> lock(mtx_);
-        return tasks_.size() + delay_tasks_.size();
+        return locked_tasks_size() + delay_tasks_.size() + wheel_cnt;
     }
 
-    // 普通任务: 尾部插入
-    void push(Task&& task) {
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            if(stop_)   return ;
-            // 使用 emplace_back 和移动语义优化
-            tasks_.emplace_back(std::move(task));
+    // 某个等级中排队的任务数（不含延时任务），不加锁，近似值
+    size_t pending(QoS qos) const {
+        auto c = static_cast<std::size_t>(qos);
+        size_t n = qos_cnt_[c].load(std::memory_order_relaxed);
+        if(ring_ && qos == QoS::Normal) n += ring_->size_approx();
+        return n;
+    }
+
+    // 占用容量的就绪任务数；没有设置 capacity 和水位回调时不统计，恒为 0。不加锁，近似值
+    size_t ready() const { return ready_cnt_.load(std::memory_order_relaxed); }
+
+    // 普通任务: 插入 qos 对应等级的队尾，同一等级内 FIFO
+    // 设置了 capacity 时，队列满了按 overflow 策略处理（见 OverflowPolicy / PushResult）
+    // 容量检查只是对 ready_cnt_ 的一次 CAS，不会多加一次锁
+    PushResult push(Task&& task, QoS qos = QoS::Normal) {
+        if(!accounting_) return push_admitted(std::move(task), qos);
+        if(stop_.load(std::memory_order_acquire))   return PushResult::Stopped;
+        if(acquire_slots(1) == 0) {
+            PushResult r = on_full(task);
+            if(r != PushResult::OK) return r;
         }
-        cond_.notify_one();
+        PushResult r = push_admitted(std::move(task), qos);
+        if(r != PushResult::OK) release_slots(1);
+        return r;
+    }
+
+    // 不管 overflow 策略，队列满时立即返回 Rejected（task 不会被移走）
+    PushResult try_push(Task&& task, QoS qos = QoS::Normal) {
+        if(!accounting_) return push_admitted(std::move(task), qos);
+        if(stop_.load(std::memory_order_acquire))   return PushResult::Stopped;
+        if(acquire_slots(1) == 0)   return PushResult::Rejected;
+        PushResult r = push_admitted(std::move(task), qos);
+        if(r != PushResult::OK) release_slots(1);
+        return r;
+    }
+
+    // 优先级任务: 即 QoS::Critical
+    // 以前是 deque 头插，优先级任务之间是 LIFO，且会把普通任务完全饿死
+    PushResult push_priority(Task&& task) {
+        return push(std::move(task), QoS::Critical);
     }
 
-    // 优先级任务: 头部插入
-    void push_priority(Task&& task) {
+    // 延时任务: 将在指定的时间点 exec_tm 执行
+    // Wheel 引擎下返回可用于 cancel_delay 的句柄；队列已停止或 Heap 引擎下返回无效句柄
+    // state 非空时任务可以通过 cancel_delay(DelayState&) 取消
+    DelayHandle push_delay(Task&& task, std::chrono::steady_clock::time_point exec_tm,
+                           std::shared_ptr<DelayState> state = nullptr) {
+        if(wheel_) {
+            {
+                // 先计数再放进时间轮，保证 pop 的 STOPPED 判断不会漏掉它
+                std::lock_guard<std::mutex> lock(mtx_);
+                if(stop_)   return {};
+                wheel_pending_.fetch_add(1, std::memory_order_relaxed);
+            }
+            DelayHandle h = wheel_->schedule(std::move(task), exec_tm);
+            if(state) {
+                state->wheel_node.store(pack(h), std::memory_order_seq_cst);
+                // 与 cancel_delay(DelayState&) 配对：要么它看到新节点，要么这里看到取消标记
+                if(state->cancelled()) cancel_delay(h);
+            }
+            return h;
+        }
         {
             std::lock_guard<std::mutex> lock(mtx_);
-            if(stop_)   return ;
-            tasks_.emplace_front(std::move(task));
+            if(stop_)   return {};
+            delay_tasks_.emplace(exec_tm, std::move(task), std::move(state));
+            if(ring_) locked_cnt_.fetch_add(1, std::memory_order_relaxed);
         }
-        cond_.notify_one();
+        notify_one();
+        return {};
     }
 
-    // 延时任务: 将在指定的时间点 exec_tm 执行
-    void push_delay(Task&& task, std::chrono::steady_clock::time_point exec_tm) {
+    // 调用方已经把 state 标记为 kCancelled 之后调用
+    // Wheel 引擎下立即释放时间轮节点；Heap 引擎下等条目到达堆顶时再丢弃
+    void cancel_delay(DelayState& state) {
+        if(wheel_) {
+            cancel_delay(unpack(state.wheel_node.exchange(0, std::memory_order_seq_cst)));
+        }
+        else if(stop_.load(std::memory_order_acquire)) {
+            // 停机后 pop 会一次性清掉已取消的条目，叫醒消费者，免得它们空等到期时间
+            sweep_delays_.store(true, std::memory_order_release);
+            wake_all();
+        }
+    }
+
+    // 取消还未到期的延时任务，O(1)
+    // 成功返回 true；任务已经被搬到就绪队列、已取消或句柄无效时返回 false
+    bool cancel_delay(DelayHandle handle) {
+        if(!wheel_ || !wheel_->cancel(handle))  return false;
+        bool last = false;
         {
             std::lock_guard<std::mutex> lock(mtx_);
-            if(stop_)   return ;
-            delay_tasks_.emplace(exec_tm, std::move(task));
+            last = wheel_pending_.fetch_sub(1, std::memory_order_release) == 1 && stop_;
         }
-        cond_.notify_one();
+        // 停机后取消了最后一个延时任务：叫醒所有消费者去发现 STOPPED
+        if(last)    wake_all();
+        return true;
+    }
+
+    // 批量普通任务: 整批只加一次锁，最多唤醒 min(n, 等待线程数) 个线程
+    // range 中的元素会被移走；返回实际入队（或由当前线程执行）的任务数，队列已停止时返回 0
+    // 设置了 capacity 时，放不下的部分逐个按 overflow 策略处理，第一个被拒绝的任务之后都不再尝试，
+    // 所以被拒绝的总是 range 的一段后缀；元素类型是 Task 时，这些任务原样留在 range 中
+    template<typename Range>
+    std::size_t push_bulk(Range&& range) {
+        using std::begin;
+        using std::end;
+        auto it = begin(range);
+        auto last = end(range);
+        if(!accounting_) return push_bulk_range(it, last);
+        if(stop_.load(std::memory_order_acquire))   return 0;
+
+        std::size_t granted = acquire_slots(static_cast<std::size_t>(std::distance(it, last)));
+        auto mid = std::next(it, static_cast<std::ptrdiff_t>(granted));
+        std::size_t n = push_bulk_range(it, mid);
+        if(n < granted) {
+            release_slots(granted - n);  // 中途停机
+            return n;
+        }
+        for(it = mid; it != last; ++it) {
+            PushResult r;
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(*it)>, Task>) {
+                r = push(std::move(*it));  // 被拒绝时不会移走 *it
+            }
+            else {
+                r = push(Task(std::move(*it)));
+            }
+            if(r == PushResult::Rejected || r == PushResult::Stopped) break;
+            ++ n;
+        }
+        return n;
     }
 
     // 从队列中取出任务
@@ -86,6 +307,7 @@ public:
     // 参数:
     //   - out_task     : 输出参数，用于接受取出的任务
     //   - idle_timeout : 没有可执行任务（没有普通任务且没有到期的延时任务）时的“最大等待时间”
+    //                    （任意精度，std::chrono::seconds 等会隐式转换）
     //
     // 返回值:
     //   - OK:     : 成功取到任务
@@ -95,11 +317,37 @@ public:
     //   - 即使 stop_=true，只要队列中还有未执行的任务（包括未来的延时任务），
     //     pop() 仍会等待并以此返回这些任务，只有在“队列为空”时才返回 STOPPED
     //   - 即使队列中存在未完成的延时任务，只要 idle_timeout 截至，仍然会返回 TIMEOUT
-    PopResult pop(Task& out_task, std::chrono::seconds idle_timeout) {
+    PopResult pop(Task& out_task, std::chrono::nanoseconds idle_timeout) {
+        PopResult res = pop_impl(out_task, nullptr, 0, idle_timeout);
+        if(res == PopResult::OK) mark_busy();
+        return res;
+    }
+
+    // 批量取任务：像 pop() 一样阻塞等待第一个任务，拿到后顺手再取最多 max_n - 1 个
+    // 已就绪的普通任务，不再额外等待。适合一次抓一小批短任务，摊薄加锁/唤醒的开销
+    // out 会被清空，返回 OK 时其中有 1 ~ max_n 个任务
+    PopResult pop_bulk(std::vector<Task>& out, std::size_t max_n, std::chrono::nanoseconds idle_timeout) {
+        out.clear();
+        out.reserve(std::max<std::size_t>(max_n, 1));
+        out.emplace_back();
+        // reserve 保证后续追加不会重新分配，out.front() 的引用一直有效
+        PopResult res = pop_impl(out.front(), &out, max_n > 0 ? max_n - 1 : 0, idle_timeout);
+        if(res != PopResult::OK) out.clear();
+        else mark_busy();
+        return res;
+    }
+
+private:
+    // pop / pop_bulk 的共同实现：extra 非空时，取到普通任务后再顺手追加最多 max_extra 个
+    PopResult pop_impl(Task& out_task, std::vector<Task>* extra, std::size_t max_extra,
+                       std::chrono::nanoseconds idle_timeout) {
+        if(ring_) return pop_lock_free(out_task, extra, max_extra, idle_timeout);
+
         std::unique_lock<std::mutex> lock(mtx_);
 
         using namespace std::chrono;
         auto deadline = steady_clock::now() + idle_timeout;
+        bool spun = false;  // 每次 pop 最多自旋一轮
 
         // (begining)是否停机？
         //   YES : return STOPPED
@@ -110,29 +358,42 @@ public:
         //                    ELSE: go begining
         while(true) {
             auto now = std::chrono::steady_clock::now();
+            drop_cancelled_delays();
 
-            // 1. 队列已停止且无任何剩余任务
+            // 1. 队列已停止且无任何剩余任务（包括还在时间轮里的延时任务）
             //    注意这里不能通过成员函数 size() 判断队列是否为空，这将会导致死锁
-            if(stop_ && delay_tasks_.empty() && tasks_.empty()) {
+            if(stop_ && delay_tasks_.empty() && locked_tasks_size() == 0 &&
+               wheel_pending_.load(std::memory_order_relaxed) == 0) {
                 return PopResult::STOPPED;
             }
 
             // 2. 优先取到期的延时任务
             if(!delay_tasks_.empty() && delay_tasks_.top().exec_tm_ <= now) {
-                TimeTask top_copy = delay_tasks_.top();
-                delay_tasks_.pop();
-                out_task = std::move(top_copy.task_);
+                // Task 只可移动，不能像以前那样先复制堆顶再 pop（见 readme V4 Q1）
+                out_task = std::move(delay_tasks_.pop_top().task_);
                 return PopResult::OK;
             }
 
-            // 3. 其次取普通任务
-            if(!tasks_.empty()) {
-                out_task = std::move(tasks_.front());
-                tasks_.pop_front();
+            // 3. 其次按 QoS 权重取普通任务，解锁之后再归还容量
+            if(int c = pick_class(false); c >= 0) {
+                std::size_t taken = dequeue_locked(static_cast<std::size_t>(c), out_task, extra, max_extra);
+                lock.unlock();
+                release_slots(taken);
                 return PopResult::OK;
-            } 
+            }
 
-            // 4. 等待下一个延时任务
+            // 4. 睡眠之前先在锁外自旋一小段时间，期间有新任务就回到循环开头去取
+            //    自旋结束后会重新加锁再检查一遍，所以不会丢失唤醒
+            //    idle_timeout 为 0（窃取、try_run_one）时只看一眼，不自旋
+            if(!spun && spin_duration_.count() > 0 && idle_timeout.count() > 0) {
+                spun = true;
+                lock.unlock();
+                bool found = spin_for_work();
+                lock.lock();
+                if(found) continue;
+            }
+
+            // 5. 等待下一个延时任务
             //    注意此时延时队列可能为空，只不过 stop_=false，因此还没有停机
             auto wait_until_tm = deadline; // 默认等到 idle_timeout 截止
         
@@ -144,7 +405,10 @@ public:
             // 等待直到 wait_until_tm
             // cond_.wait_until 会返回 std::cv_status::timeout 如果它等待到了 wait_until_tm
             // 否则返回 std::cv_status::no_timeout (被 notify 唤醒或虚假唤醒)
-            if(cond_.wait_until(lock, wait_until_tm) == std::cv_status::timeout) {
+            ++ waiters_;
+            auto status = cond_.wait_until(lock, wait_until_tm);
+            -- waiters_;
+            if(status == std::cv_status::timeout) {
                 
                 // 3. 被唤醒后，重新检查当前时间是否达到 idle_timeout 的 deadline
                 //    注意：
@@ -160,27 +424,542 @@ public:
         }
     }
 
+    // push_bulk 的入队部分（不检查容量），返回入队的个数
+    template<typename It>
+    std::size_t push_bulk_range(It it, It last) {
+        std::size_t n = 0;
+
+        if(ring_) {
+            if(!begin_ring_push())   return 0;
+            Task overflow;
+            for(; it != last; ++it) {
+                Task t(std::move(*it));
+                if(!ring_->try_push(std::move(t))) {
+                    // try_push 失败时不会移走 t
+                    overflow = std::move(t);
+                    break;
+                }
+                ++n;
+            }
+            end_ring_push();
+            if(overflow) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if(!stop_) {
+                    auto& q = tasks_[kNormal];
+                    std::size_t before = q.size();
+                    q.emplace_back(std::move(overflow));
+                    for(++it; it != last; ++it) q.emplace_back(std::move(*it));
+                    note_locked_added(kNormal, q.size() - before);
+                    n += q.size() - before;
+                }
+            }
+            // futex::wake 本身就最多只唤醒实际睡着的线程
+            if(n > 0) wake_parked(static_cast<int>(std::min<std::size_t>(n, INT32_MAX)));
+            return n;
+        }
+
+        std::size_t to_wake = 0;
+        bool wake_all = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if(stop_)   return 0;
+            for(; it != last; ++it, ++n) tasks_[kNormal].emplace_back(std::move(*it));
+            note_locked_added(kNormal, n);
+            to_wake = std::min(n, waiters_);
+            wake_all = (to_wake == waiters_);
+        }
+        if(wake_all) {
+            cond_.notify_all();
+        }
+        else {
+            for(std::size_t i = 0; i < to_wake; i ++ ) cond_.notify_one();
+        }
+        return n;
+    }
+
+    // push 的入队部分（不检查容量）：队列已停止时返回 Stopped，task 不会被移走
+    PushResult push_admitted(Task&& task, QoS qos) {
+        if(qos != QoS::Normal) {
+            // Critical / Background 在所有后端下都走 mtx_
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if(stop_)   return PushResult::Stopped;
+                enqueue_locked(static_cast<std::size_t>(qos), std::move(task));
+            }
+            notify_one();
+            return PushResult::OK;
+        }
+        if(ring_) {
+            if(!begin_ring_push())   return PushResult::Stopped;
+            bool ok = ring_->try_push(std::move(task));
+            end_ring_push();
+            if(ok) {
+                wake_parked(1);
+                return PushResult::OK;
+            }
+            // 环形队列已满：溢出到加锁的 deque 中，保证 push 不会丢任务
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if(stop_)   return PushResult::Stopped;
+            enqueue_locked(kNormal, std::move(task));
+        }
+        notify_one();
+        return PushResult::OK;
+    }
+
+    // ---- 容量与水位，只在 accounting_ 为 true 时使用 ----
+    // 申请最多 n 个空位，返回实际拿到的个数；不限容量（只有水位回调）时总是全部给出
+    std::size_t acquire_slots(std::size_t n) {
+        std::size_t cur = ready_cnt_.load(std::memory_order_seq_cst);
+        std::size_t granted = 0;
+        do {
+            granted = capacity_ == 0 ? n : (cur >= capacity_ ? 0 : std::min(n, capacity_ - cur));
+            if(granted == 0) return 0;
+        } while(!ready_cnt_.compare_exchange_weak(cur, cur + granted, std::memory_order_seq_cst));
+        if(high_watermark_ && cur + granted >= high_watermark_) cross_watermark(true);
+        return granted;
+    }
+
+    // 任务出队后归还空位
+    // 先减计数再读 blocked_，与 on_full 中先加 blocked_ 再检查计数配对，阻塞的生产者不会漏掉唤醒
+    void release_slots(std::size_t n) {
+        if(!accounting_ || n == 0) return;
+        std::size_t now = ready_cnt_.fetch_sub(n, std::memory_order_seq_cst) - n;
+        if(blocked_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(space_mtx_);
+            space_cv_.notify_all();
+        }
+        if(high_watermark_ && now <= low_watermark_) cross_watermark(false);
+    }
+
+    // 水位状态翻转时调用回调；在 watermark_mtx_ 下重新确认当前计数，保证 true / false 严格交替
+    void cross_watermark(bool high) {
+        if(above_high_.load(std::memory_order_relaxed) == high) return;
+        std::lock_guard<std::mutex> lock(watermark_mtx_);
+        if(above_high_.load(std::memory_order_relaxed) == high) return;
+        std::size_t cur = ready_cnt_.load(std::memory_order_seq_cst);
+        if(high ? cur < high_watermark_ : cur > low_watermark_) return;
+        above_high_.store(high, std::memory_order_relaxed);
+        on_watermark_(high);
+    }
+
+    // 没有空位时按 overflow_ 处理；返回 OK 表示等到了空位（已经占上）
+    PushResult on_full(Task& task) {
+        switch(overflow_) {
+        case OverflowPolicy::Reject:
+            return PushResult::Rejected;
+        case OverflowPolicy::CallerRuns:
+            task();
+            task.reset();
+            return PushResult::RanInline;
+        case OverflowPolicy::Block:
+            break;
+        }
+        bool got = false;
+        std::unique_lock<std::mutex> lock(space_mtx_);
+        blocked_.fetch_add(1, std::memory_order_seq_cst);
+        space_cv_.wait_for(lock, block_timeout_, [&] {
+            return stop_.load(std::memory_order_acquire) || (got = acquire_slots(1) == 1);
+        });
+        blocked_.fetch_sub(1, std::memory_order_relaxed);
+        if(got) return PushResult::OK;
+        return stop_.load(std::memory_order_acquire) ? PushResult::Stopped : PushResult::Rejected;
+    }
+
+    // 生产者往 ring_ 里写之前先登记，再检查 stop_（都是 seq_cst）；消费者在 stop_ 之后读 ring_pushers_。
+    // 于是只要生产者没看到 stop_，消费者判断停机时就一定能看到它的登记，不会在它写进 ring_ 之前退出，
+    // 任务也就不会在所有 worker 都退出之后才进入 ring_（没人执行）。返回 false 时已经撤销了登记
+    bool begin_ring_push() {
+        ring_pushers_.fetch_add(1, std::memory_order_seq_cst);
+        if(!stop_.load(std::memory_order_seq_cst)) return true;
+        end_ring_push();
+        return false;
+    }
+
+    // 停机后最后一个生产者离开：叫醒因为看到它的登记而睡下的消费者，去发现 STOPPED
+    void end_ring_push() {
+        if(ring_pushers_.fetch_sub(1, std::memory_order_seq_cst) == 1 && stop_.load(std::memory_order_seq_cst)) {
+            wake_parked(INT32_MAX);
+        }
+    }
+
+    // 唤醒一个等待者：Locked 后端用 cond_，LockFree 后端用 futex
+    void notify_one() {
+        if(ring_) wake_parked(1);
+        else cond_.notify_one();
+    }
+
+    void wake_all() {
+        if(ring_) wake_parked(INT32_MAX);
+        else cond_.notify_all();
+    }
+
+    static constexpr std::size_t kNormal = static_cast<std::size_t>(QoS::Normal);
+    static constexpr std::uint64_t kStride = std::uint64_t{1} << 20;
+
+    // 以下几个函数都要求持有 mtx_
+    std::size_t locked_tasks_size() const {
+        std::size_t n = 0;
+        for(auto& q : tasks_) n += q.size();
+        return n;
+    }
+
+    void note_locked_added(std::size_t c, std::size_t n) {
+        qos_cnt_[c].fetch_add(n, std::memory_order_relaxed);
+        if(ring_) locked_cnt_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void enqueue_locked(std::size_t c, Task&& task) {
+        tasks_[c].emplace_back(std::move(task));
+        note_locked_added(c, 1);
+    }
+
+    // 从等级 c 取一个任务，extra 非空时再从同一等级追加最多 max_extra 个，返回取出的个数
+    std::size_t dequeue_locked(std::size_t c, Task& out_task, std::vector<Task>* extra, std::size_t max_extra) {
+        auto& q = tasks_[c];
+        out_task = std::move(q.front());
+        q.pop_front();
+        std::size_t taken = 1;
+        for(std::size_t i = 0; extra && i < max_extra && !q.empty(); i ++ , taken ++ ) {
+            extra->push_back(std::move(q.front()));
+            q.pop_front();
+        }
+        // 批量取出的任务也要按个数计入 pass
+        pass_[c] += stride_[c] * (taken - 1);
+        qos_cnt_[c].fetch_sub(taken, std::memory_order_relaxed);
+        if(ring_) locked_cnt_.fetch_sub(taken, std::memory_order_relaxed);
+        return taken;
+    }
+
+    // 加权公平地选出下一个出队的等级，没有可取的任务时返回 -1
+    //   - 每个等级有一个 pass，选 pass 最小的非空等级，选中后 pass += kStride / weight
+    //   - 空闲一段时间的等级重新变为非空时，pass 至少追到 vtime_，
+    //     避免它攒下一大笔“额度”后长时间独占 worker
+    //   - pass 相同时下标小（等级高）的优先
+    // normal_in_ring: LockFree 后端下环形队列中是否还有普通任务
+    int pick_class(bool normal_in_ring) {
+        int best = -1;
+        std::uint64_t best_pass = 0;
+        for(std::size_t c = 0; c < kQoSCount; c ++ ) {
+            if(tasks_[c].empty() && !(c == kNormal && normal_in_ring)) continue;
+            std::uint64_t p = std::max(pass_[c], vtime_);
+            if(best < 0 || p < best_pass) {
+                best = static_cast<int>(c);
+                best_pass = p;
+            }
+        }
+        if(best >= 0) {
+            vtime_ = best_pass;
+            pass_[best] = best_pass + stride_[best];
+        }
+        return best;
+    }
+
+    static std::uint64_t pack(DelayHandle h) {
+        return (static_cast<std::uint64_t>(h.index) << 32) | h.gen;
+    }
+    static DelayHandle unpack(std::uint64_t v) {
+        return DelayHandle{static_cast<std::uint32_t>(v >> 32), static_cast<std::uint32_t>(v)};
+    }
+
+    // 在 mtx_ 下丢弃已取消的延时任务（惰性删除）：
+    //   - 平时只检查堆顶，代价是一次原子读
+    //   - 停机后一次性清掉全部已取消的条目，避免 stop() 空等它们的到期时间；
+    //     只在 stop() 和停机后的取消之后各扫一次（sweep_delays_），积压再多，之后的 pop 也只看堆顶
+    void drop_cancelled_delays() {
+        if(delay_tasks_.empty()) return;
+        std::size_t before = delay_tasks_.size();
+        if(sweep_delays_.load(std::memory_order_relaxed) && sweep_delays_.exchange(false, std::memory_order_acquire)) {
+            delay_tasks_.erase_if([](const TimeTask& t) { return t.cancelled(); });
+        }
+        while(!delay_tasks_.empty() && delay_tasks_.top().cancelled()) delay_tasks_.pop_top();
+        if(ring_ && before != delay_tasks_.size()) {
+            locked_cnt_.fetch_sub(before - delay_tasks_.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // 记录当前线程最近一次取到任务的时间，作为“最近忙碌”的提示
+    void mark_busy() {
+        if(spin_duration_.count() > 0) tls_last_busy_ = std::chrono::steady_clock::now();
+    }
+
+    // 不加锁地判断是否可能有就绪任务（只看普通任务，未到期的延时任务不算）
+    bool has_ready_hint() const {
+        for(auto& c : qos_cnt_) {
+            if(c.load(std::memory_order_relaxed) > 0) return true;
+        }
+        return ring_ && ring_->size_approx() > 0;
+    }
+
+    // 有界自旋：不持有 mtx_ 时调用，看到可能的就绪任务返回 true
+    //   - 只有最近忙碌过的线程才自旋，且同时自旋的线程不超过 max_spinners_
+    //   - 先 pause 再 yield 的指数退避，最多持续 spin_duration_
+    bool spin_for_work() {
+        auto now = std::chrono::steady_clock::now();
+        if(now - tls_last_busy_ > spin_busy_window_) return false;
+        if(spinners_.fetch_add(1, std::memory_order_relaxed) >= max_spinners_) {
+            spinners_.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto end = now + spin_duration_;
+        Backoff backoff;
+        bool found = false;
+        while(!(found = has_ready_hint()) && !stop_.load(std::memory_order_relaxed) &&
+              std::chrono::steady_clock::now() < end) {
+            backoff.pause();
+        }
+        spinners_.fetch_sub(1, std::memory_order_relaxed);
+        return found;
+    }
+
+    // 时间轮定时线程的回调：把到期的延时任务搬进普通任务队列
+    // 这些任务在停机前就已经被接受了，所以这里不检查 stop_
+    // wheel_pending_ 在任务入队之后（Locked 后端下在同一个临界区内）才扣减，
+    // 消费者看到 wheel_pending_ == 0 时一定也能看到这些任务
+    void enqueue_fired(std::vector<Task>& due) {
+        const std::size_t n = due.size();
+        std::size_t i = 0;
+        // 同理也不受容量限制，但要在入队之前计数，否则消费者可能先归还容量
+        if(accounting_) {
+            std::size_t before = ready_cnt_.fetch_add(n, std::memory_order_seq_cst);
+            if(high_watermark_ && before + n >= high_watermark_) cross_watermark(true);
+        }
+        if(ring_) {
+            while(i < n && ring_->try_push(std::move(due[i]))) ++ i;
+        }
+        std::size_t to_wake = n;
+        bool everyone = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if(i < n) {
+                note_locked_added(kNormal, n - i);
+                for(; i < n; i ++ ) tasks_[kNormal].emplace_back(std::move(due[i]));
+            }
+            // 停机后时间轮已清空：剩下的消费者都需要醒来去发现 STOPPED
+            everyone = wheel_pending_.fetch_sub(n, std::memory_order_release) == n && stop_;
+            if(!ring_) {
+                to_wake = std::min(n, waiters_);
+                everyone = everyone || to_wake == waiters_;
+            }
+        }
+        if(everyone) {
+            wake_all();
+        }
+        else if(ring_) {
+            wake_parked(static_cast<int>(std::min<std::size_t>(n, INT32_MAX)));
+        }
+        else {
+            for(std::size_t k = 0; k < to_wake; k ++ ) cond_.notify_one();
+        }
+    }
+
+    // futex_seq_ 自增后再检查 parked_：
+    // 消费者先读 futex_seq_ 再检查队列再 parked_++，futex_wait 会原子地比较 futex_seq_，
+    // 所以即使我们在这里看到 parked_ == 0 而跳过 wake，也不会丢失唤醒
+    void wake_parked(int n) {
+        futex_seq_.fetch_add(1, std::memory_order_seq_cst);
+        if(parked_.load(std::memory_order_seq_cst) > 0) {
+            futex::wake(&futex_seq_, n);
+        }
+    }
+
+    // 在 mtx_ 下从加锁部分（延时任务/优先级任务/溢出任务）取任务
+    // next_delay_tm 输出最早的未到期延时任务时间（没有则不修改）
+    // taken 输出取出的就绪任务数，用于归还容量（延时堆里的任务不占容量，不计入）
+    bool pop_locked_part(Task& out_task, std::vector<Task>* extra, std::size_t max_extra,
+                         std::chrono::steady_clock::time_point now,
+                         std::chrono::steady_clock::time_point& next_delay_tm, std::size_t& taken) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        drop_cancelled_delays();
+        if(!delay_tasks_.empty() && delay_tasks_.top().exec_tm_ <= now) {
+            out_task = std::move(delay_tasks_.pop_top().task_);
+            locked_cnt_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        // 环形队列里的普通任务也参与加权选择；选中 Normal 但溢出 deque 为空时交给调用方去取环形队列
+        int c = pick_class(ring_->size_approx() > 0);
+        if(c >= 0 && !tasks_[c].empty()) {
+            taken = dequeue_locked(static_cast<std::size_t>(c), out_task, extra, max_extra);
+            return true;
+        }
+        if(!delay_tasks_.empty()) {
+            next_delay_tm = std::min(next_delay_tm, delay_tasks_.top().exec_tm_);
+        }
+        return false;
+    }
+
+    // pop_bulk 时从环形队列补齐剩余的批量名额，直到 extra 中有 limit 个元素，返回补了几个
+    std::size_t top_up_from_ring(std::vector<Task>* extra, std::size_t limit) {
+        if(!extra) return 0;
+        std::size_t n = 0;
+        Task t;
+        while(extra->size() < limit && ring_->try_pop(t)) {
+            extra->push_back(std::move(t));
+            ++ n;
+        }
+        return n;
+    }
+
+    // LockFree 后端的 pop，语义与 pop() 相同
+    // 只有 locked_cnt_ > 0 时才会去碰 mtx_，纯普通任务的场景完全不加锁
+    PopResult pop_lock_free(Task& out_task, std::vector<Task>* extra, std::size_t max_extra,
+                            std::chrono::nanoseconds idle_timeout) {
+        using namespace std::chrono;
+        auto deadline = steady_clock::now() + idle_timeout;
+        const std::size_t base = extra ? extra->size() : 0;
+        bool spun = false;
+
+        while(true) {
+            // 先读 futex_seq_ 再检查队列：
+            //   - 在此之前完成的 push，下面的检查一定能看到
+            //   - 在此之后发生的 push 会修改 futex_seq_，futex::wait 会立即返回
+            // 因此检查与睡眠之间不会丢失唤醒
+            uint32_t seq = futex_seq_.load(std::memory_order_seq_cst);
+            auto now = steady_clock::now();
+            auto wait_until_tm = deadline;
+
+            // 1. 加锁部分：到期的延时任务和优先级任务优先
+            std::size_t taken = 0;
+            if(locked_cnt_.load(std::memory_order_acquire) > 0 &&
+               pop_locked_part(out_task, extra, max_extra, now, wait_until_tm, taken)) {
+                release_slots(taken + top_up_from_ring(extra, base + max_extra));
+                return PopResult::OK;
+            }
+
+            // 2. 无锁环形队列中的普通任务
+            if(ring_->try_pop(out_task)) {
+                release_slots(1 + top_up_from_ring(extra, base + max_extra));
+                return PopResult::OK;
+            }
+
+            // 3. 队列已停止且无任何剩余任务
+            //    size_approx() != 0 说明有生产者占了槽位但还没写完，继续等它
+            //    wheel_pending_ 要先读：它归零之前，搬出来的任务已经在 ring_/tasks_ 中了
+            //    ring_pushers_ 同理，见 begin_ring_push()
+            if(stop_.load(std::memory_order_seq_cst) &&
+               ring_pushers_.load(std::memory_order_seq_cst) == 0 &&
+               wheel_pending_.load(std::memory_order_acquire) == 0 &&
+               locked_cnt_.load(std::memory_order_acquire) == 0 &&
+               ring_->size_approx() == 0) {
+                return PopResult::STOPPED;
+            }
+
+            if(now >= deadline) {
+                return PopResult::TIMEOUT;
+            }
+
+            // 4. 先自旋一小段时间，期间有新任务就回到循环开头去取
+            if(!spun && spin_duration_.count() > 0) {
+                spun = true;
+                if(spin_for_work()) continue;
+            }
+
+            // 5. 睡在 futex 上，直到有新任务、最早的延时任务到期或 idle_timeout 截止
+            if(ring_->size_approx() == 0) {
+                parked_.fetch_add(1, std::memory_order_seq_cst);
+                futex::wait(&futex_seq_, seq, wait_until_tm - steady_clock::now());
+                parked_.fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+    }
+
 private:
-    // 延时任务结构: 包含执行时间点和具体任务
+    // 延时任务结构: 包含执行时间点、具体任务和可选的取消状态
     struct TimeTask {
         std::chrono::steady_clock::time_point exec_tm_;
         Task task_;
-        TimeTask(std::chrono::steady_clock::time_point tm, Task&& t)
-            : exec_tm_(tm), task_(std::move(t)) {}
+        std::shared_ptr<const DelayState> state_;
+        TimeTask(std::chrono::steady_clock::time_point tm, Task&& t,
+                 std::shared_ptr<const DelayState> st = nullptr)
+            : exec_tm_(tm), task_(std::move(t)), state_(std::move(st)) {}
+        bool cancelled() const { return state_ && state_->cancelled(); }
         // 让时间最早的任务在堆的顶部
         bool operator<(const TimeTask& other) const { return exec_tm_ > other.exec_tm_; }
     };
 
-    // 普通任务队列: 从 front 取任务
-    // 普通任务在 back 添加任务；高优先级任务在 front 添加任务
-    std::deque<Task> tasks_;
+    // 支持“移出堆顶”的小顶堆
+    // std::priority_queue::top() 只返回 const 引用，无法移出只可移动的 Task，
+    // 这里用 vector + push_heap/pop_heap 自己维护：pop_heap 先把堆顶换到末尾，再从末尾移出
+    template<typename T>
+    class MovableHeap {
+    public:
+        template<typename... A>
+        void emplace(A&&... a) {
+            heap_.emplace_back(std::forward<A>(a)...);
+            std::push_heap(heap_.begin(), heap_.end());
+        }
+        const T& top() const { return heap_.front(); }
+        T pop_top() {
+            std::pop_heap(heap_.begin(), heap_.end());
+            T t = std::move(heap_.back());
+            heap_.pop_back();
+            return t;
+        }
+        // 删除所有满足 pred 的元素后重新建堆，O(n)
+        template<typename Pred>
+        void erase_if(Pred pred) {
+            if(std::erase_if(heap_, pred) > 0) std::make_heap(heap_.begin(), heap_.end());
+        }
+        bool empty() const { return heap_.empty(); }
+        std::size_t size() const { return heap_.size(); }
+    private:
+        std::vector<T> heap_;
+    };
+
+    // 每个 QoS 等级一个 FIFO 队列，下标即 QoS 的值
+    // LockFree 后端下 tasks_[kNormal] 只存放环形队列满时溢出的普通任务
+    std::deque<Task> tasks_[kQoSCount];
+    std::atomic<std::size_t> qos_cnt_[kQoSCount]{};  // tasks_[c].size()，在 mtx_ 下修改，可不加锁读取
+    // 加权公平出队（stride scheduling）的状态，受 mtx_ 保护
+    std::uint64_t stride_[kQoSCount]{};
+    std::uint64_t pass_[kQoSCount]{};
+    std::uint64_t vtime_ = 0;
     // 延时任务队列: 按执行时间排序的小顶堆
-    std::priority_queue<TimeTask> delay_tasks_;
+    MovableHeap<TimeTask> delay_tasks_;
     // 为 true 时表示不再接受新任务，但未完成的任务仍会被处理
-    bool stop_ = false; 
+    // 写入总在 mtx_ 下进行；设为原子变量是为了让 LockFree 后端可以不加锁读取
+    std::atomic<bool> stop_{false};
+    // 停机后有待清理的已取消延时任务（Heap 引擎），见 drop_cancelled_delays()
+    std::atomic<bool> sweep_delays_{false};
 
     mutable std::mutex mtx_;
     std::condition_variable cond_;
+    std::size_t waiters_ = 0;  // 睡在 cond_ 上的线程数（受 mtx_ 保护），push_bulk 据此决定唤醒几个
+
+    // ---- 仅 LockFree 后端使用 ----
+    std::unique_ptr<MPMCQueue<Task>> ring_;  // 为空表示 Locked 后端
+    std::atomic<std::size_t> locked_cnt_{0}; // tasks_[*] + delay_tasks_ 的元素个数，避免加锁判断
+    alignas(kCacheLine) std::atomic<uint32_t> futex_seq_{0}; // 每次 push/stop 自增，空闲线程睡在它上面
+    std::atomic<int> parked_{0};  // 睡在 futex_seq_ 上的线程数，为 0 时生产者跳过 wake 系统调用
+    alignas(kCacheLine) std::atomic<std::size_t> ring_pushers_{0};  // 正在往 ring_ 里写的生产者数，见 begin_ring_push()
+
+    // ---- 容量与水位 ----
+    bool accounting_ = false;  // 设置了 capacity 或水位回调时才维护 ready_cnt_，否则 push / pop 完全不碰它
+    std::size_t capacity_ = 0;
+    OverflowPolicy overflow_ = OverflowPolicy::Block;
+    std::chrono::milliseconds block_timeout_{0};
+    std::size_t high_watermark_ = 0;
+    std::size_t low_watermark_ = 0;
+    std::function<void(bool)> on_watermark_;
+    alignas(kCacheLine) std::atomic<std::size_t> ready_cnt_{0};  // 已占用的容量
+    std::atomic<int> blocked_{0};  // 阻塞在 space_cv_ 上的生产者数，为 0 时消费者跳过唤醒
+    std::mutex space_mtx_;
+    std::condition_variable space_cv_;
+    std::mutex watermark_mtx_;  // 只在水位翻转时使用
+    std::atomic<bool> above_high_{false};
+
+    // ---- 自旋等待 ----
+    std::chrono::microseconds spin_duration_{0};
+    std::chrono::microseconds spin_busy_window_{0};
+    int max_spinners_ = 1;
+    std::atomic<int> spinners_{0};  // 正在自旋的线程数
+    inline static thread_local std::chrono::steady_clock::time_point tls_last_busy_{};  // 本线程最近一次取到任务的时间
+
+    // ---- 仅 Wheel 延时引擎使用 ----
+    std::atomic<std::size_t> wheel_pending_{0};  // 还在时间轮里（尚未进入就绪队列）的延时任务数
+    // 必须是最后一个成员：最先析构，先停掉定时线程，之后它不会再回调 enqueue_fired
+    std::unique_ptr<TimingWheel> wheel_;
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,253 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Task.hpp"
+
+// 分层时间轮：延时任务的 O(1) 插入 / O(1) 取消
+//
+// 共 kLevels 层，每层 kSlots 个槽位，第 L 层的一个槽位覆盖 kSlots^L 个 tick：
+//   - 插入时根据“距离现在还有多少 tick”选层，再用到期 tick 的对应位选槽，挂到槽位的双向链表上
+//   - 每走一个 tick 处理第 0 层的一个槽位；每当低层转完一圈，就把高一层当前槽位里的任务
+//     重新挂到更低的层上（cascade）
+// 一个独立的定时线程负责推进时间，把到期的任务一次性交给 sink（通常是线程池的就绪队列）
+//
+// 节点放在 vector 里用下标串成链表，handle = {下标, 代数}，节点复用时代数 + 1，
+// 所以已经触发或已经取消的 handle 再 cancel 是安全的空操作
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Sink = std::function<void(std::vector<Task>&)>;
+
+    struct Handle {
+        std::uint32_t index = 0;
+        std::uint32_t gen = 0;  // 0 表示无效 handle
+        explicit operator bool() const noexcept { return gen != 0; }
+    };
+
+    // tick: 时间轮精度，延时任务最多比预期晚一个 tick 执行，但绝不会提前
+    TimingWheel(std::chrono::nanoseconds tick, Sink sink)
+        : tick_(tick.count() > 0 ? tick : std::chrono::nanoseconds(1)),
+          start_(Clock::now()),
+          sink_(std::move(sink)) {
+        for(auto &level : slots_)
+            for(auto &head : level) head = kNil;
+        thread_ = std::thread(&TimingWheel::run, this);
+    }
+
+    // 析构时停止定时线程，尚未到期的任务直接丢弃
+    ~TimingWheel() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        if(thread_.joinable()) thread_.join();
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    Handle schedule(Task &&task, Clock::time_point when) {
+        bool was_empty = false;
+        Handle h;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            // 时间轮空着的时候定时线程不走 tick，这里先把 current_ 追到现在
+            if(size_.load(std::memory_order_relaxed) == 0) {
+                current_ = std::max(current_, tick_of(Clock::now()));
+                was_empty = true;
+            }
+            // 向上取整，保证不会提前触发；已经过期的任务放到下一个 tick
+            std::uint64_t expire = ceil_tick_of(when);
+            if(expire <= current_) expire = current_ + 1;
+
+            std::uint32_t idx = alloc_node();
+            Node &n = nodes_[idx];
+            n.task = std::move(task);
+            n.expire = expire;
+            link(idx);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            h = Handle{idx, n.gen};
+        }
+        if(was_empty) cond_.notify_one();
+        return h;
+    }
+
+    // 成功取消返回 true；任务已触发、已取消或 handle 无效时返回 false
+    bool cancel(Handle h) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if(!h || h.index >= nodes_.size()) return false;
+        Node &n = nodes_[h.index];
+        if(n.gen != h.gen || n.slot == kNil) return false;
+        unlink(h.index);
+        n.task.reset();
+        free_node(h.index);
+        size_.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    // 尚未交给 sink 的任务数
+    // 注意：到期任务在 sink 返回之后才会从这里扣除，
+    // 所以 size() == 0 时，所有已触发的任务一定已经进入了 sink
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+
+    std::chrono::nanoseconds tick() const { return tick_; }
+
+private:
+    static constexpr int kLevels = 5;
+    static constexpr int kSlotBits = 6;
+    static constexpr std::uint32_t kSlots = 1u << kSlotBits;
+    static constexpr std::uint64_t kMaxSpan = std::uint64_t{1} << (kSlotBits * kLevels);
+    static constexpr std::uint32_t kNil = UINT32_MAX;
+
+    struct Node {
+        Task task;
+        std::uint64_t expire = 0;
+        std::uint32_t prev = kNil;
+        std::uint32_t next = kNil;
+        std::uint32_t slot = kNil;  // level * kSlots + slot，kNil 表示不在轮上（空闲节点）
+        std::uint32_t gen = 0;
+    };
+
+    std::uint64_t tick_of(Clock::time_point tp) const {
+        if(tp <= start_) return 0;
+        return static_cast<std::uint64_t>((tp - start_) / tick_);
+    }
+    std::uint64_t ceil_tick_of(Clock::time_point tp) const {
+        if(tp <= start_) return 0;
+        auto d = tp - start_;
+        auto t = static_cast<std::uint64_t>(d / tick_);
+        return (d % tick_).count() ? t + 1 : t;
+    }
+
+    std::uint32_t alloc_node() {
+        std::uint32_t idx;
+        if(!free_.empty()) {
+            idx = free_.back();
+            free_.pop_back();
+        }
+        else {
+            idx = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        if(++ nodes_[idx].gen == 0) nodes_[idx].gen = 1;  // 代数回绕时跳过 0
+        return idx;
+    }
+    void free_node(std::uint32_t idx) {
+        nodes_[idx].slot = kNil;
+        free_.push_back(idx);
+    }
+
+    // 根据 expire 与 current_ 的距离选层、选槽（要求 expire >= current_）
+    // 超出 kMaxSpan 的任务也放在最高层，按真实的 expire 选槽：这个槽位每 kMaxSpan 个 tick 被 cascade 一次，
+    // 距离还是太远就原样挂回最高层，直到最后一次 cascade 时落到低层，所以不会提前触发
+    void link(std::uint32_t idx) {
+        Node &n = nodes_[idx];
+        std::uint64_t delta = n.expire - current_;
+        int level = 0;
+        while(level + 1 < kLevels && delta >= (std::uint64_t{1} << (kSlotBits * (level + 1))))
+            ++ level;
+        std::uint32_t slot = static_cast<std::uint32_t>((n.expire >> (kSlotBits * level)) & (kSlots - 1));
+        std::uint32_t &head = slots_[level][slot];
+        n.slot = static_cast<std::uint32_t>(level) * kSlots + slot;
+        n.prev = kNil;
+        n.next = head;
+        if(head != kNil) nodes_[head].prev = idx;
+        head = idx;
+    }
+
+    void unlink(std::uint32_t idx) {
+        Node &n = nodes_[idx];
+        std::uint32_t &head = slots_[n.slot / kSlots][n.slot % kSlots];
+        if(n.prev != kNil) nodes_[n.prev].next = n.next;
+        else head = n.next;
+        if(n.next != kNil) nodes_[n.next].prev = n.prev;
+        n.prev = n.next = kNil;
+    }
+
+    // 取下整个槽位的链表
+    std::uint32_t detach(int level, std::uint32_t slot) {
+        std::uint32_t head = slots_[level][slot];
+        slots_[level][slot] = kNil;
+        return head;
+    }
+
+    // 推进一个 tick：先从高层 cascade，再收集第 0 层当前槽位中的到期任务
+    void advance_one(std::vector<Task> &due) {
+        ++ current_;
+        for(int level = 1; level < kLevels; level ++ ) {
+            // 低 level 层刚好转完一圈时，才需要处理第 level 层
+            if(current_ & ((std::uint64_t{1} << (kSlotBits * level)) - 1)) break;
+            auto slot = static_cast<std::uint32_t>((current_ >> (kSlotBits * level)) & (kSlots - 1));
+            for(std::uint32_t i = detach(level, slot); i != kNil; ) {
+                std::uint32_t next = nodes_[i].next;
+                link(i);
+                i = next;
+            }
+        }
+        auto slot = static_cast<std::uint32_t>(current_ & (kSlots - 1));
+        for(std::uint32_t i = detach(0, slot); i != kNil; ) {
+            std::uint32_t next = nodes_[i].next;
+            due.push_back(std::move(nodes_[i].task));
+            nodes_[i].task.reset();
+            free_node(i);
+            i = next;
+        }
+    }
+
+    void run() {
+        std::vector<Task> due;
+        std::unique_lock<std::mutex> lock(mtx_);
+        while(!stop_) {
+            if(size_.load(std::memory_order_relaxed) == 0) {
+                // 空闲时不走 tick，等待新任务
+                cond_.wait(lock, [this]{ return stop_ || size_.load(std::memory_order_relaxed) > 0; });
+                continue;
+            }
+            auto next_tm = start_ + tick_ * static_cast<std::int64_t>(current_ + 1);
+            if(Clock::now() < next_tm) {
+                cond_.wait_until(lock, next_tm, [this]{ return stop_; });
+                continue;
+            }
+            // 追上所有已经过去的 tick（定时线程被调度延迟时一次处理多个）
+            std::uint64_t now_tick = tick_of(Clock::now());
+            while(current_ < now_tick) advance_one(due);
+            if(due.empty()) continue;
+
+            // 在锁外把到期任务交出去，交完再扣 size_
+            std::size_t n = due.size();
+            lock.unlock();
+            sink_(due);
+            due.clear();
+            size_.fetch_sub(n, std::memory_order_release);
+            lock.lock();
+        }
+    }
+
+private:
+    const std::chrono::nanoseconds tick_;
+    const Clock::time_point start_;
+    Sink sink_;
+
+    std::mutex mtx_;  // 保护下面所有非原子成员
+    std::condition_variable cond_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> free_;
+    std::uint32_t slots_[kLevels][kSlots];
+    std::uint64_t current_ = 0;  // 已经处理到的 tick
+    std::atomic<std::size_t> size_{0};
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef WORK_STEALING_QUEUE_H
+#define WORK_STEALING_QUEUE_H
+
+#include <deque>
+#include <mutex>
+
+// per-worker deque for work stealing
+//   - the owner pushes and pops at the back (LIFO, cache friendly)
+//   - thieves steal from the front (FIFO, oldest and usually largest task)
+// every worker owns exactly one queue, so the lock is almost never contended
+template<typename T>
+class WorkStealingQueue {
+public:
+    WorkStealingQueue() = default;
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+    void push(T &&item) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        deque_.push_back(std::move(item));
+    }
+
+    // owner side: non-blocking, LIFO
+    bool pop(T &item) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if(deque_.empty())
+            return false;
+        item = std::move(deque_.back());
+        deque_.pop_back();
+        return true;
+    }
+
+    // thief side: non-blocking, FIFO
+    bool steal(T &item) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if(deque_.empty())
+            return false;
+        item = std::move(deque_.front());
+        deque_.pop_front();
+        return true;
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return deque_.size();
+    }
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return deque_.empty();
+    }
+
+private:
+    std::deque<T> deque_;
+    mutable std::mutex mtx_;
+};
+
+#endif
@@ -0,0 +1,115 @@
+// 统计“每提交一个任务会产生几次堆分配”
+//   - legacy : 以前的写法，std::function<void()> + make_shared<packaged_task> 再包一层 lambda
+//   - task   : 现在的写法，只可移动的 SBO Task + make_future_task（promise 内联在 Task 里，
+//              共享状态由 RecyclingAllocator 复用）
+// 最后再通过 v4 ThreadPool 端到端跑一遍（包含队列容器本身的分配）
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "Task.hpp"
+#include "v4.hpp"
+
+static std::atomic<std::size_t> g_allocs{0};
+
+// 所有替换版本都经过这两个函数。它们不能内联：否则 GCC 会在调用点看到 operator new 的结果被 free，
+// 报 -Wmismatched-new-delete
+[[gnu::noinline]] static void* counted_alloc(std::size_t n, std::size_t align) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if(n == 0) n = 1;
+    void *p = align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? std::malloc(n)
+                                                        : std::aligned_alloc(align, (n + align - 1) / align * align);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+[[gnu::noinline]] static void counted_free(void *p) noexcept { std::free(p); }
+
+void* operator new(std::size_t n) { return counted_alloc(n, 0); }
+void* operator new[](std::size_t n) { return counted_alloc(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+
+constexpr int N = 100000;
+
+template<typename Fn>
+static double allocs_per_task(Fn &&fn) {
+    std::size_t before = g_allocs.load();
+    for(int i = 0; i < N; i ++ ) fn(i);
+    return static_cast<double>(g_allocs.load() - before) / N;
+}
+
+static void report(const char *name, double legacy, double task) {
+    std::printf("%-28s legacy=%.2f task=%.2f allocs/task\n", name, legacy, task);
+}
+
+int main() {
+    long a = 1, b = 2, c = 3;
+    std::atomic<long> sink{0};
+    // 一个捕获了 3 个指针的小 lambda，典型的“普通任务”大小
+    auto work = [&a, &b, &c](long x) { return a + b + c + x; };
+
+    // 1. 普通任务：bind 之后包进 std::function / Task
+    double legacy_plain = allocs_per_task([&](int i) {
+        std::function<void()> f = std::bind([&](long x) { sink += work(x); }, static_cast<long>(i));
+        f();
+    });
+    double task_plain = allocs_per_task([&](int i) {
+        Task t = std::bind([&](long x) { sink += work(x); }, static_cast<long>(i));
+        t();
+    });
+    report("plain task (bind)", legacy_plain, task_plain);
+
+    // 2. 有返回值的任务
+    double legacy_future = allocs_per_task([&](int i) {
+        auto pt = std::make_shared<std::packaged_task<long()>>(std::bind(work, static_cast<long>(i)));
+        std::future<long> res = pt->get_future();
+        std::function<void()> f = [pt] { (*pt)(); };
+        f();
+        sink += res.get();
+    });
+    double task_future = allocs_per_task([&](int i) {
+        auto [t, res] = make_future_task(work, static_cast<long>(i));
+        t();
+        sink += res.get();
+    });
+    report("future task", legacy_future, task_future);
+
+    // 3. 端到端：经过 v4 ThreadPool（含 TaskQueue 容器的分配，1 个线程避免扩容干扰）
+    {
+        ThreadPool pool(1, 1, 1);
+        double pool_plain = allocs_per_task([&](int i) {
+            pool.add_task([&](long x) { sink += work(x); }, static_cast<long>(i));
+        });
+        std::vector<std::future<long>> fs;
+        fs.reserve(N);
+        double pool_future = allocs_per_task([&](int i) {
+            fs.emplace_back(pool.add_future_task(work, static_cast<long>(i)));
+        });
+        for(auto &f : fs) sink += f.get();
+        // 逐个 get()：共享状态在提交线程上归还，下一次提交直接复用
+        // 上面 N 个 future 同时存活，超出 BlockCache 缓存的部分只能重新分配
+        double pool_future_sync = allocs_per_task([&](int i) {
+            sink += pool.add_future_task(work, static_cast<long>(i)).get();
+        });
+        pool.stop();
+        std::printf("%-28s add_task=%.2f add_future_task=%.2f (%d in flight) %.2f (one at a time) allocs/task\n",
+                    "v4 ThreadPool end-to-end", pool_plain, pool_future, N, pool_future_sync);
+    }
+
+    std::printf("sizeof(std::function<void()>)=%zu sizeof(Task)=%zu\n",
+                sizeof(std::function<void()>), sizeof(Task));
+    return sink.load() == 0;
+}
@@ -0,0 +1,326 @@
+// v1 ~ v4 线程池的吞吐 / 延迟基准
+//
+// 四个版本的类都叫 ThreadPool，不能放进同一个程序，所以每个版本单独编译一次：
+//   g++ -O2 -DPOOL_VERSION=4 src/bench_pool.cpp
+// 所有版本跑同一组场景，每个场景输出一行 JSON（--format=csv 输出 CSV），便于在提交之间对比
+//
+// 指标：
+//   - ops_per_sec : 从第一个任务提交到最后一个任务执行完的吞吐
+//   - p50/p99/p999: 提交到开始执行的延迟（纳秒）；delayed 场景是相对预定时间的迟到量
+//
+// 参数（getopt/bench_opts.h 的公共选项，列表会逐个组合着跑）：
+//       --tasks=N          每个场景的任务数（默认 200000）
+//       --threads=LIST     线程数（默认 hardware_concurrency，至少 2）
+//       --queue=NAMES      v4 的任务队列后端 locked / lockfree（默认 locked）
+//       --spin=LIST        v4 的 worker 取不到任务时先自旋多少微秒再睡眠（默认 0）
+//       --format=json|csv  --header 只打印 CSV 表头
+// v1 ~ v3 没有 --queue / --spin 对应的配置，这两列输出 "-" 和 0
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_opts.h"
+
+#ifndef POOL_VERSION
+#define POOL_VERSION 4
+#endif
+
+#if POOL_VERSION == 1
+#include "v1.hpp"
+#elif POOL_VERSION == 2
+#include "v2.hpp"
+#elif POOL_VERSION == 3
+#include "v3.hpp"
+#elif POOL_VERSION == 4
+#include "v4.hpp"
+#else
+#error "POOL_VERSION must be 1, 2, 3 or 4"
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// 一组组合里的一个：--threads / --queue / --spin 的列表逐个展开
+struct Config {
+    std::size_t tasks = 200000;
+    int threads = std::max(2u, std::thread::hardware_concurrency());
+    std::string queue = "locked";
+    long spin_us = 0;
+    bool csv = false;
+};
+
+// 把各版本不同的接口统一成 submit / submit_batch / submit_delay
+// 没有原生批量或延时接口的版本：批量退化为逐个提交，延时场景直接跳过
+struct Pool {
+#if POOL_VERSION == 4
+    static constexpr bool kNativeBatch = true;
+    static constexpr bool kHasDelay = true;
+
+    explicit Pool(const Config& cfg) : pool(cfg.threads, cfg.threads, 2, options(cfg)) {}
+
+    static ThreadPool::Options options(const Config& cfg) {
+        ThreadPool::Options opts;
+        opts.queue.backend = cfg.queue == "lockfree" ? QueueBackend::LockFree : QueueBackend::Locked;
+        opts.queue.spin_duration = std::chrono::microseconds(cfg.spin_us);
+        return opts;
+    }
+
+    template<typename F>
+    void submit(F&& f) { pool.add_task(std::forward<F>(f)); }
+
+    template<typename F>
+    void submit_batch(std::vector<F>& fs) {
+        std::vector<Task> batch;
+        batch.reserve(fs.size());
+        for (auto& f : fs) batch.emplace_back(std::move(f));
+        pool.add_batch_task(std::move(batch));
+    }
+
+    template<typename F>
+    void submit_delay(std::int64_t delay_ms, F&& f) { pool.add_delay_task(delay_ms, std::forward<F>(f)); }
+
+    ThreadPool pool;
+#else
+    static constexpr bool kNativeBatch = false;
+    static constexpr bool kHasDelay = false;
+
+#if POOL_VERSION == 3
+    explicit Pool(const Config& cfg) : pool(cfg.threads, SchedPolicy::WorkStealing) {}
+#else
+    explicit Pool(const Config& cfg) : pool(cfg.threads) {}
+#endif
+
+    // 只有 push_task 一个接口，返回的 future 直接丢弃（promise 的 future 析构不会阻塞）
+    template<typename F>
+    void submit(F&& f) { pool.push_task(std::forward<F>(f)); }
+
+    template<typename F>
+    void submit_batch(std::vector<F>& fs) {
+        for (auto& f : fs) pool.push_task(std::move(f));
+    }
+
+    template<typename F>
+    void submit_delay(std::int64_t, F&&) {}
+
+    ThreadPool pool;
+#endif
+};
+
+struct Result {
+    std::string scenario;
+    int producers = 1;
+    std::size_t tasks = 0;
+    double seconds = 0;
+    std::int64_t p50 = 0, p99 = 0, p999 = 0;
+};
+
+// 每个任务开始执行时把延迟写进 lat[i]，下标互不相同，不需要同步
+struct Recorder {
+    explicit Recorder(std::size_t n) : lat(n, 0) {}
+
+    void wait_all(std::size_t n) {
+        while (done.load(std::memory_order_acquire) < n) std::this_thread::yield();
+    }
+
+    void percentiles(Result& r) {
+        auto at = [&](double p) {
+            std::size_t k = std::min(lat.size() - 1, static_cast<std::size_t>(p * static_cast<double>(lat.size() - 1)));
+            std::nth_element(lat.begin(), lat.begin() + static_cast<std::ptrdiff_t>(k), lat.end());
+            return lat[k];
+        };
+        r.p50 = at(0.50);
+        r.p99 = at(0.99);
+        r.p999 = at(0.999);
+    }
+
+    std::vector<std::int64_t> lat;
+    std::atomic<std::size_t> done{0};
+};
+
+static void spin_for_ns(std::int64_t ns) {
+    std::int64_t until = now_ns() + ns;
+    while (now_ns() < until) {
+    }
+}
+
+// 空任务 / 长短不一的任务，producers 个线程各提交 tasks / producers 个
+// skew_every > 0 时每 skew_every 个任务里有一个要忙等 skew_ns
+static Result run_submit(const Config& cfg, const char* name, int producers,
+                         std::size_t skew_every = 0, std::int64_t skew_ns = 0) {
+    Pool pool(cfg);
+    std::size_t per = cfg.tasks / static_cast<std::size_t>(producers);
+    std::size_t n = per * static_cast<std::size_t>(producers);
+    Recorder rec(n);
+
+    auto t0 = Clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (std::size_t k = 0; k < per; ++k) {
+                std::size_t i = static_cast<std::size_t>(p) * per + k;
+                std::int64_t submit_ns = now_ns();
+                bool slow = skew_every && i % skew_every == 0;
+                pool.submit([&rec, i, submit_ns, slow, skew_ns] {
+                    rec.lat[i] = now_ns() - submit_ns;
+                    if (slow) spin_for_ns(skew_ns);
+                    rec.done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    rec.wait_all(n);
+    auto t1 = Clock::now();
+
+    Result r{name, producers, n, std::chrono::duration<double>(t1 - t0).count()};
+    rec.percentiles(r);
+    return r;
+}
+
+// 批量提交：每批 batch 个空任务
+static Result run_batch(const Config& cfg, std::size_t batch) {
+    Pool pool(cfg);
+    std::size_t n = cfg.tasks / batch * batch;
+    Recorder rec(n);
+
+    auto make = [&rec](std::size_t i, std::int64_t submit_ns) {
+        return [&rec, i, submit_ns] {
+            rec.lat[i] = now_ns() - submit_ns;
+            rec.done.fetch_add(1, std::memory_order_release);
+        };
+    };
+    using Fn = decltype(make(0, 0));
+    std::vector<Fn> fs;
+    fs.reserve(batch);
+
+    auto t0 = Clock::now();
+    for (std::size_t base = 0; base < n; base += batch) {
+        std::int64_t submit_ns = now_ns();
+        fs.clear();
+        for (std::size_t k = 0; k < batch; ++k) fs.push_back(make(base + k, submit_ns));
+        pool.submit_batch(fs);
+    }
+    rec.wait_all(n);
+    auto t1 = Clock::now();
+
+    Result r{Pool::kNativeBatch ? "batch" : "batch_emulated", 1, n, std::chrono::duration<double>(t1 - t0).count()};
+    rec.percentiles(r);
+    return r;
+}
+
+// 延时任务：延迟 delay_ms，记录相对预定时间的迟到量
+static Result run_delayed(const Config& cfg, std::int64_t delay_ms) {
+    Pool pool(cfg);
+    std::size_t n = std::max<std::size_t>(cfg.tasks / 20, 1);
+    Recorder rec(n);
+
+    auto t0 = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) {
+        std::int64_t due_ns = now_ns() + delay_ms * 1000000;
+        pool.submit_delay(delay_ms, [&rec, i, due_ns] {
+            rec.lat[i] = std::max<std::int64_t>(now_ns() - due_ns, 0);
+            rec.done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    rec.wait_all(n);
+    auto t1 = Clock::now();
+
+    Result r{"delayed", 1, n, std::chrono::duration<double>(t1 - t0).count()};
+    rec.percentiles(r);
+    return r;
+}
+
+static void print(const Config& cfg, const Result& r) {
+    double ops = r.seconds > 0 ? static_cast<double>(r.tasks) / r.seconds : 0;
+    if (cfg.csv) {
+        std::printf("v%d,%s,%d,%d,%s,%ld,%zu,%.6f,%.0f,%lld,%lld,%lld\n", POOL_VERSION, r.scenario.c_str(), r.producers,
+                    cfg.threads, cfg.queue.c_str(), cfg.spin_us, r.tasks, r.seconds, ops, static_cast<long long>(r.p50),
+                    static_cast<long long>(r.p99), static_cast<long long>(r.p999));
+    }
+    else {
+        std::printf("{\"pool\":\"v%d\",\"scenario\":\"%s\",\"producers\":%d,\"threads\":%d,\"queue\":\"%s\","
+                    "\"spin_us\":%ld,\"tasks\":%zu,\"seconds\":%.6f,\"ops_per_sec\":%.0f,\"p50_ns\":%lld,"
+                    "\"p99_ns\":%lld,\"p999_ns\":%lld}\n",
+                    POOL_VERSION, r.scenario.c_str(), r.producers, cfg.threads, cfg.queue.c_str(), cfg.spin_us,
+                    r.tasks, r.seconds, ops,
+                    static_cast<long long>(r.p50), static_cast<long long>(r.p99), static_cast<long long>(r.p999));
+    }
+    std::fflush(stdout);
+}
+
+static void run_all(const Config& cfg) {
+    // 预热：让线程、分配器和时钟都进入稳定状态
+    {
+        Config warm = cfg;
+        warm.tasks = std::min<std::size_t>(cfg.tasks, 10000);
+        run_submit(warm, "warmup", 1);
+    }
+
+    for (int p : {1, 4, 16, 64}) print(cfg, run_submit(cfg, "empty", p));
+    print(cfg, run_submit(cfg, "skewed", 4, 100, 20000));  // 1% 的任务忙等 20us
+    print(cfg, run_batch(cfg, 64));
+    if (Pool::kHasDelay) print(cfg, run_delayed(cfg, 1));
+}
+
+static int on_option(int id, const char* arg, void* ctx) {
+    long tasks = 0;
+    if (id != 'n' || bench_parse_long(arg, 64, &tasks) == -1) return -1;
+    static_cast<Config*>(ctx)->tasks = static_cast<std::size_t>(tasks);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_THREADS | BENCH_OPT_QUEUE | BENCH_OPT_SPIN | BENCH_OPT_FORMAT, nullptr);
+    bench_list_set(&o.threads, cfg.threads);
+    bench_names_set(&o.queue, "locked");
+    bench_list_set(&o.spin, 0);
+    static const bench_extra extra[] = {
+        {"tasks", 'n', required_argument, 'n', "N", "tasks per scenario (default 200000)"},
+        {nullptr, 0, 0, 0, nullptr, nullptr},
+    };
+    int idx = bench_opts_parse(&o, argc, argv, extra, on_option, &cfg);
+    if (idx <= 0) return idx < 0;
+    if (idx != argc) {
+        bench_opts_usage(stderr, argv[0], &o, extra);
+        return 1;
+    }
+    for (int i = 0; i < o.queue.n; ++i) {
+        if (std::strcmp(o.queue.v[i], "locked") != 0 && std::strcmp(o.queue.v[i], "lockfree") != 0) {
+            std::fprintf(stderr, "unknown queue backend: %s (locked or lockfree)\n", o.queue.v[i]);
+            return 1;
+        }
+    }
+    if (o.header) {
+        std::printf("pool,scenario,producers,threads,queue,spin_us,tasks,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns\n");
+        return 0;
+    }
+    cfg.csv = o.csv;
+    if (POOL_VERSION != 4) {
+        bench_names_set(&o.queue, "-");
+        bench_list_set(&o.spin, 0);
+    }
+
+    for (int t = 0; t < o.threads.n; ++t) {
+        for (int q = 0; q < o.queue.n; ++q) {
+            for (int sp = 0; sp < o.spin.n; ++sp) {
+                cfg.threads = static_cast<int>(o.threads.v[t]);
+                cfg.queue = o.queue.v[q];
+                cfg.spin_us = o.spin.v[sp];
+                run_all(cfg);
+            }
+        }
+    }
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <future>
 
+#include "bench_opts.h"
 #include "v1.hpp"
 
 // 一个普通的函数，用于测试非 Lambda 传参
@@ -13,10 +14,18 @@ int multiply(int a, int b) {
     return a * b;
 }
 
-int main() {
-    // 1. 初始化线程池，开启 4 个工作线程
-    ThreadPool pool(4);
-    std::cout << "=== 线程池初始化完成 (4 线程) ===" << std::endl;
+int main(int argc, char** argv) {
+    // 线程数由 --threads 指定（getopt/bench_opts.h），默认 4
+    bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_THREADS, nullptr);
+    bench_list_set(&o.threads, 4);
+    int idx = bench_opts_parse(&o, argc, argv, nullptr, nullptr, nullptr);
+    if(idx <= 0) return idx < 0;
+    const int threads = static_cast<int>(o.threads.v[0]);
+
+    // 1. 初始化线程池，开启 threads 个工作线程
+    ThreadPool pool(threads);
+    std::cout << "=== 线程池初始化完成 (" << threads << " 线程) ===" << std::endl;
 
     // ==========================================
     // 场景一：批量并行计算 (Lambda + 返回值)
@@ -53,13 +62,13 @@ int main() {
     // ==========================================
     // 场景三：并发验证 (观察打印顺序)
     // ==========================================
-    std::cout << "\n[场景 3] 并发验证：同时提交 4 个耗时 2秒 的任务" << std::endl;
-    std::cout << "如果是串行，需要 8秒；如果是并行，只需要约 2秒。" << std::endl;
+    std::cout << "\n[场景 3] 并发验证：同时提交 " << threads << " 个耗时 2秒 的任务" << std::endl;
+    std::cout << "如果是串行，需要 " << 2 * threads << "秒；如果是并行，只需要约 2秒。" << std::endl;
     
     auto start_time = std::chrono::high_resolution_clock::now();
     std::vector<std::future<void>> void_futures;
 
-    for(int i = 0; i < 4; ++i) {
+    for(int i = 0; i < threads; ++i) {
         void_futures.emplace_back(
             pool.push_task([i] {
                 // 模拟耗时
@@ -3,7 +3,9 @@
 #include <chrono>
 #include <string>
 #include <future>
+#include <atomic>
 
+#include "bench_opts.h"
 #include "v3.hpp"
 
 // 一个普通的函数，用于测试非 Lambda 传参
@@ -13,10 +15,18 @@ int multiply(int a, int b) {
     return a * b;
 }
 
-int main() {
-    // 1. 初始化线程池，开启 4 个工作线程
-    ThreadPool pool(4);
-    std::cout << "=== 线程池初始化完成 (4 线程) ===" << std::endl;
+int main(int argc, char** argv) {
+    // 线程数由 --threads 指定（getopt/bench_opts.h），默认 4
+    bench_opts o;
+    bench_opts_init(&o, BENCH_OPT_THREADS, nullptr);
+    bench_list_set(&o.threads, 4);
+    int idx = bench_opts_parse(&o, argc, argv, nullptr, nullptr, nullptr);
+    if(idx <= 0) return idx < 0;
+    const int threads = static_cast<int>(o.threads.v[0]);
+
+    // 1. 初始化线程池，开启 threads 个工作线程
+    ThreadPool pool(threads);
+    std::cout << "=== 线程池初始化完成 (" << threads << " 线程) ===" << std::endl;
 
     // ==========================================
     // 场景一：批量并行计算 (Lambda + 返回值)
@@ -53,13 +63,13 @@ int main() {
     // ==========================================
     // 场景三：并发验证 (观察打印顺序)
     // ==========================================
-    std::cout << "\n[场景 3] 并发验证：同时提交 4 个耗时 2秒 的任务" << std::endl;
-    std::cout << "如果是串行，需要 8秒；如果是并行，只需要约 2秒。" << std::endl;
+    std::cout << "\n[场景 3] 并发验证：同时提交 " << threads << " 个耗时 2秒 的任务" << std::endl;
+    std::cout << "如果是串行，需要 " << 2 * threads << "秒；如果是并行，只需要约 2秒。" << std::endl;
     
     auto start_time = std::chrono::high_resolution_clock::now();
     std::vector<std::future<void>> void_futures;
 
-    for(int i = 0; i < 4; ++i) {
+    for(int i = 0; i < threads; ++i) {
         void_futures.emplace_back(
             pool.push_task([i] {
                 // 模拟耗时
@@ -99,6 +109,39 @@ int main() {
         std::cout << "主线程捕获到了子线程的异常: " << e.what() << std::endl;
     }
 
+
+    // ==========================================
+    // 场景五：工作窃取 (Work Stealing)
+    // ==========================================
+    std::cout << "\n[场景 5] 工作窃取：4 个 300ms 长任务混在 400 个短任务里" << std::endl;
+    {
+        ThreadPool ws_pool(threads, SchedPolicy::WorkStealing);
+        std::atomic<int> done{0};
+        std::vector<std::future<void>> futures;
+
+        start_time = std::chrono::high_resolution_clock::now();
+        for(int i = 0; i < 404; ++i) {
+            bool is_long = (i % 101 == 0);
+            futures.emplace_back(ws_pool.push_task([is_long, &done] {
+                if(is_long) std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                done++;
+            }));
+        }
+        for(auto& f : futures) f.get();
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        std::cout << "完成任务数: " << done.load() << "，总耗时: " << duration << " ms" << std::endl;
+
+        // 在 worker 内部提交的任务会进入该 worker 自己的 deque
+        auto outer = ws_pool.push_task([&ws_pool] {
+            auto inner = ws_pool.push_task([] { return std::this_thread::get_id(); });
+            return inner;
+        });
+        auto inner = outer.get();
+        std::cout << "嵌套提交的任务结果可用: " << std::boolalpha << inner.valid() << std::endl;
+        inner.get();
+    }
+
     return 0;
 }
 
@@ -119,4 +162,8 @@ int main() {
 // 总耗时: 2001 ms
 
 // [场景 4] 测试任务抛出异常...
-// 主线程捕获到了子线程的异常: 这是一个故意的错误！
\ No newline at end of file
+// 主线程捕获到了子线程的异常: 这是一个故意的错误！
+
+// [场景 5] 工作窃取：4 个 300ms 长任务混在 400 个短任务里
+// 完成任务数: 404，总耗时: 301 ms
+// 嵌套提交的任务结果可用: true
\ No newline at end of file
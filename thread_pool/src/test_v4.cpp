@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <chrono>
@@ -7,7 +8,10 @@
 #include <sstream>
 #include <stdexcept>
 
-#include "tmp.hpp" 
+#include "v4.hpp"
+#include "Parallel.hpp"
+#include "Coro.hpp"
+#include "Future.hpp"
 
 // 简单的测试辅助宏
 #define TEST_CASE(name) \
@@ -97,7 +101,7 @@ void test_concurrency() {
 }
 
 // =========================================================================
-// 3. 优先级测试：验证 deque 头插 / 尾插的行为
+// 3. 优先级测试：Critical 任务先于已积压的普通任务执行
 // =========================================================================
 void test_priority() {
     TEST_CASE("Priority Task Queue");
@@ -122,7 +126,7 @@ void test_priority() {
         results.push_back(2); 
     });
 
-    // 3. 扔一个高优先级任务（deque 头插）
+    // 3. 扔一个高优先级任务（QoS::Critical）
     pool.add_priority_task([&]{ 
         std::lock_guard<std::mutex> lk(res_mutex); 
         results.push_back(999); 
@@ -132,7 +136,7 @@ void test_priority() {
 
     // 预期顺序：999 (插队), 1, 2
     ASSERT_TRUE(results.size() == 3, "All tasks executed");
-    ASSERT_TRUE(results[0] == 999, "Priority task should execute first (deque front)");
+    ASSERT_TRUE(results[0] == 999, "Priority task should execute first");
     ASSERT_TRUE(results[1] == 1, "Normal task 1 executes after priority");
     ASSERT_TRUE(results[2] == 2, "Normal task 2 executes last");
 }
@@ -326,6 +330,824 @@ void test_stop_semantics() {
     ASSERT_TRUE(caught2, "add_future_task after stop should throw");
 }
 
+// =========================================================================
+// 8. 无锁后端：多生产者 + 环形队列溢出 + 优先级/延时任务混用
+// =========================================================================
+void test_lock_free_backend() {
+    TEST_CASE("Lock-free MPMC Ring Backend");
+
+    ThreadPool::Options opts;
+    opts.queue.backend = QueueBackend::LockFree;
+    opts.queue.ring_capacity = 64;  // 故意设得很小，触发溢出到加锁 deque 的路径
+    ThreadPool pool(2, 8, 1, opts);
+
+    std::atomic<int> counter{0};
+    const int producers = 8;
+    const int per_producer = 5000;
+    std::vector<std::thread> ps;
+    for (int p = 0; p < producers; ++p) {
+        ps.emplace_back([&] {
+            for (int i = 0; i < per_producer; ++i) {
+                pool.add_task([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    for (auto& t : ps) t.join();
+
+    std::atomic<bool> delayed{false};
+    pool.add_delay_task(100, [&delayed] { delayed = true; });
+    auto f = pool.add_future_task([] { return 7; });
+    ASSERT_TRUE(f.get() == 7, "Future task works on lock-free backend");
+
+    bool ok = wait_until(std::chrono::milliseconds(2000), [&] { return delayed.load(); });
+    ASSERT_TRUE(ok, "Delay task wakes a futex-parked worker");
+
+    pool.stop();
+    ASSERT_TRUE(counter.load() == producers * per_producer,
+                "All tasks from 8 producers executed exactly once");
+
+    // stop() 与并发的 add_task 赛跑：被接受的任务必须全部执行，不能在 worker 退出之后才进入 ring
+    bool all_ran = true;
+    for (int round = 0; round < 50 && all_ran; ++round) {
+        ThreadPool racing(2, 2, 1, opts);
+        std::atomic<int> accepted{0}, ran{0};
+        std::vector<std::thread> racers;
+        for (int p = 0; p < 4; ++p) {
+            racers.emplace_back([&] {
+                for (;;) {
+                    try {
+                        racing.add_task([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+                    } catch (const std::runtime_error&) {
+                        return;
+                    }
+                    accepted.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        racing.stop();
+        for (auto& t : racers) t.join();
+        all_ran = accepted.load() == ran.load();
+    }
+    ASSERT_TRUE(all_ran, "tasks accepted while stop() races with producers all run");
+}
+
+// =========================================================================
+// 9. 批量接口：push_bulk 一次加锁入队，pop_bulk 一次取一小批
+// =========================================================================
+void test_bulk_api() {
+    TEST_CASE("Bulk push / pop");
+
+    for (auto backend : {QueueBackend::Locked, QueueBackend::LockFree}) {
+        TaskQueueOptions qopts;
+        qopts.backend = backend;
+        qopts.ring_capacity = 8;  // LockFree 下让一部分任务溢出到 deque
+        TaskQueue q(qopts);
+
+        int hits = 0;
+        std::vector<TaskQueue::Task> in;
+        for (int i = 0; i < 10; ++i) in.emplace_back([&hits] { ++hits; });
+        ASSERT_TRUE(q.push_bulk(in) == 10, "push_bulk enqueues the whole range");
+
+        std::vector<TaskQueue::Task> out;
+        auto r = q.pop_bulk(out, 4, std::chrono::seconds(1));
+        ASSERT_TRUE(r == TaskQueue::PopResult::OK && out.size() == 4, "pop_bulk takes at most max_n tasks");
+        for (auto& t : out) t();
+        while (q.pop_bulk(out, 100, std::chrono::seconds(0)) == TaskQueue::PopResult::OK) {
+            for (auto& t : out) t();
+        }
+        ASSERT_TRUE(hits == 10, "every bulk-pushed task popped exactly once");
+    }
+
+    // fan-out：10 万个小任务一次提交，worker 每次取 16 个
+    ThreadPool::Options opts;
+    opts.worker_batch = 16;
+    ThreadPool pool(4, 4, 1, opts);
+    std::atomic<int> sum{0};
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < 100000; ++i) tasks.emplace_back([&sum] { sum.fetch_add(1, std::memory_order_relaxed); });
+    pool.add_batch_task(std::move(tasks));
+    pool.stop();
+    ASSERT_TRUE(sum == 100000, "100k batch tasks executed with worker_batch=16");
+}
+
+// =========================================================================
+// 10. 时间轮延时引擎：精度、O(1) 取消、停机时排空
+// =========================================================================
+void test_timing_wheel() {
+    TEST_CASE("Timing Wheel Delay Engine");
+
+    // 直接测 TaskQueue：取消后的任务不会再出现
+    {
+        TaskQueueOptions qopts;
+        qopts.delay_engine = DelayEngine::Wheel;
+        qopts.wheel_tick = std::chrono::milliseconds(1);
+        TaskQueue q(qopts);
+
+        std::atomic<int> fired{0};
+        std::vector<TaskQueue::DelayHandle> hs;
+        auto when = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+        for (int i = 0; i < 1000; ++i) {
+            hs.push_back(q.push_delay([&fired] { fired++; }, when));
+        }
+        int cancelled = 0;
+        for (int i = 0; i < 1000; i += 2) cancelled += q.cancel_delay(hs[i]);
+        ASSERT_TRUE(cancelled == 500, "cancel_delay succeeds for pending tasks");
+        ASSERT_TRUE(!q.cancel_delay(hs[0]), "cancelling twice is a no-op");
+        ASSERT_TRUE(q.size() == 500, "cancelled tasks leave the queue immediately");
+
+        TaskQueue::Task t;
+        int got = 0;
+        bool early = false;
+        while (got < 500 && q.pop(t, std::chrono::seconds(1)) == TaskQueue::PopResult::OK) {
+            early = early || std::chrono::steady_clock::now() < when;
+            t();
+            ++got;
+        }
+        ASSERT_TRUE(!early, "wheel tasks never fire early");
+        ASSERT_TRUE(fired == 500, "only uncancelled tasks fire");
+        ASSERT_TRUE(!q.cancel_delay(hs[1]), "cancel after fire returns false");
+    }
+
+    // 通过 ThreadPool：两种后端下的精度，以及 stop() 等待时间轮中的任务
+    for (auto backend : {QueueBackend::Locked, QueueBackend::LockFree}) {
+        ThreadPool::Options opts;
+        opts.queue.backend = backend;
+        opts.queue.delay_engine = DelayEngine::Wheel;
+        opts.queue.wheel_tick = std::chrono::milliseconds(2);
+        ThreadPool pool(2, 4, 1, opts);
+
+        std::atomic<int> ok{0};
+        std::vector<int> delays = {1, 10, 130, 300, 1250};  // 2ms tick 下后几个落在第 1、2 层
+        for (int d : delays) {
+            auto start = std::chrono::steady_clock::now();
+            pool.add_delay_task(d, [&ok, start, d] {
+                auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                if (dur >= d) ok++;
+            });
+        }
+        pool.stop();
+        ASSERT_TRUE(ok == static_cast<int>(delays.size()),
+                    "wheel delay tasks run on time and stop() drains the wheel");
+    }
+}
+
+// =========================================================================
+// 11. 可取消的延时任务与周期任务（Heap / Wheel 两种引擎）
+// =========================================================================
+void test_cancel_and_periodic() {
+    TEST_CASE("Cancellable Delay & Periodic Tasks");
+
+    for (auto engine : {DelayEngine::Heap, DelayEngine::Wheel}) {
+        ThreadPool::Options opts;
+        opts.queue.delay_engine = engine;
+        ThreadPool pool(2, 4, 1, opts);
+
+        std::atomic<int> fired{0};
+        std::vector<DelayTaskHandle> hs;
+        for (int i = 0; i < 100; ++i) {
+            hs.push_back(pool.add_delay_task(50, [&fired] { fired++; }));
+        }
+        int cancelled = 0;
+        for (int i = 0; i < 100; i += 2) cancelled += hs[i].cancel();
+        ASSERT_TRUE(cancelled == 50, "cancel() succeeds before the task runs");
+        ASSERT_TRUE(!hs[0].cancel(), "second cancel() returns false");
+
+        std::atomic<int> ticks{0};
+        auto periodic = pool.add_periodic_task(10, [&ticks] { ticks++; });
+        bool ok = wait_until(std::chrono::milliseconds(2000), [&] { return ticks.load() >= 5; });
+        ASSERT_TRUE(ok, "periodic task re-arms itself");
+        ASSERT_TRUE(periodic.cancel(), "periodic task can be cancelled");
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        int after_cancel = ticks.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_TRUE(ticks.load() == after_cancel, "cancelled periodic task stops firing");
+
+        ASSERT_TRUE(fired == 50, "only the uncancelled delay tasks ran");
+        ASSERT_TRUE(!hs[1].cancel(), "cancel() after the task ran returns false");
+
+        // stop() 不会等一个已取消的长延时任务，也不会等周期任务的下一次
+        pool.add_periodic_task(60 * 1000, [] {});
+        pool.add_delay_task(60 * 1000, [] {}).cancel();
+        auto t0 = std::chrono::steady_clock::now();
+        pool.stop();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        ASSERT_TRUE(ms < 500, "stop() returns promptly with cancelled / periodic tasks pending");
+    }
+
+    // 停机时积压大量延时任务：排空它们是线性的，不会每次 pop 都把整个堆扫一遍
+    {
+        ThreadPool pool(1, 1, 1);
+        std::atomic<int> fired{0};
+        const int backlog = 50000;
+        for (int i = 0; i < backlog; ++i) pool.add_delay_task(20, [&fired] { fired++; });
+        auto t0 = std::chrono::steady_clock::now();
+        pool.stop();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+        ASSERT_TRUE(fired == backlog && ms < 1000, "stop() drains a large delay backlog in linear time");
+    }
+}
+
+// =========================================================================
+// 12. QoS 等级：等级内 FIFO，等级间加权公平，后台任务不会被饿死
+// =========================================================================
+void test_qos_classes() {
+    TEST_CASE("QoS Classes & Weighted-fair Dequeue");
+
+    for (auto backend : {QueueBackend::Locked, QueueBackend::LockFree}) {
+        ThreadPool::Options opts;
+        opts.queue.backend = backend;
+        ThreadPool pool(1, 1, 1, opts);
+        std::vector<std::pair<QoS, int>> order;
+        std::mutex mtx;
+        auto record = [&](QoS q, int i) {
+            std::lock_guard<std::mutex> lk(mtx);
+            order.emplace_back(q, i);
+        };
+
+        pool.add_task([] { std::this_thread::sleep_for(std::chrono::milliseconds(100)); });
+        for (int i = 0; i < 64; ++i) pool.add_qos_task(QoS::Critical, record, QoS::Critical, i);
+        for (int i = 0; i < 16; ++i) pool.add_qos_task(QoS::Normal, record, QoS::Normal, i);
+        for (int i = 0; i < 4; ++i) pool.add_qos_task(QoS::Background, record, QoS::Background, i);
+        ASSERT_TRUE(pool.pending() >= 84 - 1, "tasks are queued behind the blocker");
+        pool.stop();
+
+        ASSERT_TRUE(order.size() == 84, "every QoS task executed");
+        ASSERT_TRUE(order.front().first == QoS::Critical, "critical work runs first");
+        int next[kQoSCount] = {0, 0, 0};
+        bool fifo = true;
+        int first_bg = -1, crit_in_first_21 = 0;
+        for (int k = 0; k < static_cast<int>(order.size()); ++k) {
+            auto [q, i] = order[k];
+            fifo = fifo && i == next[static_cast<int>(q)]++;
+            if (q == QoS::Background && first_bg < 0) first_bg = k;
+            if (k < 21 && q == QoS::Critical) crit_in_first_21++;
+        }
+        ASSERT_TRUE(fifo, "tasks within a class run FIFO");
+        ASSERT_TRUE(crit_in_first_21 >= 14, "critical class gets most of the worker (weight 16:4:1)");
+        ASSERT_TRUE(first_bg >= 0 && first_bg < 32, "background still runs while critical work is backlogged");
+    }
+}
+
+// =========================================================================
+// 13. 绑核与 NUMA 分片：submit_on_node、本节点优先、跨节点窃取
+// =========================================================================
+void test_numa_placement() {
+    TEST_CASE("CPU Affinity & NUMA-sharded Queues");
+
+    auto cpus = numa::parse_cpulist("0-3,8,10-11\n");
+    ASSERT_TRUE((cpus == std::vector<int>{0, 1, 2, 3, 8, 10, 11}), "cpulist parsing");
+    ASSERT_TRUE(!numa::nodes().empty() && !numa::nodes().front().cpus.empty(), "topology has at least one node");
+
+    int cpu0 = numa::allowed_cpus().front();
+    {
+        ThreadPool::Options opts;
+        opts.placement = Placement::CpuSet;
+        opts.cpus = {cpu0};
+        ThreadPool pool(1, 1, 1, opts);
+        auto f = pool.add_future_task([] { return numa::allowed_cpus(); });
+        ASSERT_TRUE((f.get() == std::vector<int>{cpu0}), "CpuSet pins workers to the given CPUs");
+    }
+
+    // 两个“虚拟节点”都放在同一个 CPU 上，方便在单核机器上测试
+    ThreadPool::Options opts;
+    opts.placement = Placement::NumaNodes;
+    opts.node_cpus = {{cpu0}, {cpu0}};
+    ThreadPool pool(2, 2, 1, opts);
+    ASSERT_TRUE(pool.node_count() == 2, "one queue shard per node");
+
+    bool caught = false;
+    try {
+        pool.submit_on_node(2, [] {});
+    } catch (const std::out_of_range&) {
+        caught = true;
+    }
+    ASSERT_TRUE(caught, "submit_on_node rejects unknown nodes");
+
+    // 占住 1 号节点唯一的 worker，再往 1 号节点塞任务：只能被 0 号节点窃取执行
+    std::atomic<bool> release{false};
+    std::atomic<int> done{0};
+    pool.submit_on_node(1, [&release] {
+        while (!release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 10; ++i) pool.submit_on_node(1, [&done] { done++; });
+    bool stolen = wait_until(std::chrono::milliseconds(1000), [&] { return done.load() == 10; });
+    release = true;
+    ASSERT_TRUE(stolen, "idle node steals from a busy node");
+
+    std::atomic<int> sum{0};
+    for (int i = 0; i < 1000; ++i) pool.add_task([&sum] { sum++; });
+    pool.stop();
+    ASSERT_TRUE(sum == 1000, "round-robin submission across shards runs every task");
+}
+
+// =========================================================================
+// 14. 自旋后再睡眠：乒乓式的短任务在两种后端下都不丢任务、不丢唤醒
+// =========================================================================
+void test_spin_then_park() {
+    TEST_CASE("Spin-then-park Idle Wait");
+
+    for (auto backend : {QueueBackend::Locked, QueueBackend::LockFree}) {
+        ThreadPool::Options opts;
+        opts.queue.backend = backend;
+        opts.queue.spin_duration = std::chrono::microseconds(50);
+        opts.queue.max_spinners = 1;
+        ThreadPool pool(2, 2, 1, opts);
+
+        // 每次只有一个任务在飞：提交 -> 等它完成 -> 再提交，正好落在 worker 的自旋窗口里
+        int sum = 0;
+        for (int i = 0; i < 2000; ++i) {
+            sum += pool.add_future_task([i] { return i % 3; }).get();
+        }
+        ASSERT_TRUE(sum == 1999, "ping-pong tasks all complete with spinning enabled");
+
+        // 空闲超过 spin_busy_window 后再提交，worker 已经睡下，仍然能被唤醒
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto f = pool.add_future_task([] { return 5; });
+        ASSERT_TRUE(f.get() == 5, "parked worker is still woken after the busy window");
+        pool.stop();
+    }
+}
+
+// =========================================================================
+// 15. 统计：对数直方图、排队/执行时间、扩缩容事件
+// =========================================================================
+void test_stats() {
+    TEST_CASE("Latency & Queueing Stats");
+
+    bool monotonic = true;
+    for (std::size_t i = 1; i < LogHistogram::kBuckets - 8; ++i) {
+        auto lo = LogHistogram::lower_bound_of(i);
+        monotonic = monotonic && lo > LogHistogram::lower_bound_of(i - 1) && LogHistogram::index_of(lo) == i &&
+                    LogHistogram::index_of(lo - 1) == i - 1;
+    }
+    ASSERT_TRUE(monotonic, "histogram bucket bounds round-trip through index_of");
+
+    ThreadPool pool(1, 4, 1);
+    for (int i = 0; i < 40; ++i) pool.add_task(heavy_task, 2);
+    auto f = pool.add_future_task([] { return 1; });
+    f.get();
+    ASSERT_TRUE(wait_until(std::chrono::milliseconds(3000), [&] { return pool.pending() == 0; }), "tasks drained");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    ThreadPoolStats st = pool.stats();  // 线程池仍在运行
+#if THREAD_POOL_ENABLE_STATS
+    ASSERT_TRUE(st.enabled, "stats compiled in");
+    ASSERT_TRUE(st.exec_time.count == 41 && st.queue_wait.count == 41, "every task recorded once");
+    ASSERT_TRUE(st.exec_time.percentile(0.5) >= 1500000, "p50 exec time reflects the 2ms tasks");
+    ASSERT_TRUE(st.exec_time.percentile(0.0) <= st.exec_time.percentile(0.99), "percentiles are ordered");
+    ASSERT_TRUE(st.queue_wait.max > 0, "queue wait measured for backlogged tasks");
+    ASSERT_TRUE(st.grow_events >= 1 && st.threads_started > 1, "grow events counted");
+#else
+    ASSERT_TRUE(!st.enabled, "stats compiled out");
+#endif
+    pool.stop();
+}
+
+// =========================================================================
+// 17. fork-join：parallel_for / parallel_reduce / TaskGraph，协作式等待
+// =========================================================================
+void test_parallel() {
+    TEST_CASE("Fork-Join & Task Graph");
+
+    ThreadPool pool(2, 4, 1);
+
+    std::vector<int> hits(10000, 0);
+    parallel_for(pool, 0, 10000, 64, [&](int i) { hits[i]++; });
+    ASSERT_TRUE(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }), "parallel_for visits every index once");
+
+    std::atomic<int> chunks{0};
+    parallel_for(pool, std::size_t(0), 1000, 100, [&](std::size_t lo, std::size_t hi) {
+        if (hi - lo == 100) chunks++;
+    });
+    ASSERT_TRUE(chunks.load() == 10, "range form receives grain-sized chunks");
+
+    long long sum = parallel_reduce(pool, 0, 100000, 1000, 0LL,
+        [](int lo, int hi) { long long s = 0; for (int i = lo; i < hi; ++i) s += i; return s; },
+        [](long long a, long long b) { return a + b; });
+    ASSERT_TRUE(sum == 4999950000LL, "parallel_reduce sums [0, 100000)");
+
+    bool thrown = false;
+    try {
+        parallel_for(pool, 0, 100, 1, [](int i) { if (i == 42) throw std::runtime_error("bad item"); });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown, "exception from a chunk is rethrown to the caller");
+
+    // 只有一个 worker：它在任务里等待子任务，如果不是协作式等待就会死锁
+    {
+        ThreadPool single(1, 1, 1);
+        auto f = single.add_future_task([&single] {
+            return parallel_reduce(single, 0, 256, 8, 0,
+                [&single](int lo, int hi) {
+                    std::atomic<int> inner{0};
+                    parallel_for(single, lo, hi, 1, [&](int) { inner++; });
+                    return inner.load();
+                },
+                [](int a, int b) { return a + b; });
+        });
+        ASSERT_TRUE(f.wait_for(std::chrono::seconds(5)) == std::future_status::ready, "nested fork-join on a 1-thread pool does not deadlock");
+        ASSERT_TRUE(f.get() == 256, "nested fork-join result");
+    }
+
+    // 菱形依赖：a -> {b, c} -> d
+    TaskGraph g;
+    std::atomic<int> clock{0};
+    int ta = -1, tb = -1, tc = -1, td = -1;
+    auto a = g.emplace([&] { ta = clock++; });
+    auto b = g.emplace([&] { heavy_task(5); tb = clock++; });
+    auto c = g.emplace([&] { tc = clock++; });
+    auto d = g.emplace([&] { td = clock++; });
+    g.precede(a, b);
+    g.precede(a, c);
+    g.precede(b, d);
+    g.precede(c, d);
+    g.run(pool);
+    ASSERT_TRUE(ta == 0 && td == 3 && tb > ta && tc > ta, "graph respects dependencies");
+    g.run(pool);
+    ASSERT_TRUE(clock.load() == 8 && td == 7, "graph can be run again");
+
+    TaskGraph cyclic;
+    bool ran = false;
+    auto x = cyclic.emplace([&] { ran = true; });
+    auto y = cyclic.emplace([&] { ran = true; });
+    cyclic.precede(x, y);
+    cyclic.precede(y, x);
+    bool rejected = false;
+    try {
+        cyclic.run(pool);
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    ASSERT_TRUE(rejected && !ran, "cyclic graph is rejected before running");
+
+    pool.stop();
+
+    // 线程池已经停止：run() 在当前线程执行原来的可调用对象，而不是被移走的空壳
+    std::string got;
+    TaskGroup late(pool);
+    late.run([&got, s = std::string("payload")] { got = s; });
+    late.wait();
+    ASSERT_TRUE(got == "payload", "TaskGroup::run after stop() runs the original callable inline");
+}
+
+// =========================================================================
+// 18. ScalingPolicy：监督线程扩缩容、停放线程复用、自定义决策
+// =========================================================================
+void test_scaling_policy() {
+    TEST_CASE("Hysteresis Scaling Policy");
+
+    ThreadPool::Options opts;
+    opts.scaling.enabled = true;
+    opts.scaling.interval = std::chrono::milliseconds(5);
+    opts.scaling.shrink_hold = 4;
+    opts.scaling.max_grow_per_tick = 1;
+    opts.scaling.parked_reserve = 1;
+    {
+        ThreadPool pool(1, 2, 1, opts);
+        for (int i = 0; i < 40; ++i) pool.add_task(heavy_task, 5);
+        ASSERT_TRUE(wait_until(std::chrono::milliseconds(2000), [&] { return pool.active_threads_count() == 2; }), "supervisor grows the pool under backlog");
+        ASSERT_TRUE(wait_until(std::chrono::milliseconds(3000), [&] { return pool.pending() == 0; }), "backlog drained");
+
+        // 空闲超时之后，多出来的线程被停放而不是退出
+        ASSERT_TRUE(wait_until(std::chrono::milliseconds(4000), [&] { return pool.parked_threads_count() == 1; }), "idle extra thread is parked");
+        ASSERT_TRUE(pool.active_threads_count() == 2, "parked thread is kept alive");
+
+        for (int i = 0; i < 40; ++i) pool.add_task(heavy_task, 5);
+        ASSERT_TRUE(wait_until(std::chrono::milliseconds(2000), [&] { return pool.parked_threads_count() == 0; }), "parked thread is reactivated for the next burst");
+#if THREAD_POOL_ENABLE_STATS
+        ASSERT_TRUE(pool.stats().threads_started == 2, "reactivation does not spawn a new thread");
+#endif
+        pool.stop();
+    }
+
+    // 自定义决策：永远返回 0，线程池就不会扩容
+    std::atomic<int> samples{0};
+    opts.scaling.decide = [&](const ScalingSample& s) {
+        if (s.serving >= 1) samples++;
+        return 0;
+    };
+    {
+        ThreadPool pool(1, 4, 1, opts);
+        for (int i = 0; i < 20; ++i) pool.add_task(heavy_task, 5);
+        ASSERT_TRUE(wait_until(std::chrono::milliseconds(3000), [&] { return pool.pending() == 0; }), "custom policy still drains");
+        ASSERT_TRUE(samples.load() > 0 && pool.active_threads_count() == 1, "custom decide() controls scaling");
+        pool.stop();
+    }
+}
+
+// =========================================================================
+// 19. 协程：co_await pool.schedule() / sleep_for()，coro::task 的对称转移
+// =========================================================================
+coro::task<int> coro_add(ThreadPool& pool, int a, int b, std::thread::id* ran_on) {
+    co_await pool.schedule();
+    *ran_on = std::this_thread::get_id();
+    co_return a + b;
+}
+
+coro::task<int> coro_chain(ThreadPool& pool, std::thread::id* inner, std::thread::id* outer) {
+    int v = co_await coro_add(pool, 1, 2, inner);
+    *outer = std::this_thread::get_id();  // 内层在哪个 worker 上结束，外层就在哪里接着执行
+    co_return v * 10;
+}
+
+coro::task<void> coro_throw(ThreadPool& pool) {
+    co_await pool.schedule();
+    throw std::runtime_error("coroutine failure");
+}
+
+coro::task<void> coro_sleeper(ThreadPool& pool, std::atomic<int>& done) {
+    co_await pool.sleep_for(50);
+    done++;
+}
+
+void test_coroutines() {
+    TEST_CASE("Coroutine Executor");
+
+    ThreadPool pool(2, 4, 1);
+
+    std::thread::id ran_on;
+    ASSERT_TRUE(coro::sync_wait(coro_add(pool, 3, 4, &ran_on)) == 7, "task<int> returns its value");
+    ASSERT_TRUE(ran_on != std::this_thread::get_id(), "schedule() resumes on a worker");
+
+    std::thread::id inner, outer;
+    ASSERT_TRUE(coro::sync_wait(coro_chain(pool, &inner, &outer)) == 30, "nested co_await");
+    ASSERT_TRUE(inner == outer, "continuation resumes inline on the completing worker");
+
+    bool thrown = false;
+    try {
+        coro::sync_wait(coro_throw(pool));
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown, "exception propagates through sync_wait");
+
+    auto lazy = coro_add(pool, 0, 0, &ran_on);
+    ASSERT_TRUE(pool.pending() == 0, "task is lazy until awaited");
+    coro::sync_wait(std::move(lazy));
+
+    // 只有一个 worker：100 个协程同时 sleep_for，不会互相占着线程
+    {
+        ThreadPool single(1, 1, 1);
+        std::atomic<int> done{0};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 100; ++i) coro::spawn(coro_sleeper(single, done));
+        ASSERT_TRUE(wait_until(std::chrono::milliseconds(3000), [&] { return done.load() == 100; }, std::chrono::milliseconds(5)), "100 sleeping coroutines complete");
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        ASSERT_TRUE(ms >= 50 && ms < 1000, "sleep_for suspends without holding the worker");
+        single.stop();
+    }
+
+    pool.stop();
+}
+
+// =========================================================================
+// 20. 有界队列与背压：capacity + Block / Reject / CallerRuns，水位回调
+// =========================================================================
+void test_backpressure() {
+    TEST_CASE("Bounded Queue & Backpressure");
+    using namespace std::chrono_literals;
+
+    for (auto backend : {QueueBackend::Locked, QueueBackend::LockFree}) {
+        const char* tag = backend == QueueBackend::Locked ? " (Locked)" : " (LockFree)";
+        TaskQueueOptions qo;
+        qo.backend = backend;
+        qo.capacity = 2;
+        qo.overflow = OverflowPolicy::Reject;
+        TaskQueue q(qo);
+        int ran = 0;
+        ASSERT_TRUE(q.push(TaskQueue::Task([&] { ran++; })) == PushResult::OK &&
+                    q.push(TaskQueue::Task([&] { ran++; })) == PushResult::OK, std::string("pushes within capacity succeed") + tag);
+        TaskQueue::Task extra([&] { ran += 10; });
+        ASSERT_TRUE(q.push(std::move(extra)) == PushResult::Rejected && extra, std::string("reject-newest keeps the task intact") + tag);
+
+        TaskQueue::Task t;
+        q.pop(t, 0ms);
+        t();
+        ASSERT_TRUE(q.ready() == 1 && q.try_push(std::move(extra)) == PushResult::OK && !extra, std::string("pop frees a slot") + tag);
+
+        // push_bulk 只接受放得下的前缀
+        std::vector<TaskQueue::Task> batch;
+        for (int i = 0; i < 3; ++i) batch.emplace_back([&] { ran++; });
+        ASSERT_TRUE(q.push_bulk(batch) == 0 && batch[0] && batch[2], std::string("full queue rejects the whole bulk suffix") + tag);
+        q.stop();
+        while (q.pop(t, 0ms) == TaskQueue::PopResult::OK) t();
+        ASSERT_TRUE(ran == 12 && q.ready() == 0, std::string("accepted tasks all run") + tag);
+    }
+
+    // CallerRuns：放不下的任务在提交线程上执行
+    {
+        TaskQueueOptions qo;
+        qo.capacity = 1;
+        qo.overflow = OverflowPolicy::CallerRuns;
+        TaskQueue q(qo);
+        std::thread::id ran_on;
+        q.push(TaskQueue::Task([] {}));
+        ASSERT_TRUE(q.push(TaskQueue::Task([&] { ran_on = std::this_thread::get_id(); })) == PushResult::RanInline &&
+                    ran_on == std::this_thread::get_id(), "caller-runs executes on the submitting thread");
+        std::vector<TaskQueue::Task> batch;
+        int n = 0;
+        for (int i = 0; i < 3; ++i) batch.emplace_back([&] { n++; });
+        ASSERT_TRUE(q.push_bulk(batch) == 3 && n == 3 && q.ready() == 1, "caller-runs bulk: overflow runs inline");
+        q.stop();
+    }
+
+    // Block：等 block_timeout 后拒绝；期间有任务出队就能放进去；stop() 叫醒阻塞的生产者
+    {
+        TaskQueueOptions qo;
+        qo.capacity = 1;
+        qo.block_timeout = 50ms;
+        TaskQueue q(qo);
+        q.push(TaskQueue::Task([] {}));
+        auto t0 = std::chrono::steady_clock::now();
+        ASSERT_TRUE(q.push(TaskQueue::Task([] {})) == PushResult::Rejected &&
+                    std::chrono::steady_clock::now() - t0 >= 50ms, "block times out, then rejects");
+
+        qo.block_timeout = 5000ms;
+        TaskQueue q2(qo);
+        q2.push(TaskQueue::Task([] {}));
+        std::thread consumer([&] {
+            std::this_thread::sleep_for(30ms);
+            TaskQueue::Task t;
+            q2.pop(t, 0ms);
+        });
+        t0 = std::chrono::steady_clock::now();
+        ASSERT_TRUE(q2.push(TaskQueue::Task([] {})) == PushResult::OK &&
+                    std::chrono::steady_clock::now() - t0 < 2000ms, "blocked producer wakes when a slot frees");
+        consumer.join();
+
+        std::thread stopper([&] {
+            std::this_thread::sleep_for(30ms);
+            q2.stop();
+        });
+        ASSERT_TRUE(q2.push(TaskQueue::Task([] {})) == PushResult::Stopped, "stop() releases blocked producers");
+        stopper.join();
+        q.stop();
+    }
+
+    // 水位回调：涨到 high 报一次 true，回落到 low 报一次 false
+    {
+        std::vector<bool> events;
+        TaskQueueOptions qo;
+        qo.high_watermark = 3;
+        qo.low_watermark = 1;
+        qo.on_watermark = [&](bool high) { events.push_back(high); };
+        TaskQueue q(qo);
+        for (int i = 0; i < 5; ++i) q.push(TaskQueue::Task([] {}));
+        ASSERT_TRUE(events == std::vector<bool>{true}, "high watermark fires once");
+        TaskQueue::Task t;
+        for (int i = 0; i < 3; ++i) q.pop(t, 0ms);
+        ASSERT_TRUE(events == std::vector<bool>{true}, "no low event above low_watermark");
+        q.pop(t, 0ms);
+        ASSERT_TRUE((events == std::vector<bool>{true, false}), "low watermark fires after draining");
+        q.stop();
+    }
+
+    // 线程池：拒绝时抛出 QueueFullError，try_add_task 返回 false，TaskGroup 改为在当前线程执行
+    {
+        ThreadPool::Options opts;
+        opts.queue.capacity = 1;
+        opts.queue.overflow = OverflowPolicy::Reject;
+        ThreadPool pool(1, 1, 1, opts);
+        std::atomic<bool> gate{false};
+        std::atomic<int> done{0};
+        pool.add_task([&] { while (!gate.load()) std::this_thread::sleep_for(1ms); });
+        ASSERT_TRUE(wait_until(2000ms, [&] { return pool.pending() == 0; }, 1ms), "worker picked up the gate task");
+        pool.add_task([&] { done++; });
+
+        bool thrown = false;
+        try {
+            pool.add_task([&] { done++; });
+        } catch (const QueueFullError&) {
+            thrown = true;
+        }
+        ASSERT_TRUE(thrown, "add_task throws QueueFullError when full");
+        ASSERT_TRUE(!pool.try_add_task([&] { done++; }), "try_add_task fails fast when full");
+
+        TaskGroup group(pool);
+        std::thread::id ran_on;
+        group.run([&] { ran_on = std::this_thread::get_id(); });
+        ASSERT_TRUE(ran_on == std::this_thread::get_id(), "TaskGroup::run falls back to the caller when full");
+
+        gate = true;
+        group.wait();
+        ASSERT_TRUE(wait_until(2000ms, [&] { return done.load() == 1; }) && pool.try_add_task([&] { done++; }), "queue accepts again after draining");
+        pool.stop();
+    }
+}
+
+// =========================================================================
+// 21. 可以挂 continuation 的 Future：then / when_all / when_any，全程不阻塞 worker
+// =========================================================================
+void test_continuations() {
+    TEST_CASE("Continuation Futures");
+    using namespace std::chrono_literals;
+
+    ThreadPool pool(2, 4, 1);
+
+    std::thread::id ran_on;
+    auto f = fut::async(pool, [](int a, int b) { return a + b; }, 1, 2)
+                 .then([&](int v) { ran_on = std::this_thread::get_id(); return v * 10; })
+                 .then([](int v) { return std::to_string(v); });
+    ASSERT_TRUE(f.get() == "30", "then() chains values");
+    ASSERT_TRUE(ran_on != std::this_thread::get_id(), "continuation runs on a worker");
+
+    // continuation 的闭包直接放进 Task 的内联缓冲区
+    auto small = [](int v) { return v + 1; };
+    ASSERT_TRUE((Task::fits_inline<fut::detail::Continuation<int, decltype(small)>>), "continuation fits inline in Task");
+
+    auto nested = fut::async(pool, [] { return 2; }).then([&pool](int v) {
+        return fut::async(pool, [v] { return v * 21; });
+    });
+    ASSERT_TRUE(nested.get() == 42, "then() unwraps a returned Future");
+
+    bool skipped = true;
+    auto failed = fut::async(pool, []() -> int { throw std::runtime_error("boom"); })
+                      .then([&](int v) { skipped = false; return v; });
+    bool thrown = false;
+    try {
+        failed.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown && skipped, "exception skips then() and reaches get()");
+
+    // 只有一个 worker：每个请求在 worker 里再扇出 4 个子任务并汇聚，std::future::get() 在这里会死锁
+    {
+        ThreadPool single(1, 1, 1);
+        std::vector<fut::Future<int>> requests;
+        for (int r = 0; r < 100; ++r) {
+            requests.push_back(fut::async(single, [&single, r] {
+                std::vector<fut::Future<int>> parts;
+                for (int i = 0; i < 4; ++i) parts.push_back(fut::async(single, [r, i] { return r + i; }));
+                return fut::when_all(std::move(parts)).then([](std::vector<int> v) {
+                    int sum = 0;
+                    for (int x : v) sum += x;
+                    return sum;
+                });
+            }).then([](fut::Future<int> inner) { return inner; }));
+        }
+        int total = fut::when_all(std::move(requests))
+                        .then([](std::vector<int> v) {
+                            int sum = 0;
+                            for (int x : v) sum += x;
+                            return sum;
+                        })
+                        .get();
+        // sum_r (4r + 6) = 4 * 4950 + 600
+        ASSERT_TRUE(total == 20400, "fan-out / fan-in DAG completes on a single worker");
+        single.stop();
+    }
+
+    auto tup = fut::when_all(fut::async(pool, [] { return 1; }), fut::async(pool, [] { return std::string("x"); }),
+                             fut::async(pool, [] {}))
+                   .get();
+    ASSERT_TRUE(std::get<0>(tup) == 1 && std::get<1>(tup) == "x", "variadic when_all collects a tuple");
+
+    std::vector<fut::Future<int>> race;
+    race.push_back(fut::async(pool, [] { std::this_thread::sleep_for(200ms); return 1; }));
+    race.push_back(fut::async(pool, [] { return 2; }));
+    auto any = fut::when_any(std::move(race)).get();
+    ASSERT_TRUE(any.index == 1 && any.value == 2, "when_any picks the first to finish");
+
+    std::vector<fut::Future<void>> voids;
+    voids.push_back(fut::async(pool, [] {}));
+    voids.push_back(fut::async(pool, [] { throw std::logic_error("void failure"); }));
+    thrown = false;
+    try {
+        fut::when_all(std::move(voids)).get();
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown, "when_all propagates the first exception");
+
+    fut::Future<int> orphan;
+    {
+        fut::Promise<int> p(pool);
+        orphan = p.get_future().then([](int v) { return v; });
+    }
+    thrown = false;
+    try {
+        orphan.get();
+    } catch (const std::future_error& e) {
+        thrown = e.code() == std::future_errc::broken_promise;
+    }
+    ASSERT_TRUE(thrown, "dropped Promise reports broken_promise");
+
+    fut::Promise<int> manual(pool);
+    auto later = manual.get_future().then([](int v) { return v + 1; });
+    ASSERT_TRUE(!later.ready(), "continuation waits for set_value");
+    manual.set_value(41);
+    ASSERT_TRUE(later.get() == 42, "Promise::set_value triggers the continuation");
+
+    pool.stop();
+}
+
 int main() {
     std::cout << "=======================================" << std::endl;
     std::cout << "   ThreadPool v4 Complete Test Suite   " << std::endl;
@@ -339,6 +1161,19 @@ int main() {
     test_batch();
     test_elasticity();
     test_stop_semantics();
+    test_lock_free_backend();
+    test_bulk_api();
+    test_timing_wheel();
+    test_cancel_and_periodic();
+    test_qos_classes();
+    test_numa_placement();
+    test_spin_then_park();
+    test_stats();
+    test_parallel();
+    test_scaling_policy();
+    test_coroutines();
+    test_backpressure();
+    test_continuations();
 
     std::cout << "=======================================" << std::endl;
     std::cout << "   ALL TESTS PASSED SUCCESSFULLY       " << std::endl;
@@ -13,6 +13,8 @@
 #include <mutex>
 #include <memory>
 
+#include "Task.hpp"
+
 class ThreadPool {
 public: 
     explicit ThreadPool(int capacity);
@@ -27,7 +29,7 @@ public:
 
 private:
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+    std::queue<Task> tasks_;
     std::mutex queue_mtx_;
     std::condition_variable cond_;
     bool stop_ = false;
@@ -74,17 +76,15 @@ template<typename F, typename... Args>
 auto ThreadPool::push_task(F &&f, Args&&... args) -> std::future<std::result_of_t<F(Args...)>> {
     using result_type = std::result_of_t<F(Args...)>;
 
-    auto task = std::make_shared<std::packaged_task<result_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
-    std::future<result_type> result = task->get_future();
+    // the promise lives inside the move-only Task, no shared_ptr wrapper needed
+    auto [task, result] = make_future_task(std::forward<F>(f), std::forward<Args>(args)...);
+    static_assert(std::is_same_v<decltype(result), std::future<result_type>>);
 
     {
         std::lock_guard<std::mutex> lock(queue_mtx_);
         if(stop_) 
             throw std::runtime_error("push task on stopped thread pool");
-        // encapsulation packaged_task to a lambda function and push into tasks_
-        tasks_.emplace([task](){ (*task)(); });
+        tasks_.emplace(std::move(task));
     }
     cond_.notify_one();
     return result;
@@ -14,6 +14,7 @@
 #include <memory>
 
 #include "SafeQueue.hpp"
+#include "Task.hpp"
 
 class ThreadPool {
 public: 
@@ -29,7 +30,7 @@ public:
 
 private:
     std::vector<std::thread> workers_;
-    SafeQueue<std::function<void()>> tasks_;
+    SafeQueue<Task> tasks_;
 };
 
 inline ThreadPool::ThreadPool(int capacity) {
@@ -40,7 +41,7 @@ inline ThreadPool::ThreadPool(int capacity) {
     for(int i = 0; i < capacity; i ++ ) {
         workers_.emplace_back([this]{
             for(;;) {
-                std::function<void()> task;
+                Task task;
                 if(!tasks_.pop(task)) // queue has been stopped
                     return ;
                 if(task)
@@ -65,13 +66,10 @@ template<typename F, typename... Args>
 auto ThreadPool::push_task(F &&f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
     using result_type = std::result_of_t<F(Args...)>;
 
-    auto task = std::make_shared<std::packaged_task<result_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
-    std::future<result_type> result = task->get_future();
-
-    // encapsulation packaged_task to a lambda function and push into tasks_
-    tasks_.push([task](){ (*task)(); });
+    // the promise lives inside the move-only Task, no shared_ptr wrapper needed
+    auto [task, result] = make_future_task(std::forward<F>(f), std::forward<Args>(args)...);
+    static_assert(std::is_same_v<decltype(result), std::future<result_type>>);
+    tasks_.push(std::move(task));
 
     return result;
 }
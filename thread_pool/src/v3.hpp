@@ -10,46 +10,151 @@
 #include <memory>
 #include <type_traits>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
 
 #include "SafeQueue.hpp"
+#include "Task.hpp"
+#include "WorkStealingQueue.hpp"
+
+// scheduling policy of the multi-queue pool
+//   - RoundRobin   : dispense tasks to the queues in turn, a worker only runs its own queue
+//   - WorkStealing : a worker pops its own deque LIFO, and steals FIFO from a
+//                    random victim when its own deque runs dry
+enum class SchedPolicy { RoundRobin, WorkStealing };
 
 class ThreadPool {
-    using Job = std::function<void()>;
+    using Job = Task;
 public:
-    explicit ThreadPool(int capacity);
+    explicit ThreadPool(int capacity, SchedPolicy policy = SchedPolicy::RoundRobin);
     ~ThreadPool();
     template<typename F, typename... Args> 
     auto push_task(F &&f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>>;
  
 private:  
+    void round_robin_loop(int id);
+    void work_stealing_loop(int id);
+    bool try_steal(int thief, Job &task);
+    void dispatch(Job &&job);
+
+private:
+    SchedPolicy policy_;
     std::vector<std::thread> workers_;
     // use pointer to avoid the problem that mutex can't copy and move 
     // and the fact that std::vector require the element can copy or move 
     std::vector<std::unique_ptr<SafeQueue<Job>>> queues_;
     // use round-robin scheduling to dispense tasks
     std::atomic<size_t> next_queue_idx_{0};
+
+    // ---- work stealing only ----
+    std::vector<std::unique_ptr<WorkStealingQueue<Job>>> deques_;
+    // number of tasks sitting in all deques, signed because a worker may pop
+    // a task before the producer has counted it
+    std::atomic<long> pending_{0};
+    // number of workers blocked in sleep_cond_, lets producers skip the notify
+    std::atomic<int> sleepers_{0};
+    std::mutex sleep_mtx_;
+    std::condition_variable sleep_cond_;
+    bool stop_ = false;
+
+    // which pool and which worker the current thread belongs to,
+    // used to push tasks submitted from inside a worker onto its own deque
+    inline static thread_local ThreadPool *tls_pool_ = nullptr;
+    inline static thread_local int tls_worker_id_ = -1;
 };
 
-inline ThreadPool::ThreadPool(int capacity) {
+inline ThreadPool::ThreadPool(int capacity, SchedPolicy policy) : policy_(policy) {
     if(capacity <= 0) {
         throw std::runtime_error("capacity must be a positive");
     }
 
     for(int i = 0; i < capacity; i ++ ) {
-        queues_.emplace_back(std::make_unique<SafeQueue<Job>>());
+        if(policy_ == SchedPolicy::WorkStealing)
+            deques_.emplace_back(std::make_unique<WorkStealingQueue<Job>>());
+        else
+            queues_.emplace_back(std::make_unique<SafeQueue<Job>>());
     }
 
     workers_.reserve(capacity);
     for(int i = 0; i < capacity; i ++ ) {
-        workers_.emplace_back([this](int id){
-            for(;;) {
-                Job task;
-                if(!queues_[id]->pop(task)) {
-                    break;
-                }
-                task();
-            }
-        }, i);
+        if(policy_ == SchedPolicy::WorkStealing)
+            workers_.emplace_back(&ThreadPool::work_stealing_loop, this, i);
+        else
+            workers_.emplace_back(&ThreadPool::round_robin_loop, this, i);
+    }
+}
+
+inline void ThreadPool::round_robin_loop(int id) {
+    for(;;) {
+        Job task;
+        if(!queues_[id]->pop(task)) {
+            break;
+        }
+        task();
+    }
+}
+
+inline void ThreadPool::work_stealing_loop(int id) {
+    tls_pool_ = this;
+    tls_worker_id_ = id;
+    for(;;) {
+        Job task;
+        if(deques_[id]->pop(task) || try_steal(id, task)) {
+            pending_.fetch_sub(1);
+            task();
+            continue;
+        }
+        // nothing to run or steal: sleep until someone pushes
+        // sleepers_ and pending_ are both seq_cst, so either we see the new
+        // task here, or the producer sees us sleeping and notifies
+        std::unique_lock<std::mutex> lock(sleep_mtx_);
+        sleepers_.fetch_add(1);
+        sleep_cond_.wait(lock, [this]{ return stop_ || pending_.load() > 0; });
+        sleepers_.fetch_sub(1);
+        if(stop_ && pending_.load() <= 0) {
+            break;
+        }
+    }
+    tls_pool_ = nullptr;
+    tls_worker_id_ = -1;
+}
+
+inline bool ThreadPool::try_steal(int thief, Job &task) {
+    // start from a random victim so that thieves spread over the deques
+    static thread_local std::minstd_rand rng(std::random_device{}());
+    const int n = static_cast<int>(deques_.size());
+    int start = static_cast<int>(rng() % n);
+    for(int i = 0; i < n; i ++ ) {
+        int victim = (start + i) % n;
+        if(victim == thief) continue;
+        if(deques_[victim]->steal(task)) return true;
+    }
+    return false;
+}
+
+inline void ThreadPool::dispatch(Job &&job) {
+    if(policy_ == SchedPolicy::RoundRobin) {
+        // optimization: use relaxed memory order 
+        // because it is only necessary to ensure the atomicity of addition
+        // and there is no need to synchronize memory visibility across threads
+        size_t idx = next_queue_idx_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        queues_[idx]->push(std::move(job));
+        return ;
+    }
+
+    // tasks submitted from one of our workers stay on that worker's deque,
+    // others are spread round-robin
+    size_t idx = (tls_pool_ == this)
+        ? static_cast<size_t>(tls_worker_id_)
+        : next_queue_idx_.fetch_add(1, std::memory_order_relaxed) % deques_.size();
+    deques_[idx]->push(std::move(job));
+    pending_.fetch_add(1);
+    if(sleepers_.load() > 0) {
+        // take the lock once so the notify can't slip in between a sleeper's
+        // predicate check and its wait
+        { std::lock_guard<std::mutex> lock(sleep_mtx_); }
+        sleep_cond_.notify_one();
     }
 }
 
@@ -57,6 +162,13 @@ inline ThreadPool::~ThreadPool() {
     for(auto &que : queues_) {
         que->stop();
     }
+    if(policy_ == SchedPolicy::WorkStealing) {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mtx_);
+            stop_ = true;
+        }
+        sleep_cond_.notify_all();
+    }
     for(auto &worker : workers_) {
         if(worker.joinable()) {
             worker.join();
@@ -66,17 +178,9 @@ inline ThreadPool::~ThreadPool() {
 
 template<typename F, typename... Args> 
 auto ThreadPool::push_task(F &&f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
-    using return_type = std::invoke_result_t<F, Args...>;
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
-    std::future<return_type> res = task->get_future(); 
-
-    // optimization: use relaxed memory order 
-    // because it is only necessary to ensure the atomicity of addition
-    // and there is no need to synchronize memory visibility across threads
-    size_t idx = next_queue_idx_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
-    queues_[idx]->push([task]{ (*task)(); });
+    // the promise lives inside the move-only Task, no shared_ptr wrapper needed
+    auto [task, res] = make_future_task(std::forward<F>(f), std::forward<Args>(args)...);
+    dispatch(std::move(task));
     return res;
 }
 
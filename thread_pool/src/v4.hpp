@@ -1,9 +1,13 @@
 #ifndef THREAD_POOL_V4_H
 #define THREAD_POOL_V4_H
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <functional>
 #include <future>
 #include <list>
 #include <memory>
@@ -14,17 +18,124 @@
 #include <unordered_map>
 #include <vector>
 
+#include "Numa.hpp"
+#include "Stats.hpp"
 #include "TaskQueue.hpp"
 
+// worker 的放置策略
+//   - None      : 不绑核，所有 worker 共用一个 TaskQueue（默认，与以前一致）
+//   - CpuSet    : 所有 worker 绑定到 cpus 指定的 CPU 集合上，仍共用一个 TaskQueue
+//   - NumaNodes : 每个 NUMA 节点一组 worker、一个 TaskQueue 分片，worker 绑定到本节点的 CPU；
+//                 本节点的队列取空之后才去其它节点窃取（按 NUMA 距离由近到远）
+enum class Placement { None, CpuSet, NumaNodes };
+
+// 监督线程每个采样周期看到的负载，交给 ScalingPolicy::decide
+struct ScalingSample {
+    std::size_t backlog = 0;   // 排队任务数（不含 Background）
+    std::size_t critical = 0;  // 其中 Critical 任务数
+    double ewma = 0;           // backlog 的指数移动平均
+    int serving = 0;           // 正在服务的线程数（不含停放的线程）
+    int idle = 0;              // 其中空闲的线程数
+    int parked = 0;            // 停放的线程数
+    int min_threads = 0;
+    int max_threads = 0;
+};
+
+// 弹性伸缩策略
+//   - enabled = false（默认）：保持原来的行为，提交线程上 try_expand_workers，空闲超时一次就回收
+//   - enabled = true：扩缩容全部交给一个监督线程，每 interval 采样一次积压，
+//     EWMA 超过 grow_threshold 才扩容（每周期最多 max_grow_per_tick 个），
+//     连续 shrink_hold 个周期低于 shrink_threshold 才缩容；
+//     缩下来的线程先停放（最多 parked_reserve 个），下次扩容时直接唤醒，不再重新创建
+struct ScalingPolicy {
+    bool enabled = false;
+    std::chrono::milliseconds interval{10};
+    double ewma_alpha = 0.3;        // EWMA 中新样本的权重
+    double grow_threshold = 2.0;    // 每个服务线程的平均积压超过它就扩容
+    double shrink_threshold = 0.5;  // 每个服务线程的平均积压低于它才考虑缩容
+    int shrink_hold = 20;           // 连续这么多个周期都偏低才缩容
+    int max_grow_per_tick = 2;      // 每个周期最多扩几个线程（唤醒停放的线程也算）
+    int parked_reserve = 2;         // 最多停放几个线程
+    // 自定义决策：返回 > 0 表示扩容几个，< 0 表示缩容几个，0 不变；为空时使用上面的阈值
+    // 返回值同样受 max_grow_per_tick / min_threads / max_threads 限制
+    std::function<int(const ScalingSample&)> decide;
+};
+
+// 队列满（TaskQueueOptions::capacity）且 overflow 策略拒绝了任务时，add_* 抛出此异常
+// 线程池已停止时抛出的仍是普通的 std::runtime_error
+class QueueFullError : public std::runtime_error {
+public:
+    QueueFullError() : std::runtime_error("ThreadPool queue is full") {}
+};
+
+// 线程池的可选配置
+struct ThreadPoolOptions {
+    // 任务队列后端（Locked / LockFree）、容量上限与水位回调等
+    // NumaNodes 下每个分片各自有一份 capacity，水位回调也按分片各自触发
+    TaskQueueOptions queue;
+    int worker_batch = 1;    // worker 每次用 pop_bulk 最多取几个任务，默认 1 即逐个取
+
+    Placement placement = Placement::None;
+    std::vector<int> cpus;  // CpuSet: 绑定的 CPU；NumaNodes: 只使用这些 CPU（空表示不限制）
+    std::vector<std::vector<int>> node_cpus;  // NumaNodes: 手动指定每个节点的 CPU，空则读取 /sys
+    std::chrono::milliseconds steal_interval{2};  // NumaNodes: 空闲 worker 每隔多久去其它节点看一眼
+
+    ScalingPolicy scaling;  // 弹性伸缩策略，默认关闭（见 ScalingPolicy）
+};
+
+namespace detail {
+
+// 周期任务的共享状态：可调用对象只在 add_periodic_task 时构造一次，之后每个周期复用
+struct PeriodicState : DelayState {
+    Task fn;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point next_tm;
+};
+
+} // namespace detail
+
+// add_delay_task / add_periodic_task 返回的句柄：可复制，只有一个 shared_ptr 和一个指针
+// 丢弃句柄不会取消任务
+class DelayTaskHandle {
+public:
+    DelayTaskHandle() = default;
+
+    // 取消任务，只能在线程池析构之前调用
+    //   - 延时任务：还没开始执行时返回 true，之后不会再执行
+    //   - 周期任务：返回 true 表示之后不会再触发（正在执行的那一次不受影响）
+    //   - 已经执行过、已经取消或空句柄返回 false
+    bool cancel() {
+        if(!state_) return false;
+        std::uint8_t expected = DelayState::kPending;
+        if(!state_->status.compare_exchange_strong(expected, DelayState::kCancelled)) return false;
+        queue_->cancel_delay(*state_);
+        return true;
+    }
+
+    bool valid() const noexcept { return state_ != nullptr; }
+
+private:
+    friend class ThreadPool;
+    DelayTaskHandle(std::shared_ptr<DelayState> st, TaskQueue* q)
+        : state_(std::move(st)), queue_(q) {}
+
+    std::shared_ptr<DelayState> state_;
+    TaskQueue* queue_ = nullptr;
+};
+
 class ThreadPool {
 public:
+    using Options = ThreadPoolOptions;
+
     // 初始化线程池
     //  - 初始化 min_threads 个核心线程
     //  - 根据负载自动扩容到 max_threads
     //  - 空闲超过 idle_timeout_sec 的线程会被回收（但线程数不少于 min_threads）
+    //  - opts 用于选择任务队列后端等可选配置
     ThreadPool(int min_threads = 2,
                int max_threads = std::thread::hardware_concurrency(),
-               int idle_timeout_sec = 2);
+               int idle_timeout_sec = 2,
+               const Options& opts = Options{});
     ~ThreadPool() { stop(); }
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
@@ -38,29 +149,84 @@ public:
     void stop();
 
     // 当前队列中待执行任务数（近似值，仅供观察使用）
-    int pending() const { return static_cast<int>(queue_.size()); }
+    int pending() const {
+        size_t n = 0;
+        for (const TaskQueue* q : shards_) n += q->size();
+        return static_cast<int>(n);
+    }
+
+    // 任务队列分片数：Placement::NumaNodes 下等于节点数，否则为 1
+    int node_count() const { return static_cast<int>(shards_.size()); }
+
+    // 统计快照：合并所有 worker 的直方图，不需要停下线程池
+    // 编译时 THREAD_POOL_ENABLE_STATS=0 则返回 enabled=false 的空快照
+    ThreadPoolStats stats();
 
-    // 当前活跃活线程数量
+    // 当前活跃活线程数量（包括停放的线程）
     int active_threads_count() {
         std::lock_guard<std::mutex> lock(thread_mutex_);
         return static_cast<int>(workers_.size());
     }
 
+    // 停放的线程数，只有打开 ScalingPolicy 时才可能不为 0
+    int parked_threads_count() {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        return parked_;
+    }
+
+    // 从队列中取出一个就绪的任务，在当前线程执行；没有就绪任务时立即返回 false
+    // 用于协作式等待（见 Parallel.hpp）：等待者帮忙执行任务，而不是占着线程干等
+    // worker 优先取本节点的任务，外部线程从 0 号节点取，取不到再去其它节点
+    bool try_run_one();
+
 public:
     // 普通任务
+    // 设置了 TaskQueueOptions::capacity 时，队列满且 overflow 策略拒绝了任务会抛出 QueueFullError
+    // （add_qos_task / add_future_task / submit_on_node 同理）
     template <typename F, typename... Args>
     void add_task(F&& f, Args&&... args) {
         if (stop_.load(std::memory_order_relaxed)) {
             throw std::runtime_error("ThreadPool has been stopped");
         }
-        auto task = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        queue_.push(std::move(task));
+        auto task = stamp_task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        check_push(submit_queue().push(std::move(task)));
         try_expand_workers();
     }
 
-    // 批量普通任务
+    // 队列满时不阻塞、也不按 overflow 策略处理，直接返回 false（线程池已停止时同样返回 false）
+    template <typename F, typename... Args>
+    bool try_add_task(F&& f, Args&&... args) {
+        Task task(stamp_task(std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+        return try_submit(task);
+    }
+
+    // 同上，但失败时 task 原样留给调用方（例如改为在当前线程执行）
+    bool try_submit(Task& task, QoS qos = QoS::Normal) {
+        if (stop_.load(std::memory_order_relaxed)) return false;
+        if (submit_queue().try_push(std::move(task), qos) != PushResult::OK) return false;
+        try_expand_workers();
+        return true;
+    }
+
+    // 提交到指定 NUMA 节点的普通任务：由该节点的 worker 执行，只有它们忙不过来时才会被其它节点窃取
+    // node 取值 [0, node_count())
+    template <typename F, typename... Args>
+    void submit_on_node(int node, F&& f, Args&&... args) {
+        if (stop_.load(std::memory_order_relaxed)) {
+            throw std::runtime_error("ThreadPool has been stopped");
+        }
+        if (node < 0 || node >= node_count()) {
+            throw std::out_of_range("ThreadPool::submit_on_node: no such node");
+        }
+        auto task = stamp_task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        check_push(shards_[node]->push(std::move(task)));
+        try_expand_workers();
+    }
+
+    // 批量普通任务，返回入队（或在当前线程执行）的任务数
+    // 设置了 capacity 时可能只接受一部分，被拒绝的是 task_list 的一段后缀，不会抛出 QueueFullError
     template <typename TaskContainer>
-    void add_batch_task(TaskContainer&& task_list) {
+    size_t add_batch_task(TaskContainer&& task_list) {
         static_assert(std::is_rvalue_reference_v<decltype(task_list)&&>,
                       "task_list must be an rvalue");
 
@@ -68,11 +234,11 @@ public:
             throw std::runtime_error("ThreadPool has been stopped");
         }
         // task_list 为空时直接返回，避免执行 try_expand_workers
-        if (task_list.empty()) return;
-        for (auto& t : task_list) {
-            queue_.push(std::move(t));
-        }
-        try_expand_workers();
+        if (task_list.empty()) return 0;
+        // 整批只加一次锁、只唤醒 min(n, 空闲线程数) 个线程
+        size_t n = submit_queue().push_bulk(task_list);
+        if (n > 0) try_expand_workers();
+        return n;
     }
 
     // 有返回值的任务
@@ -82,78 +248,339 @@ public:
         if (stop_.load(std::memory_order_relaxed)) {
             throw std::runtime_error("ThreadPool has been stopped");
         }
-        using return_type = std::invoke_result_t<F, Args...>;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-        std::future<return_type> res = task->get_future();
-        queue_.push([task] { (*task)(); });
+        // promise 直接放在 Task 的内联缓冲区里，不再需要 make_shared<packaged_task>
+        auto [task, res] = make_stamped_future_task(std::forward<F>(f), std::forward<Args>(args)...);
+        check_push(submit_queue().push(std::move(task)));
         try_expand_workers();
         return res;
     }
 
-    // 高优先级任务
+    // 高优先级任务，即 QoS::Critical
     template <typename F, typename... Args>
     void add_priority_task(F&& f, Args&&... args) {
+        add_qos_task(QoS::Critical, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // 指定服务等级的任务，各等级之间按 TaskQueueOptions::qos_weights 加权公平出队
+    template <typename F, typename... Args>
+    void add_qos_task(QoS qos, F&& f, Args&&... args) {
         if (stop_.load(std::memory_order_relaxed)) {
             throw std::runtime_error("ThreadPool has been stopped");
         }
-        auto task = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        queue_.push_priority(std::move(task));
+        auto task = stamp_task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        check_push(submit_queue().push(std::move(task), qos));
         try_expand_workers();
     }
 
-    // 延时任务
+    // 延时任务，返回的句柄可用于取消
+    // 延时任务和周期任务总是放在 0 号节点的队列中
     template <typename F, typename... Args>
-    void add_delay_task(int64_t delay_ms, F&& f, Args&&... args) {
+    DelayTaskHandle add_delay_task(int64_t delay_ms, F&& f, Args&&... args) {
         if (stop_.load(std::memory_order_relaxed)) {
             throw std::runtime_error("ThreadPool has been stopped");
         }
         auto exec_tm = std::chrono::steady_clock::now() +
                        std::chrono::milliseconds(delay_ms);
-        auto task = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        queue_.push_delay(std::move(task), exec_tm);
+        auto state = std::make_shared<DelayState>();
+        // 真正执行前再抢一次状态：与 cancel() 竞争，保证两者只有一个成功
+        auto task = [state, fn = std::bind(std::forward<F>(f), std::forward<Args>(args)...)]() mutable {
+            std::uint8_t expected = DelayState::kPending;
+            if (state->status.compare_exchange_strong(expected, DelayState::kStarted)) fn();
+        };
+        queue_.push_delay(std::move(task), exec_tm, state);
+        try_expand_workers();
+        return DelayTaskHandle(std::move(state), &queue_);
+    }
+
+    // 周期任务：每隔 interval_ms 执行一次，直到句柄被 cancel() 或线程池 stop()
+    //   - 按固定频率触发（下一次 = 上一次的计划时间 + interval），执行太慢时不补跑错过的周期
+    //   - 同一个周期任务不会并发执行，下一次在本次执行完之后才重新挂上
+    //   - 重新挂上时只复制一个 shared_ptr，不会为每个周期分配新的任务
+    template <typename F, typename... Args>
+    DelayTaskHandle add_periodic_task(int64_t interval_ms, F&& f, Args&&... args) {
+        if (stop_.load(std::memory_order_relaxed)) {
+            throw std::runtime_error("ThreadPool has been stopped");
+        }
+        auto state = std::make_shared<detail::PeriodicState>();
+        state->fn = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+        state->interval = std::chrono::milliseconds(std::max<int64_t>(interval_ms, 1));
+        state->next_tm = std::chrono::steady_clock::now() + state->interval;
+        {
+            std::lock_guard<std::mutex> lock(periodic_mutex_);
+            std::erase_if(periodic_, [](const auto& w) { return w.expired(); });
+            periodic_.push_back(state);
+        }
+        queue_.push_delay([this, state] { run_periodic(state); }, state->next_tm, state);
         try_expand_workers();
+        return DelayTaskHandle(std::move(state), &queue_);
     }
 
+    // ---- 协程（配合 Coro.hpp 中的 coro::task 使用）----
+    class ScheduleAwaiter;
+    class SleepAwaiter;
+
+    // co_await pool.schedule()：挂起当前协程，由线程池的 worker 接着执行
+    ScheduleAwaiter schedule(QoS qos = QoS::Normal);
+
+    // co_await pool.sleep_for(ms)：挂起 ms 毫秒后由 worker 接着执行，等待期间不占用任何线程
+    SleepAwaiter sleep_for(int64_t delay_ms);
+
 private:
-    // 工作线程主循环：不断从 TaskQueue 中 pop 任务并执行
-    void worker_loop();
+    // 工作线程主循环：不断从本节点的 TaskQueue 中 pop 任务并执行，本节点为空时去其它节点窃取
+    void worker_loop(int node);
+
+    // 根据 Options 中的放置策略建立节点、队列分片和窃取顺序
+    void setup_placement(const Options& opts);
+
+    // 创建一个属于 node 的 worker，需持有 thread_mutex_
+    void spawn_worker(int node);
+
+    // 从其它节点窃取一批任务，按 steal_order_ 由近到远
+    bool try_steal(int node, std::vector<TaskQueue::Task>& batch);
+
+    // 普通任务提交到哪个分片：worker 自己提交的任务留在本节点，外部提交的轮流分给各节点
+    TaskQueue& submit_queue() {
+        if (shards_.size() == 1) return queue_;
+        if (tls_pool_ == this) return *shards_[tls_node_];
+        return *shards_[rr_.fetch_add(1, std::memory_order_relaxed) % shards_.size()];
+    }
+
+    // 把 TaskQueue::push 的失败转换成异常
+    static void check_push(PushResult r) {
+        if (r == PushResult::Rejected) throw QueueFullError();
+        if (r == PushResult::Stopped) throw std::runtime_error("ThreadPool has been stopped");
+    }
 
     // 扩容逻辑：根据 pending/idle/active 情况决定是否创建新线程
+    // 打开 ScalingPolicy 时只在所有线程都忙的时候踢一下监督线程
     void try_expand_workers();
 
+    // 新线程放在哪个节点：“积压任务数 - worker 数”最大的节点，需持有 thread_mutex_
+    int pick_spawn_node() const;
+
+    // ---- ScalingPolicy ----
+    // 监督线程主循环：每 interval 采样一次，或者被 try_expand_workers 提前踢醒
+    void supervisor_loop();
+    // 采样一次并执行扩缩容
+    void supervise_once();
+    // 内置的滞回决策
+    int default_scaling_decision(const ScalingSample& s);
+    // 空闲超时的 worker 领取缩容名额：停放或退出，返回 true 表示当前线程应当退出
+    bool scale_down_idle(int node);
+
     // 清理已退出线程：将 dead_workers_ 中的线程 join 掉
     void clean_inactive_threads();
 
+    // 执行一次周期任务并挂上下一次
+    void run_periodic(const std::shared_ptr<detail::PeriodicState>& state);
+
 private:
     int min_threads_;                        // 核心线程数
     int max_threads_;                        // 最大线程数
     std::chrono::seconds idle_timeout_sec_;  // 非核心线程的空闲回收时间
-
-    TaskQueue queue_;  // 任务队列
+    std::size_t worker_batch_;               // worker 每次最多取几个任务
+
+    TaskQueue queue_;  // 任务队列（NumaNodes 下即 0 号节点的分片）
+
+    // ---- worker 放置（见 Numa.hpp）----
+    std::vector<std::vector<int>> node_cpus_;  // 每个节点的 worker 绑定到哪些 CPU，空表示不绑核
+    std::vector<std::unique_ptr<TaskQueue>> extra_shards_;  // 1 号及以后节点的队列
+    std::vector<TaskQueue*> shards_;           // 所有节点的队列，shards_[0] == &queue_
+    std::vector<std::vector<int>> steal_order_;  // 每个节点窃取时依次访问的其它节点
+    std::vector<int> node_workers_;  // 各节点的 worker 数，受 thread_mutex_ 保护
+    std::chrono::nanoseconds steal_interval_{0};
+    std::atomic<unsigned> rr_{0};  // 外部提交时轮流选择节点
+    inline static thread_local ThreadPool* tls_pool_ = nullptr;  // 当前线程所属的线程池（非 worker 为空）
+    inline static thread_local int tls_node_ = 0;                // 当前 worker 所属的节点
+
+    // ---- ScalingPolicy ----
+    ScalingPolicy scaling_;
+    std::thread supervisor_;
+    std::mutex supervisor_mutex_;  // 只用来配合 supervisor_cv_
+    std::condition_variable supervisor_cv_;
+    std::atomic<bool> supervisor_kick_{false};  // 所有线程都忙时由提交线程置位
+    double backlog_ewma_ = 0;  // 只由监督线程访问
+    int low_ticks_ = 0;        // 连续多少个周期负载偏低，只由监督线程访问
+    std::atomic<int> shrink_budget_{0};  // 监督线程给出的缩容名额，由空闲超时的 worker 领取
+    std::condition_variable park_cv_;    // 停放的线程睡在这里，配合 thread_mutex_
+    int parked_ = 0;        // 停放的线程数，受 thread_mutex_ 保护
+    int unpark_tokens_ = 0;  // 待唤醒的停放线程数，受 thread_mutex_ 保护
+
+#if THREAD_POOL_ENABLE_STATS
+    // ---- 统计（见 Stats.hpp）----
+    // 取得 / 归还一个 WorkerStats 槽位，worker 启动和退出时各调用一次
+    WorkerStats* acquire_stats_slot();
+    void release_stats_slot(WorkerStats* ws);
+
+    std::mutex stats_mutex_;  // 保护下面两个容器，只在 worker 启停和 stats() 时使用
+    std::vector<std::unique_ptr<WorkerStats>> worker_stats_;  // 所有槽位，只增不减
+    std::vector<WorkerStats*> free_stats_;   // 已退出 worker 留下的槽位
+    std::atomic<std::uint64_t> grow_events_{0};
+    std::atomic<std::uint64_t> threads_started_{0};
+    std::atomic<std::uint64_t> threads_retired_{0};
+#endif
 
     mutable std::mutex thread_mutex_;  // 保护 workers_ / dead_workers_
     std::unordered_map<std::thread::id, std::thread> workers_;  // 当前活跃线程
     std::list<std::thread> dead_workers_;  // 已经从 workers_ 中移除的线程，用于稍后 join
                                           // 使用 list 管理是因为 list 移动效率很高（splice）
 
+    std::mutex periodic_mutex_;  // 保护 periodic_
+    std::vector<std::weak_ptr<detail::PeriodicState>> periodic_;  // 尚未结束的周期任务，stop() 时统一取消
+
     std::atomic<int> idle_threads_{0};  // 当前处于“阻塞等待任务”的线程数（近似值）
     std::atomic<bool> stop_{false};  // 线程池是否停止
 };
 
+// 恢复协程的任务只有一个 coroutine_handle，放得进 Task 的内联缓冲区，不需要 packaged_task
+// 线程池已经 stop() 时 add_task 抛出的异常会在 co_await 处重新抛给协程
+class ThreadPool::ScheduleAwaiter {
+public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        pool_->add_qos_task(qos_, [h] { h.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+private:
+    friend class ThreadPool;
+    ScheduleAwaiter(ThreadPool* pool, QoS qos) : pool_(pool), qos_(qos) {}
+
+    ThreadPool* pool_;
+    QoS qos_;
+};
+
+// 挂在延时队列上（时间轮或小顶堆，见 TaskQueueOptions::delay_engine），到期后由 worker 恢复
+class ThreadPool::SleepAwaiter {
+public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        pool_->add_delay_task(delay_ms_, [h] { h.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+private:
+    friend class ThreadPool;
+    SleepAwaiter(ThreadPool* pool, int64_t delay_ms) : pool_(pool), delay_ms_(delay_ms) {}
+
+    ThreadPool* pool_;
+    int64_t delay_ms_;
+};
+
+inline ThreadPool::ScheduleAwaiter ThreadPool::schedule(QoS qos) {
+    return ScheduleAwaiter(this, qos);
+}
+
+inline ThreadPool::SleepAwaiter ThreadPool::sleep_for(int64_t delay_ms) {
+    return SleepAwaiter(this, delay_ms);
+}
+
 // 类外定义不需要再次执行默认值
 inline ThreadPool::ThreadPool(int min_threads, 
                               int max_threads,
-                              int idle_timeout_sec)
+                              int idle_timeout_sec,
+                              const Options& opts)
     : min_threads_(min_threads),
       max_threads_(std::max(min_threads, max_threads)),
-      idle_timeout_sec_(idle_timeout_sec) 
+      idle_timeout_sec_(idle_timeout_sec),
+      worker_batch_(std::max(1, opts.worker_batch)),
+      queue_(opts.queue),
+      scaling_(opts.scaling)
 {
-    std::lock_guard<std::mutex> lock(thread_mutex_);
-    for (int i = 0; i < min_threads; i++) {
-        std::thread t(&ThreadPool::worker_loop, this);
-        workers_.emplace(t.get_id(), std::move(t));
+    setup_placement(opts);
+    // 每个节点至少一个 worker，否则提交到该节点的任务只能靠窃取
+    min_threads_ = std::max(min_threads_, node_count());
+    max_threads_ = std::max(max_threads_, min_threads_);
+
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        for (int i = 0; i < min_threads_; i++) {
+            spawn_worker(i % node_count());
+        }
+    }
+    if (scaling_.enabled) {
+        scaling_.interval = std::max(scaling_.interval, std::chrono::milliseconds(1));
+        scaling_.max_grow_per_tick = std::max(scaling_.max_grow_per_tick, 1);
+        supervisor_ = std::thread(&ThreadPool::supervisor_loop, this);
+    }
+}
+
+inline void ThreadPool::setup_placement(const Options& opts) {
+    shards_.push_back(&queue_);
+    steal_interval_ = opts.steal_interval;
+
+    if (opts.placement == Placement::CpuSet) {
+        node_cpus_.push_back(opts.cpus);
+    }
+    else if (opts.placement == Placement::NumaNodes) {
+        std::vector<numa::Node> nodes;
+        if (!opts.node_cpus.empty()) {
+            for (size_t i = 0; i < opts.node_cpus.size(); i++) {
+                nodes.push_back(numa::Node{static_cast<int>(i), opts.node_cpus[i], {}});
+            }
+        }
+        else {
+            nodes = numa::nodes();
+        }
+        if (!opts.cpus.empty()) {
+            for (auto& n : nodes) {
+                std::erase_if(n.cpus, [&](int c) {
+                    return std::find(opts.cpus.begin(), opts.cpus.end(), c) == opts.cpus.end();
+                });
+            }
+            std::erase_if(nodes, [](const numa::Node& n) { return n.cpus.empty(); });
+            if (nodes.empty()) nodes.push_back(numa::Node{0, opts.cpus, {}});
+        }
+
+        // 其它节点的分片只放普通任务，延时任务都在 queue_ 中，不需要各自的时间轮
+        TaskQueueOptions shard_opts = opts.queue;
+        shard_opts.delay_engine = DelayEngine::Heap;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            node_cpus_.push_back(nodes[i].cpus);
+            if (i > 0) {
+                extra_shards_.push_back(std::make_unique<TaskQueue>(shard_opts));
+                shards_.push_back(extra_shards_.back().get());
+            }
+        }
+
+        // 窃取顺序：按 /sys 中的 NUMA 距离由近到远，距离未知时按节点编号
+        steal_order_.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            auto dist = [&](size_t j) {
+                const auto& d = nodes[i].distance;
+                size_t id = static_cast<size_t>(nodes[j].id);
+                return id < d.size() ? d[id] : 0;
+            };
+            for (size_t j = 1; j < nodes.size(); j++) {
+                steal_order_[i].push_back(static_cast<int>((i + j) % nodes.size()));
+            }
+            std::stable_sort(steal_order_[i].begin(), steal_order_[i].end(),
+                             [&](int a, int b) { return dist(a) < dist(b); });
+        }
+    }
+    else {
+        node_cpus_.emplace_back();
     }
+    node_workers_.assign(shards_.size(), 0);
+}
+
+inline void ThreadPool::spawn_worker(int node) {
+    std::thread t(&ThreadPool::worker_loop, this, node);
+    workers_.emplace(t.get_id(), std::move(t));
+    node_workers_[node]++;
+#if THREAD_POOL_ENABLE_STATS
+    threads_started_.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+inline bool ThreadPool::try_steal(int node, std::vector<TaskQueue::Task>& batch) {
+    for (int victim : steal_order_[node]) {
+        if (shards_[victim]->pop_bulk(batch, worker_batch_, std::chrono::nanoseconds(0)) ==
+            TaskQueue::PopResult::OK) {
+            return true;
+        }
+    }
+    return false;
 }
 
 inline void ThreadPool::stop() {
@@ -164,13 +591,32 @@ inline void ThreadPool::stop() {
         return;
     }
 
-    queue_.stop();
+    // 周期任务会不停地重新挂上自己，停机前先取消，否则 stop() 要等它们下一次到期
+    {
+        std::lock_guard<std::mutex> lock(periodic_mutex_);
+        for (auto& w : periodic_) {
+            if (auto st = w.lock()) DelayTaskHandle(std::move(st), &queue_).cancel();
+        }
+        periodic_.clear();
+    }
+
+    // 先停监督线程，之后不会再有线程被创建或唤醒
+    if (supervisor_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(supervisor_mutex_);
+        }
+        supervisor_cv_.notify_all();
+        supervisor_.join();
+    }
+
+    for (TaskQueue* q : shards_) q->stop();
 
     // 将所有线程对象从 workers_ / dead_workers_ 中移动出来，避免在持锁时 join
     // 导致死锁
     std::vector<std::thread> threads_to_join;
     {
         std::lock_guard<std::mutex> lock(thread_mutex_);
+        park_cv_.notify_all();  // 停放的线程醒来后回到主循环，把剩余任务做完再退出
         for (auto& pair : workers_)
             threads_to_join.emplace_back(std::move(pair.second));
         workers_.clear();
@@ -185,14 +631,43 @@ inline void ThreadPool::stop() {
     }
 }
 
-inline void ThreadPool::worker_loop() {
+inline void ThreadPool::worker_loop(int node) {
+    numa::pin_current_thread(node_cpus_[node]);
+    tls_pool_ = this;
+    tls_node_ = node;
+#if THREAD_POOL_ENABLE_STATS
+    // worker_loop 有多个 return，用一个局部对象保证退出时归还槽位
+    struct StatsSlot {
+        ThreadPool* pool;
+        WorkerStats* ws;
+        ~StatsSlot() {
+            detail::tls_worker_stats = nullptr;
+            pool->release_stats_slot(ws);
+        }
+    } stats_slot{this, acquire_stats_slot()};
+    detail::tls_worker_stats = stats_slot.ws;
+#endif
+
     // 线程启动时，认为自己一定是“空闲”的
     idle_threads_.fetch_add(1, std::memory_order_relaxed);
 
+    TaskQueue& local = *shards_[node];
+    // 有其它节点时不能一直睡在本节点的队列上：每隔 steal_interval_ 醒来去其它节点看一眼，
+    // 累计空闲满 idle_timeout_sec_ 才算真正超时
+    const bool can_steal = shards_.size() > 1;
+    const std::chrono::nanoseconds wait =
+        can_steal ? std::min<std::chrono::nanoseconds>(steal_interval_, idle_timeout_sec_)
+                  : std::chrono::nanoseconds(idle_timeout_sec_);
+    auto idle_since = std::chrono::steady_clock::now();
+
     // 对 idle_threads_ 的处理要小心，要确保该值不会泄漏
+    std::vector<TaskQueue::Task> batch;
     for (;;) {
-        TaskQueue::Task task;
-        TaskQueue::PopResult result = queue_.pop(task, idle_timeout_sec_);
+        TaskQueue::PopResult result = local.pop_bulk(batch, worker_batch_, wait);
+        // 本节点取不到任务时才跨节点窃取
+        if (result != TaskQueue::PopResult::OK && can_steal && try_steal(node, batch)) {
+            result = TaskQueue::PopResult::OK;
+        }
         if (result == TaskQueue::PopResult::STOPPED) {
             // ？
             idle_threads_.fetch_sub(1, std::memory_order_relaxed);
@@ -200,18 +675,33 @@ inline void ThreadPool::worker_loop() {
         }
         if (result == TaskQueue::PopResult::TIMEOUT) {
             // 如果是因为停机导致没有任务执行，关闭线程
-            if (stop_.load(std::memory_order_relaxed)) {
+            // 多节点时 wait 很短，本节点还有未到期的延时任务就继续等
+            if (stop_.load(std::memory_order_relaxed) && (!can_steal || local.size() == 0)) {
                 idle_threads_.fetch_sub(1, std::memory_order_relaxed);
                 return;
             }
+            if (can_steal && std::chrono::steady_clock::now() - idle_since < idle_timeout_sec_) {
+                continue;
+            }
+            idle_since = std::chrono::steady_clock::now();
+            // 打开 ScalingPolicy 时是否缩容由监督线程决定，这里只领取名额
+            if (scaling_.enabled) {
+                if (scale_down_idle(node)) return;
+                continue;
+            }
             // 否则: 我们认为线程数多于任务数，尝试缩容（裁掉非核心线程）
             // 这里我们的缩容策略比较简单：裁掉当前线程
+            // 多节点时每个节点至少保留一个 worker
             std::lock_guard<std::mutex> lock(thread_mutex_);
-            if (static_cast<int>(workers_.size()) > min_threads_) {
+            if (static_cast<int>(workers_.size()) > min_threads_ && node_workers_[node] > 1) {
                 auto my_id = std::this_thread::get_id();
                 auto it = workers_.find(my_id);
                 if (it != workers_.end()) {
                     idle_threads_.fetch_sub(1, std::memory_order_relaxed);
+                    node_workers_[node]--;
+#if THREAD_POOL_ENABLE_STATS
+                    threads_retired_.fetch_add(1, std::memory_order_relaxed);
+#endif
                     // 将需要裁掉的线程移至 dead_workers_，稍后由其它线程同一
                     // join （这里就能理解 dead_workers_
                     // 的意义了，它相当于一个缓冲区，缓冲需要 join 的线程，
@@ -227,14 +717,65 @@ inline void ThreadPool::worker_loop() {
         }
         // result == ok
         idle_threads_.fetch_sub(1, std::memory_order_relaxed);
-        if (task) task();
+#if THREAD_POOL_ENABLE_STATS
+        // 上一个任务的结束时间就是下一个任务的开始时间，每个任务只读一次时钟
+        std::int64_t t0 = detail::now_ns();
+        for (auto& task : batch) {
+            if (!task) continue;
+            detail::tls_task_start_ns = t0;
+            task();
+            std::int64_t t1 = detail::now_ns();
+            stats_slot.ws->exec_time.record(static_cast<std::uint64_t>(t1 - t0));
+            t0 = t1;
+        }
+#else
+        for (auto& task : batch) {
+            if (task) task();
+        }
+#endif
+        batch.clear();
         idle_threads_.fetch_add(1, std::memory_order_relaxed);
+        idle_since = std::chrono::steady_clock::now();
     }
 }
 
+inline bool ThreadPool::try_run_one() {
+    const int node = tls_pool_ == this ? tls_node_ : 0;
+    TaskQueue::Task task;
+    bool got = shards_[node]->pop(task, std::chrono::nanoseconds(0)) == TaskQueue::PopResult::OK;
+    for (size_t i = 0; !got && shards_.size() > 1 && i < steal_order_[node].size(); i++) {
+        got = shards_[steal_order_[node][i]]->pop(task, std::chrono::nanoseconds(0)) ==
+              TaskQueue::PopResult::OK;
+    }
+    if (!got || !task) return false;
+#if THREAD_POOL_ENABLE_STATS
+    // 嵌套在 worker 当前任务里执行，同样记入该 worker 的直方图
+    std::int64_t t0 = detail::now_ns();
+    detail::tls_task_start_ns = t0;
+    task();
+    if (WorkerStats* ws = detail::tls_worker_stats) {
+        ws->exec_time.record(static_cast<std::uint64_t>(detail::now_ns() - t0));
+    }
+#else
+    task();
+#endif
+    return true;
+}
+
 // 扩容策略：根据 pending / idle / active
 // 状态一次性创建所需线程，避免频繁创建销毁
 inline void ThreadPool::try_expand_workers() {
+    if (scaling_.enabled) {
+        // 扩容交给监督线程，提交线程上不创建线程也不拿 thread_mutex_
+        // 所有线程都忙时踢它一下，不用等到下一个采样周期（这里不加锁，偶尔丢一次也只是晚一个周期）
+        if (idle_threads_.load(std::memory_order_relaxed) == 0 &&
+            !supervisor_kick_.load(std::memory_order_relaxed) &&
+            !supervisor_kick_.exchange(true, std::memory_order_relaxed)) {
+            supervisor_cv_.notify_one();
+        }
+        return;
+    }
+
     // 顺便清理掉已经结束的线程
     clean_inactive_threads();
 
@@ -242,33 +783,229 @@ inline void ThreadPool::try_expand_workers() {
     if (stop_.load(std::memory_order_relaxed)) return;
 
     std::lock_guard<std::mutex> lock(thread_mutex_);
-    size_t pending = static_cast<size_t>(queue_.size());       // 总任务数
+    // 持锁再看一次：stop() 先置 stop_ 再在 thread_mutex_ 下收走所有线程，
+    // 如果在它收走之后才创建新线程，这个线程就不会被 join（析构时 std::terminate）
+    if (stop_.load(std::memory_order_relaxed)) return;
+    // 总任务数，后台任务不参与扩容
+    size_t total = 0, background = 0, critical = 0;
+    for (const TaskQueue* q : shards_) {
+        total += q->size();
+        background += q->pending(QoS::Background);
+        critical += q->pending(QoS::Critical);  // 延迟敏感任务的积压
+    }
+    size_t pending = total > background ? total - background : 0;
     int idle = idle_threads_.load(std::memory_order_relaxed);  // 空闲线程数
     size_t active = workers_.size();  // 活跃线程数
 
     // 扩容触发条件：
     //    - 当前活跃线程数 < max_threads_
     //    - pending 任务数 > idle 空闲线程数 + 一定阈值（这里是 1）
+    //      或者 Critical 任务数 > idle（不设阈值，延迟敏感任务一积压就扩容）
     //
     // 这样避免“刚有一点任务就频繁创建线程”的抖动
     const int threshold = 1;
+    bool critical_backlog = critical > static_cast<size_t>(idle);
     if (active < static_cast<size_t>(max_threads_) &&
-        pending > static_cast<size_t>(idle + threshold)) {
+        (critical_backlog || pending > static_cast<size_t>(idle + threshold))) {
         // 需要创建的线程数量 = pending - idle（每个空闲线程可以处理一个任务）
         // 最终创建的线程数不能超过 max_threads - active
         size_t threads_needed =
             std::min(pending - static_cast<size_t>(idle),
                      static_cast<size_t>(max_threads_) - active);
 
+#if THREAD_POOL_ENABLE_STATS
+        if (threads_needed > 0) grow_events_.fetch_add(1, std::memory_order_relaxed);
+#endif
         for (size_t i = 0; i < threads_needed; i++) {
-            std::thread t(&ThreadPool::worker_loop, this);
-            workers_.emplace(t.get_id(), std::move(t));
+            spawn_worker(pick_spawn_node());
         }
         // 注意：新线程启动后会在 worker_loop 的开头对 idle_threads ++
         //      这路无需手动调整 idle_threads_
     }
 }
 
+inline int ThreadPool::pick_spawn_node() const {
+    // 多节点时新线程放到“积压任务数 - worker 数”最大的节点上
+    int node = 0;
+    long best = 0;
+    for (size_t k = 0; shards_.size() > 1 && k < shards_.size(); k++) {
+        long deficit = static_cast<long>(shards_[k]->size()) - node_workers_[k];
+        if (k == 0 || deficit > best) {
+            node = static_cast<int>(k);
+            best = deficit;
+        }
+    }
+    return node;
+}
+
+inline void ThreadPool::supervisor_loop() {
+    std::unique_lock<std::mutex> lock(supervisor_mutex_);
+    while (!stop_.load(std::memory_order_relaxed)) {
+        supervisor_cv_.wait_for(lock, scaling_.interval, [this] {
+            return stop_.load(std::memory_order_relaxed) ||
+                   supervisor_kick_.load(std::memory_order_relaxed);
+        });
+        if (stop_.load(std::memory_order_relaxed)) break;
+        supervisor_kick_.store(false, std::memory_order_relaxed);
+        lock.unlock();
+        supervise_once();
+        lock.lock();
+    }
+}
+
+inline void ThreadPool::supervise_once() {
+    clean_inactive_threads();
+
+    ScalingSample s;
+    size_t total = 0, background = 0;
+    for (const TaskQueue* q : shards_) {
+        total += q->size();
+        background += q->pending(QoS::Background);
+        s.critical += q->pending(QoS::Critical);
+    }
+    s.backlog = total > background ? total - background : 0;
+    backlog_ewma_ = scaling_.ewma_alpha * static_cast<double>(s.backlog) +
+                    (1 - scaling_.ewma_alpha) * backlog_ewma_;
+    s.ewma = backlog_ewma_;
+    s.idle = idle_threads_.load(std::memory_order_relaxed);
+    s.min_threads = min_threads_;
+    s.max_threads = max_threads_;
+
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    s.parked = parked_;
+    s.serving = static_cast<int>(workers_.size()) - parked_;
+
+    int delta = scaling_.decide ? scaling_.decide(s) : default_scaling_decision(s);
+    if (delta <= 0) {
+        shrink_budget_.store(std::max(0, std::min(-delta, s.serving - min_threads_)),
+                             std::memory_order_relaxed);
+        return;
+    }
+    shrink_budget_.store(0, std::memory_order_relaxed);
+
+    int n = std::min(delta, scaling_.max_grow_per_tick);
+    // 优先唤醒停放的线程，不够再创建
+    int wake = std::min(n, parked_ - unpark_tokens_);
+    unpark_tokens_ += wake;
+    for (int i = 0; i < wake; i++) park_cv_.notify_one();
+    int spawn = std::min(n - wake, max_threads_ - static_cast<int>(workers_.size()));
+    for (int i = 0; i < spawn; i++) spawn_worker(pick_spawn_node());
+#if THREAD_POOL_ENABLE_STATS
+    if (wake + spawn > 0) grow_events_.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+inline int ThreadPool::default_scaling_decision(const ScalingSample& s) {
+    const int serving = std::max(s.serving, 1);
+    const double per_thread = s.ewma / serving;
+    // 需要的线程数：让每个线程的积压回到 grow_threshold 以下
+    const int wanted = static_cast<int>(s.ewma / std::max(scaling_.grow_threshold, 1e-9)) + 1;
+
+    // Critical 任务积压时不等 EWMA 慢慢涨上来
+    if (s.critical > static_cast<size_t>(s.idle)) {
+        low_ticks_ = 0;
+        return std::max(wanted - s.serving, static_cast<int>(s.critical) - s.idle);
+    }
+    if (per_thread > scaling_.grow_threshold) {
+        low_ticks_ = 0;
+        return std::max(wanted - s.serving, 1);
+    }
+    // 介于两个阈值之间：保持不变，这就是滞回区间
+    if (per_thread >= scaling_.shrink_threshold || s.idle == 0) {
+        low_ticks_ = 0;
+        return 0;
+    }
+    if (++low_ticks_ < scaling_.shrink_hold) return 0;
+    return -(s.serving - std::max(s.min_threads, wanted));
+}
+
+inline bool ThreadPool::scale_down_idle(int node) {
+    std::unique_lock<std::mutex> lock(thread_mutex_);
+    if (static_cast<int>(workers_.size()) - parked_ <= min_threads_ || node_workers_[node] <= 1) {
+        return false;
+    }
+    int budget = shrink_budget_.load(std::memory_order_relaxed);
+    do {
+        if (budget <= 0) return false;
+    } while (!shrink_budget_.compare_exchange_weak(budget, budget - 1, std::memory_order_relaxed));
+
+    if (parked_ < scaling_.parked_reserve) {
+        // 停放：不再从队列取任务，也不算空闲线程，等监督线程扩容时唤醒
+        idle_threads_.fetch_sub(1, std::memory_order_relaxed);
+        node_workers_[node]--;
+        parked_++;
+        park_cv_.wait(lock, [this] { return unpark_tokens_ > 0 || stop_.load(std::memory_order_relaxed); });
+        if (unpark_tokens_ > 0) unpark_tokens_--;
+        parked_--;
+        node_workers_[node]++;
+        idle_threads_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 停放的线程已经够多了，真正退出（与默认策略的缩容相同）
+    auto it = workers_.find(std::this_thread::get_id());
+    if (it == workers_.end()) return false;
+    idle_threads_.fetch_sub(1, std::memory_order_relaxed);
+    node_workers_[node]--;
+#if THREAD_POOL_ENABLE_STATS
+    threads_retired_.fetch_add(1, std::memory_order_relaxed);
+#endif
+    dead_workers_.push_back(std::move(it->second));
+    workers_.erase(it);
+    return true;
+}
+
+inline ThreadPoolStats ThreadPool::stats() {
+    ThreadPoolStats st;
+    st.active_threads = active_threads_count();
+    st.parked_threads = parked_threads_count();
+    st.pending = pending();
+#if THREAD_POOL_ENABLE_STATS
+    st.enabled = true;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        for (auto& ws : worker_stats_) {
+            ws->queue_wait.merge_into(st.queue_wait);
+            ws->exec_time.merge_into(st.exec_time);
+        }
+    }
+    st.grow_events = grow_events_.load(std::memory_order_relaxed);
+    st.threads_started = threads_started_.load(std::memory_order_relaxed);
+    st.threads_retired = threads_retired_.load(std::memory_order_relaxed);
+#endif
+    return st;
+}
+
+#if THREAD_POOL_ENABLE_STATS
+inline WorkerStats* ThreadPool::acquire_stats_slot() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (!free_stats_.empty()) {
+        WorkerStats* ws = free_stats_.back();
+        free_stats_.pop_back();
+        return ws;
+    }
+    worker_stats_.push_back(std::make_unique<WorkerStats>());
+    return worker_stats_.back().get();
+}
+
+inline void ThreadPool::release_stats_slot(WorkerStats* ws) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    free_stats_.push_back(ws);
+}
+#endif
+
+inline void ThreadPool::run_periodic(const std::shared_ptr<detail::PeriodicState>& state) {
+    if (state->cancelled()) return;
+    state->fn();
+    if (state->cancelled()) return;
+
+    auto now = std::chrono::steady_clock::now();
+    state->next_tm += state->interval;
+    if (state->next_tm < now) state->next_tm = now;
+    // Task 里只有 this 和一个 shared_ptr，放得进内联缓冲区；停机后 push_delay 直接丢弃
+    queue_.push_delay([this, state] { run_periodic(state); }, state->next_tm, state);
+}
+
 inline void ThreadPool::clean_inactive_threads() {
     // 将 dead_workers_ 中的线程移动到局部变量中，在不持有锁的环境下 join
     std::list<std::thread> local_dead;
@@ -0,0 +1,18 @@
+#include "heavy_templates.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+// 由 CMakeLists.txt 生成的 CONSUMER_TUS 个函数
+#define CONSUMER(i) int consumer_##i(demo::io::Reader &r);
+#include "consumer_list.inc"
+#undef CONSUMER
+
+int main() {
+    std::ofstream("consumer_input.txt") << 5;
+    long long sum = 0;
+#define CONSUMER(i) { auto r = demo::io::make_file_reader("consumer_input.txt"); sum += consumer_##i(*r); }
+#include "consumer_list.inc"
+#undef CONSUMER
+    std::printf("sum = %lld\n", sum);
+}
@@ -0,0 +1,16 @@
+#include "heavy_templates.hpp"
+
+// 显式实例化定义：不管 USE_EXTERN_TEMPLATES 是否打开都编进静态库，打开时其它翻译单元链接的就是这一份
+template class demo::algo::Pipeline<stages::AddN, stages::MulN, stages::AddN>;
+
+template void SafeQueue<Job>::push(Job &&);
+template bool SafeQueue<Job>::pop(Job &);
+template std::size_t SafeQueue<Job>::size() const;
+template void SafeQueue<Job>::stop();
+
+template void WorkStealingQueue<Job>::push(Job &&);
+template bool WorkStealingQueue<Job>::pop(Job &);
+template bool WorkStealingQueue<Job>::steal(Job &);
+
+template Task::Task(std::function<void()> &&);
+template auto make_future_task(std::function<int()> &&) -> std::pair<Task, std::future<int>>;
@@ -0,0 +1,51 @@
+#pragma once
+
+// 把上面 X1 / X2 的做法用到真正的重量级头文件上：
+// thread_pool/src 和 doxygen_demo/include 里的模板都是 header-only 的，每个用到它们的翻译单元都要各自实例化一遍，
+// 最后再由链接器丢掉重复的副本。这里挑出最常用的几个特化：
+//   - heavy_templates.cpp 里做一次显式实例化定义，编进 heavy_templates 静态库
+//   - 打开 USE_EXTERN_TEMPLATES（CMake 选项）时，包含本头文件的翻译单元只看到显式实例化声明（extern template），
+//     不再自己实例化，直接链接静态库里的那一份
+// 只可移动的 Task 不能整体显式实例化 SafeQueue<Task>（push(const T&) 需要拷贝），所以和 X1<int>::f1 一样按成员实例化
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <utility>
+
+#include "SafeQueue.hpp"
+#include "Task.hpp"
+#include "WorkStealingQueue.hpp"
+#include "algo/pipeline.hpp"
+#include "io/reader.hpp"
+
+// 有名字的阶段类型：lambda 的类型每个翻译单元都不一样，没法在别处预先实例化
+namespace stages {
+struct AddN {
+    int n;
+    int operator()(int x) const { return x + n; }
+};
+struct MulN {
+    int n;
+    int operator()(int x) const { return x * n; }
+};
+} // namespace stages
+
+using Job = Task;
+using StdPipeline = demo::algo::Pipeline<stages::AddN, stages::MulN, stages::AddN>;
+
+#ifdef USE_EXTERN_TEMPLATES
+extern template class demo::algo::Pipeline<stages::AddN, stages::MulN, stages::AddN>;
+
+extern template void SafeQueue<Job>::push(Job &&);
+extern template bool SafeQueue<Job>::pop(Job &);
+extern template std::size_t SafeQueue<Job>::size() const;
+extern template void SafeQueue<Job>::stop();
+
+extern template void WorkStealingQueue<Job>::push(Job &&);
+extern template bool WorkStealingQueue<Job>::pop(Job &);
+extern template bool WorkStealingQueue<Job>::steal(Job &);
+
+extern template Task::Task(std::function<void()> &&);
+extern template auto make_future_task(std::function<int()> &&) -> std::pair<Task, std::future<int>>;
+#endif